@@ -0,0 +1,70 @@
+// app/HeapTracker.cpp
+#include "HeapTracker.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<size_t> current{0};
+std::atomic<size_t> peak{0};
+
+// Keeps the returned pointer aligned for any fundamental type
+constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+
+void* allocate(size_t size) noexcept {
+    void* block = std::malloc(size + HEADER_SIZE);
+    if (!block) {
+        return nullptr;
+    }
+    *static_cast<size_t*>(block) = size;
+    size_t now = current.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t highest = peak.load(std::memory_order_relaxed);
+    while (now > highest && !peak.compare_exchange_weak(highest, now, std::memory_order_relaxed)) {
+    }
+    return static_cast<char*>(block) + HEADER_SIZE;
+}
+
+void* allocateOrThrow(size_t size) {
+    void* p = allocate(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void release(void* p) noexcept {
+    if (!p) {
+        return;
+    }
+    void* block = static_cast<char*>(p) - HEADER_SIZE;
+    current.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+} // anonymous namespace
+
+size_t HeapTracker::currentBytes() { return current.load(std::memory_order_relaxed); }
+
+size_t HeapTracker::peakBytes() { return peak.load(std::memory_order_relaxed); }
+
+size_t HeapTracker::resetPeak() {
+    size_t now = current.load(std::memory_order_relaxed);
+    peak.store(now, std::memory_order_relaxed);
+    return now;
+}
+
+// --- Replacement allocation functions ---
+
+void* operator new(size_t size) { return allocateOrThrow(size); }
+void* operator new[](size_t size) { return allocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p); }
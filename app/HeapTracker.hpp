@@ -0,0 +1,30 @@
+// app/HeapTracker.hpp
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Live and peak heap usage of the whole process.
+ *
+ * HeapTracker.cpp replaces the global operator new/delete of the program it
+ * is linked into, so only link it into measurement tools. Every allocation
+ * carries a small header holding its size; over-aligned allocations are not
+ * counted.
+ *
+ * @code
+ * size_t baseline = HeapTracker::resetPeak();
+ * auto packed = compressor.compress(data);
+ * size_t peakDuringCall = HeapTracker::peakBytes() - baseline;
+ * @endcode
+ */
+class HeapTracker {
+public:
+    // Bytes currently allocated through operator new
+    static size_t currentBytes();
+
+    // Highest currentBytes() since the last resetPeak()
+    static size_t peakBytes();
+
+    // Restarts peak tracking at the current level and returns that level
+    static size_t resetPeak();
+};
@@ -0,0 +1,126 @@
+// app/PerfCounters.cpp
+#include "PerfCounters.hpp"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+CounterSample& CounterSample::operator+=(const CounterSample& other) {
+    cycles += other.cycles;
+    instructions += other.instructions;
+    cacheMisses += other.cacheMisses;
+    branchMisses += other.branchMisses;
+    hasCacheMisses = hasCacheMisses || other.hasCacheMisses;
+    hasBranchMisses = hasBranchMisses || other.hasBranchMisses;
+    return *this;
+}
+
+#ifdef __linux__
+
+namespace {
+
+int openCounter(uint64_t config, int groupFd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = groupFd < 0 ? 1 : 0; // The group starts and stops with its leader
+    attr.exclude_kernel = 1;              // Allowed at perf_event_paranoid <= 2
+    attr.exclude_hv = 1;
+    attr.inherit = 1; // Count threads started later too, such as the shared pool's workers
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+} // anonymous namespace
+
+PerfCounters::PerfCounters() {
+    for (int& fd : fds_) {
+        fd = -1;
+    }
+    fds_[CYCLES] = openCounter(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (fds_[CYCLES] < 0) {
+        reason_ = std::string("perf_event_open failed: ") + std::strerror(errno);
+        return;
+    }
+    fds_[INSTRUCTIONS] = openCounter(PERF_COUNT_HW_INSTRUCTIONS, fds_[CYCLES]);
+    if (fds_[INSTRUCTIONS] < 0) {
+        // Cycles without instructions give no IPC; treat the PMU as unusable
+        reason_ = std::string("instruction counter unavailable: ") + std::strerror(errno);
+        close(fds_[CYCLES]);
+        fds_[CYCLES] = -1;
+        return;
+    }
+    // Optional: some virtual PMUs lack cache or branch events
+    fds_[CACHE_MISSES] = openCounter(PERF_COUNT_HW_CACHE_MISSES, fds_[CYCLES]);
+    fds_[BRANCH_MISSES] = openCounter(PERF_COUNT_HW_BRANCH_MISSES, fds_[CYCLES]);
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds_) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void PerfCounters::start() {
+    if (!available()) return;
+    ioctl(fds_[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds_[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+CounterSample PerfCounters::stop() {
+    CounterSample sample;
+    if (!available()) return sample;
+    ioctl(fds_[CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // Group read: nr, time enabled, time running, then one value per open counter
+    uint64_t buffer[3 + COUNTER_COUNT] = {};
+    if (read(fds_[CYCLES], buffer, sizeof(buffer)) < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+        return sample;
+    }
+    uint64_t enabled = buffer[1];
+    uint64_t running = buffer[2];
+    if (running == 0) {
+        return sample; // Never scheduled onto the PMU
+    }
+
+    uint64_t values[COUNTER_COUNT] = {};
+    size_t next = 0;
+    for (int counter = 0; counter < COUNTER_COUNT && next < buffer[0]; ++counter) {
+        if (fds_[counter] >= 0) {
+            // Extrapolate when the kernel multiplexed the group
+            values[counter] = static_cast<uint64_t>(buffer[3 + next++] * (static_cast<double>(enabled) / running));
+        }
+    }
+    sample.cycles = values[CYCLES];
+    sample.instructions = values[INSTRUCTIONS];
+    sample.cacheMisses = values[CACHE_MISSES];
+    sample.branchMisses = values[BRANCH_MISSES];
+    sample.hasCacheMisses = fds_[CACHE_MISSES] >= 0;
+    sample.hasBranchMisses = fds_[BRANCH_MISSES] >= 0;
+    return sample;
+}
+
+#else
+
+PerfCounters::PerfCounters() : reason_("hardware counters need Linux perf_event_open") {
+    for (int& fd : fds_) {
+        fd = -1;
+    }
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::start() {}
+
+CounterSample PerfCounters::stop() { return {}; }
+
+#endif
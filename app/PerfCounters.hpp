@@ -0,0 +1,63 @@
+// app/PerfCounters.hpp
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Hardware counter deltas for one measured region.
+ *
+ * Values are scaled for multiplexing when the kernel could not keep every
+ * counter on the PMU for the whole region. A counter the CPU or kernel does
+ * not provide stays at zero with its flag cleared.
+ */
+struct CounterSample {
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cacheMisses = 0;
+    uint64_t branchMisses = 0;
+    bool hasCacheMisses = false;
+    bool hasBranchMisses = false;
+
+    CounterSample& operator+=(const CounterSample& other);
+};
+
+/**
+ * @brief User-space cycle, instruction, cache-miss and branch-miss counters
+ * read through Linux perf_event_open.
+ *
+ * Counters are opened once as a group for the calling thread and are
+ * inherited by the threads it starts afterwards, so the workers of a
+ * parallel compressor are counted as long as the pool is created after the
+ * counters (the shared pool starts on first use). When counters are
+ * unavailable (non-Linux build, no PMU in a VM, perf_event_paranoid too
+ * strict, seccomp) available() is false, reason() says why, and start()/stop()
+ * return empty samples so callers need no special path.
+ *
+ * @code
+ * PerfCounters counters;
+ * counters.start();
+ * auto packed = compressor.compress(data);
+ * CounterSample sample = counters.stop();
+ * @endcode
+ */
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return fds_[CYCLES] >= 0; }
+    const std::string& reason() const { return reason_; }
+
+    void start();
+    CounterSample stop();
+
+private:
+    enum Counter { CYCLES, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES, COUNTER_COUNT };
+
+    int fds_[COUNTER_COUNT];
+    std::string reason_;
+};
@@ -6,23 +6,113 @@
 #include <chrono>
 #include <memory>
 #include <iomanip>
-#include <numeric> // std::accumulate (potentially needed later)
+#include <algorithm>
 #include <filesystem> // Requires C++17
-#include <sstream> // Include for stringstream
+#include <sstream>
+#include <stdexcept>
 
-// Include all compressor headers
 #include <compression/ICompressor.hpp>
-#include <compression/NullCompressor.hpp>
-#include <compression/RleCompressor.hpp>
-#include <compression/HuffmanCompressor.hpp>
+#include <compression/CompressionContext.hpp>
+#include <compression/CompressorFactory.hpp>
 #include <compression/Lz77Compressor.hpp>
-#include <compression/DeflateCompressor.hpp>
-#include <compression/BwtCompressor.hpp>
+#include <compression/AutoCompressor.hpp>
+#include <compression/CorpusGenerator.hpp>
+
+#include "HeapTracker.hpp"
+#include "PerfCounters.hpp"
+
+#ifndef BENCHMARK_DATA_DIR
+    #error "BENCHMARK_DATA_DIR is not defined. Check app/CMakeLists.txt"
+#endif
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// --- Configuration ---
+
+struct Options {
+    fs::path corpusDir = BENCHMARK_DATA_DIR;
+    bool corpusDirGiven = false;
+    uint64_t syntheticSize = 0; // Bytes per generated kind; 0 reads the corpus directory
+    uint64_t seed = compression::utils::CorpusGenerator::DEFAULT_SEED;
+    int warmups = 1;
+    int repetitions = 5;
+    bool counters = false; // Read hardware counters around timed runs
+    std::vector<std::string> algorithms = {"null", "rle", "huffman", "lz77", "lzh", "bwt", "bwt:cm", "cm", "ppm", "dedup", "auto"};
+    std::vector<int> levels = {1, compression::Lz77Compressor::DEFAULT_LEVEL, 9}; // lz77, lzh and auto
+    fs::path csvPath;
+    fs::path jsonPath;
+    fs::path markdownPath = fs::path(BENCHMARK_DATA_DIR) / "../BENCHMARKS.md";
+};
+
+// One algorithm at one level; level 0 means the algorithm has no levels
+struct Variant {
+    std::string algorithm;
+    int level = 0;
+
+    std::string label() const {
+        return level == 0 ? algorithm : algorithm + " -" + std::to_string(level);
+    }
+};
+
+struct CorpusFile {
+    std::string category; // First directory below the corpus root, or the file stem
+    std::string name;     // Path relative to the corpus root
+    std::vector<uint8_t> data;
+};
+
+// Throughput at the median and at the 95th-percentile (slow tail) run time
+struct Throughput {
+    double medianMBps = 0.0;
+    double p95MBps = 0.0;
+};
+
+// Hardware counter rates per uncompressed byte, in one direction
+struct CounterSummary {
+    bool valid = false;
+    double cyclesPerByte = 0.0;
+    double ipc = 0.0;               // Instructions per cycle
+    double cacheMissesPerKiB = -1.0; // -1 if the counter is unavailable
+    double branchMissesPerKiB = -1.0;
+};
+
+struct BenchmarkResult {
+    std::string category;
+    std::string file;
+    Variant variant;
+    size_t originalSize = 0;
+    size_t compressedSize = 0;
+    double ratio = 0.0; // Compressed size / original size
+    Throughput compress;
+    Throughput decompress;
+    double compressMedianSeconds = 0.0;
+    double decompressMedianSeconds = 0.0;
+    size_t compressPeakHeap = 0;      // Heap high-water mark of one compress() call
+    size_t decompressPeakHeap = 0;
+    size_t workingSetEstimate = 0;    // ICompressor::workingSetSize() for this input
+    CounterSample compressCounters;   // Summed over the timed runs; empty without --counters
+    CounterSample decompressCounters;
+    uint64_t countedBytes = 0;        // Uncompressed bytes processed while counting
+    std::string error; // Empty if the round trip was exact
+};
 
 // --- Helper Functions ---
 
+void printUsage(const char* appName) {
+    std::cerr << "Usage: " << appName << " [corpus_dir | --generate <size>[K|M|G] [--seed <n>]]\n"
+              << "       [--warmup <n>] [--reps <n>]\n"
+              << "       [--algorithms <a,b,...>] [--levels <l,l,...>]\n"
+              << "       [--csv <file>] [--json <file>] [--markdown <file>] [--counters]\n"
+              << "Every file below corpus_dir is benchmarked; its first directory (e.g. text/,\n"
+              << "binary/, logs/, json/, incompressible/, redundant/) names its category.\n"
+              << "--generate benchmarks built-in synthetic data of each kind instead; it is also\n"
+              << "used (1M per kind) when the default corpus " << BENCHMARK_DATA_DIR << " is missing.\n"
+              << "--counters adds cycles/byte, IPC and cache/branch misses per KiB from Linux\n"
+              << "perf_event_open; it is skipped with a warning where counters are unavailable.\n";
+}
+
 // Reads a whole file into a byte vector
-std::vector<uint8_t> readFile(const std::filesystem::path& filePath) {
+std::vector<uint8_t> readFile(const fs::path& filePath) {
     std::ifstream file(filePath, std::ios::binary | std::ios::ate);
     if (!file) {
         throw std::runtime_error("Cannot open file: " + filePath.string());
@@ -30,203 +120,606 @@ std::vector<uint8_t> readFile(const std::filesystem::path& filePath) {
     std::streamsize size = file.tellg();
     file.seekg(0, std::ios::beg);
     std::vector<uint8_t> buffer(size);
-    if (!file.read(reinterpret_cast<char*>(buffer.data()), size)) {
-         throw std::runtime_error("Error reading file: " + filePath.string());
+    if (size > 0 && !file.read(reinterpret_cast<char*>(buffer.data()), size)) {
+        throw std::runtime_error("Error reading file: " + filePath.string());
     }
     return buffer;
 }
 
-// Structure to hold benchmark results for one algorithm
-struct BenchmarkResult {
-    std::string algorithmName;
-    size_t originalSize = 0;
-    size_t compressedSize = 0;
-    double compressionTimeMs = 0.0;
-    double decompressionTimeMs = 0.0;
-    double ratio = 0.0;
-};
+// Parses a byte count with an optional K, M or G (binary) suffix
+uint64_t parseSize(const std::string& text) {
+    size_t consumed = 0;
+    uint64_t value = std::stoull(text, &consumed);
+    std::string suffix = text.substr(consumed);
+    if (suffix == "K" || suffix == "k") return value << 10;
+    if (suffix == "M" || suffix == "m") return value << 20;
+    if (suffix == "G" || suffix == "g") return value << 30;
+    if (!suffix.empty()) {
+        throw std::invalid_argument("Invalid size: " + text);
+    }
+    return value;
+}
 
-// Runs compress/decompress and times them
-BenchmarkResult runBenchmark(
-    const std::string& name,
-    const compression::ICompressor& compressor,
-    const std::vector<uint8_t>& originalData)
-{
-    BenchmarkResult result;
-    result.algorithmName = name;
-    result.originalSize = originalData.size();
-
-    if (originalData.empty()) {
-        return result; // Avoid division by zero and unnecessary work
-    }
-
-    // --- Time Compression ---
-    auto startCompress = std::chrono::high_resolution_clock::now();
-    std::vector<uint8_t> compressedData = compressor.compress(originalData);
-    auto endCompress = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> compressDuration = endCompress - startCompress;
-    result.compressionTimeMs = compressDuration.count();
-    result.compressedSize = compressedData.size();
-
-    // --- Time Decompression ---
-    std::vector<uint8_t> decompressedData;
-    double decompressDurationMs = 0.0;
-     if (!compressedData.empty()) { // Avoid decompressing nothing if compression failed/returned empty
-        try {
-            auto startDecompress = std::chrono::high_resolution_clock::now();
-            decompressedData = compressor.decompress(compressedData);
-            auto endDecompress = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double, std::milli> decompressDuration = endDecompress - startDecompress;
-            decompressDurationMs = decompressDuration.count();
-
-            // Trim any trailing null terminators from decompressed data before comparison
-            while (!decompressedData.empty() && decompressedData.back() == 0) {
-                decompressedData.pop_back();
-            }
-            
-            // If original data might have trailing nulls too, extract those as well for fair comparison
-            std::vector<uint8_t> originalDataForComparison = originalData;
-            while (!originalDataForComparison.empty() && originalDataForComparison.back() == 0) {
-                originalDataForComparison.pop_back();
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+Options parseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            options.corpusDir = arg;
+            options.corpusDirGiven = true;
+            continue;
+        }
+        if (arg == "--counters") {
+            options.counters = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--generate") {
+            options.syntheticSize = parseSize(value);
+        } else if (arg == "--seed") {
+            options.seed = std::stoull(value);
+        } else if (arg == "--warmup") {
+            options.warmups = std::stoi(value);
+        } else if (arg == "--reps") {
+            options.repetitions = std::stoi(value);
+        } else if (arg == "--algorithms") {
+            options.algorithms = splitList(value);
+        } else if (arg == "--levels") {
+            options.levels.clear();
+            for (const auto& level : splitList(value)) {
+                options.levels.push_back(std::stoi(level));
             }
+        } else if (arg == "--csv") {
+            options.csvPath = value;
+        } else if (arg == "--json") {
+            options.jsonPath = value;
+        } else if (arg == "--markdown") {
+            options.markdownPath = value;
+        } else {
+            throw std::invalid_argument("Unknown option: " + arg);
+        }
+    }
+    if (options.warmups < 0 || options.repetitions < 1) {
+        throw std::invalid_argument("Need --warmup >= 0 and --reps >= 1");
+    }
+    if (options.algorithms.empty() || options.levels.empty()) {
+        throw std::invalid_argument("Algorithm and level lists must not be empty");
+    }
+    if (options.syntheticSize > 0 && options.corpusDirGiven) {
+        throw std::invalid_argument("Give either a corpus directory or --generate, not both");
+    }
+    if (options.syntheticSize == 0 && !options.corpusDirGiven && !fs::is_directory(options.corpusDir)) {
+        options.syntheticSize = 1 << 20;
+    }
+    return options;
+}
 
-            // Sanity check decompression
-            if (decompressedData != originalDataForComparison) {
-                // For LZ77 and BWT, some mismatch might occur due to the nature of the algorithm
-                // and data structures, so we silence this warning for those algorithms
-                if (name != "LZ77" && name != "BWT") {
-                    std::cerr << "WARNING: Decompression mismatch for " << name << "!" << std::endl;
-                }
+// Loads every non-empty regular file below the corpus root, in path order
+std::vector<CorpusFile> loadCorpus(const fs::path& root) {
+    if (!fs::is_directory(root)) {
+        throw std::runtime_error("Corpus directory not found: " + root.string());
+    }
+    std::vector<fs::path> paths;
+    for (const auto& entry : fs::recursive_directory_iterator(root)) {
+        if (entry.is_regular_file()) {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<CorpusFile> corpus;
+    for (const auto& path : paths) {
+        CorpusFile file;
+        fs::path relative = fs::relative(path, root);
+        file.name = relative.generic_string();
+        file.category = std::distance(relative.begin(), relative.end()) > 1
+                            ? relative.begin()->string()
+                            : relative.stem().string();
+        file.data = readFile(path);
+        if (file.data.empty()) {
+            std::cerr << "Skipping empty file " << file.name << std::endl;
+            continue;
+        }
+        corpus.push_back(std::move(file));
+    }
+    if (corpus.empty()) {
+        throw std::runtime_error("No benchmark data found in " + root.string());
+    }
+    return corpus;
+}
+
+// One in-memory file per synthetic kind, reproducible from the seed
+std::vector<CorpusFile> generateCorpus(uint64_t size, uint64_t seed) {
+    compression::utils::CorpusGenerator generator(seed);
+    std::vector<CorpusFile> corpus;
+    for (auto kind : compression::utils::allCorpusKinds()) {
+        CorpusFile file;
+        file.category = compression::utils::corpusKindToString(kind);
+        file.name = "synthetic/" + file.category;
+        file.data = generator.generate(kind, static_cast<size_t>(size));
+        corpus.push_back(std::move(file));
+    }
+    return corpus;
+}
+
+std::string corpusDescription(const Options& options) {
+    if (options.syntheticSize > 0) {
+        return "synthetic corpus (" + std::to_string(options.syntheticSize) + " bytes per kind, seed " +
+               std::to_string(options.seed) + ")";
+    }
+    return options.corpusDir.generic_string();
+}
+
+std::vector<Variant> expandVariants(const Options& options) {
+    std::vector<Variant> variants;
+    for (const auto& algorithm : options.algorithms) {
+        if (algorithm == "lz77" || algorithm == "lzh" || algorithm == "auto") {
+            for (int level : options.levels) {
+                variants.push_back({algorithm, level});
             }
-        } catch (const std::exception& e) {
-            std::cerr << "ERROR: Decompression failed for " << name << ": " << e.what() << std::endl;
-             // Indicate failure, e.g., set time to infinity or NaN
-             decompressDurationMs = std::numeric_limits<double>::infinity();
+        } else {
+            variants.push_back({algorithm, 0});
         }
-     } else if (result.originalSize > 0) {
-         // If original was not empty but compressed is, decompression is trivial (and likely instant)
-         // but might indicate an issue or edge case in compress.
-         decompressDurationMs = 0.0; // Or leave as 0?
-     }
-    result.decompressionTimeMs = decompressDurationMs;
+    }
+    return variants;
+}
+
+std::unique_ptr<compression::ICompressor> createVariant(const Variant& variant) {
+    auto compressor = compression::createCompressor(variant.algorithm);
+    if (variant.level != 0) {
+        if (auto* lz77 = dynamic_cast<compression::Lz77Compressor*>(compressor.get())) {
+            lz77->setLevel(variant.level);
+        } else if (auto* automatic = dynamic_cast<compression::AutoCompressor*>(compressor.get())) {
+            automatic->setLevel(variant.level);
+        } else {
+            throw std::invalid_argument("Levels are only supported by lz77, lzh and auto");
+        }
+    }
+    return compressor;
+}
 
+// Nearest-rank percentile of a sample set (0 < percent <= 100)
+double percentile(std::vector<double> samples, double percent) {
+    std::sort(samples.begin(), samples.end());
+    size_t rank = static_cast<size_t>(percent / 100.0 * samples.size() + 0.999999);
+    return samples[std::min(std::max<size_t>(rank, 1), samples.size()) - 1];
+}
 
-    // --- Calculate Ratio ---
-    if (result.originalSize > 0) {
-        result.ratio = static_cast<double>(result.compressedSize) / result.originalSize;
+CounterSummary summarizeCounters(const CounterSample& total, uint64_t bytes) {
+    CounterSummary summary;
+    if (total.cycles == 0 || bytes == 0) {
+        return summary;
+    }
+    summary.valid = true;
+    summary.cyclesPerByte = static_cast<double>(total.cycles) / bytes;
+    summary.ipc = static_cast<double>(total.instructions) / total.cycles;
+    if (total.hasCacheMisses) {
+        summary.cacheMissesPerKiB = total.cacheMisses * 1024.0 / bytes;
+    }
+    if (total.hasBranchMisses) {
+        summary.branchMissesPerKiB = total.branchMisses * 1024.0 / bytes;
     }
+    return summary;
+}
+
+Throughput summarize(const std::vector<double>& seconds, size_t bytes) {
+    // The 95th-percentile time is the slow tail: 95% of runs were at least this fast
+    const double megabytes = bytes / 1e6;
+    return {megabytes / std::max(percentile(seconds, 50.0), 1e-12),
+            megabytes / std::max(percentile(seconds, 95.0), 1e-12)};
+}
 
+// Runs warmups and timed repetitions; any round-trip difference is reported, never masked.
+// Counters, if given, are read around each timed compress and decompress call.
+BenchmarkResult runBenchmark(const CorpusFile& file, const Variant& variant, const Options& options,
+                             PerfCounters* counters) {
+    BenchmarkResult result;
+    result.category = file.category;
+    result.file = file.name;
+    result.variant = variant;
+    result.originalSize = file.data.size();
+
+    try {
+        auto compressor = createVariant(variant);
+        compression::CompressionContext context(compressor->scratchSize(file.data.size()));
+
+        std::vector<uint8_t> compressed = compressor->compress(file.data, context);
+        result.compressedSize = compressed.size();
+        result.ratio = static_cast<double>(result.compressedSize) / result.originalSize;
+        std::vector<uint8_t> decompressed = compressor->decompress(compressed, context);
+        if (decompressed != file.data) {
+            result.error = "round-trip mismatch (" + std::to_string(decompressed.size()) + " of " +
+                           std::to_string(file.data.size()) + " bytes)";
+            return result;
+        }
+
+        // Peak heap of standalone calls, which allocate their own scratch memory
+        result.workingSetEstimate = compressor->workingSetSize(file.data.size());
+        {
+            size_t baseline = HeapTracker::resetPeak();
+            auto output = compressor->compress(file.data);
+            result.compressPeakHeap = HeapTracker::peakBytes() - baseline;
+        }
+        {
+            size_t baseline = HeapTracker::resetPeak();
+            auto output = compressor->decompress(compressed);
+            result.decompressPeakHeap = HeapTracker::peakBytes() - baseline;
+        }
+
+        for (int i = 0; i < options.warmups; ++i) {
+            compressed = compressor->compress(file.data, context);
+            decompressed = compressor->decompress(compressed, context);
+        }
+
+        std::vector<double> compressSeconds;
+        std::vector<double> decompressSeconds;
+        for (int i = 0; i < options.repetitions; ++i) {
+            // Clocks are read inside the counting window, so the perf
+            // syscalls do not count toward the measured time
+            if (counters) counters->start();
+            auto start = Clock::now();
+            compressed = compressor->compress(file.data, context);
+            auto end = Clock::now();
+            if (counters) result.compressCounters += counters->stop();
+            compressSeconds.push_back(std::chrono::duration<double>(end - start).count());
+
+            if (counters) counters->start();
+            start = Clock::now();
+            decompressed = compressor->decompress(compressed, context);
+            end = Clock::now();
+            if (counters) result.decompressCounters += counters->stop();
+            decompressSeconds.push_back(std::chrono::duration<double>(end - start).count());
+            if (compressed.size() != result.compressedSize || decompressed.size() != file.data.size()) {
+                result.error = "output changed between repetitions";
+                return result;
+            }
+        }
+        result.compress = summarize(compressSeconds, file.data.size());
+        result.decompress = summarize(decompressSeconds, file.data.size());
+        result.compressMedianSeconds = percentile(compressSeconds, 50.0);
+        result.decompressMedianSeconds = percentile(decompressSeconds, 50.0);
+        if (counters) {
+            result.countedBytes = static_cast<uint64_t>(file.data.size()) * options.repetitions;
+        }
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    }
     return result;
 }
 
-// --- Main Function ---
+// --- Report Writers ---
+
+std::string jsonEscape(const std::string& text) {
+    std::ostringstream out;
+    for (char c : text) {
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c)
+                        << std::dec << std::setfill(' ');
+                } else {
+                    out << c;
+                }
+        }
+    }
+    return out.str();
+}
 
-int main() {
-    // --- Get Data File Path using Compile Definition ---
-#ifndef BENCHMARK_DATA_DIR
-    #error "BENCHMARK_DATA_DIR is not defined. Check app/CMakeLists.txt"
-#endif
-    // Use the macro directly as it expands to a C string literal
-    std::filesystem::path dataDir = BENCHMARK_DATA_DIR;
-    std::filesystem::path dataFilePath = dataDir / "test.txt";
+std::string csvField(const std::string& text) {
+    if (text.find_first_of(",\"\n") == std::string::npos) {
+        return text;
+    }
+    std::string quoted = "\"";
+    for (char c : text) {
+        quoted += c;
+        if (c == '"') quoted += '"';
+    }
+    return quoted + "\"";
+}
+
+// cycles/byte, IPC, cache and branch misses per KiB; blank where not measured
+std::string csvCounters(const CounterSummary& summary) {
+    if (!summary.valid) {
+        return ",,,";
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4) << summary.cyclesPerByte << ',' << summary.ipc << ',';
+    if (summary.cacheMissesPerKiB >= 0) out << summary.cacheMissesPerKiB;
+    out << ',';
+    if (summary.branchMissesPerKiB >= 0) out << summary.branchMissesPerKiB;
+    return out.str();
+}
+
+std::string jsonCounters(const CounterSummary& summary) {
+    if (!summary.valid) {
+        return "null";
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4) << "{\"cycles_per_byte\": " << summary.cyclesPerByte
+        << ", \"ipc\": " << summary.ipc << ", \"cache_misses_per_kib\": ";
+    if (summary.cacheMissesPerKiB >= 0) out << summary.cacheMissesPerKiB; else out << "null";
+    out << ", \"branch_misses_per_kib\": ";
+    if (summary.branchMissesPerKiB >= 0) out << summary.branchMissesPerKiB; else out << "null";
+    out << "}";
+    return out.str();
+}
+
+void writeCsv(const fs::path& path, const std::vector<BenchmarkResult>& results) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Cannot write " + path.string());
+    }
+    out << "category,file,algorithm,level,original_bytes,compressed_bytes,ratio,"
+           "compress_median_mbps,compress_p95_mbps,decompress_median_mbps,decompress_p95_mbps,"
+           "compress_cycles_per_byte,compress_ipc,compress_cache_misses_per_kib,compress_branch_misses_per_kib,"
+           "decompress_cycles_per_byte,decompress_ipc,decompress_cache_misses_per_kib,"
+           "decompress_branch_misses_per_kib,compress_peak_heap_bytes,decompress_peak_heap_bytes,"
+           "working_set_estimate_bytes,status\n";
+    out << std::fixed << std::setprecision(4);
+    for (const auto& r : results) {
+        out << csvField(r.category) << ',' << csvField(r.file) << ',' << r.variant.algorithm << ','
+            << (r.variant.level ? std::to_string(r.variant.level) : "") << ','
+            << r.originalSize << ',' << r.compressedSize << ',' << r.ratio << ','
+            << r.compress.medianMBps << ',' << r.compress.p95MBps << ','
+            << r.decompress.medianMBps << ',' << r.decompress.p95MBps << ','
+            << csvCounters(summarizeCounters(r.compressCounters, r.countedBytes)) << ','
+            << csvCounters(summarizeCounters(r.decompressCounters, r.countedBytes)) << ','
+            << r.compressPeakHeap << ',' << r.decompressPeakHeap << ',' << r.workingSetEstimate << ','
+            << csvField(r.error.empty() ? "ok" : r.error) << '\n';
+    }
+}
 
-    // Check if the constructed path exists
-    if (!std::filesystem::exists(dataFilePath)) {
-         std::cerr << "Error: Benchmark data file not found at expected location: " << dataFilePath << std::endl;
-         std::cerr << "(Derived from BENCHMARK_DATA_DIR macro: " << BENCHMARK_DATA_DIR << ")" << std::endl;
-         return 1;
+void writeJson(const fs::path& path, const Options& options, const std::vector<BenchmarkResult>& results) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Cannot write " + path.string());
+    }
+    out << std::fixed << std::setprecision(4);
+    out << "{\n  \"corpus\": \"" << jsonEscape(corpusDescription(options)) << "\",\n"
+        << "  \"warmups\": " << options.warmups << ",\n"
+        << "  \"repetitions\": " << options.repetitions << ",\n"
+        << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << "    {\"category\": \"" << jsonEscape(r.category) << "\", \"file\": \"" << jsonEscape(r.file)
+            << "\", \"algorithm\": \"" << r.variant.algorithm << "\", \"level\": ";
+        if (r.variant.level) out << r.variant.level; else out << "null";
+        out << ", \"original_bytes\": " << r.originalSize << ", \"compressed_bytes\": " << r.compressedSize
+            << ", \"ratio\": " << r.ratio
+            << ", \"compress_mbps\": {\"median\": " << r.compress.medianMBps << ", \"p95\": " << r.compress.p95MBps
+            << "}, \"decompress_mbps\": {\"median\": " << r.decompress.medianMBps << ", \"p95\": "
+            << r.decompress.p95MBps << "}, \"compress_counters\": "
+            << jsonCounters(summarizeCounters(r.compressCounters, r.countedBytes))
+            << ", \"decompress_counters\": "
+            << jsonCounters(summarizeCounters(r.decompressCounters, r.countedBytes))
+            << ", \"peak_heap_bytes\": {\"compress\": " << r.compressPeakHeap << ", \"decompress\": "
+            << r.decompressPeakHeap << "}, \"working_set_estimate_bytes\": " << r.workingSetEstimate
+            << ", \"error\": ";
+        if (r.error.empty()) out << "null"; else out << '"' << jsonEscape(r.error) << '"';
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+std::string markdownReport(const Options& options, const std::vector<CorpusFile>& corpus,
+                           const std::vector<Variant>& variants, const std::vector<BenchmarkResult>& results) {
+    size_t totalBytes = 0;
+    for (const auto& file : corpus) {
+        totalBytes += file.data.size();
+    }
+
+    std::ostringstream md;
+    md << std::fixed;
+    md << "# Compression Benchmark Results\n\n"
+       << "Corpus: " << corpusDescription(options) << ", " << corpus.size() << " files, " << totalBytes << " bytes. "
+       << options.warmups << " warmup and " << options.repetitions
+       << " timed runs per file; speeds are MB/s (10^6 bytes) of uncompressed data at the median "
+       << "and at the 95th-percentile run time. Ratio is compressed / original size.\n\n";
+
+    // Overall: sizes summed over the corpus, speed from summed median times
+    md << "## All files\n\n"
+       << "| Algorithm | Ratio (%) | Compress MB/s | Decompress MB/s | Failures |\n"
+       << "|-----------|-----------|---------------|-----------------|----------|\n";
+    for (const auto& variant : variants) {
+        size_t original = 0, compressed = 0, failures = 0;
+        double compressSeconds = 0.0, decompressSeconds = 0.0;
+        for (const auto& r : results) {
+            if (r.variant.label() != variant.label()) continue;
+            if (!r.error.empty()) {
+                failures++;
+                continue;
+            }
+            original += r.originalSize;
+            compressed += r.compressedSize;
+            compressSeconds += r.compressMedianSeconds;
+            decompressSeconds += r.decompressMedianSeconds;
+        }
+        md << "| " << variant.label() << " | " << std::setprecision(2)
+           << (original ? 100.0 * compressed / original : 0.0) << " | "
+           << (compressSeconds > 0 ? original / 1e6 / compressSeconds : 0.0) << " | "
+           << (decompressSeconds > 0 ? original / 1e6 / decompressSeconds : 0.0) << " | "
+           << failures << " |\n";
     }
 
-    // Determine the path for the output MD file (relative to source dir)
-    // Use the compile-time path directly here too
-    std::filesystem::path benchmarkMdPath = std::filesystem::path(BENCHMARK_DATA_DIR) / "../BENCHMARKS.md"; 
+    // Largest standalone-call peak over the corpus next to the library's estimate for that file
+    md << "\n## Memory\n\n"
+       << "Peak heap (MiB) of one compress or decompress call without a reusable context, the largest "
+       << "over all files, and ICompressor::workingSetSize() for the file that reached it.\n\n"
+       << "| Algorithm | Compress peak | Decompress peak | Estimate |\n"
+       << "|-----------|---------------|-----------------|----------|\n";
+    for (const auto& variant : variants) {
+        const BenchmarkResult* worst = nullptr;
+        size_t decompressPeak = 0;
+        for (const auto& r : results) {
+            if (r.variant.label() != variant.label() || !r.error.empty()) continue;
+            if (!worst || r.compressPeakHeap > worst->compressPeakHeap) worst = &r;
+            decompressPeak = std::max(decompressPeak, r.decompressPeakHeap);
+        }
+        if (!worst) continue;
+        const double mebibyte = 1024.0 * 1024.0;
+        md << "| " << variant.label() << " | " << std::setprecision(2) << worst->compressPeakHeap / mebibyte
+           << " | " << decompressPeak / mebibyte << " | " << worst->workingSetEstimate / mebibyte << " |\n";
+    }
 
-    // --- Rest of main function --- 
-    std::cout << "Starting benchmark using file: " << dataFilePath << std::endl;
+    // Counter totals over the corpus, only when --counters measured something
+    std::ostringstream countersTable;
+    bool anyCounters = false;
+    for (const auto& variant : variants) {
+        CounterSample compressTotal, decompressTotal;
+        uint64_t bytes = 0;
+        for (const auto& r : results) {
+            if (r.variant.label() != variant.label() || !r.error.empty()) continue;
+            compressTotal += r.compressCounters;
+            decompressTotal += r.decompressCounters;
+            bytes += r.countedBytes;
+        }
+        CounterSummary c = summarizeCounters(compressTotal, bytes);
+        CounterSummary d = summarizeCounters(decompressTotal, bytes);
+        if (!c.valid && !d.valid) continue;
+        anyCounters = true;
+        auto misses = [](double perKiB) {
+            if (perKiB < 0) return std::string("n/a");
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(2) << perKiB;
+            return out.str();
+        };
+        countersTable << "| " << variant.label() << " | " << std::setprecision(2) << c.cyclesPerByte << " | "
+                      << c.ipc << " | " << misses(c.cacheMissesPerKiB) << " | " << misses(c.branchMissesPerKiB)
+                      << " | " << d.cyclesPerByte << " | " << d.ipc << " | " << misses(d.cacheMissesPerKiB)
+                      << " | " << misses(d.branchMissesPerKiB) << " |\n";
+    }
+    if (anyCounters) {
+        md << "\n## Hardware counters\n\n"
+           << "User-space counts over all timed runs and all threads, per uncompressed byte (misses per KiB).\n\n"
+           << "| Algorithm | C cycles/B | C IPC | C cache miss/KiB | C branch miss/KiB "
+              "| D cycles/B | D IPC | D cache miss/KiB | D branch miss/KiB |\n"
+           << "|-----------|------------|-------|------------------|-------------------"
+              "|------------|-------|------------------|-------------------|\n"
+           << countersTable.str();
+    }
+
+    md << "\n## Per file\n\n"
+       << "| Category | File | Algorithm | Size (bytes) | Ratio (%) | Compress MB/s (median / p95) "
+          "| Decompress MB/s (median / p95) |\n"
+       << "|----------|------|-----------|--------------|-----------|------------------------------"
+          "|--------------------------------|\n";
+    for (const auto& r : results) {
+        md << "| " << r.category << " | " << r.file << " | " << r.variant.label() << " | ";
+        if (!r.error.empty()) {
+            md << r.originalSize << " | FAILED: " << r.error << " | | |\n";
+            continue;
+        }
+        md << r.compressedSize << " | " << std::setprecision(2) << 100.0 * r.ratio << " | "
+           << r.compress.medianMBps << " / " << r.compress.p95MBps << " | "
+           << r.decompress.medianMBps << " / " << r.decompress.p95MBps << " |\n";
+    }
+    return md.str();
+}
+
+// --- Main Function ---
 
-    std::vector<uint8_t> originalData;
+int main(int argc, char* argv[]) {
+    Options options;
+    std::vector<CorpusFile> corpus;
     try {
-        originalData = readFile(dataFilePath);
+        options = parseOptions(argc, argv);
+        corpus = options.syntheticSize > 0 ? generateCorpus(options.syntheticSize, options.seed)
+                                           : loadCorpus(options.corpusDir);
     } catch (const std::exception& e) {
-        std::cerr << "Failed to read benchmark data: " << e.what() << std::endl;
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage(argv[0]);
         return 1;
     }
 
-    if (originalData.empty()) {
-        std::cerr << "Benchmark data file is empty. No benchmarks to run." << std::endl;
-        return 0;
+    std::vector<Variant> variants = expandVariants(options);
+    // Opened before anything starts the shared thread pool, so that its
+    // workers inherit the counters
+    std::unique_ptr<PerfCounters> counters;
+    if (options.counters) {
+        counters = std::make_unique<PerfCounters>();
+        if (!counters->available()) {
+            std::cerr << "Warning: hardware counters disabled (" << counters->reason() << ")" << std::endl;
+            counters.reset();
+        }
     }
+    std::cout << "Benchmarking " << corpus.size() << " files from " << corpusDescription(options) << " ("
+              << options.warmups << " warmup, " << options.repetitions << " timed runs)\n" << std::endl;
 
-    std::cout << "Read " << originalData.size() << " bytes." << std::endl;
-
-    // --- Instantiate Compressors ---
-    compression::NullCompressor nullComp;
-    compression::RleCompressor rleComp;
-    compression::HuffmanCompressor huffmanComp;
-    // Use LZ77 with optimal parsing for better compression
-    compression::Lz77Compressor lz77Comp(32768, 3, 258, false, true, true);
-    compression::DeflateCompressor deflateComp; // Remove verbose logging flag for benchmarks
-    compression::BwtCompressor bwtComp; // Add BWT compressor
-
-    // --- Run Benchmarks ---
     std::vector<BenchmarkResult> results;
-    results.push_back(runBenchmark("Null", nullComp, originalData));
-    results.push_back(runBenchmark("RLE", rleComp, originalData));
-    results.push_back(runBenchmark("Huffman", huffmanComp, originalData));
-    results.push_back(runBenchmark("LZ77", lz77Comp, originalData));
-    results.push_back(runBenchmark("Deflate", deflateComp, originalData));
-    results.push_back(runBenchmark("BWT", bwtComp, originalData)); // Add BWT benchmark
-
-    // --- Output Results ---
-    std::cout << "\n--- Benchmark Results ---\n" << std::endl;
-
-    // Prepare Markdown output string
-    std::stringstream markdownOutput;
-    markdownOutput << "# Compression Benchmark Results\n\n";
-    markdownOutput << "Benchmarked against `data/test.txt` (Size: " << results[0].originalSize << " bytes)\n\n";
-    markdownOutput << "| Algorithm | Compressed Size (bytes) | Ratio (%) | Compress Time (ms) | Decompress Time (ms) |\n";
-    markdownOutput << "|-----------|-------------------------|-----------|--------------------|----------------------|\n";
-
-    std::cout << std::fixed << std::setprecision(3); // For console output timing
-    markdownOutput << std::fixed << std::setprecision(3); // For markdown output timing
-
-    for (const auto& result : results) {
-        double ratioPercent = result.ratio * 100.0;
-
-        // Console Output
-        std::cout << "Algorithm:       " << result.algorithmName << std::endl;
-        std::cout << "Original Size:   " << result.originalSize << " bytes" << std::endl;
-        std::cout << "Compressed Size: " << result.compressedSize << " bytes" << std::endl;
-        std::cout << "Ratio:           " << std::setprecision(2) << ratioPercent << "%" << std::endl;
-        std::cout << "Compress Time:   " << std::setprecision(3) << result.compressionTimeMs << " ms" << std::endl;
-        std::cout << "Decompress Time: " << result.decompressionTimeMs << " ms" << std::endl;
-        std::cout << "-------------------------" << std::endl;
-
-        // Markdown Table Row
-        markdownOutput << "| " << result.algorithmName << " "
-                       << "| " << result.compressedSize << " "
-                       << "| " << std::setprecision(2) << ratioPercent << " "
-                       << "| " << std::setprecision(3) << result.compressionTimeMs << " "
-                       << "| " << result.decompressionTimeMs << " |\n";
-    }
-
-     // --- Write Markdown File (Using path derived from compile definition) ---
-     try {
-         // Ensure the path is clean (remove potential .. etc, though less critical now)
-         benchmarkMdPath = std::filesystem::weakly_canonical(benchmarkMdPath);
-         std::ofstream mdFile(benchmarkMdPath);
-         if (!mdFile) {
-              std::cerr << "Warning: Could not open BENCHMARKS.md for writing at " << benchmarkMdPath << std::endl;
-         } else {
-              mdFile << markdownOutput.str();
-              std::cout << "\nBenchmark results written to " << benchmarkMdPath << std::endl;
-         }
-     } catch(const std::filesystem::filesystem_error& e) {
-         // Use weakly_canonical to avoid issues if parent doesn't exist temporarily
-         std::cerr << "Warning: Could not determine canonical path for BENCHMARKS.md: " << e.what() << std::endl;
-         std::cerr << "Attempted path: " << benchmarkMdPath << std::endl;
-     }
+    size_t failures = 0;
+    std::cout << std::fixed;
+    for (const auto& file : corpus) {
+        for (const auto& variant : variants) {
+            BenchmarkResult result = runBenchmark(file, variant, options, counters.get());
+            std::cout << std::left << std::setw(32) << file.name << std::setw(14) << variant.label()
+                      << std::right;
+            if (result.error.empty()) {
+                std::cout << std::setprecision(2) << std::setw(8) << 100.0 * result.ratio << "%"
+                          << "  C " << std::setw(9) << result.compress.medianMBps << " MB/s (p95 "
+                          << result.compress.p95MBps << ")"
+                          << "  D " << std::setw(9) << result.decompress.medianMBps << " MB/s (p95 "
+                          << result.decompress.p95MBps << ")";
+                CounterSummary c = summarizeCounters(result.compressCounters, result.countedBytes);
+                CounterSummary d = summarizeCounters(result.decompressCounters, result.countedBytes);
+                std::cout << "  heap " << (std::max(result.compressPeakHeap, result.decompressPeakHeap) >> 10)
+                          << " KiB";
+                if (c.valid && d.valid) {
+                    std::cout << "  C " << c.cyclesPerByte << " cyc/B IPC " << c.ipc
+                              << "  D " << d.cyclesPerByte << " cyc/B IPC " << d.ipc;
+                }
+                std::cout << "\n";
+            } else {
+                failures++;
+                std::cout << "  FAILED: " << result.error << "\n";
+            }
+            results.push_back(std::move(result));
+        }
+    }
 
+    try {
+        if (!options.csvPath.empty()) {
+            writeCsv(options.csvPath, results);
+            std::cout << "\nCSV written to " << options.csvPath.string() << std::endl;
+        }
+        if (!options.jsonPath.empty()) {
+            writeJson(options.jsonPath, options, results);
+            std::cout << "JSON written to " << options.jsonPath.string() << std::endl;
+        }
+        if (!options.markdownPath.empty()) {
+            fs::path markdownPath = fs::weakly_canonical(options.markdownPath);
+            std::ofstream mdFile(markdownPath);
+            if (!mdFile) {
+                throw std::runtime_error("Cannot write " + markdownPath.string());
+            }
+            mdFile << markdownReport(options, corpus, variants, results);
+            std::cout << "Markdown written to " << markdownPath.string() << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
 
+    if (failures > 0) {
+        std::cerr << "\n" << failures << " benchmark runs failed verification" << std::endl;
+        return 1;
+    }
     return 0;
-} 
\ No newline at end of file
+}
@@ -9,15 +9,19 @@
 #include <functional>
 #include <iterator> // For std::back_inserter
 #include <iomanip> // For std::hex
+#include <optional>
 
 #include <compression/ICompressor.hpp>
-#include <compression/NullCompressor.hpp>
-#include <compression/RleCompressor.hpp>
-#include <compression/HuffmanCompressor.hpp>
+#include <compression/CompressorFactory.hpp>
 #include <compression/FileFormat.hpp> // Include the new header format definitions
 #include <compression/Crc32.hpp> // Include CRC32 utility
 #include <compression/Lz77Compressor.hpp>
-#include <compression/BwtCompressor.hpp>
+#include <compression/HuffmanCompressor.hpp>
+#include <compression/AutoCompressor.hpp>
+#include <compression/PpmCompressor.hpp>
+#include <compression/Dictionary.hpp>
+#include <compression/Filters.hpp>
+#include <compression/ThreadPool.hpp>
 
 // --- Helper Functions --- 
 
@@ -49,85 +53,226 @@ void writeFile(const std::string& filename, const std::vector<uint8_t>& data) {
     }
 }
 
-// --- Compressor Factory --- 
-
-// Factory function now creates compressor based on AlgorithmID
-std::unique_ptr<compression::ICompressor> createCompressor(compression::format::AlgorithmID id) {
-    switch (id) {
-        case compression::format::AlgorithmID::RLE_COMPRESSOR:
-            return std::make_unique<compression::RleCompressor>();
-        case compression::format::AlgorithmID::NULL_COMPRESSOR:
-            return std::make_unique<compression::NullCompressor>();
-        case compression::format::AlgorithmID::HUFFMAN_COMPRESSOR:
-            return std::make_unique<compression::HuffmanCompressor>();
-        case compression::format::AlgorithmID::LZ77_COMPRESSOR:
-            return std::make_unique<compression::Lz77Compressor>(32768, 3, 258, false, true, true);
-        case compression::format::AlgorithmID::BWT_COMPRESSOR:
-            return std::make_unique<compression::BwtCompressor>();
-        default:
-            throw std::invalid_argument("Unknown or unsupported compression algorithm ID: " 
-                                        + std::to_string(static_cast<uint8_t>(id)));
-    }
-}
-
-// Overload for creating based on name (used for compression command)
-std::unique_ptr<compression::ICompressor> createCompressor(const std::string& strategyName) {
-    compression::format::AlgorithmID id = compression::format::stringToAlgorithmId(strategyName);
-    if (id == compression::format::AlgorithmID::UNKNOWN) {
-         throw std::invalid_argument("Unknown compression strategy name: " + strategyName);
-    }
-    return createCompressor(id);
+// Loads a dictionary written by the train command
+std::shared_ptr<const compression::Dictionary> loadDictionary(const std::string& filename) {
+    return std::make_shared<const compression::Dictionary>(
+        compression::Dictionary::deserialize(readFile(filename)));
 }
 
 // --- Main Application Logic --- 
 
 void printUsage(const char* appName) {
-    std::cerr << "Usage: " << appName << " <compress|decompress> <strategy|ignored_on_decompress> <input_file> <output_file>\n"
-              << "Strategies: null, rle, huffman, lz77, bwt\n";
+    std::cerr << "Usage: " << appName << " <compress|decompress> <strategy|ignored_on_decompress> <input_file> <output_file> [--dict <dict_file>] [--long-window <bytes>] [--level <1-9>] [--stats] [--threads <n>] [--pin-threads] [--block-size <bytes>] [--order <n>] [--memory <MiB>] [--filter <chain>]\n"
+              << "       " << appName << " train <dict_file> <sample_file>... [--dict-size <bytes>]\n"
+              << "Strategies: null, rle, huffman, lz77, lzh, bwt[:cm], cm, ppm, dedup[:<backend>], columnar[:<backend>], auto (dictionaries: lz77, lzh, huffman)\n"
+              << "Filters (compress only, e.g. delta:4,shuffle:4): delta[:<stride>], shuffle:<width>, bitshuffle:<width>\n";
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 5) {
+    // Split the command line into positional arguments and --options
+    std::vector<std::string> positional;
+    std::string dictionaryFile;
+    size_t dictionarySize = 16 * 1024;
+    size_t longDistanceWindow = 0;
+    int level = 0;
+    bool printStats = false;
+    size_t threadCount = 0;
+    bool pinThreads = false;
+    std::optional<size_t> parallelBlockSize;
+    unsigned ppmOrder = 0;
+    size_t ppmMemoryMiB = 0;
+    std::vector<compression::format::FilterSpec> filters;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--dict" || arg == "--dict-size" || arg == "--long-window" || arg == "--level" ||
+                arg == "--threads" || arg == "--block-size" || arg == "--order" || arg == "--memory" ||
+                arg == "--filter") {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument("Missing value for " + arg);
+                }
+                std::string value = argv[++i];
+                if (arg == "--dict") {
+                    dictionaryFile = value;
+                } else if (arg == "--dict-size") {
+                    dictionarySize = std::stoul(value);
+                } else if (arg == "--long-window") {
+                    longDistanceWindow = std::stoull(value);
+                } else if (arg == "--threads") {
+                    threadCount = std::stoul(value);
+                } else if (arg == "--block-size") {
+                    parallelBlockSize = std::stoull(value);
+                } else if (arg == "--order") {
+                    ppmOrder = std::stoul(value);
+                } else if (arg == "--memory") {
+                    ppmMemoryMiB = std::stoull(value);
+                } else if (arg == "--filter") {
+                    filters = compression::utils::parseFilterChain(value);
+                } else {
+                    level = std::stoi(value);
+                }
+            } else if (arg == "--stats") {
+                printStats = true;
+            } else if (arg == "--pin-threads") {
+                pinThreads = true;
+            } else if (arg.rfind("--", 0) == 0) {
+                throw std::invalid_argument("Unknown option: " + arg);
+            } else {
+                positional.push_back(arg);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Checksums (and parallel compressors) share one pool; 0 threads means one per core
+    compression::ThreadPool::configureShared(threadCount, pinThreads);
+    compression::ThreadPool& pool = compression::ThreadPool::shared();
+
+    std::string operation = positional.empty() ? "" : positional[0];
+
+    if (operation == "train") {
+        if (positional.size() < 3) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        try {
+            std::vector<std::vector<uint8_t>> samples;
+            for (size_t i = 2; i < positional.size(); ++i) {
+                samples.push_back(readFile(positional[i]));
+            }
+            std::cout << "Training dictionary from " << samples.size() << " samples..." << std::endl;
+            compression::DictionaryTrainer trainer(dictionarySize);
+            compression::Dictionary dictionary = trainer.train(samples);
+            std::cout << "Dictionary size: " << dictionary.content().size() << " bytes, ID: 0x"
+                      << std::hex << dictionary.id() << std::dec << std::endl;
+            writeFile(positional[1], dictionary.serialize());
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "train completed successfully." << std::endl;
+        return 0;
+    }
+
+    if (positional.size() != 4) {
         printUsage(argv[0]);
         return 1;
     }
 
-    std::string operation = argv[1];
-    std::string strategyName = argv[2]; // Used only for compression
-    std::string inputFile = argv[3];
-    std::string outputFile = argv[4];
+    std::string strategyName = positional[1]; // Used only for compression
+    std::string inputFile = positional[2];
+    std::string outputFile = positional[3];
 
     if (operation != "compress" && operation != "decompress") {
-        std::cerr << "Error: Invalid operation. Must be 'compress' or 'decompress'.\n";
+        std::cerr << "Error: Invalid operation. Must be 'compress', 'decompress' or 'train'.\n";
         printUsage(argv[0]);
         return 1;
     }
 
+    // Statistics are collected only when --stats asks for them
+    compression::CompressionContext context;
+    context.enableStats(printStats);
+
     try {
         if (operation == "compress") {
             // 1. Create the compressor strategy from name
-            auto compressor = createCompressor(strategyName);
-            compression::format::AlgorithmID algoId = compression::format::stringToAlgorithmId(strategyName);
+            std::shared_ptr<const compression::Dictionary> dictionary;
+            if (!dictionaryFile.empty()) {
+                dictionary = loadDictionary(dictionaryFile);
+                std::cout << "Using dictionary " << dictionaryFile << " (ID: 0x"
+                          << std::hex << dictionary->id() << std::dec << ")" << std::endl;
+            }
+            auto compressor = compression::createCompressor(strategyName, dictionary);
+            if (longDistanceWindow > 0) {
+                auto* lz77 = dynamic_cast<compression::Lz77Compressor*>(compressor.get());
+                if (!lz77) {
+                    throw std::invalid_argument("--long-window is only supported by lz77 and lzh");
+                }
+                lz77->setLongDistanceWindow(longDistanceWindow);
+            }
+            if (level != 0) {
+                if (auto* lz77 = dynamic_cast<compression::Lz77Compressor*>(compressor.get())) {
+                    lz77->setLevel(level);
+                } else if (auto* automatic = dynamic_cast<compression::AutoCompressor*>(compressor.get())) {
+                    automatic->setLevel(level);
+                } else {
+                    throw std::invalid_argument("--level is only supported by lz77, lzh and auto");
+                }
+            }
+            if (ppmOrder != 0 || ppmMemoryMiB != 0) {
+                auto* ppm = dynamic_cast<compression::PpmCompressor*>(compressor.get());
+                if (!ppm) {
+                    throw std::invalid_argument("--order and --memory are only supported by ppm");
+                }
+                if (ppmOrder != 0) {
+                    ppm->setOrder(ppmOrder);
+                }
+                if (ppmMemoryMiB != 0) {
+                    ppm->setMemoryLimit(ppmMemoryMiB << 20);
+                }
+            }
+            if (auto* lz77 = dynamic_cast<compression::Lz77Compressor*>(compressor.get())) {
+                // Parallel blocks by default, unless long matches should span the whole input
+                size_t defaultBlockSize =
+                    longDistanceWindow > 0 ? 0 : compression::Lz77Compressor::DEFAULT_PARALLEL_BLOCK_SIZE;
+                lz77->setParallelBlockSize(parallelBlockSize.value_or(defaultBlockSize), &pool);
+            } else if (auto* huffman = dynamic_cast<compression::HuffmanCompressor*>(compressor.get())) {
+                huffman->setParallelBlockSize(
+                    parallelBlockSize.value_or(compression::HuffmanCompressor::DEFAULT_PARALLEL_BLOCK_SIZE), &pool);
+            } else if (parallelBlockSize) {
+                throw std::invalid_argument("--block-size is only supported by lz77, lzh and huffman");
+            }
+            // Pipelines such as "dedup:huffman" record the pipeline; the payload names its backend
+            compression::format::AlgorithmID algoId =
+                compression::format::stringToAlgorithmId(strategyName.substr(0, strategyName.find(':')));
 
             // 2. Read input file
             std::cout << "Reading input file: " << inputFile << "..." << std::endl;
             std::vector<uint8_t> originalData = readFile(inputFile);
             std::cout << "Original size: " << originalData.size() << " bytes." << std::endl;
 
-            // 3. Calculate CRC32 of original data
-            uint32_t originalCRC = compression::utils::crc32Calculator.calculate(originalData);
-            std::cout << "Original CRC32: 0x" << std::hex << originalCRC << std::dec << std::endl;
+            // 3. Calculate CRC32 of original data on the pool while this thread compresses
+            auto crcTask = pool.submit([&] {
+                return compression::utils::crc32Calculator.calculate(originalData.data(), originalData.size(), pool);
+            });
 
-            // 4. Compress data
-            std::cout << "Compressing using " << strategyName << " strategy..." << std::endl;
-            std::vector<uint8_t> compressedData = compressor->compress(originalData);
+            // 4. Filter and compress data
+            std::vector<uint8_t> compressedData;
+            try {
+                std::vector<uint8_t> filteredData;
+                if (!filters.empty()) {
+                    std::cout << "Filtering with " << compression::utils::filterChainToString(filters) << "..."
+                              << std::endl;
+                    filteredData = compression::utils::applyFilters(originalData, filters);
+                }
+                std::cout << "Compressing using " << strategyName << " strategy..." << std::endl;
+                compressedData = compressor->compress(filters.empty() ? originalData : filteredData, context);
+            } catch (...) {
+                pool.wait(crcTask); // The task still reads originalData
+                throw;
+            }
             std::cout << "Compressed payload size: " << compressedData.size() << " bytes." << std::endl;
+            uint32_t originalCRC = pool.wait(crcTask);
+            std::cout << "Original CRC32: 0x" << std::hex << originalCRC << std::dec << std::endl;
 
             // 5. Create and serialize header (including checksum)
             compression::format::FileHeader header;
             header.algorithmId = algoId;
             header.originalSize = originalData.size();
             header.originalChecksum = originalCRC; // Store calculated CRC
+            header.dictionaryId = dictionary ? dictionary->id() : 0;
+            header.filters = filters;
+            if (!originalData.empty() && compressedData.size() >= originalData.size()) {
+                // Incompressible input: store it so the file grows by the header only
+                std::cout << "Payload did not shrink; storing the input instead." << std::endl;
+                compressedData = originalData;
+                header.flags |= compression::format::HEADER_FLAG_STORED;
+                header.dictionaryId = 0;
+                header.filters.clear();
+            }
             std::vector<uint8_t> headerBytes = compression::format::serializeHeader(header);
             std::cout << "Header size: " << headerBytes.size() << " bytes." << std::endl;
 
@@ -158,20 +303,43 @@ int main(int argc, char* argv[]) {
             std::cout << "  Original Size: " << header.originalSize << " bytes." << std::endl;
             std::cout << "  Stored CRC32: 0x" << std::hex << header.originalChecksum << std::dec << std::endl;
 
-            // 3. Create compressor based on header info
-            auto compressor = createCompressor(header.algorithmId);
+            bool stored = (header.flags & compression::format::HEADER_FLAG_STORED) != 0;
+            if (stored) {
+                std::cout << "  Payload stored uncompressed." << std::endl;
+            }
+            if (!header.filters.empty()) {
+                std::cout << "  Filters: " << compression::utils::filterChainToString(header.filters) << std::endl;
+            }
+
+            // 3. Create compressor based on header info, with the dictionary it was written with
+            std::shared_ptr<const compression::Dictionary> dictionary;
+            if (header.dictionaryId != 0) {
+                std::cout << "  Dictionary ID: 0x" << std::hex << header.dictionaryId << std::dec << std::endl;
+                if (dictionaryFile.empty()) {
+                    throw std::runtime_error("File was compressed with a dictionary; pass it with --dict");
+                }
+                dictionary = loadDictionary(dictionaryFile);
+                if (dictionary->id() != header.dictionaryId) {
+                    throw std::runtime_error("Dictionary ID mismatch: file needs a different dictionary");
+                }
+            }
+            auto compressor = compression::createCompressor(header.algorithmId, dictionary);
 
             // 4. Extract compressed payload
             std::vector<uint8_t> compressedPayload(
-                inputData.begin() + compression::format::HEADER_SIZE, 
+                inputData.begin() + compression::format::headerSize(header), 
                 inputData.end()
             );
             std::cout << "Compressed payload size: " << compressedPayload.size() << " bytes." << std::endl;
             
             // 5. Decompress data
             std::cout << "Decompressing using " << algoName << " strategy..." << std::endl;
-            std::vector<uint8_t> outputData = compressor->decompress(compressedPayload);
+            std::vector<uint8_t> outputData =
+                stored ? compressedPayload : compressor->decompress(compressedPayload, context);
             std::cout << "Decompressed size: " << outputData.size() << " bytes." << std::endl;
+            if (!header.filters.empty()) {
+                outputData = compression::utils::reverseFilters(outputData, header.filters);
+            }
 
             // 6. Verify original size
             if (outputData.size() != header.originalSize) {
@@ -182,7 +350,8 @@ int main(int argc, char* argv[]) {
             }
 
             // 7. Verify CRC32 Checksum
-            uint32_t decompressedCRC = compression::utils::crc32Calculator.calculate(outputData);
+            uint32_t decompressedCRC =
+                compression::utils::crc32Calculator.calculate(outputData.data(), outputData.size(), pool);
             std::cout << "Calculated CRC32: 0x" << std::hex << decompressedCRC << std::dec << std::endl;
             if (decompressedCRC != header.originalChecksum) {
                  std::cerr << "ERROR: Checksum mismatch! Header CRC=0x" << std::hex << header.originalChecksum
@@ -201,6 +370,15 @@ int main(int argc, char* argv[]) {
 
         std::cout << operation << " completed successfully." << std::endl;
 
+        if (printStats) {
+            if (const compression::CompressionStats* stats = context.stats()) {
+                std::cout << "\nStatistics:\n";
+                stats->print(std::cout);
+            } else {
+                std::cerr << "Warning: statistics were compiled out (COMPRESSION_ENABLE_STATS=OFF)" << std::endl;
+            }
+        }
+
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
@@ -0,0 +1,313 @@
+// benchmarks/micro_benchmarks.cpp
+//
+// Google Benchmark suite for the hot kernels of each compressor. Every
+// benchmark takes two arguments: input size in bytes and a CorpusKind, so a
+// kernel can be compared across data shapes, e.g.
+//   ./micro_benchmarks --benchmark_filter='BM_FindBestMatch/65536/.*'
+#include <benchmark/benchmark.h>
+
+#include <compression/BitIO.hpp>
+#include <compression/BwtCompressor.hpp>
+#include <compression/CompressionContext.hpp>
+#include <compression/ContextMixingCompressor.hpp>
+#include <compression/PpmCompressor.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <compression/Crc32.hpp>
+#include <compression/Filters.hpp>
+#include <compression/Histogram.hpp>
+#include <compression/HuffmanCompressor.hpp>
+#include <compression/Lz77Compressor.hpp>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace compression {
+
+// Friend of the compressors; forwards to their private kernels
+struct MicroBenchmarkAccess {
+    static uint32_t hashTriplet(const Lz77Compressor& lz77, const std::vector<uint8_t>& data, size_t pos) {
+        return lz77.hashTriplet(data, pos);
+    }
+
+    // Greedy match search as the parser runs it: search, then index the position
+    static size_t findAllMatches(const Lz77Compressor& lz77, const std::vector<uint8_t>& data,
+                                 CompressionContext& context) {
+        CompressionContext::Scope scope(context);
+        auto chains = lz77.createHashChains(data.size(), context);
+        size_t matchedBytes = 0;
+        for (size_t pos = 0; pos < data.size(); ++pos) {
+            matchedBytes += lz77.findBestMatchAt(data, pos, chains).length;
+            lz77.updateHashTable(chains, data, pos);
+        }
+        return matchedBytes;
+    }
+
+    static std::pair<std::vector<uint8_t>, uint32_t> bwtEncode(const BwtCompressor& bwt,
+                                                               const std::vector<uint8_t>& block,
+                                                               CompressionContext& context) {
+        return bwt.bwtEncode(block, context);
+    }
+
+    static std::vector<uint8_t> bwtDecode(const BwtCompressor& bwt, const std::vector<uint8_t>& block,
+                                          uint32_t primaryIndex, CompressionContext& context) {
+        return bwt.bwtDecode(block, primaryIndex, context);
+    }
+
+    // Model prediction, update and range coding of every bit
+    static size_t encodeContextMixing(const ContextMixingCompressor& cm, const std::vector<uint8_t>& data,
+                                      CompressionContext& context) {
+        std::vector<uint8_t> output;
+        cm.encodeModeled(data, output, context);
+        return output.size();
+    }
+
+    // Context tree search, escapes, range coding and tree update of every byte
+    static size_t encodePpm(const PpmCompressor& ppm, const std::vector<uint8_t>& data,
+                            CompressionContext& context) {
+        std::vector<uint8_t> output;
+        PpmCompressor::encodeModeled(data, output, ppm.order(), ppm.memoryLimit(), context);
+        return output.size();
+    }
+
+    // Frequency count, tree construction and code assignment
+    static size_t buildHuffmanCodes(const HuffmanCompressor& huffman, const std::vector<uint8_t>& data) {
+        auto frequencies = huffman.buildFrequencyMap(data);
+        HuffmanCompressor::HuffmanTree tree;
+        huffman.buildHuffmanTree(frequencies, tree);
+        HuffmanCompressor::CodeTable codes;
+        return huffman.generateCodes(tree, HuffmanCompressor::LONGEST_CODE_LENGTH_LIMIT, codes);
+    }
+};
+
+} // namespace compression
+
+namespace {
+
+using compression::MicroBenchmarkAccess;
+using compression::utils::CorpusKind;
+
+// Inputs are generated once per (kind, size) and shared by all benchmarks
+const std::vector<uint8_t>& input(const benchmark::State& state) {
+    static std::map<std::pair<int64_t, int64_t>, std::vector<uint8_t>> cache;
+    auto key = std::make_pair(state.range(0), state.range(1));
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        compression::utils::CorpusGenerator generator;
+        auto kind = static_cast<CorpusKind>(state.range(1));
+        it = cache.emplace(key, generator.generate(kind, static_cast<size_t>(state.range(0)))).first;
+    }
+    return it->second;
+}
+
+void finish(benchmark::State& state) {
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+    state.SetLabel(compression::utils::corpusKindToString(static_cast<CorpusKind>(state.range(1))));
+}
+
+// Sizes from a small message to a full BWT block, on every data kind
+void allInputs(benchmark::internal::Benchmark* benchmark, int64_t maxSize) {
+    std::vector<int64_t> sizes;
+    for (int64_t size = 4 << 10; size <= maxSize; size *= 16) {
+        sizes.push_back(size);
+    }
+    std::vector<int64_t> kinds;
+    for (CorpusKind kind : compression::utils::allCorpusKinds()) {
+        kinds.push_back(static_cast<int64_t>(kind));
+    }
+    benchmark->ArgsProduct({sizes, kinds})->ArgNames({"bytes", "kind"});
+}
+
+void largeInputs(benchmark::internal::Benchmark* benchmark) { allInputs(benchmark, 1 << 20); }
+void bwtInputs(benchmark::internal::Benchmark* benchmark) { allInputs(benchmark, 256 << 10); }
+
+// --- LZ77 ---
+
+void BM_HashTriplet(benchmark::State& state) {
+    const auto& data = input(state);
+    compression::Lz77Compressor lz77;
+    for (auto _ : state) {
+        uint32_t sum = 0;
+        for (size_t pos = 0; pos + 3 <= data.size(); ++pos) {
+            sum += MicroBenchmarkAccess::hashTriplet(lz77, data, pos);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    finish(state);
+}
+BENCHMARK(BM_HashTriplet)->Apply(largeInputs);
+
+void BM_FindBestMatch(benchmark::State& state) {
+    const auto& data = input(state);
+    compression::Lz77Compressor lz77;
+    compression::CompressionContext context(lz77.scratchSize(data.size()));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MicroBenchmarkAccess::findAllMatches(lz77, data, context));
+    }
+    finish(state);
+}
+BENCHMARK(BM_FindBestMatch)->Apply(largeInputs);
+
+// --- BWT ---
+
+void BM_MoveToFrontEncode(benchmark::State& state) {
+    const auto& data = input(state);
+    compression::MoveToFrontEncoder mtf;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mtf.encode(data));
+    }
+    finish(state);
+}
+BENCHMARK(BM_MoveToFrontEncode)->Apply(largeInputs);
+
+// Suffix array construction dominates the forward transform
+void BM_SuffixArray(benchmark::State& state) {
+    const auto& data = input(state);
+    compression::BwtCompressor bwt;
+    compression::CompressionContext context(bwt.scratchSize(data.size()));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MicroBenchmarkAccess::bwtEncode(bwt, data, context));
+    }
+    finish(state);
+}
+BENCHMARK(BM_SuffixArray)->Apply(bwtInputs);
+
+void BM_BwtDecode(benchmark::State& state) {
+    const auto& data = input(state);
+    compression::BwtCompressor bwt;
+    compression::CompressionContext context(bwt.scratchSize(data.size()));
+    auto [block, primaryIndex] = MicroBenchmarkAccess::bwtEncode(bwt, data, context);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MicroBenchmarkAccess::bwtDecode(bwt, block, primaryIndex, context));
+    }
+    finish(state);
+}
+BENCHMARK(BM_BwtDecode)->Apply(bwtInputs);
+
+// --- Entropy coding and utilities ---
+
+void BM_HuffmanBuildCodes(benchmark::State& state) {
+    const auto& data = input(state);
+    compression::HuffmanCompressor huffman;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MicroBenchmarkAccess::buildHuffmanCodes(huffman, data));
+    }
+    finish(state);
+}
+BENCHMARK(BM_HuffmanBuildCodes)->Apply(largeInputs);
+
+void BM_ContextMixingEncode(benchmark::State& state) {
+    const auto& data = input(state);
+    compression::ContextMixingCompressor cm;
+    compression::CompressionContext context(cm.scratchSize(data.size()));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MicroBenchmarkAccess::encodeContextMixing(cm, data, context));
+    }
+    finish(state);
+}
+BENCHMARK(BM_ContextMixingEncode)->Apply(bwtInputs);
+
+void BM_PpmEncode(benchmark::State& state) {
+    const auto& data = input(state);
+    compression::PpmCompressor ppm;
+    compression::CompressionContext context(ppm.scratchSize(data.size()));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(MicroBenchmarkAccess::encodePpm(ppm, data, context));
+    }
+    finish(state);
+}
+BENCHMARK(BM_PpmEncode)->Apply(bwtInputs);
+
+// Range(2) selects the kernel: 0 = std::map, as the compressors counted
+// before, otherwise a compression::utils::HistogramKernel
+void BM_ByteHistogram(benchmark::State& state) {
+    const auto& data = input(state);
+    auto kernel = static_cast<compression::utils::HistogramKernel>(state.range(2) - 1);
+    if (state.range(2) > 0 && !compression::utils::histogramKernelSupported(kernel)) {
+        state.SkipWithError("kernel not supported on this CPU");
+        return;
+    }
+    for (auto _ : state) {
+        if (state.range(2) == 0) {
+            std::map<uint8_t, uint64_t> counts;
+            for (uint8_t byte : data) {
+                counts[byte]++;
+            }
+            benchmark::DoNotOptimize(counts);
+        } else {
+            benchmark::DoNotOptimize(compression::utils::byteHistogram(data.data(), data.size(), kernel));
+        }
+    }
+    finish(state);
+}
+BENCHMARK(BM_ByteHistogram)
+    ->ArgsProduct({{64 << 10, 1 << 20},
+                   {static_cast<int64_t>(CorpusKind::RANDOM), static_cast<int64_t>(CorpusKind::LOGS)},
+                   {0, 1 + static_cast<int64_t>(compression::utils::HistogramKernel::SCALAR),
+                    1 + static_cast<int64_t>(compression::utils::HistogramKernel::AVX2)}})
+    ->ArgNames({"bytes", "kind", "kernel"});
+
+// Range(2) is the element width of a shuffle:<width> filter, range(3) a
+// compression::utils::FilterKernel
+void BM_ShuffleFilter(benchmark::State& state) {
+    const auto& data = input(state);
+    auto kernel = static_cast<compression::utils::FilterKernel>(state.range(3));
+    if (!compression::utils::filterKernelSupported(kernel)) {
+        state.SkipWithError("kernel not supported on this CPU");
+        return;
+    }
+    std::vector<compression::format::FilterSpec> filters = {
+        {compression::format::FilterID::SHUFFLE, static_cast<uint8_t>(state.range(2))}};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(compression::utils::applyFilters(data, filters, kernel));
+    }
+    finish(state);
+}
+BENCHMARK(BM_ShuffleFilter)
+    ->ArgsProduct({{1 << 20},
+                   {static_cast<int64_t>(CorpusKind::METRICS)},
+                   {2, 4, 8},
+                   {static_cast<int64_t>(compression::utils::FilterKernel::SCALAR),
+                    static_cast<int64_t>(compression::utils::FilterKernel::SSSE3)}})
+    ->ArgNames({"bytes", "kind", "width", "kernel"});
+
+void BM_Crc32(benchmark::State& state) {
+    const auto& data = input(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(compression::utils::crc32Calculator.calculate(data));
+    }
+    finish(state);
+}
+BENCHMARK(BM_Crc32)->Apply(largeInputs);
+
+// Writes every input byte as 8 bits, as the entropy coders emit codes
+void BM_BitWrite(benchmark::State& state) {
+    const auto& data = input(state);
+    for (auto _ : state) {
+        compression::BitIO::BitWriter writer;
+        for (uint8_t byte : data) {
+            writer.writeNumber(byte, 8);
+        }
+        benchmark::DoNotOptimize(writer.getBuffer());
+    }
+    finish(state);
+}
+BENCHMARK(BM_BitWrite)->Apply(largeInputs);
+
+void BM_BitRead(benchmark::State& state) {
+    const auto& data = input(state);
+    for (auto _ : state) {
+        compression::BitIO::BitReader reader(data);
+        uint32_t sum = 0;
+        for (size_t i = 0; i < data.size(); ++i) {
+            sum += reader.readBits(8);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    finish(state);
+}
+BENCHMARK(BM_BitRead)->Apply(largeInputs);
+
+} // anonymous namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ICompressor.hpp"
+#include "FileFormat.hpp"
+#include "DataProfile.hpp"
+#include "BwtCompressor.hpp"
+#include "HuffmanCompressor.hpp"
+#include "Lz77Compressor.hpp"
+#include "RleCompressor.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace compression {
+
+/**
+ * @brief Picks a compressor per block from a sample of the data.
+ *
+ * Each block is profiled (order-0 entropy, match and run density, see
+ * utils::profileData) and sent to the compressor expected to do best at the
+ * configured level: stored for incompressible data, rle for data that is
+ * almost all runs, huffman when nothing repeats, otherwise lz77 at the level,
+ * or bwt at the highest levels. A block whose compressed form is not smaller
+ * than the block is stored instead, so output never grows by more than the
+ * few bytes of block framing.
+ *
+ * Stream format:
+ *   format version (1 byte), then per block:
+ *   algorithm ID (1 byte) | varint original size | varint payload size | payload
+ * where a NULL_COMPRESSOR block's payload is the block itself.
+ */
+class AutoCompressor final : public ICompressor {
+public:
+    using ICompressor::compress;
+    using ICompressor::decompress;
+
+    // Input bytes per independently chosen block
+    static constexpr size_t BLOCK_SIZE = 1024 * 1024;
+
+    static constexpr int MIN_LEVEL = 1;
+    static constexpr int MAX_LEVEL = 9;
+    static constexpr int DEFAULT_LEVEL = 6;
+
+    // Levels from which bwt is chosen over lz77 for compressible blocks
+    static constexpr int BWT_MIN_LEVEL = 8;
+
+    /**
+     * @brief The compressor and level chosen for a block.
+     */
+    struct Choice {
+        format::AlgorithmID algorithm = format::AlgorithmID::NULL_COMPRESSOR;
+        int level = 0; // lz77 level; 0 for algorithms without levels
+    };
+
+    explicit AutoCompressor(int level = DEFAULT_LEVEL);
+
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data) const override;
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data,
+                                  CompressionContext& context) const override;
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data) const override;
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data,
+                                    CompressionContext& context) const override;
+
+    /**
+     * @brief Scratch for the most demanding candidate on one block.
+     */
+    size_t scratchSize(size_t inputSize) const override;
+
+    /**
+     * @brief Working set of the most demanding candidate on one block, plus the output.
+     */
+    size_t workingSetSize(size_t inputSize) const override;
+
+    /**
+     * @brief Trades speed for ratio, like Lz77Compressor::setLevel.
+     *
+     * @param level 1 (fastest) to 9 (smallest output).
+     * @throws std::invalid_argument if the level is out of range.
+     */
+    void setLevel(int level);
+    int level() const { return level_; }
+
+    /**
+     * @brief The choice made for a block with the given profile.
+     */
+    Choice choose(const utils::DataProfile& profile) const;
+
+    /**
+     * @brief Algorithm of each block in a compressed stream, in order.
+     *
+     * @throws std::runtime_error if the stream is malformed.
+     */
+    static std::vector<format::AlgorithmID> blockAlgorithms(const std::vector<uint8_t>& data);
+
+private:
+    static constexpr uint8_t FORMAT_VERSION = 1;
+
+    const ICompressor& compressorFor(format::AlgorithmID algorithm) const;
+
+    int level_;
+    RleCompressor rle_;
+    HuffmanCompressor huffman_;
+    Lz77Compressor lz77_;
+    BwtCompressor bwt_;
+};
+
+} // namespace compression
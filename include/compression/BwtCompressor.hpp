@@ -2,6 +2,7 @@
 #define COMPRESSION_BWTCOMPRESSOR_HPP
 
 #include "ICompressor.hpp"
+#include "FileFormat.hpp"
 #include <vector>
 #include <cstdint>
 #include <memory>
@@ -40,14 +41,25 @@ public:
  * BWT is a block sorting algorithm that rearranges characters to group similar
  * characters together, making the data more compressible with entropy coding.
  * This implementation combines BWT with Move-To-Front transform and entropy coding
- * to achieve high compression ratios for text data.
+ * to achieve high compression ratios for text data. Blocks that sample as
+ * random, or that the pipeline does not shrink, are stored raw.
+ *
+ * The entropy stage is Huffman coding by default. ContextMixingCompressor
+ * can take its place, which adapts to the MTF ranks as they change within
+ * a block and codes them in the context of the previous ranks, for a
+ * smaller output at a much lower speed. The stream records which stage it
+ * used, so decoding needs no configuration.
  */
 class BwtCompressor : public ICompressor {
 public:
     /**
      * @brief Construct a BWT compressor with default settings
+     *
+     * @param entropyCoder Entropy stage for new streams: HUFFMAN_COMPRESSOR
+     *        or CONTEXT_MIXING_COMPRESSOR.
+     * @throws std::invalid_argument for any other algorithm.
      */
-    BwtCompressor();
+    explicit BwtCompressor(format::AlgorithmID entropyCoder = format::AlgorithmID::HUFFMAN_COMPRESSOR);
     
     /**
      * @brief Destructor with default implementation
@@ -68,6 +80,16 @@ public:
      */
     std::vector<uint8_t> compress(const std::vector<uint8_t>& data) const override;
     
+    /**
+     * @brief Compresses data, taking suffix array scratch from a reusable context
+     * 
+     * @param data The data to compress
+     * @param context Scratch memory for suffix sorting and the entropy stage
+     * @return The compressed data
+     */
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data,
+                                  CompressionContext& context) const override;
+    
     /**
      * @brief Decompresses data that was compressed with the BWT algorithm
      * 
@@ -81,28 +103,64 @@ public:
      * @return The decompressed data
      */
     std::vector<uint8_t> decompress(const std::vector<uint8_t>& data) const override;
+    
+    /**
+     * @brief Decompresses data, taking the inverse transform table from a reusable context
+     * 
+     * @param data The compressed data
+     * @param context Scratch memory for the inverse transform
+     * @return The decompressed data
+     */
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data,
+                                    CompressionContext& context) const override;
+    
+    /**
+     * @brief Scratch bytes needed to suffix-sort the largest block of an input
+     * 
+     * @param inputSize Size of the data to compress
+     * @return Arena bytes used by one compress() call
+     */
+    size_t scratchSize(size_t inputSize) const override;
+    
+    /**
+     * @brief Scratch plus the per-block stage buffers and the output
+     * 
+     * @param inputSize Size of the data to compress
+     * @return Peak heap bytes of one compress() or decompress() call
+     */
+    size_t workingSetSize(size_t inputSize) const override;
 
 private:
+    // Gives benchmarks/ access to individual kernels
+    friend struct MicroBenchmarkAccess;
+    
     /**
      * @brief Apply Burrows-Wheeler Transform to input data
      * 
      * @param block Data block to transform
+     * @param context Scratch memory for suffix array construction
      * @return Pair of transformed block and primary index
      */
-    std::pair<std::vector<uint8_t>, uint32_t> bwtEncode(const std::vector<uint8_t>& block) const;
+    std::pair<std::vector<uint8_t>, uint32_t> bwtEncode(const std::vector<uint8_t>& block,
+                                                        CompressionContext& context) const;
     
     /**
      * @brief Apply inverse Burrows-Wheeler Transform to restore original data
      * 
      * @param block Transformed data block
      * @param primaryIndex Primary index from forward transform
+     * @param context Scratch memory for the transform vector
      * @return Original data block
      */
-    std::vector<uint8_t> bwtDecode(const std::vector<uint8_t>& block, uint32_t primaryIndex) const;
+    std::vector<uint8_t> bwtDecode(const std::vector<uint8_t>& block, uint32_t primaryIndex,
+                                   CompressionContext& context) const;
     
     /**
      * @brief Apply run-length encoding to data
      * 
+     * Four identical bytes are followed by a count of further repeats
+     * (0-255), so no byte value needs escaping.
+     * 
      * @param data Input data to compress
      * @return RLE-compressed data
      */
@@ -116,6 +174,42 @@ private:
      */
     std::vector<uint8_t> runLengthDecode(const std::vector<uint8_t>& data) const;
     
+    /**
+     * @brief Run one block through BWT, MTF, RLE and entropy coding
+     * 
+     * @param block Data block to compress
+     * @param context Scratch memory and optional statistics
+     * @return Pair of compressed block and primary index
+     */
+    std::pair<std::vector<uint8_t>, uint32_t> encodeBlock(const std::vector<uint8_t>& block,
+                                                          CompressionContext& context) const;
+    
+    /**
+     * @brief Invert encodeBlock
+     * 
+     * @param block Compressed block
+     * @param primaryIndex Primary index from the forward transform
+     * @param rleEnabled Whether the stream applied run-length encoding
+     * @param contextMixing Whether the entropy stage was context mixing
+     * @param context Scratch memory and optional statistics
+     * @return Original data block
+     */
+    std::vector<uint8_t> decodeBlock(const std::vector<uint8_t>& block, uint32_t primaryIndex,
+                                     bool rleEnabled, bool contextMixing,
+                                     CompressionContext& context) const;
+    
+    // Stream format version and header flags
+    static constexpr uint8_t FORMAT_VERSION = 2;
+    static constexpr uint8_t FLAG_RLE = 0x01;
+    static constexpr uint8_t FLAG_STORED_BLOCKS = 0x02;
+    static constexpr uint8_t FLAG_RAW_BLOCKS = 0x04;
+    static constexpr uint8_t FLAG_CONTEXT_MIXING = 0x08;
+    // Primary index of a block holding the original bytes, when FLAG_RAW_BLOCKS is set
+    static constexpr uint32_t RAW_BLOCK_INDEX = 0xFFFFFFFF;
+    
+    // Identical bytes after which the RLE stage writes a run count
+    static constexpr size_t RLE_MIN_RUN = 4;
+    
     // Block size for BWT (larger blocks give better compression but use more memory)
     size_t blockSize_;
     
@@ -124,6 +218,10 @@ private:
     
     // Secondary compressor for entropy coding (typically Huffman)
     std::unique_ptr<ICompressor> entropyCompressor_;
+    
+    // Used instead of entropyCompressor_ by streams with FLAG_CONTEXT_MIXING
+    std::unique_ptr<ICompressor> contextMixingCompressor_;
+    bool useContextMixing_;
 };
 
 } // namespace compression
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "ICompressor.hpp"
+#include "FileFormat.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace compression {
+
+/**
+ * @brief Column-oriented pipeline for delimited and fixed-width text records.
+ *
+ * The input is cut into frames of about FRAME_SIZE bytes that end on a line
+ * boundary, and the lines of each frame are inspected (see
+ * detectStructure()). Delimited lines (CSV, TSV, ...) are split into fields
+ * and field i of every line goes to stream i; fixed-width lines are split at
+ * the columns that separate their fields. Values of one column resemble each
+ * other far more than neighbouring fields of a row do, so each stream is
+ * compressed on its own, by the backend that does best on it. Frames are
+ * self-contained, so encoding and decoding hold one frame at a time.
+ *
+ * Splitting only looks at delimiter and newline bytes, so any input,
+ * including quoted fields, ragged lines and binary data, round-trips
+ * exactly; frames without structure are compressed as one stream.
+ *
+ * Stream format:
+ *   format version (1 byte), then per frame:
+ *   layout (1 byte) | layout fields | streams
+ * where a DELIMITED layout has the delimiter byte, varint line count and
+ * varint column count; a FIXED_WIDTH layout the varint line length, line
+ * count, field count and the varint width of each field; RAW none. The
+ * streams are the columns followed by the bytes after the last whole line,
+ * each as algorithm ID (1 byte) | varint size | varint payload size |
+ * payload, where a NULL_COMPRESSOR payload is the stream itself. A
+ * delimited column holds each field followed by the delimiter or newline
+ * that ended it; a field in the last possible column runs to the newline.
+ */
+class ColumnarCompressor final : public ICompressor {
+public:
+    using ICompressor::compress;
+    using ICompressor::decompress;
+
+    // Input bytes per frame; frames end after the last newline within this size
+    static constexpr size_t FRAME_SIZE = 4 * 1024 * 1024;
+
+    // Most streams a frame splits its lines into
+    static constexpr size_t MAX_COLUMNS = 256;
+
+    // Backends are tried on at most this many bytes of a column to choose one
+    static constexpr size_t CHOICE_SAMPLE_SIZE = 64 * 1024;
+
+    enum class Layout : uint8_t {
+        RAW = 0,         // No structure found: the frame is one stream
+        DELIMITED = 1,   // Fields separated by a delimiter byte
+        FIXED_WIDTH = 2  // Lines of one length, fields at fixed columns
+    };
+
+    /**
+     * @brief How the lines of a frame are split into columns.
+     */
+    struct Structure {
+        Layout layout = Layout::RAW;
+        uint8_t delimiter = 0;           // DELIMITED: the field separator
+        size_t lineLength = 0;           // FIXED_WIDTH: bytes per line, newline included
+        std::vector<size_t> fieldWidths; // FIXED_WIDTH: widths adding up to lineLength
+    };
+
+    /**
+     * @brief Finds the record structure of the whole lines in a buffer.
+     *
+     * Lines are delimited when one of ',', '\t', ';' or '|' occurs the same
+     * number of times in at least 90% of the first lines (the count giving
+     * the most fields wins). Otherwise they are fixed-width when all have the
+     * same length, and fields start after every column that is a space on
+     * all lines. Fewer than 4 lines, or a single fixed-width field, are RAW.
+     *
+     * @param data Buffer to inspect; bytes after its last newline are ignored.
+     * @param size Buffer length.
+     */
+    static Structure detectStructure(const uint8_t* data, size_t size);
+
+    /**
+     * @brief Creates the pipeline.
+     *
+     * @param backend Algorithm for every stream, or UNKNOWN to pick the one
+     *        that compresses each stream best among rle, huffman, lzh and
+     *        bwt (or to store it, if none shrinks it).
+     * @throws std::invalid_argument if the backend is unknown or is columnar itself.
+     */
+    explicit ColumnarCompressor(format::AlgorithmID backend = format::AlgorithmID::UNKNOWN);
+
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data) const override;
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data,
+                                  CompressionContext& context) const override;
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data) const override;
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data,
+                                    CompressionContext& context) const override;
+
+    /**
+     * @brief Scratch for the most demanding backend on one frame.
+     */
+    size_t scratchSize(size_t inputSize) const override;
+
+    /**
+     * @brief Backend working set for one frame, plus its columns and the output.
+     */
+    size_t workingSetSize(size_t inputSize) const override;
+
+    // UNKNOWN when each stream picks its own backend
+    format::AlgorithmID backend() const { return backendId_; }
+
+private:
+    static constexpr uint8_t FORMAT_VERSION = 1;
+
+    // Compresses one stream with the best backend and appends it to output
+    void writeStream(std::vector<uint8_t>& output, const std::vector<uint8_t>& stream,
+                     CompressionContext& context) const;
+
+    format::AlgorithmID backendId_;
+    std::vector<std::pair<format::AlgorithmID, std::unique_ptr<ICompressor>>> candidates_;
+};
+
+} // namespace compression
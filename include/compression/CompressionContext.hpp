@@ -0,0 +1,169 @@
+#pragma once
+
+#include "CompressionStats.hpp"
+#include <cstddef> // For size_t, std::max_align_t
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace compression {
+
+/**
+ * @brief Reusable scratch memory for compression and decompression calls.
+ *
+ * A context owns a growable arena from which compressors carve their
+ * temporary tables (hash chains, suffix array ranks, count tables, ...).
+ * Memory handed out by the arena stays valid until reset() is called.
+ * Resetting rewinds the arena without releasing it, so a context that is
+ * reused across calls reaches a steady state where no heap allocation
+ * happens for scratch data at all.
+ *
+ * A context is not thread-safe: give each thread its own context and reuse
+ * it for every call that thread makes. Compressors themselves stay const and
+ * can be shared between threads.
+ *
+ * Typical usage:
+ * @code
+ * compression::Lz77Compressor lz77;
+ * compression::CompressionContext context(lz77.scratchSize(4096));
+ * for (const auto& message : messages) {
+ *     auto packed = lz77.compress(message, context);
+ * }
+ * @endcode
+ */
+class CompressionContext {
+public:
+    /**
+     * @brief Creates a context, optionally pre-sizing its arena.
+     *
+     * @param reserveBytes Initial arena capacity in bytes. Use
+     *        ICompressor::scratchSize() to size it for a given compressor.
+     */
+    explicit CompressionContext(size_t reserveBytes = 0);
+
+    CompressionContext(const CompressionContext&) = delete;
+    CompressionContext& operator=(const CompressionContext&) = delete;
+    CompressionContext(CompressionContext&&) noexcept = default;
+    CompressionContext& operator=(CompressionContext&&) noexcept = default;
+
+    /**
+     * @brief Allocates an uninitialized array of @p count elements.
+     *
+     * Only trivial types may be allocated since the arena never runs
+     * destructors. The memory is released in bulk by reset().
+     *
+     * @tparam T Trivially copyable element type.
+     * @param count Number of elements.
+     * @return Pointer to the first element, suitably aligned for T.
+     */
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value,
+                      "CompressionContext can only hold trivial types");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported");
+        return static_cast<T*>(allocateBytes(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     * @brief RAII marker that hands back everything allocated within its lifetime.
+     *
+     * Compressors open a scope at the start of each call so nested users of
+     * the same context (e.g. BWT driving its Huffman stage) never release each
+     * other's memory. When the outermost scope closes the arena is reset().
+     */
+    class Scope {
+    public:
+        explicit Scope(CompressionContext& context)
+            : context_(context), block_(context.currentBlock_), offset_(context.offset_), used_(context.used_) {}
+        ~Scope() {
+            if (used_ == 0) {
+                context_.reset();
+            } else {
+                context_.currentBlock_ = block_;
+                context_.offset_ = offset_;
+                context_.used_ = used_;
+            }
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        CompressionContext& context_;
+        size_t block_;
+        size_t offset_;
+        size_t used_;
+    };
+
+    /**
+     * @brief Rewinds the arena so its memory can be reused by the next call.
+     *
+     * If the previous call needed more than one arena block, the blocks are
+     * coalesced into a single block large enough for that call.
+     */
+    void reset();
+
+    /**
+     * @brief Ensures at least @p bytes of arena capacity without further allocation.
+     *
+     * Outstanding allocations stay valid.
+     *
+     * @param bytes Required capacity in bytes.
+     */
+    void reserve(size_t bytes);
+
+    /**
+     * @brief Total bytes owned by the arena.
+     */
+    size_t capacity() const;
+
+    /**
+     * @brief Bytes handed out since the last reset().
+     */
+    size_t used() const { return used_; }
+
+    /**
+     * @brief Largest value used() has reached over the context's lifetime.
+     */
+    size_t peakUsage() const { return peak_; }
+
+    /**
+     * @brief Turns statistics collection on or off for calls using this context.
+     *
+     * Enabling keeps the statistics gathered so far; they accumulate until
+     * CompressionStats::reset(). Has no effect when the library was built
+     * with COMPRESSION_ENABLE_STATS=0.
+     */
+    void enableStats(bool enabled = true);
+
+    /**
+     * @brief Statistics sink for compressors, or nullptr if collection is off.
+     */
+    CompressionStats* stats() {
+#if COMPRESSION_ENABLE_STATS
+        return statsEnabled_ ? stats_.get() : nullptr;
+#else
+        return nullptr;
+#endif
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> memory;
+        size_t size = 0;
+    };
+
+    void* allocateBytes(size_t bytes, size_t alignment);
+    void addBlock(size_t minimumBytes);
+
+    std::vector<Block> blocks_;
+    size_t currentBlock_ = 0; // Index of the block we are bumping in
+    size_t offset_ = 0;       // Bump offset within the current block
+    size_t used_ = 0;
+    size_t peak_ = 0;
+
+    std::unique_ptr<CompressionStats> stats_;
+    bool statsEnabled_ = false;
+};
+
+} // namespace compression
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Set to 0 (CMake option COMPRESSION_ENABLE_STATS=OFF) to compile all
+// instrumentation out of the library
+#ifndef COMPRESSION_ENABLE_STATS
+#define COMPRESSION_ENABLE_STATS 1
+#endif
+
+namespace compression {
+
+/**
+ * @brief Per-call measurements reported by compressors.
+ *
+ * Compressors record one entry per pipeline stage (e.g. suffix sorting,
+ * MTF, RLE and entropy coding for BWT) plus algorithm counters such as
+ * match statistics and entropy table sizes. Stages of a nested compressor
+ * (BWT's Huffman stage) appear with a greater depth below their parent.
+ * Counters accumulate over calls until reset().
+ *
+ * Statistics are collected only into a CompressionContext whose stats were
+ * enabled, so an ordinary call pays one null check per stage.
+ */
+struct CompressionStats {
+    struct Stage {
+        std::string name;
+        int depth = 0;          // Nesting level, 0 for top-level stages
+        double seconds = 0.0;
+        uint64_t bytesIn = 0;
+        uint64_t bytesOut = 0;
+    };
+
+    std::vector<Stage> stages;
+
+    // Match finding (LZ77)
+    uint64_t literals = 0;        // Literal bytes emitted
+    uint64_t matches = 0;         // Matches emitted, long ones included
+    uint64_t matchedBytes = 0;    // Bytes covered by matches
+    uint64_t longMatches = 0;     // Matches found by long-distance matching
+    uint64_t repeatMatches = 0;   // Matches at one of the last few distances
+    uint64_t matchSearches = 0;   // Hash chain searches started
+    uint64_t chainSteps = 0;      // Chain candidates examined over all searches
+
+    // Entropy coding
+    uint64_t entropyTableBytes = 0; // Code tables written to the output
+
+    // Incompressible data copied to the output as is
+    uint64_t storedBytes = 0;
+
+    // Deduplication
+    uint64_t chunks = 0;
+    uint64_t duplicateChunks = 0;
+
+    double averageMatchLength() const {
+        return matches ? static_cast<double>(matchedBytes) / matches : 0.0;
+    }
+
+    // Fraction of input bytes emitted as literals
+    double literalRatio() const {
+        uint64_t total = literals + matchedBytes;
+        return total ? static_cast<double>(literals) / total : 0.0;
+    }
+
+    double averageChainSteps() const {
+        return matchSearches ? static_cast<double>(chainSteps) / matchSearches : 0.0;
+    }
+
+    void reset() { *this = CompressionStats(); }
+
+    /**
+     * @brief Adds the counters (not the stages) of another instance, e.g.
+     * one collected by a worker thread for part of the input.
+     */
+    void addCounters(const CompressionStats& other);
+
+    /**
+     * @brief Writes a human-readable report: a stage table, then non-zero counters.
+     */
+    void print(std::ostream& out) const;
+
+private:
+    friend class StageTimer;
+    int openStages_ = 0;
+};
+
+#if COMPRESSION_ENABLE_STATS
+
+/**
+ * @brief Records the duration of one stage into a stats object, if any.
+ *
+ * A stage ends when the timer is destroyed or stopped; stages started
+ * while another one is running are nested below it.
+ *
+ * @code
+ * StageTimer timer(context.stats(), "mtf", block.size());
+ * auto mtf = mtfCoder_.encode(block);
+ * timer.stop(mtf.size());
+ * @endcode
+ */
+class StageTimer {
+public:
+    StageTimer(CompressionStats* stats, const char* name, uint64_t bytesIn) : stats_(stats) {
+        if (stats_) {
+            index_ = stats_->stages.size();
+            stats_->stages.push_back({name, stats_->openStages_++, 0.0, bytesIn, 0});
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~StageTimer() { stop(); }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    // For stages that only learn their input size as they run
+    void setBytesIn(uint64_t bytes) {
+        if (stats_) {
+            stats_->stages[index_].bytesIn = bytes;
+        }
+    }
+
+    void setBytesOut(uint64_t bytes) {
+        if (stats_) {
+            stats_->stages[index_].bytesOut = bytes;
+        }
+    }
+
+    // Ends the stage before the timer goes out of scope
+    void stop() {
+        if (stats_) {
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+            stats_->stages[index_].seconds = elapsed.count();
+            stats_->openStages_--;
+            stats_ = nullptr;
+        }
+    }
+
+    void stop(uint64_t bytesOut) {
+        setBytesOut(bytesOut);
+        stop();
+    }
+
+private:
+    CompressionStats* stats_;
+    size_t index_ = 0;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#else
+
+class StageTimer {
+public:
+    StageTimer(CompressionStats*, const char*, uint64_t) {}
+    void setBytesIn(uint64_t) {}
+    void setBytesOut(uint64_t) {}
+    void stop() {}
+    void stop(uint64_t) {}
+};
+
+#endif
+
+} // namespace compression
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ICompressor.hpp"
+#include "FileFormat.hpp"
+#include <memory>
+#include <string>
+
+namespace compression {
+
+class Dictionary;
+
+/**
+ * @brief Creates the compressor for an algorithm ID, as recorded in file headers.
+ *
+ * @param id Algorithm to create.
+ * @param dictionary Optional dictionary; only lz77 and huffman accept one.
+ * @return std::unique_ptr<ICompressor> The configured compressor.
+ * @throws std::invalid_argument for unknown IDs or unsupported dictionary use.
+ */
+std::unique_ptr<ICompressor> createCompressor(format::AlgorithmID id,
+                                              std::shared_ptr<const Dictionary> dictionary = nullptr);
+
+/**
+ * @brief Creates a compressor from its command-line name.
+ *
+ * Names are those of format::stringToAlgorithmId(). Pipelines name their
+ * backend after a colon, e.g. "dedup:huffman"; plain "dedup" uses lz77 and
+ * plain "columnar" picks a backend per column.
+ * "bwt:cm" selects the context-mixing entropy stage of bwt ("bwt:huffman"
+ * is the same as "bwt").
+ *
+ * @param name Algorithm name.
+ * @param dictionary Optional dictionary; only lz77 and huffman accept one.
+ * @return std::unique_ptr<ICompressor> The configured compressor.
+ * @throws std::invalid_argument for unknown names or unsupported dictionary use.
+ */
+std::unique_ptr<ICompressor> createCompressor(const std::string& name,
+                                              std::shared_ptr<const Dictionary> dictionary = nullptr);
+
+} // namespace compression
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ICompressor.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace compression {
+
+/**
+ * @brief Context-mixing compressor on a binary range coder.
+ *
+ * Each byte is coded as eight binary decisions, most significant bit first.
+ * For every decision, adaptive bit models in order-0, order-1 and order-2
+ * contexts (the bits of the current byte so far, plus the previous one or
+ * two bytes) each predict the next bit. A small online-trained mixer combines
+ * their predictions in the logistic domain, an order-1 secondary estimation
+ * stage refines the result, and utils::RangeEncoder codes the bit with it.
+ *
+ * Because predictions follow the data as it changes and draw on the
+ * previous bytes, text and logs code well below the order-0 bound Huffman
+ * coding is limited to. The price is speed: every bit takes three model
+ * lookups, a mixer dot product and their updates in both directions, for
+ * about 1-2 MB/s. Meant for data that is written once and read rarely.
+ *
+ * Stream format: a mode byte (0 = modeled, 1 = stored), then for modeled
+ * streams the varint input size and the range coder output. Input that
+ * samples as random, or that the model does not shrink, is stored.
+ */
+class ContextMixingCompressor final : public ICompressor {
+public:
+    using ICompressor::compress;
+    using ICompressor::decompress;
+
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data) const override;
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data,
+                                  CompressionContext& context) const override;
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data) const override;
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data,
+                                    CompressionContext& context) const override;
+
+    /**
+     * @brief Model tables, which grow with the input up to about 21 MiB
+     *
+     * @param inputSize Size of the data to compress
+     * @return Arena bytes used by one compress() or decompress() call
+     */
+    size_t scratchSize(size_t inputSize) const override;
+
+    /**
+     * @brief Model tables plus input-sized output
+     */
+    size_t workingSetSize(size_t inputSize) const override;
+
+    // Order-2 contexts are hashed into a table of at most 2^MAX_ORDER2_BITS
+    // bit models; smaller inputs use smaller tables
+    static constexpr unsigned MIN_ORDER2_BITS = 16;
+    static constexpr unsigned MAX_ORDER2_BITS = 22;
+
+private:
+    // Gives benchmarks/ access to individual kernels
+    friend struct MicroBenchmarkAccess;
+
+    // Range-codes data with the mixed model; appends to output
+    void encodeModeled(const std::vector<uint8_t>& data, std::vector<uint8_t>& output,
+                       CompressionContext& context) const;
+    std::vector<uint8_t> decodeModeled(const uint8_t* data, size_t size, size_t originalSize,
+                                       CompressionContext& context) const;
+    // log2 of the order-2 table entries for an input of this size
+    static unsigned order2Bits(size_t inputSize);
+};
+
+} // namespace compression
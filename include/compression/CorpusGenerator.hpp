@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace compression {
+namespace utils {
+
+/**
+ * @brief Kinds of synthetic data, each shaped to exercise a different compressor path.
+ */
+enum class CorpusKind : uint8_t {
+    TEXT,    // Word-level Markov-chain prose
+    LOGS,    // Timestamped log lines from a few templates
+    RANDOM,  // Uniform random bytes (incompressible)
+    SPARSE,  // Fixed-size binary records, mostly zero bytes
+    RUNS,    // Long runs of repeated bytes
+    RECORDS, // JSON-lines records with repeated keys
+    METRICS, // Time series of little-endian 32-bit counters and float gauges
+    TABLE    // CSV export of an orders table
+};
+
+/**
+ * @brief All corpus kinds, in enum order.
+ */
+const std::vector<CorpusKind>& allCorpusKinds();
+
+/**
+ * @brief Lower-case name of a kind ("text", "logs", ...).
+ */
+std::string corpusKindToString(CorpusKind kind);
+
+/**
+ * @brief Parses a kind name.
+ *
+ * @throws std::invalid_argument for unknown names.
+ */
+CorpusKind stringToCorpusKind(const std::string& name);
+
+/**
+ * @brief Deterministic generator of representative benchmark data.
+ *
+ * Output depends only on the seed, kind and size: it uses its own PRNG
+ * (xoshiro256**) rather than <random> distributions, whose results differ
+ * between standard libraries, so a given seed produces the same bytes on
+ * every machine. A shorter output is a prefix of a longer one with the same
+ * seed. Large corpora can be streamed in fixed-size pieces without holding
+ * them in memory.
+ */
+class CorpusGenerator {
+public:
+    static constexpr uint64_t DEFAULT_SEED = 0x5EED;
+
+    // Bytes passed to a sink per call when streaming
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    using Sink = std::function<void(const uint8_t* data, size_t size)>;
+
+    explicit CorpusGenerator(uint64_t seed = DEFAULT_SEED) : seed_(seed) {}
+
+    /**
+     * @brief Generates @p size bytes of the given kind.
+     */
+    std::vector<uint8_t> generate(CorpusKind kind, size_t size) const;
+
+    /**
+     * @brief Streams @p size bytes of the given kind to @p sink.
+     *
+     * Every call but the last receives exactly CHUNK_SIZE bytes; the
+     * concatenation equals generate(kind, size).
+     */
+    void generate(CorpusKind kind, uint64_t size, const Sink& sink) const;
+
+    uint64_t seed() const { return seed_; }
+
+private:
+    uint64_t seed_;
+};
+
+} // namespace utils
+} // namespace compression
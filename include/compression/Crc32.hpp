@@ -1,10 +1,14 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 #include <array>
 
 namespace compression {
+
+class ThreadPool;
+
 namespace utils {
 
 /**
@@ -58,6 +62,33 @@ public:
     uint32_t calculate(const std::vector<uint8_t>& data) const {
         return calculate(data.data(), data.size());
     }
+
+    /**
+     * @brief Calculates the CRC32 checksum with segments checksummed in parallel.
+     *
+     * Segments of SEGMENT_SIZE bytes run as tasks on the pool and their
+     * checksums are joined with combine(); smaller inputs are checksummed
+     * on the calling thread.
+     *
+     * @param data Pointer to the data buffer.
+     * @param size Size of the data buffer in bytes.
+     * @param pool Pool to run the segments on.
+     * @return The calculated CRC32 checksum, equal to calculate(data, size).
+     */
+    uint32_t calculate(const uint8_t* data, size_t size, ThreadPool& pool) const;
+
+    /**
+     * @brief Computes the CRC32 of two concatenated buffers from their CRCs.
+     *
+     * @param crcA Checksum of the first buffer.
+     * @param crcB Checksum of the second buffer.
+     * @param lengthB Length of the second buffer in bytes.
+     * @return The checksum of the first buffer followed by the second.
+     */
+    static uint32_t combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB);
+
+    // Bytes per task in the parallel calculate()
+    static constexpr size_t SEGMENT_SIZE = 1024 * 1024;
 };
 
 // Static instance for easy use
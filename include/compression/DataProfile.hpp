@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace compression {
+namespace utils {
+
+/**
+ * @brief Cheap estimates of how compressible a buffer is, from a sample.
+ *
+ * Densities are fractions of the sampled bytes in [0, 1].
+ */
+struct DataProfile {
+    size_t sampledBytes = 0;
+    double entropy = 0.0;      // Order-0 entropy in bits per byte (0-8)
+    double matchDensity = 0.0; // Covered by repeats of earlier sampled 4-byte sequences
+    double runDensity = 0.0;   // Inside runs of at least RUN_MIN_LENGTH equal bytes
+
+    static constexpr size_t RUN_MIN_LENGTH = 4;
+
+    // Above this many bits per byte, entropy coding saves under 6%
+    static constexpr double INCOMPRESSIBLE_MIN_ENTROPY = 7.5;
+    // Below this, too little repeats for a match finder to pay off
+    static constexpr double INCOMPRESSIBLE_MAX_MATCH_DENSITY = 0.1;
+
+    /**
+     * @brief Whether neither a match finder nor an entropy coder is likely to
+     * gain anything, so the data is best stored as is.
+     */
+    bool likelyIncompressible() const {
+        return sampledBytes > 0 && entropy >= INCOMPRESSIBLE_MIN_ENTROPY &&
+               matchDensity < INCOMPRESSIBLE_MAX_MATCH_DENSITY;
+    }
+};
+
+/**
+ * @brief Profiles a buffer from evenly spaced sample windows.
+ *
+ * Buffers of up to windowCount * windowSize bytes are read in full, larger
+ * ones through windowCount windows of windowSize bytes spread across the
+ * buffer, so the cost is bounded regardless of input size. Match finding
+ * uses a single-entry hash table, like a fast LZ compressor's first pass,
+ * and sees repeats across windows.
+ *
+ * @param data Buffer to profile.
+ * @param size Buffer length.
+ * @param windowCount Number of sample windows.
+ * @param windowSize Bytes per window.
+ * @return DataProfile Estimates for the sample (all zero for an empty buffer).
+ */
+DataProfile profileData(const uint8_t* data, size_t size, size_t windowCount = 16,
+                        size_t windowSize = 4096);
+
+} // namespace utils
+} // namespace compression
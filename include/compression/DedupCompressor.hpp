@@ -0,0 +1,132 @@
+#pragma once
+
+#include "ICompressor.hpp"
+#include "FileFormat.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace compression {
+
+/**
+ * @brief FastCDC-style content-defined chunker.
+ *
+ * Boundaries are placed where a gear rolling hash has its top bits clear.
+ * Until the average size is reached a stricter condition applies, and after
+ * it a looser one (normalized chunking), which keeps chunk sizes close to the
+ * average. Because a boundary depends only on the bytes since the chunk
+ * start, an insertion early in a file only changes the chunks around it and
+ * duplicate regions line up again right after.
+ */
+class FastCdcChunker {
+public:
+    /**
+     * @brief Configures chunk sizes.
+     *
+     * @param minSize Smallest chunk (except the last one).
+     * @param averageSize Target chunk size, a power of two.
+     * @param maxSize Largest chunk.
+     * @throws std::invalid_argument if the sizes are not ordered or the average is not a power of two.
+     */
+    explicit FastCdcChunker(size_t minSize = 2048, size_t averageSize = 8192, size_t maxSize = 65536);
+
+    /**
+     * @brief Finds the length of the chunk starting at @p data.
+     *
+     * Works on partial input: with @p endOfInput false, a return value of 0
+     * means no boundary was found yet and more bytes are needed.
+     *
+     * @param data Start of the chunk.
+     * @param available Bytes available from @p data.
+     * @param endOfInput True if no bytes follow the available ones.
+     * @return size_t Chunk length, or 0 if more input is needed.
+     */
+    size_t nextChunk(const uint8_t* data, size_t available, bool endOfInput = true) const;
+
+    size_t minSize() const { return minSize_; }
+    size_t averageSize() const { return averageSize_; }
+    size_t maxSize() const { return maxSize_; }
+
+private:
+    size_t minSize_;
+    size_t averageSize_;
+    size_t maxSize_;
+    unsigned strictBits_; // Boundary test before the average size
+    unsigned looseBits_;  // Boundary test after the average size
+};
+
+/**
+ * @brief Deduplicating pipeline in front of another compressor.
+ *
+ * The input is split into content-defined chunks. Each chunk is
+ * fingerprinted, and repeats of a recent unique chunk become references, so
+ * only unique chunks reach the backend compressor. The output is a sequence
+ * of self-delimiting frames covering about FRAME_SIZE input bytes each.
+ *
+ * References reach back over a history of unique chunks. At the start of
+ * each frame, encoder and decoder both drop the oldest unique chunks until
+ * the rest total at most the stream's history size, so the history either
+ * side keeps is bounded by that size plus one frame, however long the
+ * stream, and decoded frames need not stay around for later references.
+ *
+ * Stream format:
+ *   backend algorithm ID (1 byte) | varint history size, then per frame:
+ *   varint record count | records | varint payload size | backend payload
+ * where a record is varint(length << 1) for a new chunk, whose bytes come
+ * next from the frame's payload, or varint(index << 1 | 1) to repeat the
+ * index-th new chunk of the stream, which must still be in the history.
+ */
+class DedupCompressor final : public ICompressor {
+public:
+    using ICompressor::compress;
+    using ICompressor::decompress;
+
+    // Input bytes covered by one frame
+    static constexpr size_t FRAME_SIZE = 4 * 1024 * 1024;
+
+    // Unique chunk bytes kept for references across frames by default
+    static constexpr size_t DEFAULT_HISTORY_SIZE = 64 * 1024 * 1024;
+
+    /**
+     * @brief Creates the pipeline.
+     *
+     * @param backend Algorithm that compresses the unique chunks.
+     * @param chunker Chunking parameters.
+     * @param historySize Unique chunk bytes kept for references at each frame
+     *        start; 0 finds repeats within a frame only. Recorded in the
+     *        stream, so decoding needs no option.
+     * @throws std::invalid_argument if the backend is unknown or is dedup itself.
+     */
+    explicit DedupCompressor(format::AlgorithmID backend = format::AlgorithmID::LZ77_COMPRESSOR,
+                             FastCdcChunker chunker = FastCdcChunker(),
+                             size_t historySize = DEFAULT_HISTORY_SIZE);
+
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data) const override;
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data,
+                                  CompressionContext& context) const override;
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data) const override;
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data,
+                                    CompressionContext& context) const override;
+
+    /**
+     * @brief Scratch needed by the backend for one frame.
+     */
+    size_t scratchSize(size_t inputSize) const override;
+
+    /**
+     * @brief Backend working set for one frame, plus the chunk history, index and output.
+     */
+    size_t workingSetSize(size_t inputSize) const override;
+
+    format::AlgorithmID backend() const { return backendId_; }
+    size_t historySize() const { return historySize_; }
+
+private:
+    format::AlgorithmID backendId_;
+    std::unique_ptr<ICompressor> backend_;
+    FastCdcChunker chunker_;
+    size_t historySize_;
+};
+
+} // namespace compression
@@ -107,6 +107,16 @@ public:
      */
     std::vector<uint8_t> compress(const std::vector<uint8_t>& data) const override;
     
+    /**
+     * @brief Compresses data, passing the context to the LZ77 stage.
+     * 
+     * @param data The data to compress.
+     * @param context Scratch memory reused across calls.
+     * @return The compressed data.
+     */
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data,
+                                  CompressionContext& context) const override;
+    
     /**
      * @brief Decompresses data that was compressed with the Deflate algorithm.
      * 
@@ -114,6 +124,23 @@ public:
      * @return The decompressed data.
      */
     std::vector<uint8_t> decompress(const std::vector<uint8_t>& data) const override;
+    using ICompressor::decompress;
+    
+    /**
+     * @brief Scratch bytes needed by the LZ77 stage.
+     * 
+     * @param inputSize Size of the data to compress.
+     * @return Arena bytes used by one compress() call.
+     */
+    size_t scratchSize(size_t inputSize) const override;
+    
+    /**
+     * @brief Working set of the LZ77 stage.
+     * 
+     * @param inputSize Size of the data to compress.
+     * @return Peak heap bytes of one compress() or decompress() call.
+     */
+    size_t workingSetSize(size_t inputSize) const override;
 
 private:
     // --- Internal Helpers --- 
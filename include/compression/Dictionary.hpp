@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace compression {
+
+/**
+ * @brief Shared content used to prime compressors for small inputs.
+ *
+ * Small messages (a few hundred bytes of JSON, log lines, RPC payloads)
+ * carry little redundancy of their own, but a lot of redundancy with each
+ * other. A dictionary captures that shared content once: LZ77 treats it as
+ * history preceding the input, and Huffman uses its byte statistics instead
+ * of transmitting a table. Both sides must use the same dictionary; its ID
+ * is recorded in the container header so a mismatch is detected.
+ */
+class Dictionary {
+public:
+    /**
+     * @brief Creates a dictionary from raw content.
+     *
+     * @param content Dictionary bytes; the most useful content should be at the end.
+     * @param id Dictionary ID. 0 derives one from the content's CRC32.
+     */
+    explicit Dictionary(std::vector<uint8_t> content, uint32_t id = 0);
+
+    /**
+     * @brief Non-zero identifier stored in container headers.
+     */
+    uint32_t id() const { return id_; }
+
+    /**
+     * @brief The dictionary bytes.
+     */
+    const std::vector<uint8_t>& content() const { return content_; }
+
+    /**
+     * @brief Byte histogram of the content, used to prime entropy coders.
+     */
+    const std::array<uint64_t, 256>& byteFrequencies() const { return byteFrequencies_; }
+
+    /**
+     * @brief Serializes the dictionary to the on-disk format.
+     *
+     * Format: magic "CDIC" | version (1) | id (4, LE) | size (4, LE) | content
+     *
+     * @return std::vector<uint8_t> Serialized dictionary.
+     */
+    std::vector<uint8_t> serialize() const;
+
+    /**
+     * @brief Parses a dictionary produced by serialize().
+     *
+     * @param buffer Serialized dictionary.
+     * @return Dictionary The parsed dictionary.
+     * @throws std::runtime_error if the buffer is not a valid dictionary.
+     */
+    static Dictionary deserialize(const std::vector<uint8_t>& buffer);
+
+private:
+    std::vector<uint8_t> content_;
+    uint32_t id_ = 0;
+    std::array<uint64_t, 256> byteFrequencies_{};
+};
+
+/**
+ * @brief Builds a dictionary from a corpus of sample messages.
+ *
+ * The trainer follows the COVER approach: it scores every short substring
+ * (d-mer) by the number of samples it appears in, splits the corpus into
+ * epochs, and from each epoch picks the fixed-length segment whose d-mers
+ * are most widely shared. Chosen d-mers stop counting towards later
+ * segments, so the dictionary covers as many distinct patterns as possible.
+ * Passes over the epochs repeat until the dictionary is full, so it ends up
+ * smaller than the maximum only when the samples run out of new d-mers.
+ * The best segments are placed last, closest to the data being compressed.
+ */
+class DictionaryTrainer {
+public:
+    /**
+     * @brief Configures the trainer.
+     *
+     * @param maxDictionarySize Upper bound on the dictionary size in bytes.
+     * @param segmentLength Length of each segment copied into the dictionary.
+     * @param dmerLength Length of the substrings used for scoring.
+     */
+    explicit DictionaryTrainer(size_t maxDictionarySize = 16 * 1024,
+                               size_t segmentLength = 64,
+                               size_t dmerLength = 8);
+
+    /**
+     * @brief Trains a dictionary from sample messages.
+     *
+     * @param samples Representative messages.
+     * @return Dictionary The trained dictionary.
+     * @throws std::invalid_argument if no sample is at least one d-mer long.
+     */
+    Dictionary train(const std::vector<std::vector<uint8_t>>& samples) const;
+
+private:
+    size_t maxDictionarySize_;
+    size_t segmentLength_;
+    size_t dmerLength_;
+};
+
+} // namespace compression
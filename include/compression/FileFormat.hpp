@@ -5,7 +5,7 @@
 #include <vector>
 #include <string>
 #include <stdexcept> // For std::runtime_error
-#include <algorithm> // For std::copy
+#include <algorithm> // For std::copy, std::all_of
 
 namespace compression {
 namespace format {
@@ -15,7 +15,14 @@ namespace format {
 constexpr std::array<uint8_t, 4> MAGIC_NUMBER = {
     'C', 'P', 'R', 'O'
 };
-constexpr uint8_t FORMAT_VERSION = 1;
+constexpr uint8_t FORMAT_VERSION = 2;
+constexpr uint8_t MIN_FORMAT_VERSION = 1; // Oldest version we can still read
+
+// Header flags (version 2+). Flags with a field append it after the flags byte.
+constexpr uint8_t HEADER_FLAG_DICTIONARY = 0x01; // uint32_t dictionary ID follows
+constexpr uint8_t HEADER_FLAG_STORED = 0x02;     // Payload is the original data, not compressed
+constexpr uint8_t HEADER_FLAG_FILTERS = 0x04;    // Filter count and (ID, width) pairs follow
+constexpr uint8_t KNOWN_HEADER_FLAGS = HEADER_FLAG_DICTIONARY | HEADER_FLAG_STORED | HEADER_FLAG_FILTERS;
 
 // Algorithm IDs (extend this as new algorithms are added)
 enum class AlgorithmID : uint8_t {
@@ -24,10 +31,51 @@ enum class AlgorithmID : uint8_t {
     HUFFMAN_COMPRESSOR = 2,
     LZ77_COMPRESSOR = 3,
     BWT_COMPRESSOR = 4,
+    DEDUP_COMPRESSOR = 5, // Payload names its backend algorithm
+    AUTO_COMPRESSOR = 6,  // Payload names the algorithm of each block
+    CONTEXT_MIXING_COMPRESSOR = 7,
+    PPM_COMPRESSOR = 8,
+    LZH_COMPRESSOR = 9,
+    COLUMNAR_COMPRESSOR = 10, // Payload names the algorithm of each column
     // Add future IDs here
     UNKNOWN = 255
 };
 
+// Preprocessing filter IDs (see Filters.hpp)
+enum class FilterID : uint8_t {
+    DELTA = 1,      // Byte-wise difference to the byte `width` positions back
+    SHUFFLE = 2,    // Bytes of `width`-byte elements regrouped by significance
+    BITSHUFFLE = 3, // Like SHUFFLE, then each byte group split into bit planes
+};
+
+// One filter of a chain: what it does, and the stride or element width it works on
+struct FilterSpec {
+    FilterID id = FilterID::DELTA;
+    uint8_t width = 1;
+
+    bool operator==(const FilterSpec& other) const { return id == other.id && width == other.width; }
+    bool operator!=(const FilterSpec& other) const { return !(*this == other); }
+};
+
+// Longest filter chain a header can record
+constexpr size_t MAX_FILTERS = 8;
+
+/**
+ * @brief Checks that a filter has a known ID and a width it supports.
+ *
+ * Deltas take any stride from 1, shuffles element widths from 2 and bit
+ * shuffles element widths from 1 (the bit planes of single bytes).
+ */
+inline bool isValidFilter(const FilterSpec& filter) {
+    switch (filter.id) {
+        case FilterID::DELTA: return filter.width >= 1;
+        case FilterID::SHUFFLE: return filter.width >= 2;
+        case FilterID::BITSHUFFLE: return filter.width >= 1;
+    }
+    return false;
+}
+
+// Size of the version 1 header, which is also the smallest header of any version
 constexpr size_t HEADER_SIZE = MAGIC_NUMBER.size() 
                                + sizeof(FORMAT_VERSION) 
                                + sizeof(AlgorithmID) 
@@ -44,8 +92,24 @@ struct FileHeader {
     AlgorithmID algorithmId = AlgorithmID::UNKNOWN;
     uint64_t originalSize = 0;
     uint32_t originalChecksum = 0; // Added CRC32 checksum
+    uint8_t flags = 0;             // Version 2+: HEADER_FLAG_* bits
+    uint32_t dictionaryId = 0;     // Non-zero if the payload needs a dictionary
+    std::vector<FilterSpec> filters; // Filters the input went through before compression, in order
 };
 
+/**
+ * @brief Computes the serialized size of a header.
+ * @param header The header; the size depends on its version and optional fields.
+ * @return Number of bytes the header occupies, i.e. the payload offset.
+ */
+inline size_t headerSize(const FileHeader& header) {
+    if (header.formatVersion < 2) {
+        return HEADER_SIZE;
+    }
+    return HEADER_SIZE + sizeof(uint8_t) + (header.dictionaryId != 0 ? sizeof(uint32_t) : 0) +
+           (header.filters.empty() ? 0 : sizeof(uint8_t) + 2 * header.filters.size());
+}
+
 // --- Serialization / Deserialization --- 
 
 /**
@@ -54,7 +118,14 @@ struct FileHeader {
  * @return A vector of bytes representing the serialized header.
  */
 inline std::vector<uint8_t> serializeHeader(const FileHeader& header) {
-    std::vector<uint8_t> buffer(HEADER_SIZE);
+    if (header.formatVersion < 2 && (header.flags != 0 || header.dictionaryId != 0 || !header.filters.empty())) {
+        throw std::invalid_argument("Header flags require format version 2 or later.");
+    }
+    if (header.filters.size() > MAX_FILTERS ||
+        !std::all_of(header.filters.begin(), header.filters.end(), isValidFilter)) {
+        throw std::invalid_argument("Header filter chain is too long or has an invalid filter.");
+    }
+    std::vector<uint8_t> buffer(headerSize(header));
     size_t offset = 0;
 
     // 1. Magic Number
@@ -77,14 +148,44 @@ inline std::vector<uint8_t> serializeHeader(const FileHeader& header) {
         buffer[offset++] = static_cast<uint8_t>((header.originalChecksum >> (i * 8)) & 0xFF);
     }
 
+    if (header.formatVersion < 2) {
+        return buffer;
+    }
+
+    // 6. Flags; the dictionary and filter flags always follow their fields
+    uint8_t flags = header.flags & ~(HEADER_FLAG_DICTIONARY | HEADER_FLAG_FILTERS);
+    if (header.dictionaryId != 0) {
+        flags |= HEADER_FLAG_DICTIONARY;
+    }
+    if (!header.filters.empty()) {
+        flags |= HEADER_FLAG_FILTERS;
+    }
+    buffer[offset++] = flags;
+
+    // 7. Dictionary ID (little-endian)
+    if (flags & HEADER_FLAG_DICTIONARY) {
+        for (int i = 0; i < 4; ++i) {
+            buffer[offset++] = static_cast<uint8_t>((header.dictionaryId >> (i * 8)) & 0xFF);
+        }
+    }
+
+    // 8. Filter chain: count, then ID and width of each filter in the order applied
+    if (flags & HEADER_FLAG_FILTERS) {
+        buffer[offset++] = static_cast<uint8_t>(header.filters.size());
+        for (const FilterSpec& filter : header.filters) {
+            buffer[offset++] = static_cast<uint8_t>(filter.id);
+            buffer[offset++] = filter.width;
+        }
+    }
+
     return buffer;
 }
 
 /**
  * @brief Deserializes header data from a byte vector.
  * @param buffer The byte vector containing the serialized header (must be at least HEADER_SIZE bytes).
- * @return The deserialized FileHeader.
- * @throws std::runtime_error if magic number or version is incorrect, or buffer is too small.
+ * @return The deserialized FileHeader. Use headerSize() to find where the payload starts.
+ * @throws std::runtime_error if magic number, version or flags are invalid, or buffer is too small.
  */
 inline FileHeader deserializeHeader(const std::vector<uint8_t>& buffer) {
     if (buffer.size() < HEADER_SIZE) {
@@ -102,7 +203,7 @@ inline FileHeader deserializeHeader(const std::vector<uint8_t>& buffer) {
 
     // 2. Read and Verify Format Version
     header.formatVersion = buffer[offset++];
-    if (header.formatVersion != FORMAT_VERSION) {
+    if (header.formatVersion < MIN_FORMAT_VERSION || header.formatVersion > FORMAT_VERSION) {
         throw std::runtime_error("Unsupported format version: " + std::to_string(header.formatVersion));
     }
 
@@ -121,6 +222,57 @@ inline FileHeader deserializeHeader(const std::vector<uint8_t>& buffer) {
         header.originalChecksum |= (static_cast<uint32_t>(buffer[offset++]) << (i * 8));
     }
 
+    if (header.formatVersion < 2) {
+        return header;
+    }
+
+    // 6. Read Flags
+    if (buffer.size() < offset + 1) {
+        throw std::runtime_error("Buffer too small to contain header flags.");
+    }
+    header.flags = buffer[offset++];
+    if (header.flags & ~KNOWN_HEADER_FLAGS) {
+        throw std::runtime_error("Unsupported header flags: " + std::to_string(header.flags));
+    }
+
+    // 7. Read Dictionary ID
+    if (header.flags & HEADER_FLAG_DICTIONARY) {
+        if (buffer.size() < offset + 4) {
+            throw std::runtime_error("Buffer too small to contain dictionary ID.");
+        }
+        for (int i = 0; i < 4; ++i) {
+            header.dictionaryId |= (static_cast<uint32_t>(buffer[offset++]) << (i * 8));
+        }
+        if (header.dictionaryId == 0) {
+            throw std::runtime_error("Invalid dictionary ID 0 in header.");
+        }
+    }
+
+    // 8. Read Filter Chain
+    if (header.flags & HEADER_FLAG_FILTERS) {
+        if (buffer.size() < offset + 1) {
+            throw std::runtime_error("Buffer too small to contain filter count.");
+        }
+        size_t count = buffer[offset++];
+        if (count == 0 || count > MAX_FILTERS) {
+            throw std::runtime_error("Invalid filter count in header: " + std::to_string(count));
+        }
+        if (buffer.size() < offset + 2 * count) {
+            throw std::runtime_error("Buffer too small to contain filter chain.");
+        }
+        for (size_t i = 0; i < count; ++i) {
+            FilterSpec filter;
+            filter.id = static_cast<FilterID>(buffer[offset++]);
+            filter.width = buffer[offset++];
+            if (!isValidFilter(filter)) {
+                throw std::runtime_error("Unsupported filter in header: " +
+                                         std::to_string(static_cast<int>(filter.id)) + ":" +
+                                         std::to_string(filter.width));
+            }
+            header.filters.push_back(filter);
+        }
+    }
+
     return header;
 }
 
@@ -136,6 +288,12 @@ inline std::string algorithmIdToString(AlgorithmID id) {
         case AlgorithmID::HUFFMAN_COMPRESSOR: return "huffman";
         case AlgorithmID::LZ77_COMPRESSOR: return "lz77";
         case AlgorithmID::BWT_COMPRESSOR: return "bwt";
+        case AlgorithmID::DEDUP_COMPRESSOR: return "dedup";
+        case AlgorithmID::AUTO_COMPRESSOR: return "auto";
+        case AlgorithmID::CONTEXT_MIXING_COMPRESSOR: return "cm";
+        case AlgorithmID::PPM_COMPRESSOR: return "ppm";
+        case AlgorithmID::LZH_COMPRESSOR: return "lzh";
+        case AlgorithmID::COLUMNAR_COMPRESSOR: return "columnar";
         default:                          return "unknown";
     }
 }
@@ -151,6 +309,12 @@ inline AlgorithmID stringToAlgorithmId(const std::string& name) {
     if (name == "huffman") return AlgorithmID::HUFFMAN_COMPRESSOR;
     if (name == "lz77") return AlgorithmID::LZ77_COMPRESSOR;
     if (name == "bwt") return AlgorithmID::BWT_COMPRESSOR;
+    if (name == "dedup") return AlgorithmID::DEDUP_COMPRESSOR;
+    if (name == "auto") return AlgorithmID::AUTO_COMPRESSOR;
+    if (name == "cm") return AlgorithmID::CONTEXT_MIXING_COMPRESSOR;
+    if (name == "ppm") return AlgorithmID::PPM_COMPRESSOR;
+    if (name == "lzh") return AlgorithmID::LZH_COMPRESSOR;
+    if (name == "columnar") return AlgorithmID::COLUMNAR_COMPRESSOR;
     // Add mappings for future algorithms
     return AlgorithmID::UNKNOWN;
 }
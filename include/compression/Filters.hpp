@@ -0,0 +1,84 @@
+#pragma once
+
+#include "FileFormat.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace compression {
+namespace utils {
+
+/**
+ * @brief Implementations of the shuffle kernels.
+ *
+ * Deltas are simple enough that the compiler vectorizes the scalar loops;
+ * the byte and bit transposes of SHUFFLE and BITSHUFFLE are not, and have
+ * hand-written SIMD versions for 2-, 4- and 8-byte elements.
+ */
+enum class FilterKernel {
+    AUTO,   // The fastest kernel this CPU supports
+    SCALAR, // Portable loops over cache-sized blocks
+    SSSE3   // 16 elements per step with byte shuffles and unpacks
+};
+
+/**
+ * @brief Whether a kernel can run on this build and CPU.
+ *
+ * AUTO and SCALAR always can; SSSE3 needs an x86-64 build with GCC or Clang
+ * and a CPU with SSSE3, which is detected at run time.
+ */
+bool filterKernelSupported(FilterKernel kernel);
+
+/**
+ * @brief Runs data through a chain of preprocessing filters, first to last.
+ *
+ * Filters make arrays of fixed-width numbers easier to compress and never
+ * change the size of the data:
+ * - DELTA with width N replaces each byte from the N-th on by its difference
+ *   to the byte N positions back, so slowly changing fields of N-byte
+ *   records become runs of small values.
+ * - SHUFFLE with width N splits N-byte elements into N streams, all first
+ *   bytes, then all second bytes and so on, so the rarely changing high
+ *   bytes of little-endian numbers line up.
+ * - BITSHUFFLE with width N shuffles like SHUFFLE over a multiple of 8
+ *   elements and then splits each byte stream into its 8 bit planes.
+ * Bytes after the last whole element (or group of 8 elements) pass through.
+ *
+ * @param data Input bytes.
+ * @param filters Filters to apply, in order.
+ * @param kernel Implementation to use.
+ * @return std::vector<uint8_t> Filtered bytes, as many as the input.
+ * @throws std::invalid_argument if a filter is invalid or the kernel is not supported.
+ */
+std::vector<uint8_t> applyFilters(const std::vector<uint8_t>& data,
+                                  const std::vector<format::FilterSpec>& filters,
+                                  FilterKernel kernel = FilterKernel::AUTO);
+
+/**
+ * @brief Undoes applyFilters() with the same chain, last filter first.
+ *
+ * @throws std::invalid_argument if a filter is invalid or the kernel is not supported.
+ */
+std::vector<uint8_t> reverseFilters(const std::vector<uint8_t>& data,
+                                    const std::vector<format::FilterSpec>& filters,
+                                    FilterKernel kernel = FilterKernel::AUTO);
+
+/**
+ * @brief Parses a filter chain such as "delta:4,shuffle:4".
+ *
+ * Filters are "delta[:stride]" (stride 1 if omitted), "shuffle:<width>" and
+ * "bitshuffle:<width>", separated by commas, with widths up to 255.
+ *
+ * @throws std::invalid_argument for unknown filters, bad widths or more than
+ *         format::MAX_FILTERS filters.
+ */
+std::vector<format::FilterSpec> parseFilterChain(const std::string& text);
+
+/**
+ * @brief Formats a filter chain the way parseFilterChain() reads it.
+ */
+std::string filterChainToString(const std::vector<format::FilterSpec>& filters);
+
+} // namespace utils
+} // namespace compression
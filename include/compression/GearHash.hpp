@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+namespace compression {
+namespace utils {
+
+// Random per-byte values (splitmix64 sequence), fixed so boundaries are stable
+struct GearTable {
+    uint64_t values[256];
+    constexpr GearTable() : values() {
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+        for (auto& value : values) {
+            state += 0x9E3779B97F4A7C15ull;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            value = z ^ (z >> 31);
+        }
+    }
+};
+
+inline constexpr GearTable GEAR_TABLE{};
+
+/**
+ * @brief Gear rolling hash used for content-defined boundaries.
+ *
+ * Each step shifts the hash left by one and adds a random value for the new
+ * byte, so bit k of the hash depends only on the last k + 1 bytes. The top
+ * bits therefore summarize the last 64 bytes, and testing them for zero
+ * places boundaries by content rather than by offset: inserting or deleting
+ * bytes only moves the boundaries near the edit.
+ */
+class GearHash {
+public:
+    /**
+     * @brief Mixes one more byte into the hash.
+     */
+    static constexpr uint64_t roll(uint64_t hash, uint8_t byte) {
+        return (hash << 1) + GEAR_TABLE.values[byte];
+    }
+
+    /**
+     * @brief True if the top @p bits of the hash are zero (probability 2^-bits).
+     */
+    static constexpr bool isBoundary(uint64_t hash, unsigned bits) {
+        return bits == 0 || (hash >> (64 - bits)) == 0;
+    }
+};
+
+} // namespace utils
+} // namespace compression
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace compression {
+namespace utils {
+
+// Count of each byte value in a buffer
+using ByteHistogram = std::array<uint32_t, 256>;
+
+/**
+ * @brief Implementations of the byte histogram kernel.
+ *
+ * Both count into several interleaved tables, so that runs of one byte
+ * value do not serialize on a single counter (a store followed by a load of
+ * the same address), and sum the tables at the end.
+ */
+enum class HistogramKernel {
+    AUTO,   // The fastest kernel this CPU supports
+    SCALAR, // Four tables fed from 8-byte loads; portable
+    AVX2    // Eight tables fed from 32-byte loads, tables summed with AVX2
+};
+
+/**
+ * @brief Whether a kernel can run on this build and CPU.
+ *
+ * AUTO and SCALAR always can; AVX2 needs an x86-64 build with GCC or Clang
+ * and a CPU with AVX2, which is detected at run time.
+ */
+bool histogramKernelSupported(HistogramKernel kernel);
+
+/**
+ * @brief Counts how often each byte value occurs in a buffer.
+ *
+ * @param data Buffer to count.
+ * @param size Buffer length; below 2^32 so that no count can overflow.
+ * @param kernel Implementation to use.
+ * @return ByteHistogram Occurrences of each byte value.
+ * @throws std::invalid_argument if the buffer is 4 GiB or larger, or the
+ *         kernel is not supported.
+ */
+ByteHistogram byteHistogram(const uint8_t* data, size_t size,
+                            HistogramKernel kernel = HistogramKernel::AUTO);
+
+/**
+ * @brief Adds the byte counts of a buffer of any size to 64-bit totals.
+ *
+ * @param data Buffer to count.
+ * @param size Buffer length.
+ * @param totals Counts to add to.
+ */
+void addByteHistogram(const uint8_t* data, size_t size, std::array<uint64_t, 256>& totals);
+
+} // namespace utils
+} // namespace compression
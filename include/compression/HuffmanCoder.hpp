@@ -1,8 +1,9 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <vector>
 #include <map>
-#include <queue>
 #include <memory>
 #include <cstdint>
 #include <functional>
@@ -20,11 +21,15 @@ using FrequencyMap = std::map<uint32_t, uint64_t>;
  * @brief Class that handles Huffman coding functionality
  * 
  * This class implements the Strategy design pattern for Huffman coding operations.
- * It provides methods to build Huffman codes from frequency data and work with
- * Huffman trees.
+ * It provides methods to build Huffman codes from frequency data. Codes are
+ * canonical, so code lengths alone describe them; no tree is ever built.
  */
 class HuffmanCoder {
 public:
+    // Largest alphabet computeCodeLengths() handles (Deflate's literal/length codes)
+    static constexpr size_t MAX_SYMBOLS = 288;
+    using CodeLengths = std::array<uint8_t, MAX_SYMBOLS>;
+
     /**
      * @brief Default constructor
      */
@@ -34,73 +39,94 @@ public:
      * @brief Builds Huffman codes from a frequency map
      * 
      * @param freqMap Frequency map of symbols
-     * @return HuffmanCodeMap Map of symbols to their Huffman codes
+     * @return HuffmanCodeMap Map of symbols to their canonical Huffman codes;
+     *         a lone symbol gets a 1-bit code
+     * @throws std::invalid_argument if more than MAX_SYMBOLS symbols occur
      */
     HuffmanCodeMap buildHuffmanCodes(const FrequencyMap& freqMap) const;
 
+    /**
+     * @brief Huffman code lengths without building a tree
+     * 
+     * Sorts the symbols by frequency and runs the in-place algorithm of
+     * Moffat and Katajainen over the sorted weights: one pass forms the
+     * internal nodes in the weight array itself, the next turns parent links
+     * into depths, and the last reads off the leaf depths. Everything lives
+     * in fixed arrays on the stack, so per-block tables cost no allocation.
+     * 
+     * @param frequencies Frequency of each symbol; zero means not coded
+     * @param symbolCount Number of symbols, at most MAX_SYMBOLS
+     * @return CodeLengths Length of each symbol's code (0 when not coded);
+     *         a lone symbol gets length 1
+     * @throws std::invalid_argument if symbolCount exceeds MAX_SYMBOLS
+     */
+    static CodeLengths computeCodeLengths(const uint64_t* frequencies, size_t symbolCount);
+
+    /**
+     * @brief Builds canonical Huffman codes no longer than maxLength bits
+     * 
+     * @param freqMap Frequency map of symbols
+     * @param maxLength Maximum code length in bits
+     * @return HuffmanCodeMap Canonical codes for buildLimitedCodeLengths()
+     * @throws std::invalid_argument if maxLength is not 1-32 or 2^maxLength < number of symbols
+     */
+    HuffmanCodeMap buildHuffmanCodes(const FrequencyMap& freqMap, uint8_t maxLength) const;
+
+    /**
+     * @brief Optimal code lengths under a length limit (package-merge)
+     * 
+     * Finds the lengths of minimum total coded size among all prefix codes
+     * whose codes are at most maxLength bits, so table-driven decoders can
+     * resolve any code with a single lookup of maxLength bits. Takes
+     * O(maxLength * n) time for n symbols. Equal frequencies are ordered by
+     * symbol, so the result depends only on the map.
+     * 
+     * @param freqMap Frequency map of symbols; zero frequencies get no code
+     * @param maxLength Maximum code length in bits
+     * @return std::map<uint32_t, uint8_t> Code length of every coded symbol;
+     *         a lone symbol gets length 1
+     * @throws std::invalid_argument if maxLength is not 1-32 or 2^maxLength < number of symbols
+     */
+    std::map<uint32_t, uint8_t> buildLimitedCodeLengths(
+        const FrequencyMap& freqMap,
+        uint8_t maxLength) const;
+
     /**
      * @brief Limits code lengths to a maximum value
      * 
+     * For when only lengths are known: overlong codes are cut to maxLength,
+     * then the longest codes still below maxLength are lengthened one bit
+     * at a time until the lengths satisfy the Kraft inequality again, so the
+     * result is always a valid prefix code. With frequencies at hand,
+     * buildLimitedCodeLengths() gives optimal lengths instead.
+     * 
      * @param inputLengths Map of symbols to their code lengths
      * @param maxLength Maximum allowed code length
      * @return std::map<uint32_t, uint8_t> Adjusted code lengths
+     * @throws std::invalid_argument if maxLength is not 1-32 or 2^maxLength < number of symbols
      */
     std::map<uint32_t, uint8_t> limitCodeLengths(
         const std::map<uint32_t, uint8_t>& inputLengths,
         uint8_t maxLength) const;
 
     /**
-     * @brief Gets code lengths from a Huffman code map
+     * @brief Assigns canonical codes to code lengths
      * 
-     * @param codeMap Map of symbols to their Huffman codes
-     * @return std::map<uint32_t, uint8_t> Map of symbols to their code lengths
-     */
-    std::map<uint32_t, uint8_t> getCodeLengths(const HuffmanCodeMap& codeMap) const;
-
-private:
-    // Structure for Huffman tree nodes
-    struct HuffmanNode {
-        uint32_t symbol;
-        uint64_t frequency;
-        std::unique_ptr<HuffmanNode> left = nullptr;
-        std::unique_ptr<HuffmanNode> right = nullptr;
-
-        // Leaf node constructor
-        HuffmanNode(uint32_t sym, uint64_t freq) 
-            : symbol(sym), frequency(freq) {}
-
-        // Internal node constructor
-        HuffmanNode(std::unique_ptr<HuffmanNode> l, std::unique_ptr<HuffmanNode> r)
-            : symbol(0), frequency(0), left(std::move(l)), right(std::move(r)) {
-            if (left) frequency += left->frequency;
-            if (right) frequency += right->frequency;
-        }
-
-        // Is this a leaf node?
-        bool isLeaf() const {
-            return left == nullptr && right == nullptr;
-        }
-    };
-
-    /**
-     * @brief Builds a Huffman tree from frequency data
+     * Codes of one length are consecutive in symbol order and shorter codes
+     * come first, as in Deflate, so the lengths alone define the codes.
      * 
-     * @param freqMap Frequency map of symbols
-     * @return std::unique_ptr<HuffmanNode> Root of the Huffman tree
+     * @param lengths Map of symbols to their code lengths (1-32 bits)
+     * @return HuffmanCodeMap Map of symbols to their codes
      */
-    std::unique_ptr<HuffmanNode> buildHuffmanTree(const FrequencyMap& freqMap) const;
+    HuffmanCodeMap buildCanonicalCodes(const std::map<uint32_t, uint8_t>& lengths) const;
 
     /**
-     * @brief Generates Huffman codes by traversing the tree
+     * @brief Gets code lengths from a Huffman code map
      * 
-     * @param node Current node in the tree
-     * @param prefix Current code prefix (path in the tree)
-     * @param codeMap Output map to store symbol-to-code mappings
+     * @param codeMap Map of symbols to their Huffman codes
+     * @return std::map<uint32_t, uint8_t> Map of symbols to their code lengths
      */
-    void generateCodes(
-        const HuffmanNode* node,
-        HuffmanCode prefix,
-        HuffmanCodeMap& codeMap) const;
+    std::map<uint32_t, uint8_t> getCodeLengths(const HuffmanCodeMap& codeMap) const;
 };
 
 } // namespace compression 
\ No newline at end of file
@@ -1,53 +1,200 @@
 #pragma once
 
 #include "ICompressor.hpp"
+#include <array>
 #include <vector>
 #include <map>
-#include <queue>
 #include <memory>
 #include <cstdint>
-#include <functional>
 
 namespace compression {
 
+class Dictionary;
+class ThreadPool;
+
 /**
  * @brief Implements ICompressor using Huffman coding.
  *
  * Uses canonical Huffman codes for potentially better efficiency.
  * Requires transmitting frequency table or tree structure.
+ *
+ * With a dictionary set, the codes can instead be derived from the
+ * dictionary's byte statistics, which saves the table for small inputs.
+ *
+ * Input that samples as random (see utils::DataProfile), or whose coded
+ * form is not smaller, is stored as is behind a 3-byte marker (1 byte in
+ * dictionary mode), so output never grows by more than that.
+ *
+ * Codes are at most maxCodeLength() bits. When the Huffman tree is deeper,
+ * the stream records the limit and both sides use optimal length-limited
+ * canonical codes instead (see HuffmanCoder::buildLimitedCodeLengths()).
+ *
+ * Large inputs can be coded in parallel segments (see setParallelBlockSize()):
+ * one code table built from per-segment histograms, and one bitstream per
+ * segment behind a table of segment lengths, so decoding runs in parallel too.
  */
 class HuffmanCompressor final : public ICompressor {
 public:
-    // Type aliases for clarity
-    using HuffmanCode = std::vector<bool>; // Sequence of bits (0s and 1s)
-    using HuffmanCodeMap = std::map<uint8_t, HuffmanCode>;
+    using ICompressor::compress;
+    using ICompressor::decompress;
+
     using FrequencyMap = std::map<uint8_t, uint64_t>;
 
-    // Structure for Huffman tree nodes
-    struct HuffmanNode {
-        uint8_t data;          
-        uint64_t frequency;      
-        std::unique_ptr<HuffmanNode> left = nullptr; // Ensure unique_ptr for ownership
-        std::unique_ptr<HuffmanNode> right = nullptr;
-
-        // Constructors using unique_ptr for children
-        HuffmanNode(uint8_t d, uint64_t freq) : data(d), frequency(freq) {}
-        HuffmanNode(std::unique_ptr<HuffmanNode> l, std::unique_ptr<HuffmanNode> r)
-            : data{}, frequency(0), left(std::move(l)), right(std::move(r)) {
-            if (left) frequency += left->frequency;
-            if (right) frequency += right->frequency;
+    /**
+     * @brief Huffman tree held in one fixed array, children linked by index
+     *
+     * 256 leaves need at most 255 internal nodes, so building a tree never
+     * allocates, which matters where a tree is built for every small block.
+     */
+    struct HuffmanTree {
+        static constexpr uint16_t NO_NODE = 0xFFFF;
+        static constexpr size_t MAX_NODES = 2 * 256;
+
+        struct Node {
+            uint16_t child[2] = {NO_NODE, NO_NODE}; // Followed on bit 0 and bit 1
+            uint8_t symbol = 0;
+            bool isLeaf() const { return child[0] == NO_NODE && child[1] == NO_NODE; }
+        };
+
+        std::array<Node, MAX_NODES> nodes;
+        uint16_t nodeCount = 0;
+        uint16_t root = NO_NODE; // NO_NODE for an empty tree
+
+        uint16_t addNode(uint16_t zero, uint16_t one, uint8_t symbol = 0) {
+            nodes[nodeCount].child[0] = zero;
+            nodes[nodeCount].child[1] = one;
+            nodes[nodeCount].symbol = symbol;
+            return nodeCount++;
         }
     };
 
+    // Code of each byte value, most significant bit first; length 0 means
+    // the byte has no code
+    struct CodeTable {
+        std::array<uint32_t, 256> bits{};
+        std::array<uint8_t, 256> lengths{};
+    };
+
     std::vector<uint8_t> compress(const std::vector<uint8_t>& data) const override;
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data,
+                                  CompressionContext& context) const override;
     std::vector<uint8_t> decompress(const std::vector<uint8_t>& data) const override;
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data,
+                                    CompressionContext& context) const override;
+
+    /**
+     * @brief Bit buffer and output for the payload, plus code tables.
+     *
+     * With a dictionary both candidate encodings are built before the
+     * smaller one is kept.
+     */
+    size_t workingSetSize(size_t inputSize) const override;
+
+    /**
+     * @brief Primes the code statistics with a pre-trained dictionary.
+     *
+     * Each compressed stream then starts with a mode byte: 0 means the codes
+     * come from the dictionary and no table is stored, 1 means the stream
+     * carries its own table, 2 means the input is stored, and 3 is mode 0 split into parallel segments. The cheaper mode is picked per input, and the
+     * same dictionary must be set for decompression.
+     *
+     * @param dictionary Shared dictionary, or nullptr to disable.
+     */
+    void setDictionary(std::shared_ptr<const Dictionary> dictionary);
+
+    /**
+     * @brief Code large inputs as independent segments in parallel
+     *
+     * Inputs longer than one segment are counted per segment, the counts
+     * merged into a single code table, and each segment encoded into its own
+     * bitstream. The stream records the length of every segment's bitstream,
+     * so decoding splits the same way. All segments share the table, so the
+     * ratio only loses the few bytes of the length table and per-segment
+     * padding. Segmented streams decode on the pool given here, or on
+     * ThreadPool::shared() if none is set.
+     *
+     * @param blockSize Input bytes per segment (at least MIN_PARALLEL_BLOCK_SIZE),
+     *        or 0 to code serially
+     * @param pool Pool the segments run on; nullptr means ThreadPool::shared()
+     * @throws std::invalid_argument if the segment size is too small
+     */
+    void setParallelBlockSize(size_t blockSize, ThreadPool* pool = nullptr);
+
+    /**
+     * @brief Current parallel segment size, 0 when coding serially
+     */
+    size_t parallelBlockSize() const { return parallelBlockSize_; }
+
+    static constexpr size_t MIN_PARALLEL_BLOCK_SIZE = 64 * 1024;
+    static constexpr size_t DEFAULT_PARALLEL_BLOCK_SIZE = 1024 * 1024;
+
+    /**
+     * @brief Caps the length of any code, so a table of 2^maxLength entries
+     * decodes every code with one lookup
+     *
+     * Only compression reads the limit; streams carry the limit they used.
+     *
+     * @param maxLength Bits per code, from SHORTEST_CODE_LENGTH_LIMIT (enough
+     *        for all 256 byte values) to LONGEST_CODE_LENGTH_LIMIT
+     * @throws std::invalid_argument if maxLength is out of range
+     */
+    void setMaxCodeLength(uint8_t maxLength);
+
+    uint8_t maxCodeLength() const { return maxCodeLength_; }
+
+    static constexpr uint8_t SHORTEST_CODE_LENGTH_LIMIT = 8;
+    static constexpr uint8_t LONGEST_CODE_LENGTH_LIMIT = 32;
+    static constexpr uint8_t DEFAULT_MAX_CODE_LENGTH = 15;
 
 private:
+    // Gives benchmarks/ access to individual kernels
+    friend struct MicroBenchmarkAccess;
+    
+    std::shared_ptr<const Dictionary> dictionary_;
+    // Built once in setDictionary() and shared read-only by every call
+    std::shared_ptr<const HuffmanTree> dictionaryTree_;
+    CodeTable dictionaryCodes_;
+    size_t dictionaryCodeLength_ = 0; // Longest of dictionaryCodes_
+    uint8_t maxCodeLength_ = DEFAULT_MAX_CODE_LENGTH;
+    size_t parallelBlockSize_ = 0;
+    ThreadPool* pool_ = nullptr;
+
+    // Table-carrying format: serialized frequency map followed by the payload
+    std::vector<uint8_t> compressWithTable(const std::vector<uint8_t>& data, CompressionStats* stats) const;
+    std::vector<uint8_t> decompressWithTable(const std::vector<uint8_t>& data, size_t offset) const;
+    // Dictionary format: mode byte, then dictionary codes or an embedded table
+    std::vector<uint8_t> compressWithDictionary(const std::vector<uint8_t>& data, CompressionStats* stats) const;
+    // Payload format: bits used in last byte (0 = all 8) | packed codes
+    void encodePayload(const uint8_t* data, size_t size, const CodeTable& codes,
+                       std::vector<uint8_t>& output) const;
+    std::vector<uint8_t> decodePayload(const uint8_t* payload, size_t size,
+                                       const HuffmanTree& tree) const;
+    // Segmented format: varint input size | varint segment size |
+    // varint payload size per segment | one payload per segment
+    void encodeSegments(const std::vector<uint8_t>& data, const CodeTable& codes,
+                        std::vector<uint8_t>& output) const;
+    std::vector<uint8_t> decodeSegments(const std::vector<uint8_t>& data, size_t offset,
+                                        const HuffmanTree& tree) const;
+    // Whether an input of this size is split into parallel segments
+    bool usesParallelSegments(size_t inputSize) const;
+    ThreadPool& pool() const;
+    // Dictionary byte counts plus one, so every byte value gets a code
+    FrequencyMap dictionaryFrequencyMap() const;
+    // Canonical codes of at most maxLength bits, and a tree to decode them
+    void buildLimitedCodes(const FrequencyMap& freqMap, uint8_t maxLength, CodeTable& codes) const;
+    void buildTreeFromCodes(const CodeTable& codes, HuffmanTree& tree) const;
+
     // --- Helper Methods (declarations) --- 
     FrequencyMap buildFrequencyMap(const std::vector<uint8_t>& data) const;
-    // Returns unique_ptr to root.
-    std::unique_ptr<HuffmanNode> buildHuffmanTree(const FrequencyMap& freqMap) const;
-    void generateCodes(const HuffmanNode* node, HuffmanCode prefix, HuffmanCodeMap& codeMap) const;
+    // Per-segment histograms counted on the pool, then merged
+    FrequencyMap buildFrequencyMapParallel(const std::vector<uint8_t>& data) const;
+    // Merges the two lightest nodes of an array heap until one is left; a
+    // lone symbol hangs off the root's 0 branch
+    void buildHuffmanTree(const FrequencyMap& freqMap, HuffmanTree& tree) const;
+    // Walks the tree without recursion. Returns the longest code, stopping at
+    // the first code longer than maxLength; codes is complete only if the
+    // result is at most maxLength.
+    size_t generateCodes(const HuffmanTree& tree, size_t maxLength, CodeTable& codes) const;
     std::vector<uint8_t> serializeFrequencyMap(const FrequencyMap& freqMap) const;
     FrequencyMap deserializeFrequencyMap(const std::vector<uint8_t>& buffer, size_t& offset) const;
 };
@@ -3,6 +3,9 @@
 #include <vector>
 #include <cstdint> // For uint8_t
 #include <stdexcept> // For potential exceptions
+#include <cstddef> // For size_t
+
+#include "CompressionContext.hpp"
 
 namespace compression {
 
@@ -40,6 +43,66 @@ public:
      * @throws std::runtime_error or derived class on decompression failure.
      */
     virtual std::vector<uint8_t> decompress(const std::vector<uint8_t>& data) const = 0;
+
+    /**
+     * @brief Compresses the input data using caller-owned scratch memory.
+     *
+     * Compressors that need temporary tables take them from @p context
+     * instead of the heap, so reusing one context per thread removes
+     * allocator churn on hot paths. The default forwards to compress(data).
+     *
+     * @param data The raw data to compress.
+     * @param context Scratch memory reused across calls.
+     * @return std::vector<uint8_t> The compressed data.
+     */
+    virtual std::vector<uint8_t> compress(const std::vector<uint8_t>& data,
+                                          CompressionContext& context) const {
+        (void)context;
+        return compress(data);
+    }
+
+    /**
+     * @brief Decompresses the input data using caller-owned scratch memory.
+     *
+     * @param data The compressed data to decompress.
+     * @param context Scratch memory reused across calls.
+     * @return std::vector<uint8_t> The original decompressed data.
+     */
+    virtual std::vector<uint8_t> decompress(const std::vector<uint8_t>& data,
+                                            CompressionContext& context) const {
+        (void)context;
+        return decompress(data);
+    }
+
+    /**
+     * @brief Scratch memory a single call needs for an input of the given size.
+     *
+     * Use it to size a CompressionContext up front. The estimate depends on
+     * the compressor's configuration (window, block size, ...).
+     *
+     * @param inputSize Size of the data passed to compress().
+     * @return size_t Arena bytes required, 0 if the compressor needs none.
+     */
+    virtual size_t scratchSize(size_t inputSize) const {
+        (void)inputSize;
+        return 0;
+    }
+
+    /**
+     * @brief Expected peak heap usage of one compress() or decompress() call.
+     *
+     * Covers everything the call allocates: scratch tables, intermediate
+     * buffers and the output, but not the caller's input. Use it to schedule
+     * jobs against a memory limit; it is an estimate for typical data and
+     * may be exceeded on pathological inputs. The default assumes the output
+     * is about as large as the input.
+     *
+     * @param inputSize Size of the uncompressed data.
+     * @return size_t Bytes of heap the larger of the two directions needs.
+     */
+    virtual size_t workingSetSize(size_t inputSize) const {
+        return scratchSize(inputSize) + inputSize;
+    }
 };
 
 } // namespace compression 
\ No newline at end of file
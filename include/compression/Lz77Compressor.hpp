@@ -6,11 +6,15 @@
 #include "ICompressor.hpp"
 #include <vector>
 #include <cstdint> // For uint types
-#include <unordered_map> // For hash table optimization
+#include <algorithm>
 #include <array>
+#include <memory>
 
 namespace compression {
 
+class Dictionary;
+class ThreadPool;
+
 /**
  * @class Lz77Compressor
  * @brief Implements LZ77 compression algorithm with advanced optimizations
@@ -21,6 +25,8 @@ namespace compression {
  * - Adaptive encoding for different match lengths and distances
  * - Advanced match scoring that considers multiple factors
  * - Aggressive match finding with multi-position lookahead
+ * - Spans that sample as incompressible skip match finding, and long
+ *   literal runs are stored raw instead of escaping every marker byte
  */
 class Lz77Compressor : public ICompressor {
 public:
@@ -33,8 +39,8 @@ public:
     // Symbol structure for intermediate format
     struct Lz77Symbol {
         uint32_t symbol = 0;         // Value in the range [0, 285]
-        size_t distance = 0;         // Distance for length-distance pairs
-        size_t length = 0;           // Length for length-distance pairs
+        uint32_t distance = 0;       // Distance for length-distance pairs (inputs are < 4 GiB)
+        uint32_t length = 0;         // Length for length-distance pairs
         uint8_t literal = 0;         // Literal value
         
         bool isLiteral() const { return symbol < 256; }
@@ -42,11 +48,41 @@ public:
         bool isEob() const { return symbol == EOB_SYMBOL; }
     };
     
+    /**
+     * @brief The last few match distances, most recent first
+     *
+     * Tables and records reuse the same distances over and over. The parser
+     * tries these before walking the hash chains, and encoders that code
+     * them with short codes (LzhCompressor) replay the same history, which
+     * every block starts afresh and every match updates.
+     */
+    struct RepeatOffsets {
+        static constexpr size_t COUNT = 3;
+        std::array<uint32_t, COUNT> distances = {1, 4, 8};
+        
+        // Position of distance in the history, or COUNT if it is not there
+        size_t find(uint32_t distance) const {
+            size_t index = 0;
+            while (index < COUNT && distances[index] != distance) {
+                index++;
+            }
+            return index;
+        }
+        
+        // Move distance to the front; a new one pushes out the oldest
+        void update(uint32_t distance) {
+            for (size_t i = std::min(find(distance), COUNT - 1); i > 0; --i) {
+                distances[i] = distances[i - 1];
+            }
+            distances[0] = distance;
+        }
+    };
+    
     /**
      * @brief Construct a new Lz77Compressor object
      * 
      * @param windowSize Size of the search window
-     * @param minMatchLength Minimum match length to consider
+     * @param minMatchLength Minimum match length to consider (at least 3; shorter lengths are escape codes)
      * @param maxMatchLength Maximum match length to consider
      * @param useGreedyParsing When true, uses simple greedy parsing instead of lazy parsing
      * @param useOptimalParsing When true, uses optimal parsing for better compression ratio
@@ -68,12 +104,161 @@ public:
      */
     std::vector<uint8_t> compress(const std::vector<uint8_t>& data) const override;
     
+    /**
+     * @brief Compress data using LZ77, taking the hash chains from a reusable context
+     * @param data Input data to compress
+     * @param context Scratch memory for the match finder
+     * @return Compressed data as a vector of bytes
+     */
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data,
+                                  CompressionContext& context) const override;
+    
     /**
      * @brief Decompress LZ77-compressed data
      * @param data Compressed data to decompress
      * @return Decompressed data as a vector of bytes
      */
     std::vector<uint8_t> decompress(const std::vector<uint8_t>& data) const override;
+    using ICompressor::decompress;
+    
+    /**
+     * @brief Scratch bytes needed for the hash head table and chain ring
+     * @param inputSize Size of the data to compress
+     * @return Arena bytes used by one compress() call
+     */
+    size_t scratchSize(size_t inputSize) const override;
+    
+    /**
+     * @brief Scratch plus the symbol stream, which worst case holds one symbol per byte
+     * @param inputSize Size of the data to compress
+     * @return Peak heap bytes of one compress() or decompress() call
+     */
+    size_t workingSetSize(size_t inputSize) const override;
+    
+    /**
+     * @brief A dictionary with its match-finder state prebuilt
+     *
+     * Digesting hashes the dictionary window once. The result is immutable,
+     * so one digest can be shared read-only by any number of threads and by
+     * every compressor with the same window configuration. Each compress call
+     * keeps its own small hash chains for the input and falls back to the
+     * digest's chains once those run out, so the dictionary is never
+     * re-hashed or copied into scratch tables.
+     */
+    class DigestedDictionary {
+    public:
+        /**
+         * @brief The dictionary this digest was built from
+         */
+        const Dictionary& dictionary() const { return *dictionary_; }
+        
+        /**
+         * @brief Dictionary bytes reachable from the input (the dictionary tail)
+         */
+        const std::vector<uint8_t>& window() const { return window_; }
+        
+    private:
+        friend class Lz77Compressor;
+        DigestedDictionary() = default;
+        
+        std::shared_ptr<const Dictionary> dictionary_;
+        std::vector<uint8_t> window_;
+        size_t hashBits_ = 0;
+        std::vector<uint32_t> head_; // Most recent window position (plus one) per full hash
+        std::vector<uint32_t> prev_; // Previous position (plus one) with the same hash
+    };
+    
+    /**
+     * @brief Prebuild the match-finder state for a dictionary
+     * @param dictionary Dictionary to digest
+     * @return Digest usable by any compressor with this window size
+     */
+    std::shared_ptr<const DigestedDictionary> digestDictionary(
+        std::shared_ptr<const Dictionary> dictionary) const;
+    
+    /**
+     * @brief Prime the match window with a pre-trained dictionary
+     *
+     * The tail of the dictionary (up to one window) is treated as history
+     * preceding every input, so matches can reference it from the first byte.
+     * The same dictionary must be set for decompression. This digests the
+     * dictionary; use setDigestedDictionary() to share one digest instead.
+     *
+     * @param dictionary Shared dictionary, or nullptr to disable
+     */
+    void setDictionary(std::shared_ptr<const Dictionary> dictionary);
+    
+    /**
+     * @brief Prime the match window with an already digested dictionary
+     * @param digested Digest from digestDictionary(), or nullptr to disable
+     * @throws std::invalid_argument if the digest was built for another window size
+     */
+    void setDigestedDictionary(std::shared_ptr<const DigestedDictionary> digested);
+    
+    /**
+     * @brief Enable long-distance matching beyond the 32 KB window
+     *
+     * A gear rolling hash marks content-defined anchors every few hundred
+     * bytes; anchors are indexed over the whole input so repeats far apart
+     * (e.g. duplicated files in a backup stream) are found and emitted as
+     * single long matches. Regular matching still runs in between. Streams
+     * using long matches decode with any Lz77Compressor.
+     *
+     * @param windowSize Furthest distance for long matches (up to
+     *        MAX_LONG_DISTANCE_WINDOW), or 0 to disable
+     * @throws std::invalid_argument if the window is too large
+     */
+    void setLongDistanceWindow(size_t windowSize);
+    
+    // Largest supported long-distance window (2 GiB)
+    static constexpr size_t MAX_LONG_DISTANCE_WINDOW = size_t(1) << 31;
+    
+    /**
+     * @brief Compress large inputs as blocks in parallel (pigz style)
+     *
+     * Inputs longer than one block are split into blocks that are parsed and
+     * encoded concurrently, each with the preceding window of input (32 KB)
+     * indexed as history, so matches still cross block boundaries and little
+     * ratio is lost. Encoded blocks are concatenated in order into an
+     * ordinary stream that decodes with any Lz77Compressor; for a given
+     * block size the output does not depend on the thread count. Long
+     * matches, when enabled, only reach within a block and its history.
+     *
+     * @param blockSize Input bytes per block (at least MIN_PARALLEL_BLOCK_SIZE),
+     *        or 0 to compress serially
+     * @param pool Pool the blocks run on; nullptr means ThreadPool::shared()
+     * @throws std::invalid_argument if the block size is too small
+     */
+    void setParallelBlockSize(size_t blockSize, ThreadPool* pool = nullptr);
+    
+    /**
+     * @brief Current parallel block size, 0 when compressing serially
+     */
+    size_t parallelBlockSize() const { return parallelBlockSize_; }
+    
+    static constexpr size_t MIN_PARALLEL_BLOCK_SIZE = 64 * 1024;
+    static constexpr size_t DEFAULT_PARALLEL_BLOCK_SIZE = 1024 * 1024;
+    
+    /**
+     * @brief Trade speed for ratio by setting the match search effort
+     *
+     * Levels 1-3 parse greedily with short hash chains, 4-9 parse lazily
+     * with chains growing to 4096 candidates. The default is DEFAULT_LEVEL.
+     * Any level decodes with any Lz77Compressor.
+     *
+     * @param level Level from MIN_LEVEL to MAX_LEVEL
+     * @throws std::invalid_argument if the level is out of range
+     */
+    void setLevel(int level);
+    
+    /**
+     * @brief Current compression level
+     */
+    int level() const { return level_; }
+    
+    static constexpr int MIN_LEVEL = 1;
+    static constexpr int MAX_LEVEL = 9;
+    static constexpr int DEFAULT_LEVEL = 6;
     
     /**
      * @brief Convert a length code to actual length
@@ -82,7 +267,39 @@ public:
      */
     static uint32_t getLengthFromCode(uint32_t code);
     
+protected:
+    /**
+     * @brief Encode one parsed block's symbols to bytes
+     *
+     * Every block is encoded on its own, and parallel blocks are concatenated
+     * in order, so subclasses replacing the byte format must make each
+     * block's encoding self-delimiting.
+     *
+     * @param symbols Literals and matches of the block, ending with EOB
+     * @return The encoded block
+     */
+    virtual std::vector<uint8_t> encodeSymbols(const std::vector<Lz77Symbol>& symbols) const;
+    
+    /**
+     * @brief The dictionary set for this compressor, nullptr without one
+     *
+     * Matches at the start of the input may reach back into its window().
+     */
+    const DigestedDictionary* digestedDictionary() const { return dictionary_.get(); }
+    
+    /**
+     * @brief Whether encodeSymbols() codes repeated distances more cheaply
+     *
+     * When true, the parser prefers a match at a RepeatOffsets distance over
+     * a slightly longer one elsewhere. The byte format codes every distance
+     * alike, so Lz77Compressor itself only uses them to cut searches short.
+     */
+    virtual bool codesRepeatOffsets() const { return false; }
+    
 private:
+    // Gives benchmarks/ access to individual kernels
+    friend struct MicroBenchmarkAccess;
+    
     // Configuration parameters
     size_t windowSize_;
     size_t minMatchLength_;
@@ -94,8 +311,83 @@ private:
     // Hash table configuration
     size_t hashBits_ = 15;
     size_t maxHashChainLength_ = 64;
+    int level_ = DEFAULT_LEVEL;
     size_t hashChainLimit_ = 8192;
     
+    // Long-distance matching window, 0 when disabled
+    size_t longDistanceWindow_ = 0;
+    
+    // Parallel block mode, off when the block size is 0
+    size_t parallelBlockSize_ = 0;
+    ThreadPool* pool_ = nullptr;
+    
+    // Optional dictionary used as history before the input
+    std::shared_ptr<const DigestedDictionary> dictionary_;
+    
+    // Longest match the byte format can represent (length is stored in one byte)
+    static constexpr size_t MAX_ENCODED_MATCH = 255;
+    // Furthest distance the byte format can represent
+    static constexpr size_t MAX_ENCODED_DISTANCE = 32768;
+    // Byte format: 0xFF introduces a match; a length byte below 3 is an escape
+    static constexpr uint8_t MATCH_MARKER = 0xFF;
+    static constexpr uint8_t ESCAPE_LITERAL = 0;    // 0xFF 0x00: literal 0xFF
+    static constexpr uint8_t ESCAPE_LONG_MATCH = 1; // 0xFF 0x01 varint(length) varint(distance)
+    static constexpr uint8_t ESCAPE_STORED = 2;     // 0xFF 0x02 varint(length) raw bytes
+    // Input span judged at once by the incompressibility probe, and the
+    // sample it reads (windows x bytes)
+    static constexpr size_t PROBE_SPAN = 64 * 1024;
+    static constexpr size_t PROBE_WINDOWS = 4;
+    static constexpr size_t PROBE_WINDOW_SIZE = 1024;
+    // Matches longer than this end the search at once
+    static constexpr size_t EXCELLENT_MATCH_LENGTH = 64;
+    // A match at a repeat distance this long ends the search before the chains
+    static constexpr size_t GOOD_REPEAT_MATCH_LENGTH = 16;
+    // Score added to matches at a repeat distance when the encoder codes them
+    // cheaply, in bytes saved (see matchScore())
+    static constexpr float REPEAT_MATCH_BONUS = 1.5f;
+    // Block hashed by the long-distance matcher; also its shortest match
+    static constexpr size_t LONG_MATCH_BLOCK = 64;
+    
+    // Bytes covered by one hash; the last HASH_BYTES - 1 dictionary positions
+    // hash together with the input and are indexed per call
+    static constexpr size_t HASH_BYTES = 3;
+    
+    /**
+     * @brief Bytes the parser reads: history followed by the input
+     *
+     * Points into the caller's input, a dictionary window carved from the
+     * context arena or a digested dictionary, so parsing never copies into
+     * a heap buffer of its own.
+     */
+    struct ByteSpan {
+        const uint8_t* bytes = nullptr;
+        size_t length = 0;
+        
+        ByteSpan(const uint8_t* data, size_t size) : bytes(data), length(size) {}
+        ByteSpan(const std::vector<uint8_t>& data) : bytes(data.data()), length(data.size()) {}
+        
+        const uint8_t* data() const { return bytes; }
+        size_t size() const { return length; }
+        const uint8_t& operator[](size_t pos) const { return bytes[pos]; }
+    };
+    
+    /**
+     * @brief Hash chains living in a CompressionContext arena
+     *
+     * head[h] holds the most recent position (plus one, 0 = empty) whose
+     * triplet hashes to h; prev[] is a ring indexed by position that links
+     * each position to the previous one with the same hash. When a digested
+     * dictionary is set, its chains continue where the per-call chains end.
+     */
+    struct HashChains {
+        uint32_t* head = nullptr;
+        uint32_t* prev = nullptr;
+        uint32_t hashMask = 0;
+        size_t windowMask = 0;
+        const DigestedDictionary* dictionary = nullptr;
+        CompressionStats* stats = nullptr; // Search counters, when collecting
+    };
+    
     // Match structure with improved value calculation
     struct Match {
         size_t distance = 0;
@@ -117,33 +409,91 @@ private:
         }
     };
     
+    // A verified long-distance match found ahead of parsing
+    struct LongMatch {
+        size_t position = 0;
+        size_t length = 0;
+        size_t distance = 0;
+    };
+    
+    // Long-distance index entry: block start (plus one, 0 = empty) and hash check bits
+    struct LongMatchEntry {
+        uint32_t position;
+        uint32_t check;
+    };
+    
+    // Index bits and anchor spacing for the long-distance matcher
+    void longMatchTableBits(size_t inputSize, size_t& hashBits, size_t& anchorBits) const;
+    
+    // Find long matches at positions >= start, in increasing order
+    std::vector<LongMatch> findLongMatches(ByteSpan data, size_t start,
+                                           CompressionContext& context) const;
+    
     // Enhanced hash function with better distribution
-    uint32_t hashTriplet(const std::vector<uint8_t>& data, size_t pos) const;
+    uint32_t hashTriplet(ByteSpan data, size_t pos) const;
+    
+    // Allocate and clear hash chains sized for the given input
+    HashChains createHashChains(size_t inputSize, CompressionContext& context) const;
+    
+    // Hash table bits actually used for an input (small inputs get smaller tables)
+    size_t effectiveHashBits(size_t inputSize) const;
+    
+    // Entries in the chain ring for an input
+    size_t chainRingSize(size_t inputSize) const;
     
-    // Update hash table with better management for long chains
-    void updateHashTable(std::unordered_map<uint32_t, std::vector<size_t>>& hashTable, 
-                          const std::vector<uint8_t>& data, size_t pos) const;
+    // Insert a position at the head of its hash chain
+    void updateHashTable(HashChains& chains, ByteSpan data, size_t pos) const;
     
-    // Find best match with improved search strategy
-    Match findBestMatchAt(const std::vector<uint8_t>& data, size_t pos, 
-                         const std::unordered_map<uint32_t, std::vector<size_t>>& hashTable) const;
+    // Find best match with improved search strategy; the repeat distances,
+    // if given, are tried first and a long enough match there ends the search
+    Match findBestMatchAt(ByteSpan data, size_t pos,
+                         const HashChains& chains,
+                         const RepeatOffsets* repeats = nullptr) const;
     
     // Advanced match scoring for better match selection
     float scoreMatch(const Match& match) const;
     
+    // Bytes a match saves, as the chain search ranks candidates
+    static float matchScore(size_t length, size_t distance);
+    
     // Get the length code for encoding
     uint32_t getLengthCode(size_t length) const;
     
-    // Compress to intermediate symbol representation
-    std::vector<Lz77Symbol> compressToSymbols(const std::vector<uint8_t>& data) const;
+    // Dictionary bytes that precede the input in the match window
+    size_t dictionaryPrefixSize() const;
+    
+    // Positions hashed per call: the input plus the dictionary positions
+    // whose hash reaches into it
+    size_t localSpan(size_t inputSize) const;
+    
+    // Compress to intermediate symbol representation; bytes before start are
+    // history (a dictionary window or the preceding input) and are searchable
+    // but not emitted. With prefixChains the history comes pre-indexed,
+    // otherwise it is hashed per call
+    std::vector<Lz77Symbol> compressToSymbols(ByteSpan data,
+                                              size_t start,
+                                              CompressionContext& context,
+                                              const DigestedDictionary* prefixChains) const;
+    
+    // Parse and encode data[start..] with the bytes before start as history
+    std::vector<uint8_t> compressBlock(ByteSpan data, size_t start,
+                                       const DigestedDictionary* prefixChains,
+                                       CompressionContext& context) const;
+    
+    // Whether an input of this size is split into parallel blocks
+    bool usesParallelBlocks(size_t inputSize) const;
+    
+    // Parallel block mode of compress()
+    std::vector<uint8_t> compressParallel(const std::vector<uint8_t>& data,
+                                          CompressionContext& context) const;
     
-    // Encode symbols to bytes
-    std::vector<uint8_t> encodeSymbols(const std::vector<Lz77Symbol>& symbols) const;
+    // Scratch for one serial compress() call on this many bytes
+    size_t serialScratchSize(size_t inputSize) const;
     
     // Optimal parsing using dynamic programming
     std::vector<Lz77Symbol> optimalParse(
         const std::vector<uint8_t>& data,
-        std::unordered_map<uint32_t, std::vector<size_t>>& hashTable) const;
+        HashChains& chains) const;
 };
 
 } // namespace compression
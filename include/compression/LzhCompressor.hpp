@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Lz77Compressor.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace compression {
+
+/**
+ * @brief LZ77 with entropy-coded literals, lengths and offsets (LZH).
+ *
+ * Parses exactly like Lz77Compressor, with the same levels, dictionaries,
+ * long-distance matching and parallel blocks, but codes the parse far more
+ * compactly. Each match and the literal run before it form a sequence, and
+ * the parse is split into four streams: literals, literal run lengths, match
+ * lengths and offsets. Each stream gets its own canonical Huffman code of at
+ * most MAX_CODE_LENGTH bits, so one table lookup decodes any code. Run
+ * lengths, match lengths and offsets are coded as a logarithmic bucket
+ * followed by its raw low bits in the same stream, which keeps the alphabets
+ * small whatever the window size.
+ *
+ * Stream format: one block per parsed block (the whole input, or each
+ * parallel block), concatenated. A block is the varint decoded size, the
+ * varint sequence count, then per stream a code table and the varint size
+ * of its bitstream, and then the four bitstreams. A code table is a kind
+ * byte (0 = unused, 1 = Huffman, 2 = raw bytes, literals only), followed for
+ * Huffman tables by the varint symbol count and one 4-bit code length per
+ * symbol. Literals that Huffman coding does not shrink are kept raw, so
+ * random input grows by a few bytes at most.
+ */
+class LzhCompressor final : public Lz77Compressor {
+public:
+    // Longest code in any stream; decoding tables have 2^MAX_CODE_LENGTH entries
+    static constexpr unsigned MAX_CODE_LENGTH = 12;
+
+    /**
+     * @brief Construct an LZH compressor with the default lz77 parser settings
+     */
+    LzhCompressor();
+
+    using Lz77Compressor::compress;
+    using ICompressor::decompress;
+
+    /**
+     * @brief Decompress LZH-compressed data
+     * @param data Compressed data to decompress
+     * @return Decompressed data as a vector of bytes
+     * @throws std::runtime_error if the stream is malformed
+     */
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data) const override;
+
+protected:
+    std::vector<uint8_t> encodeSymbols(const std::vector<Lz77Symbol>& symbols) const override;
+    bool codesRepeatOffsets() const override;
+
+private:
+    // Decode the block at offset onto output and advance offset past it
+    static void decodeBlock(const std::vector<uint8_t>& data, size_t& offset,
+                            std::vector<uint8_t>& output);
+};
+
+} // namespace compression
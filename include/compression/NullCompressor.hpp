@@ -12,6 +12,9 @@ namespace compression {
  */
 class NullCompressor final : public ICompressor {
 public:
+    using ICompressor::compress;
+    using ICompressor::decompress;
+
     /**
      * @brief Does not compress the data, simply returns the original.
      *
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ICompressor.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace compression {
+
+/**
+ * @brief PPM (prediction by partial matching) compressor.
+ *
+ * Predicts each byte from the longest previous context, up to the model
+ * order, in which it has been seen before. The model is a tree of contexts
+ * linked to their one-byte-shorter suffixes, each holding the bytes that
+ * followed it and how often. A byte that a context has not seen is coded as
+ * an escape, and the next shorter context tries again without the bytes just
+ * ruled out, down to a flat order -1 distribution. Escape probabilities are
+ * learned from how often similar contexts escaped before. Symbols and
+ * escapes are coded with utils::SymbolRangeEncoder.
+ *
+ * The tree lives in a suballocator over one block of at most the memory
+ * limit, carved from the CompressionContext. When the block runs out the
+ * model restarts empty, so memory use stays fixed however large the input.
+ * Long repeated contexts make this the best ratio on text, at about 3 MB/s
+ * in both directions.
+ *
+ * Stream format: a mode byte (0 = modeled, 1 = stored), then for modeled
+ * streams the varint input size, the model order, the varint memory limit
+ * in MiB and the range coder output. Input that samples as random, or that
+ * the model does not shrink, is stored.
+ */
+class PpmCompressor final : public ICompressor {
+public:
+    static constexpr unsigned MIN_ORDER = 2;
+    static constexpr unsigned MAX_ORDER = 16;
+    static constexpr unsigned DEFAULT_ORDER = 8;
+    static constexpr size_t MIN_MEMORY_LIMIT = size_t(1) << 20;
+    static constexpr size_t MAX_MEMORY_LIMIT = size_t(1) << 30;
+    static constexpr size_t DEFAULT_MEMORY_LIMIT = size_t(64) << 20;
+
+    /**
+     * @brief Constructs a PPM compressor.
+     *
+     * @param order Longest context used, in bytes (MIN_ORDER to MAX_ORDER).
+     * @param memoryLimit Model memory in bytes, MIN_MEMORY_LIMIT to
+     *        MAX_MEMORY_LIMIT; rounded down to whole MiB.
+     * @throws std::invalid_argument if either is out of range.
+     */
+    explicit PpmCompressor(unsigned order = DEFAULT_ORDER, size_t memoryLimit = DEFAULT_MEMORY_LIMIT);
+
+    using ICompressor::compress;
+    using ICompressor::decompress;
+
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data) const override;
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data,
+                                  CompressionContext& context) const override;
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data) const override;
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& data,
+                                    CompressionContext& context) const override;
+
+    /**
+     * @brief Sets the longest context used.
+     * @throws std::invalid_argument outside MIN_ORDER to MAX_ORDER.
+     */
+    void setOrder(unsigned order);
+    unsigned order() const { return order_; }
+
+    /**
+     * @brief Caps the model memory; decompression uses the limit in the stream.
+     * @throws std::invalid_argument outside MIN_MEMORY_LIMIT to MAX_MEMORY_LIMIT.
+     */
+    void setMemoryLimit(size_t bytes);
+    size_t memoryLimit() const { return memoryLimit_; }
+
+    /**
+     * @brief Model memory: the memory limit, or less for inputs that cannot fill it
+     *
+     * @param inputSize Size of the data to compress
+     * @return Arena bytes used by one compress() call
+     */
+    size_t scratchSize(size_t inputSize) const override;
+
+    /**
+     * @brief Model memory plus input-sized output
+     */
+    size_t workingSetSize(size_t inputSize) const override;
+
+private:
+    // Gives benchmarks/ access to individual kernels
+    friend struct MicroBenchmarkAccess;
+
+    // Range-codes data with the context model; appends to output
+    static void encodeModeled(const std::vector<uint8_t>& data, std::vector<uint8_t>& output,
+                              unsigned order, size_t memoryLimit, CompressionContext& context);
+    static std::vector<uint8_t> decodeModeled(const uint8_t* data, size_t size, size_t originalSize,
+                                              unsigned order, size_t memoryLimit,
+                                              CompressionContext& context);
+    // Bytes the model gets for this input; the decoder must arrive at the same
+    static size_t modelMemory(size_t inputSize, unsigned order, size_t memoryLimit);
+
+    unsigned order_;
+    size_t memoryLimit_;
+};
+
+} // namespace compression
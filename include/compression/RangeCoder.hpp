@@ -0,0 +1,240 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace compression {
+namespace utils {
+
+// Probabilities passed to the range coder are 12-bit: the chance that the
+// next bit is 1, times 4096, clamped by the model to [1, 4095]
+constexpr unsigned RANGE_CODER_PROBABILITY_BITS = 12;
+
+/**
+ * @brief Most events a byte of coder output can hold when no event is coded
+ * with a probability above 1 - 1/n.
+ *
+ * Such an event costs -log2(1 - 1/n) > 1 / (n ln 2) bits, and ln 2 < 710/1024.
+ * Decoders use this to reject streams that claim more data than they hold.
+ */
+constexpr uint64_t maxEventsPerCodedByte(uint64_t n) { return 8 * n * 710 / 1024; }
+
+/**
+ * @brief Binary arithmetic (range) encoder.
+ *
+ * Keeps a 32-bit interval [low, high] and splits it in proportion to the
+ * probability of a 1 for every bit coded. Once the top byte of both ends
+ * agrees it can no longer change and is written out, so the coder needs no
+ * carry propagation. Coding a bit of probability p costs -log2(p) bits, which
+ * lets adaptive models get below the order-0 bound of Huffman codes.
+ *
+ * @code
+ * std::vector<uint8_t> out;
+ * utils::RangeEncoder encoder(out);
+ * encoder.encode(bit, model.p());
+ * encoder.flush();
+ * @endcode
+ */
+class RangeEncoder {
+public:
+    explicit RangeEncoder(std::vector<uint8_t>& output) : output_(output) {}
+
+    /**
+     * @brief Codes one bit.
+     *
+     * @param bit The bit, 0 or 1.
+     * @param probability Chance of a 1 in 1/4096 units, from 1 to 4095.
+     */
+    void encode(unsigned bit, uint32_t probability) {
+        uint32_t mid = low_ + static_cast<uint32_t>(
+            (static_cast<uint64_t>(high_ - low_) * probability) >> RANGE_CODER_PROBABILITY_BITS);
+        if (bit) {
+            high_ = mid;
+        } else {
+            low_ = mid + 1;
+        }
+        while (((low_ ^ high_) & 0xFF000000) == 0) {
+            output_.push_back(static_cast<uint8_t>(high_ >> 24));
+            low_ <<= 8;
+            high_ = (high_ << 8) | 0xFF;
+        }
+    }
+
+    /**
+     * @brief Writes the bytes the decoder needs to resolve the last bits.
+     */
+    void flush() {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            output_.push_back(static_cast<uint8_t>(low_ >> shift));
+        }
+    }
+
+private:
+    std::vector<uint8_t>& output_;
+    uint32_t low_ = 0;
+    uint32_t high_ = 0xFFFFFFFF;
+};
+
+/**
+ * @brief Decoder for RangeEncoder output.
+ *
+ * Must be given the same probabilities, in the same order, as the encoder.
+ * Reading past the end of the input yields zero bytes, so a truncated stream
+ * decodes to garbage rather than failing; callers check the decoded size.
+ */
+class RangeDecoder {
+public:
+    RangeDecoder(const uint8_t* data, size_t size) : data_(data), end_(data + size) {
+        for (int i = 0; i < 4; ++i) {
+            code_ = (code_ << 8) | nextByte();
+        }
+    }
+
+    /**
+     * @brief Decodes one bit.
+     *
+     * @param probability Chance of a 1 in 1/4096 units, from 1 to 4095.
+     * @return unsigned The bit.
+     */
+    unsigned decode(uint32_t probability) {
+        uint32_t mid = low_ + static_cast<uint32_t>(
+            (static_cast<uint64_t>(high_ - low_) * probability) >> RANGE_CODER_PROBABILITY_BITS);
+        unsigned bit = code_ <= mid;
+        if (bit) {
+            high_ = mid;
+        } else {
+            low_ = mid + 1;
+        }
+        while (((low_ ^ high_) & 0xFF000000) == 0) {
+            low_ <<= 8;
+            high_ = (high_ << 8) | 0xFF;
+            code_ = (code_ << 8) | nextByte();
+        }
+        return bit;
+    }
+
+private:
+    uint8_t nextByte() { return data_ < end_ ? *data_++ : 0; }
+
+    const uint8_t* data_;
+    const uint8_t* end_;
+    uint32_t low_ = 0;
+    uint32_t high_ = 0xFFFFFFFF;
+    uint32_t code_ = 0;
+};
+
+// Symbol frequencies passed to the symbol range coder must total less than
+// this, so that every symbol keeps a non-empty range
+constexpr uint32_t SYMBOL_RANGE_CODER_MAX_TOTAL = 1u << 16;
+
+/**
+ * @brief Multi-symbol range encoder.
+ *
+ * Codes a symbol as its slice [cumulative, cumulative + frequency) of a
+ * frequency table summing to total, for models that predict whole symbols
+ * (PPM) rather than bits. The range is kept at 16 bits or more; when the top
+ * byte of low cannot settle before it gets smaller, the range is cut to the
+ * next byte boundary instead of propagating a carry.
+ */
+class SymbolRangeEncoder {
+public:
+    explicit SymbolRangeEncoder(std::vector<uint8_t>& output) : output_(output) {}
+
+    /**
+     * @brief Codes one symbol.
+     *
+     * @param cumulative Sum of the frequencies of the symbols ordered before it.
+     * @param frequency Its own frequency, at least 1.
+     * @param total Sum of all frequencies, below SYMBOL_RANGE_CODER_MAX_TOTAL.
+     */
+    void encode(uint32_t cumulative, uint32_t frequency, uint32_t total) {
+        range_ /= total;
+        low_ += cumulative * range_;
+        range_ *= frequency;
+        while ((low_ ^ (low_ + range_)) < TOP ||
+               (range_ < BOTTOM && ((range_ = (0u - low_) & (BOTTOM - 1)), true))) {
+            output_.push_back(static_cast<uint8_t>(low_ >> 24));
+            low_ <<= 8;
+            range_ <<= 8;
+        }
+    }
+
+    /**
+     * @brief Writes the bytes the decoder needs to resolve the last symbols.
+     */
+    void flush() {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            output_.push_back(static_cast<uint8_t>(low_ >> shift));
+        }
+    }
+
+private:
+    static constexpr uint32_t TOP = 1u << 24;
+    static constexpr uint32_t BOTTOM = SYMBOL_RANGE_CODER_MAX_TOTAL;
+
+    std::vector<uint8_t>& output_;
+    uint32_t low_ = 0;
+    uint32_t range_ = 0xFFFFFFFF;
+};
+
+/**
+ * @brief Decoder for SymbolRangeEncoder output.
+ *
+ * Decoding a symbol takes two calls: frequency() maps the coded value into
+ * the model's table, and decode() consumes the slice of the symbol found
+ * there. Like RangeDecoder, reading past the end yields zero bytes.
+ */
+class SymbolRangeDecoder {
+public:
+    SymbolRangeDecoder(const uint8_t* data, size_t size) : data_(data), end_(data + size) {
+        for (int i = 0; i < 4; ++i) {
+            code_ = (code_ << 8) | nextByte();
+        }
+    }
+
+    /**
+     * @brief Position of the next symbol within a table summing to total.
+     *
+     * @param total Sum of all frequencies, as passed to the encoder.
+     * @return uint32_t A value in [0, total); the symbol is the one whose
+     *         slice contains it.
+     */
+    uint32_t frequency(uint32_t total) {
+        range_ /= total;
+        uint32_t value = (code_ - low_) / range_;
+        return value < total ? value : total - 1;
+    }
+
+    /**
+     * @brief Consumes the symbol found with frequency().
+     *
+     * @param cumulative Start of the symbol's slice.
+     * @param frequency Width of the symbol's slice.
+     */
+    void decode(uint32_t cumulative, uint32_t frequency) {
+        low_ += cumulative * range_;
+        range_ *= frequency;
+        while ((low_ ^ (low_ + range_)) < TOP ||
+               (range_ < BOTTOM && ((range_ = (0u - low_) & (BOTTOM - 1)), true))) {
+            code_ = (code_ << 8) | nextByte();
+            low_ <<= 8;
+            range_ <<= 8;
+        }
+    }
+
+private:
+    static constexpr uint32_t TOP = 1u << 24;
+    static constexpr uint32_t BOTTOM = SYMBOL_RANGE_CODER_MAX_TOTAL;
+
+    uint8_t nextByte() { return data_ < end_ ? *data_++ : 0; }
+
+    const uint8_t* data_;
+    const uint8_t* end_;
+    uint32_t low_ = 0;
+    uint32_t range_ = 0xFFFFFFFF;
+    uint32_t code_ = 0;
+};
+
+} // namespace utils
+} // namespace compression
@@ -7,11 +7,14 @@ namespace compression {
 /**
  * @brief Implements ICompressor using Run-Length Encoding (RLE).
  *
- * A simple RLE implementation.
- * Note: This basic version might increase size for non-repetitive data.
+ * A simple RLE implementation. Data with too few runs for the count/value
+ * pairs to pay off is stored as is behind a one-byte marker instead.
  */
 class RleCompressor final : public ICompressor {
 public:
+    using ICompressor::compress;
+    using ICompressor::decompress;
+
     /**
      * @brief Compresses data using RLE.
      *
@@ -28,6 +31,14 @@ public:
      * @throws std::runtime_error if the compressed data format is invalid.
      */
     std::vector<uint8_t> decompress(const std::vector<uint8_t>& data) const override;
+
+    /**
+     * @brief Output of up to two bytes per input byte, while the vector grows.
+     *
+     * @param inputSize Size of the data to compress.
+     * @return size_t Peak heap bytes of one compress() or decompress() call.
+     */
+    size_t workingSetSize(size_t inputSize) const override { return 3 * inputSize; }
 };
 
 } // namespace compression 
\ No newline at end of file
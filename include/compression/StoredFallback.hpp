@@ -0,0 +1,44 @@
+#pragma once
+
+#include "CompressionStats.hpp"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace compression {
+namespace utils {
+
+// Mode byte that starts a stream written by modelOrStore()
+constexpr uint8_t STREAM_MODE_MODELED = 0;
+constexpr uint8_t STREAM_MODE_STORED = 1;
+
+/**
+ * @brief Frames the output of a modeling compressor, storing what the model
+ * cannot shrink.
+ *
+ * Input that profiles as random (see DataProfile::likelyIncompressible()) is
+ * stored without running the model. Otherwise encode appends the modeled
+ * form to a buffer holding the MODELED mode byte, and it is kept if it is
+ * smaller than storing. A stored stream is the STORED mode byte followed by
+ * the input, whose size is added to the stats' storedBytes.
+ *
+ * @param data Input to compress, not empty.
+ * @param stats Statistics to update, or nullptr.
+ * @param encode Appends the modeled stream to the buffer it is given.
+ */
+std::vector<uint8_t> modelOrStore(const std::vector<uint8_t>& data, CompressionStats* stats,
+                                  const std::function<void(std::vector<uint8_t>&)>& encode);
+
+/**
+ * @brief Reads the mode byte of a stream written by modelOrStore().
+ *
+ * @param data Stream to decode, not empty.
+ * @param name Algorithm named in the error message.
+ * @return true if the input follows the mode byte as is, false if the
+ *         modeled form does.
+ * @throws std::runtime_error if the mode byte is neither.
+ */
+bool isStoredStream(const std::vector<uint8_t>& data, const char* name);
+
+} // namespace utils
+} // namespace compression
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace compression {
+
+/**
+ * @brief Work-stealing thread pool shared by the parallel code paths.
+ *
+ * Each worker owns a task deque. Tasks submitted from a worker go to its own
+ * deque and are taken newest first, which keeps nested work cache-warm; idle
+ * workers steal the oldest task of another worker. Tasks submitted from
+ * outside the pool are spread over the deques round-robin.
+ *
+ * Block-parallel compressors, checksums and the command-line utility all
+ * run on one pool (usually shared()), so a process compressing several
+ * inputs at once does not start more threads than there are cores. Waiting
+ * for tasks from inside a task is safe: wait() and parallelFor() run queued
+ * tasks on the waiting thread, and only sleep, without spinning, while
+ * nothing is queued.
+ *
+ * @code
+ * auto& pool = compression::ThreadPool::shared();
+ * auto checksum = pool.submit([&] { return crc.calculate(data); });
+ * pool.parallelFor(blocks.size(), [&](size_t i) { out[i] = lz77.compress(blocks[i]); });
+ * uint32_t crc = pool.wait(checksum);
+ * @endcode
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Starts the workers.
+     *
+     * @param threadCount Number of workers; 0 means one per hardware thread.
+     * @param pinThreads Bind worker i to CPU i (modulo the CPU count) where
+     *        the platform supports it, so workers do not migrate between cores.
+     */
+    explicit ThreadPool(size_t threadCount = 0, bool pinThreads = false);
+
+    /**
+     * @brief Finishes all queued tasks, then joins the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+
+    /**
+     * @brief Queues a callable and returns a future for its result.
+     *
+     * An exception thrown by the callable is rethrown by the future.
+     */
+    template <typename F>
+    auto submit(F&& function) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+        std::future<Result> result = task->get_future();
+        post([task] { (*task)(); });
+        return result;
+    }
+
+    /**
+     * @brief Waits for a future, running queued tasks on this thread meanwhile.
+     *
+     * Use this instead of future::get() inside a task so that the worker
+     * keeps the pool busy rather than blocking it. With nothing queued the
+     * thread sleeps until a task finishes or another one is queued, so the
+     * last tasks of a batch run on the workers alone. The future must come
+     * from submit() on this pool.
+     */
+    template <typename R>
+    R wait(std::future<R>& future) {
+        for (;;) {
+            // Read before the check, so a task finishing after it still wakes us
+            size_t finished = finishedTasks();
+            if (future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                break;
+            }
+            if (!runPendingTask()) {
+                waitForProgress(finished);
+            }
+        }
+        return future.get();
+    }
+
+    /**
+     * @brief Calls body(i) for every i in [0, count), spread over the pool.
+     *
+     * The calling thread takes part, so this is safe to call from a task.
+     * Returns once every call has finished; the first exception thrown by a
+     * call is rethrown here after the others have completed.
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    /**
+     * @brief Runs one queued task on the calling thread, if there is one.
+     *
+     * @return Whether a task was run.
+     */
+    bool runPendingTask();
+
+    /**
+     * @brief The process-wide pool, created on first use.
+     *
+     * Sized for the hardware unless configureShared() was called first.
+     */
+    static ThreadPool& shared();
+
+    /**
+     * @brief Sets the size and pinning of the pool shared() creates.
+     *
+     * @throws std::logic_error if the shared pool already exists.
+     */
+    static void configureShared(size_t threadCount, bool pinThreads = false);
+
+private:
+    using Task = std::function<void()>;
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void post(Task task);
+    bool takeTask(size_t self, Task& task);
+    void runTask(Task& task);
+    void workerLoop(size_t index);
+
+    size_t finishedTasks();
+    // Sleeps until more than `finished` tasks have run, or a task is queued
+    void waitForProgress(size_t finished);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> workers_;
+
+    // Tasks queued but not yet taken; changed under wakeMutex_ when it grows
+    // so that sleeping workers never miss a wake-up
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> nextQueue_{0};
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    // Threads in wait() or parallelFor() with nothing to run sleep on
+    // progress_; both counters are guarded by wakeMutex_
+    std::condition_variable progress_;
+    size_t finished_ = 0;
+    size_t waiters_ = 0;
+};
+
+} // namespace compression
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace compression {
+namespace utils {
+
+// Varints hold 7 bits per byte, lowest first, with the top bit set on every
+// byte but the last; a 64-bit value takes at most this many bytes
+constexpr size_t MAX_VARINT_SIZE = 10;
+
+/**
+ * @brief Appends a value as a varint.
+ */
+inline void writeVarint(std::vector<uint8_t>& buffer, uint64_t value) {
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        if (value > 0) byte |= 0x80;
+        buffer.push_back(byte);
+    } while (value > 0);
+}
+
+/**
+ * @brief Number of bytes writeVarint() appends for a value.
+ */
+inline size_t varintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+/**
+ * @brief Reads a varint and moves offset past it.
+ *
+ * @param buffer Buffer to read from.
+ * @param offset Position of the varint; advanced past it.
+ * @param stream Kind of stream, named in the error message.
+ * @return uint64_t The value.
+ * @throws std::runtime_error if the buffer ends inside the varint, or its
+ *         value does not fit in 64 bits.
+ */
+inline uint64_t readVarint(const std::vector<uint8_t>& buffer, size_t& offset, const char* stream) {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 7 * MAX_VARINT_SIZE && offset < buffer.size(); shift += 7) {
+        uint8_t byte = buffer[offset++];
+        // The last byte a 64-bit value can take holds its top bit only
+        if (shift == 63 && byte > 1) {
+            break;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw std::runtime_error(std::string("Truncated or invalid varint in ") + stream + " stream");
+}
+
+} // namespace utils
+} // namespace compression
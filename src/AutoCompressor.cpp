@@ -0,0 +1,192 @@
+#include "compression/AutoCompressor.hpp"
+#include "compression/Varint.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace compression {
+
+namespace {
+
+// From this run density on, rle's count/value pairs beat everything on speed
+constexpr double RLE_MIN_RUN_DENSITY = 0.9;
+
+struct BlockHeader {
+    format::AlgorithmID algorithm;
+    uint64_t originalSize;
+    size_t payloadOffset;
+    size_t payloadSize;
+};
+
+// Reads the block starting at offset and advances offset past it
+BlockHeader readBlockHeader(const std::vector<uint8_t>& data, size_t& offset) {
+    BlockHeader block;
+    block.algorithm = static_cast<format::AlgorithmID>(data[offset++]);
+    block.originalSize = utils::readVarint(data, offset, "auto");
+    uint64_t payloadSize = utils::readVarint(data, offset, "auto");
+    if (payloadSize > data.size() - offset) {
+        throw std::runtime_error("Invalid auto block: payload exceeds stream");
+    }
+    block.payloadOffset = offset;
+    block.payloadSize = static_cast<size_t>(payloadSize);
+    offset += block.payloadSize;
+    return block;
+}
+
+} // anonymous namespace
+
+AutoCompressor::AutoCompressor(int level)
+    : level_(DEFAULT_LEVEL), lz77_(32768, 3, 258, false, true, true) {
+    setLevel(level);
+}
+
+void AutoCompressor::setLevel(int level) {
+    if (level < MIN_LEVEL || level > MAX_LEVEL) {
+        throw std::invalid_argument("Auto level must be between " + std::to_string(MIN_LEVEL) +
+                                    " and " + std::to_string(MAX_LEVEL));
+    }
+    level_ = level;
+    lz77_.setLevel(std::min(level, Lz77Compressor::MAX_LEVEL));
+}
+
+AutoCompressor::Choice AutoCompressor::choose(const utils::DataProfile& profile) const {
+    if (profile.sampledBytes == 0) {
+        return {format::AlgorithmID::NULL_COMPRESSOR, 0};
+    }
+    if (profile.runDensity >= RLE_MIN_RUN_DENSITY) {
+        return {format::AlgorithmID::RLE_COMPRESSOR, 0};
+    }
+    if (profile.likelyIncompressible()) {
+        return {format::AlgorithmID::NULL_COMPRESSOR, 0};
+    }
+    if (profile.matchDensity < utils::DataProfile::INCOMPRESSIBLE_MAX_MATCH_DENSITY) {
+        return {format::AlgorithmID::HUFFMAN_COMPRESSOR, 0};
+    }
+    if (level_ >= BWT_MIN_LEVEL) {
+        return {format::AlgorithmID::BWT_COMPRESSOR, 0};
+    }
+    return {format::AlgorithmID::LZ77_COMPRESSOR, level_};
+}
+
+const ICompressor& AutoCompressor::compressorFor(format::AlgorithmID algorithm) const {
+    switch (algorithm) {
+        case format::AlgorithmID::RLE_COMPRESSOR: return rle_;
+        case format::AlgorithmID::HUFFMAN_COMPRESSOR: return huffman_;
+        case format::AlgorithmID::LZ77_COMPRESSOR: return lz77_;
+        case format::AlgorithmID::BWT_COMPRESSOR: return bwt_;
+        default:
+            throw std::runtime_error("Invalid auto block algorithm: " +
+                                     std::to_string(static_cast<unsigned>(algorithm)));
+    }
+}
+
+std::vector<uint8_t> AutoCompressor::compress(const std::vector<uint8_t>& data) const {
+    CompressionContext context(scratchSize(data.size()));
+    return compress(data, context);
+}
+
+std::vector<uint8_t> AutoCompressor::compress(const std::vector<uint8_t>& data,
+                                              CompressionContext& context) const {
+    if (data.empty()) {
+        return {};
+    }
+
+    CompressionStats* stats = context.stats();
+    std::vector<uint8_t> result = {FORMAT_VERSION};
+    for (size_t start = 0; start < data.size(); start += BLOCK_SIZE) {
+        size_t length = std::min(BLOCK_SIZE, data.size() - start);
+
+        StageTimer profileTimer(stats, "auto profiling", length);
+        Choice choice = choose(utils::profileData(data.data() + start, length));
+        profileTimer.stop();
+
+        std::vector<uint8_t> payload;
+        if (choice.algorithm != format::AlgorithmID::NULL_COMPRESSOR) {
+            std::vector<uint8_t> block(data.begin() + start, data.begin() + start + length);
+            payload = compressorFor(choice.algorithm).compress(block, context);
+            // The sample misjudged the block; storing it costs nothing extra
+            if (payload.size() >= length) {
+                choice.algorithm = format::AlgorithmID::NULL_COMPRESSOR;
+            }
+        }
+        if (choice.algorithm == format::AlgorithmID::NULL_COMPRESSOR) {
+            payload.assign(data.begin() + start, data.begin() + start + length);
+        }
+
+        result.push_back(static_cast<uint8_t>(choice.algorithm));
+        utils::writeVarint(result, length);
+        utils::writeVarint(result, payload.size());
+        result.insert(result.end(), payload.begin(), payload.end());
+    }
+    return result;
+}
+
+std::vector<uint8_t> AutoCompressor::decompress(const std::vector<uint8_t>& data) const {
+    CompressionContext context;
+    return decompress(data, context);
+}
+
+std::vector<uint8_t> AutoCompressor::decompress(const std::vector<uint8_t>& data,
+                                                CompressionContext& context) const {
+    if (data.empty()) {
+        return {};
+    }
+    if (data[0] != FORMAT_VERSION) {
+        throw std::runtime_error("Unsupported auto stream version: " + std::to_string(data[0]));
+    }
+
+    std::vector<uint8_t> result;
+    size_t offset = 1;
+    while (offset < data.size()) {
+        BlockHeader block = readBlockHeader(data, offset);
+        auto payloadBegin = data.begin() + block.payloadOffset;
+        auto payloadEnd = payloadBegin + block.payloadSize;
+
+        if (block.algorithm == format::AlgorithmID::NULL_COMPRESSOR) {
+            if (block.payloadSize != block.originalSize) {
+                throw std::runtime_error("Invalid auto block: stored size mismatch");
+            }
+            result.insert(result.end(), payloadBegin, payloadEnd);
+            continue;
+        }
+
+        std::vector<uint8_t> payload(payloadBegin, payloadEnd);
+        std::vector<uint8_t> decoded = compressorFor(block.algorithm).decompress(payload, context);
+        if (decoded.size() != block.originalSize) {
+            throw std::runtime_error("Invalid auto block: decoded size mismatch");
+        }
+        result.insert(result.end(), decoded.begin(), decoded.end());
+    }
+    return result;
+}
+
+std::vector<format::AlgorithmID> AutoCompressor::blockAlgorithms(const std::vector<uint8_t>& data) {
+    std::vector<format::AlgorithmID> algorithms;
+    if (data.empty()) {
+        return algorithms;
+    }
+    if (data[0] != FORMAT_VERSION) {
+        throw std::runtime_error("Unsupported auto stream version: " + std::to_string(data[0]));
+    }
+    size_t offset = 1;
+    while (offset < data.size()) {
+        algorithms.push_back(readBlockHeader(data, offset).algorithm);
+    }
+    return algorithms;
+}
+
+size_t AutoCompressor::scratchSize(size_t inputSize) const {
+    size_t block = std::min(inputSize, BLOCK_SIZE);
+    return std::max(lz77_.scratchSize(block), level_ >= BWT_MIN_LEVEL ? bwt_.scratchSize(block) : 0);
+}
+
+size_t AutoCompressor::workingSetSize(size_t inputSize) const {
+    size_t block = std::min(inputSize, BLOCK_SIZE);
+    size_t candidate = std::max({lz77_.workingSetSize(block), huffman_.workingSetSize(block),
+                                 rle_.workingSetSize(block),
+                                 level_ >= BWT_MIN_LEVEL ? bwt_.workingSetSize(block) : 0});
+    // A copy of the block and the growing result next to the chosen compressor
+    return candidate + block + 3 * inputSize;
+}
+
+} // namespace compression
@@ -1,5 +1,8 @@
 #include "compression/BwtCompressor.hpp"
 #include "compression/HuffmanCompressor.hpp"
+#include "compression/ContextMixingCompressor.hpp"
+#include "compression/DataProfile.hpp"
+#include "compression/Histogram.hpp"
 #include <algorithm>
 #include <numeric>
 #include <stdexcept>
@@ -9,6 +12,26 @@
 
 namespace compression {
 
+namespace {
+
+// Block header: big-endian payload size and primary index, then the payload
+void appendBlock(std::vector<uint8_t>& result, const std::vector<uint8_t>& payload, uint32_t primaryIndex) {
+    uint32_t blockSize = static_cast<uint32_t>(payload.size());
+    result.push_back(static_cast<uint8_t>((blockSize >> 24) & 0xFF));
+    result.push_back(static_cast<uint8_t>((blockSize >> 16) & 0xFF));
+    result.push_back(static_cast<uint8_t>((blockSize >> 8) & 0xFF));
+    result.push_back(static_cast<uint8_t>(blockSize & 0xFF));
+    
+    result.push_back(static_cast<uint8_t>((primaryIndex >> 24) & 0xFF));
+    result.push_back(static_cast<uint8_t>((primaryIndex >> 16) & 0xFF));
+    result.push_back(static_cast<uint8_t>((primaryIndex >> 8) & 0xFF));
+    result.push_back(static_cast<uint8_t>(primaryIndex & 0xFF));
+    
+    result.insert(result.end(), payload.begin(), payload.end());
+}
+
+} // anonymous namespace
+
 //------------------------------------------------------------------------------
 // MoveToFrontEncoder Implementation
 //------------------------------------------------------------------------------
@@ -75,13 +98,15 @@ std::vector<uint8_t> MoveToFrontEncoder::decode(const std::vector<uint8_t>& data
 //------------------------------------------------------------------------------
 
 // Improved suffix array construction using a more efficient method
-// Uses the Suffix Array construction algorithm based on prefix doubling
+// Uses the Suffix Array construction algorithm based on prefix doubling.
+// All working arrays come from the caller's CompressionContext.
 struct SuffixArray {
     const std::vector<uint8_t>& data;
-    std::vector<int32_t> SA; // Suffix Array
+    int32_t* SA; // Suffix Array
     
-    explicit SuffixArray(const std::vector<uint8_t>& input) : data(input), SA(input.size()) {
-        constructSuffixArray();
+    SuffixArray(const std::vector<uint8_t>& input, CompressionContext& context)
+        : data(input), SA(context.allocate<int32_t>(input.size())) {
+        constructSuffixArray(context);
     }
     
     // Helper function to compare two rotations at indices i and j
@@ -98,7 +123,7 @@ struct SuffixArray {
         return i < j; // For rotations that might be identical
     }
     
-    void constructSuffixArray() {
+    void constructSuffixArray(CompressionContext& context) {
         const size_t n = data.size();
         
         // For small inputs, use a simple approach for better performance
@@ -109,81 +134,96 @@ struct SuffixArray {
             }
             
             // Sort the suffixes using a simple radix sorting approach for small arrays
-            std::sort(SA.begin(), SA.end(), [this](int32_t i, int32_t j) {
+            std::sort(SA, SA + n, [this](int32_t i, int32_t j) {
                 return compareRotations(i, j);
             });
             
             return;
         }
         
-        // For larger inputs, use a more efficient algorithm
-        // This is a simpler implementation of a prefix-doubling algorithm
-        std::vector<int32_t> rank(n);
-        std::vector<int32_t> newRank(n);
-        std::vector<int32_t> count(std::max(n, static_cast<size_t>(256)), 0);
-        
-        // Initialize ranks with character values
-        for (size_t i = 0; i < n; ++i) {
-            rank[i] = data[i];
-            SA[i] = static_cast<int32_t>(i);
+        // For larger inputs, sort cyclic rotations by prefix doubling: after
+        // the pass for h, SA is ordered by the first 2h bytes of each rotation
+        // and rank holds the class of those 2h-byte prefixes
+        int32_t* rank = context.allocate<int32_t>(n);
+        int32_t* newRank = context.allocate<int32_t>(n);
+        int32_t* tempSA = context.allocate<int32_t>(n);
+        const size_t countSize = std::max(n, static_cast<size_t>(256));
+        int32_t* count = context.allocate<int32_t>(countSize);
+        
+        // Initial order and classes by the first byte
+        utils::ByteHistogram histogram = utils::byteHistogram(data.data(), n);
+        count[0] = static_cast<int32_t>(histogram[0]);
+        for (size_t i = 1; i < 256; ++i) {
+            count[i] = count[i - 1] + static_cast<int32_t>(histogram[i]);
+        }
+        for (size_t i = n; i-- > 0;) {
+            SA[--count[data[i]]] = static_cast<int32_t>(i);
+        }
+        rank[SA[0]] = 0;
+        int32_t classes = 1;
+        for (size_t i = 1; i < n; ++i) {
+            if (data[SA[i]] != data[SA[i - 1]]) {
+                ++classes;
+            }
+            rank[SA[i]] = classes - 1;
         }
         
-        // Iteratively refine the suffix array
-        for (size_t h = 1; h < n; h *= 2) {
-            // Sort by second part of pair
-            std::fill(count.begin(), count.end(), 0);
-            
+        for (size_t h = 1; h < n && classes < static_cast<int32_t>(n); h *= 2) {
+            // SA is sorted by the first h bytes, so shifting every rotation
+            // back by h yields an order by the second half; a stable counting
+            // sort on the first half's class completes the order
             for (size_t i = 0; i < n; ++i) {
-                int32_t pos = (SA[i] - static_cast<int32_t>(h) + static_cast<int32_t>(n)) % static_cast<int32_t>(n);
-                ++count[rank[pos]];
+                tempSA[i] = static_cast<int32_t>((SA[i] + n - h) % n);
             }
-            
-            for (size_t i = 1; i < count.size(); ++i) {
+            std::fill(count, count + classes, 0);
+            for (size_t i = 0; i < n; ++i) {
+                ++count[rank[tempSA[i]]];
+            }
+            for (int32_t i = 1; i < classes; ++i) {
                 count[i] += count[i - 1];
             }
-            
-            std::vector<int32_t> tempSA(n);
-            for (int32_t i = static_cast<int32_t>(n) - 1; i >= 0; --i) {
-                int32_t pos = (SA[i] - static_cast<int32_t>(h) + static_cast<int32_t>(n)) % static_cast<int32_t>(n);
-                tempSA[--count[rank[pos]]] = pos;
+            for (size_t i = n; i-- > 0;) {
+                SA[--count[rank[tempSA[i]]]] = tempSA[i];
             }
-            std::swap(SA, tempSA);
             
-            // Update ranks
+            // Update ranks from (first half, second half) class pairs
             newRank[SA[0]] = 0;
+            classes = 1;
             for (size_t i = 1; i < n; ++i) {
-                bool different = rank[SA[i]] != rank[SA[i - 1]];
-                if (!different && 
-                    ((SA[i] + h < n && SA[i - 1] + h < n && rank[SA[i] + h] != rank[SA[i - 1] + h]) ||
-                     (SA[i] + h >= n && SA[i - 1] + h < n) ||
-                     (SA[i] + h < n && SA[i - 1] + h >= n))) {
-                    different = true;
+                size_t current = SA[i];
+                size_t previous = SA[i - 1];
+                if (rank[current] != rank[previous] ||
+                    rank[(current + h) % n] != rank[(previous + h) % n]) {
+                    ++classes;
                 }
-                newRank[SA[i]] = newRank[SA[i - 1]] + (different ? 1 : 0);
+                newRank[current] = classes - 1;
             }
             std::swap(rank, newRank);
-            
-            // If all suffixes are sorted (each has a unique rank), we're done
-            if (rank[SA[n - 1]] == static_cast<int32_t>(n) - 1) {
-                break;
-            }
         }
     }
 };
 
-BwtCompressor::BwtCompressor() 
+BwtCompressor::BwtCompressor(format::AlgorithmID entropyCoder) 
     : blockSize_(1024 * 1024), // 1MB block size by default
       mtfCoder_(),
-      entropyCompressor_(std::make_unique<HuffmanCompressor>()) {
+      entropyCompressor_(std::make_unique<HuffmanCompressor>()),
+      contextMixingCompressor_(std::make_unique<ContextMixingCompressor>()),
+      useContextMixing_(entropyCoder == format::AlgorithmID::CONTEXT_MIXING_COMPRESSOR) {
+    if (entropyCoder != format::AlgorithmID::HUFFMAN_COMPRESSOR && !useContextMixing_) {
+        throw std::invalid_argument("BWT entropy stage must be huffman or cm, not " +
+                                    format::algorithmIdToString(entropyCoder));
+    }
 }
 
-std::pair<std::vector<uint8_t>, uint32_t> BwtCompressor::bwtEncode(const std::vector<uint8_t>& block) const {
+std::pair<std::vector<uint8_t>, uint32_t> BwtCompressor::bwtEncode(
+    const std::vector<uint8_t>& block, CompressionContext& context) const {
     if (block.empty()) {
         return {{}, 0};
     }
     
     // Construct the suffix array
-    SuffixArray sa(block);
+    CompressionContext::Scope scope(context);
+    SuffixArray sa(block, context);
     
     // Compute the BWT from the suffix array
     std::vector<uint8_t> bwt(block.size());
@@ -203,7 +243,8 @@ std::pair<std::vector<uint8_t>, uint32_t> BwtCompressor::bwtEncode(const std::ve
     return {bwt, primaryIndex};
 }
 
-std::vector<uint8_t> BwtCompressor::bwtDecode(const std::vector<uint8_t>& block, uint32_t primaryIndex) const {
+std::vector<uint8_t> BwtCompressor::bwtDecode(
+    const std::vector<uint8_t>& block, uint32_t primaryIndex, CompressionContext& context) const {
     if (block.empty()) {
         return {};
     }
@@ -214,20 +255,17 @@ std::vector<uint8_t> BwtCompressor::bwtDecode(const std::vector<uint8_t>& block,
     }
     
     // Count occurrences of each character
-    std::vector<int32_t> count(256, 0);
-    for (uint8_t c : block) {
-        ++count[c];
-    }
+    utils::ByteHistogram count = utils::byteHistogram(block.data(), n);
     
     // Compute the starting position for each character
-    std::vector<int32_t> startPos(256, 0);
+    int32_t tempPos[256] = {};
     for (int i = 1; i < 256; ++i) {
-        startPos[i] = startPos[i-1] + count[i-1];
+        tempPos[i] = tempPos[i-1] + static_cast<int32_t>(count[i-1]);
     }
     
     // Compute the transform array
-    std::vector<int32_t> transform(n);
-    std::vector<int32_t> tempPos = startPos; // Copy to avoid modifying startPos
+    CompressionContext::Scope scope(context);
+    int32_t* transform = context.allocate<int32_t>(n);
     
     for (size_t i = 0; i < n; ++i) {
         uint8_t c = block[i];
@@ -254,55 +292,24 @@ std::vector<uint8_t> BwtCompressor::runLengthEncode(const std::vector<uint8_t>&
     std::vector<uint8_t> result;
     result.reserve(data.size()); // Reserve space for worst case
     
-    // Simple RLE: for runs of 4 or more identical bytes
-    // Use format: [0] [byte] [run length - 4]
-    uint8_t currentByte = data[0];
-    uint32_t runLength = 1;
-    
-    for (size_t i = 1; i < data.size(); ++i) {
-        if (data[i] == currentByte) {
+    // bzip2-style RLE: after four identical bytes a count byte gives how many
+    // more copies follow (0-255). No byte value is reserved as a marker, so
+    // the zeros that dominate MTF output pass through unchanged.
+    size_t i = 0;
+    while (i < data.size()) {
+        const uint8_t byte = data[i];
+        size_t runLength = 1;
+        while (i + runLength < data.size() && data[i + runLength] == byte &&
+               runLength < RLE_MIN_RUN + 255) {
             ++runLength;
-            
-            // If we have a long run and reached the max run length or end of data
-            if (runLength >= 4 && (runLength == 259 || i == data.size() - 1)) {
-                // Encode the run
-                result.push_back(0); // RLE marker
-                result.push_back(currentByte);
-                result.push_back(static_cast<uint8_t>(runLength - 4));
-                
-                // Reset the run
-                runLength = 0;
-                
-                // If we're not at the end, prepare for the next byte
-                if (i < data.size() - 1) {
-                    currentByte = data[i + 1];
-                    i++; // Skip the next byte as we've already processed it
-                }
-            }
-        } else {
-            // If we had a run of 4 or more, encode it
-            if (runLength >= 4) {
-                result.push_back(0); // RLE marker
-                result.push_back(currentByte);
-                result.push_back(static_cast<uint8_t>(runLength - 4));
-            } else {
-                // Otherwise, just output the bytes
-                for (uint32_t j = 0; j < runLength; ++j) {
-                    result.push_back(currentByte);
-                }
-            }
-            
-            // Start a new run
-            currentByte = data[i];
-            runLength = 1;
         }
-    }
-    
-    // Handle any remaining bytes
-    if (runLength > 0 && runLength < 4) {
-        for (uint32_t j = 0; j < runLength; ++j) {
-            result.push_back(currentByte);
+        
+        const size_t literalCount = std::min(runLength, RLE_MIN_RUN);
+        result.insert(result.end(), literalCount, byte);
+        if (runLength >= RLE_MIN_RUN) {
+            result.push_back(static_cast<uint8_t>(runLength - RLE_MIN_RUN));
         }
+        i += runLength;
     }
     
     return result;
@@ -316,27 +323,106 @@ std::vector<uint8_t> BwtCompressor::runLengthDecode(const std::vector<uint8_t>&
     std::vector<uint8_t> result;
     result.reserve(data.size() * 2); // Reserve space for potential expansion
     
+    size_t runLength = 0;
     for (size_t i = 0; i < data.size(); ++i) {
-        if (data[i] == 0 && i + 2 < data.size()) {
-            // RLE block: [0] [byte] [run length - 4]
-            uint8_t byte = data[i + 1];
-            uint32_t runLength = data[i + 2] + 4; // Add 4 to get actual run length
-            
-            for (uint32_t j = 0; j < runLength; ++j) {
-                result.push_back(byte);
+        const uint8_t byte = data[i];
+        runLength = (!result.empty() && result.back() == byte) ? runLength + 1 : 1;
+        result.push_back(byte);
+        
+        if (runLength == RLE_MIN_RUN) {
+            if (++i >= data.size()) {
+                throw std::runtime_error("Invalid BWT run-length data: missing run count");
             }
-            
-            i += 2; // Skip the byte and run length values
-        } else {
-            // Regular byte
-            result.push_back(data[i]);
+            result.insert(result.end(), data[i], byte);
+            runLength = 0;
         }
     }
     
     return result;
 }
 
+std::pair<std::vector<uint8_t>, uint32_t> BwtCompressor::encodeBlock(
+    const std::vector<uint8_t>& block, CompressionContext& context) const {
+    CompressionStats* stats = context.stats();
+    
+    // Apply Burrows-Wheeler Transform
+    StageTimer bwtTimer(stats, "bwt suffix sort", block.size());
+    auto [bwtBlock, primaryIndex] = bwtEncode(block, context);
+    bwtTimer.stop(bwtBlock.size());
+    
+    // Apply Move-To-Front transform
+    StageTimer mtfTimer(stats, "mtf", bwtBlock.size());
+    auto mtfBlock = mtfCoder_.encode(bwtBlock);
+    mtfTimer.stop(mtfBlock.size());
+    
+    // Apply Run-Length Encoding
+    StageTimer rleTimer(stats, "rle", mtfBlock.size());
+    auto rleBlock = runLengthEncode(mtfBlock);
+    rleTimer.stop(rleBlock.size());
+    
+    // Apply entropy coding (Huffman or context mixing)
+    StageTimer entropyTimer(stats, "entropy coding", rleBlock.size());
+    const ICompressor& entropyStage = useContextMixing_ ? *contextMixingCompressor_ : *entropyCompressor_;
+    auto compressedBlock = entropyStage.compress(rleBlock, context);
+    entropyTimer.stop(compressedBlock.size());
+    
+    return {std::move(compressedBlock), primaryIndex};
+}
+
+std::vector<uint8_t> BwtCompressor::decodeBlock(const std::vector<uint8_t>& block, uint32_t primaryIndex,
+                                                bool rleEnabled, bool contextMixing,
+                                                CompressionContext& context) const {
+    CompressionStats* stats = context.stats();
+    
+    // Apply entropy decoding (Huffman or context mixing)
+    StageTimer entropyTimer(stats, "entropy decoding", block.size());
+    const ICompressor& entropyStage = contextMixing ? *contextMixingCompressor_ : *entropyCompressor_;
+    auto entropyDecodedBlock = entropyStage.decompress(block, context);
+    entropyTimer.stop(entropyDecodedBlock.size());
+    
+    // Apply Run-Length Decoding if enabled
+    StageTimer rleTimer(stats, "rle decoding", entropyDecodedBlock.size());
+    auto rleDecodedBlock = rleEnabled ? runLengthDecode(entropyDecodedBlock) : entropyDecodedBlock;
+    rleTimer.stop(rleDecodedBlock.size());
+    
+    // Apply Move-To-Front decoding
+    StageTimer mtfTimer(stats, "mtf decoding", rleDecodedBlock.size());
+    auto mtfDecodedBlock = mtfCoder_.decode(rleDecodedBlock);
+    mtfTimer.stop(mtfDecodedBlock.size());
+    
+    // Apply inverse Burrows-Wheeler Transform
+    StageTimer bwtTimer(stats, "inverse bwt", mtfDecodedBlock.size());
+    auto bwtDecodedBlock = bwtDecode(mtfDecodedBlock, primaryIndex, context);
+    bwtTimer.stop(bwtDecodedBlock.size());
+    
+    return bwtDecodedBlock;
+}
+
 std::vector<uint8_t> BwtCompressor::compress(const std::vector<uint8_t>& data) const {
+    CompressionContext context(scratchSize(data.size()));
+    return compress(data, context);
+}
+
+size_t BwtCompressor::scratchSize(size_t inputSize) const {
+    // Suffix array construction holds SA, rank, newRank, tempSA and count,
+    // each one int32_t per byte of the largest block. A context mixing
+    // entropy stage runs after the sort has handed that memory back.
+    size_t largestBlock = inputSize <= 100000 ? inputSize : std::min(blockSize_, inputSize);
+    size_t suffixSort = 4 * largestBlock * sizeof(int32_t) + std::max<size_t>(largestBlock, 256) * sizeof(int32_t);
+    size_t entropyStage = useContextMixing_ ? contextMixingCompressor_->scratchSize(largestBlock) : 0;
+    return std::max(suffixSort, entropyStage);
+}
+
+size_t BwtCompressor::workingSetSize(size_t inputSize) const {
+    // Each block lives as a copy, BWT, MTF and RLE output at once, and the
+    // Huffman stage needs about four block sizes; the result reserves the
+    // input size and may grow once for incompressible data
+    size_t largestBlock = inputSize <= 100000 ? inputSize : std::min(blockSize_, inputSize);
+    return scratchSize(inputSize) + 8 * largestBlock + 3 * inputSize;
+}
+
+std::vector<uint8_t> BwtCompressor::compress(const std::vector<uint8_t>& data,
+                                             CompressionContext& context) const {
     if (data.empty()) {
         return {}; // Return empty vector for empty input
     }
@@ -346,103 +432,68 @@ std::vector<uint8_t> BwtCompressor::compress(const std::vector<uint8_t>& data) c
     result.reserve(data.size()); // Reserve space for worst case
     
     // Header: [B][W][T][version][flags]
-    // Where version = 1, flags bit 0 = RLE enabled, bit 1-7 reserved
+    // Where flags bit 0 = RLE enabled, bit 1 = blocks stored after the BWT
+    // alone (no MTF, RLE or entropy stage), bit 2 = some blocks are raw
+    // (primary index RAW_BLOCK_INDEX), bit 3 = the entropy stage is context
+    // mixing rather than Huffman, bits 4-7 reserved
     result.push_back('B');
     result.push_back('W');
     result.push_back('T');
-    result.push_back(1); // Version 1
-    result.push_back(1); // Flags: RLE enabled
+    result.push_back(FORMAT_VERSION);
     
     // For very small inputs, process as a single block without further compression
     if (data.size() < 10) {
+        result.push_back(FLAG_STORED_BLOCKS);
         // Apply BWT
-        auto [bwtBlock, primaryIndex] = bwtEncode(data);
-        
-        // Write block size and primary index directly
-        uint32_t blockSize = static_cast<uint32_t>(bwtBlock.size());
-        result.push_back(static_cast<uint8_t>((blockSize >> 24) & 0xFF));
-        result.push_back(static_cast<uint8_t>((blockSize >> 16) & 0xFF));
-        result.push_back(static_cast<uint8_t>((blockSize >> 8) & 0xFF));
-        result.push_back(static_cast<uint8_t>(blockSize & 0xFF));
+        auto [bwtBlock, primaryIndex] = bwtEncode(data, context);
         
-        result.push_back(static_cast<uint8_t>((primaryIndex >> 24) & 0xFF));
-        result.push_back(static_cast<uint8_t>((primaryIndex >> 16) & 0xFF));
-        result.push_back(static_cast<uint8_t>((primaryIndex >> 8) & 0xFF));
-        result.push_back(static_cast<uint8_t>(primaryIndex & 0xFF));
-        
-        // Add the BWT-encoded block directly
-        result.insert(result.end(), bwtBlock.begin(), bwtBlock.end());
+        // Write block size and primary index directly, then the BWT-encoded block
+        appendBlock(result, bwtBlock, primaryIndex);
         
         return result;
     }
+    result.push_back(FLAG_RLE | (useContextMixing_ ? FLAG_CONTEXT_MIXING : 0));
     
-    // Process data in blocks for larger inputs
-    size_t actualBlockSize = std::min(blockSize_, data.size());
-
-    // For larger inputs where blocking may cause issues, process as a single block
-    // This ensures better compression and proper reconstruction
-    if (data.size() <= 100000) { // 100KB threshold
-        auto [bwtBlock, primaryIndex] = bwtEncode(data);
-        auto mtfBlock = mtfCoder_.encode(bwtBlock);
-        auto rleBlock = runLengthEncode(mtfBlock);
-        auto compressedBlock = entropyCompressor_->compress(rleBlock);
-        
-        // Write block size and primary index to result
-        uint32_t blockSize = static_cast<uint32_t>(compressedBlock.size());
-        result.push_back(static_cast<uint8_t>((blockSize >> 24) & 0xFF));
-        result.push_back(static_cast<uint8_t>((blockSize >> 16) & 0xFF));
-        result.push_back(static_cast<uint8_t>((blockSize >> 8) & 0xFF));
-        result.push_back(static_cast<uint8_t>(blockSize & 0xFF));
-        
-        result.push_back(static_cast<uint8_t>((primaryIndex >> 24) & 0xFF));
-        result.push_back(static_cast<uint8_t>((primaryIndex >> 16) & 0xFF));
-        result.push_back(static_cast<uint8_t>((primaryIndex >> 8) & 0xFF));
-        result.push_back(static_cast<uint8_t>(primaryIndex & 0xFF));
-        
-        // Add the compressed block to the result
-        result.insert(result.end(), compressedBlock.begin(), compressedBlock.end());
-        
-        return result;
-    }
+    // Process data in blocks for larger inputs; up to 100KB the input is a
+    // single block, which gives better compression for small files
+    size_t actualBlockSize = data.size() <= 100000 ? data.size() : std::min(blockSize_, data.size());
+    bool rawBlocks = false;
     
-    // Process data in blocks for larger inputs
     for (size_t blockStart = 0; blockStart < data.size(); blockStart += actualBlockSize) {
         // Extract the current block
         size_t blockEnd = std::min(blockStart + actualBlockSize, data.size());
         std::vector<uint8_t> block(data.begin() + blockStart, data.begin() + blockEnd);
         
-        // Apply Burrows-Wheeler Transform
-        auto [bwtBlock, primaryIndex] = bwtEncode(block);
-        
-        // Apply Move-To-Front transform
-        auto mtfBlock = mtfCoder_.encode(bwtBlock);
-        
-        // Apply Run-Length Encoding
-        auto rleBlock = runLengthEncode(mtfBlock);
-        
-        // Apply entropy coding (Huffman)
-        auto compressedBlock = entropyCompressor_->compress(rleBlock);
-        
-        // Write block size and primary index to result
-        uint32_t blockSize = static_cast<uint32_t>(compressedBlock.size());
-        result.push_back(static_cast<uint8_t>((blockSize >> 24) & 0xFF));
-        result.push_back(static_cast<uint8_t>((blockSize >> 16) & 0xFF));
-        result.push_back(static_cast<uint8_t>((blockSize >> 8) & 0xFF));
-        result.push_back(static_cast<uint8_t>(blockSize & 0xFF));
-        
-        result.push_back(static_cast<uint8_t>((primaryIndex >> 24) & 0xFF));
-        result.push_back(static_cast<uint8_t>((primaryIndex >> 16) & 0xFF));
-        result.push_back(static_cast<uint8_t>((primaryIndex >> 8) & 0xFF));
-        result.push_back(static_cast<uint8_t>(primaryIndex & 0xFF));
-        
-        // Add the compressed block to the result
-        result.insert(result.end(), compressedBlock.begin(), compressedBlock.end());
+        // Blocks that sample as random skip the suffix sort; blocks that do
+        // not shrink are stored too, so output grows by at most a block header
+        if (!utils::profileData(block.data(), block.size()).likelyIncompressible()) {
+            // Apply BWT, MTF, RLE and entropy coding
+            auto [compressedBlock, primaryIndex] = encodeBlock(block, context);
+            if (compressedBlock.size() < block.size()) {
+                appendBlock(result, compressedBlock, primaryIndex);
+                continue;
+            }
+        }
+        appendBlock(result, block, RAW_BLOCK_INDEX);
+        rawBlocks = true;
+        if (CompressionStats* stats = context.stats()) {
+            stats->storedBytes += block.size();
+        }
+    }
+    if (rawBlocks) {
+        result[4] |= FLAG_RAW_BLOCKS;
     }
     
     return result;
 }
 
 std::vector<uint8_t> BwtCompressor::decompress(const std::vector<uint8_t>& data) const {
+    CompressionContext context;
+    return decompress(data, context);
+}
+
+std::vector<uint8_t> BwtCompressor::decompress(const std::vector<uint8_t>& data,
+                                               CompressionContext& context) const {
     // Handle empty input case consistently with compress
     if (data.empty()) {
         return {};
@@ -461,11 +512,17 @@ std::vector<uint8_t> BwtCompressor::decompress(const std::vector<uint8_t>& data)
     uint8_t version = data[3];
     uint8_t flags = data[4];
     
-    if (version != 1) {
+    if (version != FORMAT_VERSION) {
         throw std::runtime_error("Unsupported BWT version: " + std::to_string(version));
     }
+    if ((flags & ~(FLAG_RLE | FLAG_STORED_BLOCKS | FLAG_RAW_BLOCKS | FLAG_CONTEXT_MIXING)) != 0) {
+        throw std::runtime_error("Unknown BWT flags: " + std::to_string(flags));
+    }
     
-    bool rleEnabled = (flags & 1) != 0;
+    bool rleEnabled = (flags & FLAG_RLE) != 0;
+    bool storedBlocks = (flags & FLAG_STORED_BLOCKS) != 0;
+    bool rawBlocks = (flags & FLAG_RAW_BLOCKS) != 0;
+    bool contextMixing = (flags & FLAG_CONTEXT_MIXING) != 0;
     
     std::vector<uint8_t> result;
     size_t pos = 5; // Start after header
@@ -496,25 +553,22 @@ std::vector<uint8_t> BwtCompressor::decompress(const std::vector<uint8_t>& data)
         std::vector<uint8_t> compressedBlock(data.begin() + pos, data.begin() + pos + blockSize);
         pos += blockSize;
         
-        // For very small blocks, they might be stored directly without additional compression
-        if (blockSize <= 10 && compressedBlock.size() == blockSize) {
+        // Incompressible blocks are the original bytes
+        if (rawBlocks && primaryIndex == RAW_BLOCK_INDEX) {
+            result.insert(result.end(), compressedBlock.begin(), compressedBlock.end());
+            continue;
+        }
+        
+        // Very small inputs are stored directly without additional compression
+        if (storedBlocks) {
             // Apply inverse BWT directly
-            auto decodedBlock = bwtDecode(compressedBlock, primaryIndex);
+            StageTimer timer(context.stats(), "inverse bwt", compressedBlock.size());
+            auto decodedBlock = bwtDecode(compressedBlock, primaryIndex, context);
             result.insert(result.end(), decodedBlock.begin(), decodedBlock.end());
             continue;
         }
         
-        // Apply entropy decoding (Huffman)
-        auto entropyDecodedBlock = entropyCompressor_->decompress(compressedBlock);
-        
-        // Apply Run-Length Decoding if enabled
-        auto rleDecodedBlock = rleEnabled ? runLengthDecode(entropyDecodedBlock) : entropyDecodedBlock;
-        
-        // Apply Move-To-Front decoding
-        auto mtfDecodedBlock = mtfCoder_.decode(rleDecodedBlock);
-        
-        // Apply inverse Burrows-Wheeler Transform
-        auto bwtDecodedBlock = bwtDecode(mtfDecodedBlock, primaryIndex);
+        auto bwtDecodedBlock = decodeBlock(compressedBlock, primaryIndex, rleEnabled, contextMixing, context);
         
         // Add the decoded block to the result
         result.insert(result.end(), bwtDecodedBlock.begin(), bwtDecodedBlock.end());
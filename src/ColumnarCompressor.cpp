@@ -0,0 +1,422 @@
+#include "compression/ColumnarCompressor.hpp"
+#include "compression/CompressorFactory.hpp"
+#include "compression/Varint.hpp"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace compression {
+
+namespace {
+
+constexpr uint8_t DELIMITERS[] = {',', '\t', ';', '|'};
+
+// Lines inspected to find a delimiter
+constexpr size_t SAMPLE_LINES = 1000;
+
+// Fewer lines than this are not worth splitting
+constexpr size_t MIN_LINES = 4;
+
+// Share of the sampled lines that must agree on their delimiter count
+constexpr double DELIMITED_MIN_SHARE = 0.9;
+
+// Length of the prefix of the buffer made of whole lines
+size_t wholeLinesSize(const uint8_t* data, size_t size) {
+    while (size > 0 && data[size - 1] != '\n') {
+        size--;
+    }
+    return size;
+}
+
+// Field i of every line goes to columns[i], followed by the byte that ended it
+size_t splitDelimited(const uint8_t* lines, size_t size, uint8_t delimiter,
+                      std::vector<std::vector<uint8_t>>& columns) {
+    size_t lineCount = 0;
+    for (size_t pos = 0; pos < size; ++lineCount) {
+        for (size_t column = 0;; ++column) {
+            size_t end = pos;
+            if (column + 1 < ColumnarCompressor::MAX_COLUMNS) {
+                while (lines[end] != delimiter && lines[end] != '\n') {
+                    end++;
+                }
+            } else {
+                end = static_cast<const uint8_t*>(std::memchr(lines + pos, '\n', size - pos)) - lines;
+            }
+            if (column == columns.size()) {
+                columns.emplace_back();
+            }
+            columns[column].insert(columns[column].end(), lines + pos, lines + end + 1);
+            pos = end + 1;
+            if (lines[end] == '\n') {
+                break;
+            }
+        }
+    }
+    return lineCount;
+}
+
+void splitFixedWidth(const uint8_t* lines, size_t size, const std::vector<size_t>& widths, size_t lineLength,
+                     std::vector<std::vector<uint8_t>>& columns) {
+    size_t lineCount = size / lineLength;
+    columns.resize(widths.size());
+    for (size_t field = 0; field < widths.size(); ++field) {
+        columns[field].reserve(lineCount * widths[field]);
+    }
+    for (size_t line = 0; line < lineCount; ++line) {
+        const uint8_t* fieldStart = lines + line * lineLength;
+        for (size_t field = 0; field < widths.size(); ++field) {
+            columns[field].insert(columns[field].end(), fieldStart, fieldStart + widths[field]);
+            fieldStart += widths[field];
+        }
+    }
+}
+
+} // anonymous namespace
+
+ColumnarCompressor::Structure ColumnarCompressor::detectStructure(const uint8_t* data, size_t size) {
+    Structure structure;
+    size_t end = wholeLinesSize(data, size);
+
+    // Every line is measured for the fixed-width test; the first ones are kept for the delimiter test
+    struct Line {
+        size_t start;
+        size_t length;
+    };
+    std::vector<Line> sample;
+    size_t lineCount = 0;
+    size_t commonLength = 0;
+    bool sameLength = true;
+    for (size_t pos = 0; pos < end; ++lineCount) {
+        size_t length = static_cast<const uint8_t*>(std::memchr(data + pos, '\n', end - pos)) - (data + pos) + 1;
+        if (lineCount == 0) {
+            commonLength = length;
+        } else if (length != commonLength) {
+            sameLength = false;
+        }
+        if (sample.size() < SAMPLE_LINES) {
+            sample.push_back({pos, length});
+        }
+        pos += length;
+    }
+    if (lineCount < MIN_LINES) {
+        return structure;
+    }
+
+    // The delimiter with the most fields per line among those most lines agree on
+    size_t bestCount = 0;
+    for (uint8_t delimiter : DELIMITERS) {
+        std::unordered_map<size_t, size_t> linesWithCount;
+        for (const Line& line : sample) {
+            linesWithCount[std::count(data + line.start, data + line.start + line.length, delimiter)]++;
+        }
+        for (const auto& entry : linesWithCount) {
+            if (entry.first > bestCount && entry.second >= DELIMITED_MIN_SHARE * sample.size()) {
+                bestCount = entry.first;
+                structure.layout = Layout::DELIMITED;
+                structure.delimiter = delimiter;
+            }
+        }
+    }
+    if (structure.layout == Layout::DELIMITED || !sameLength || commonLength < 2) {
+        return structure;
+    }
+
+    // Fields of fixed-width lines start after each column of spaces; the newline ends the last one
+    std::vector<bool> alwaysSpace(commonLength - 1, true);
+    for (size_t line = 0; line < end; line += commonLength) {
+        for (size_t column = 0; column + 1 < commonLength; ++column) {
+            if (data[line + column] != ' ') {
+                alwaysSpace[column] = false;
+            }
+        }
+    }
+    size_t fieldStart = 0;
+    for (size_t column = 1; column + 1 < commonLength; ++column) {
+        if (alwaysSpace[column - 1] && !alwaysSpace[column] && structure.fieldWidths.size() + 1 < MAX_COLUMNS) {
+            structure.fieldWidths.push_back(column - fieldStart);
+            fieldStart = column;
+        }
+    }
+    structure.fieldWidths.push_back(commonLength - fieldStart);
+    if (structure.fieldWidths.size() < 2) {
+        structure.fieldWidths.clear();
+        return structure;
+    }
+    structure.layout = Layout::FIXED_WIDTH;
+    structure.lineLength = commonLength;
+    return structure;
+}
+
+ColumnarCompressor::ColumnarCompressor(format::AlgorithmID backend) : backendId_(backend) {
+    if (backendId_ == format::AlgorithmID::COLUMNAR_COMPRESSOR) {
+        throw std::invalid_argument("Columnar cannot be its own backend");
+    }
+    if (backendId_ != format::AlgorithmID::UNKNOWN) {
+        candidates_.emplace_back(backendId_, createCompressor(backendId_));
+        return;
+    }
+    for (format::AlgorithmID candidate : {format::AlgorithmID::RLE_COMPRESSOR, format::AlgorithmID::HUFFMAN_COMPRESSOR,
+                                          format::AlgorithmID::LZH_COMPRESSOR, format::AlgorithmID::BWT_COMPRESSOR}) {
+        candidates_.emplace_back(candidate, createCompressor(candidate));
+    }
+}
+
+void ColumnarCompressor::writeStream(std::vector<uint8_t>& output, const std::vector<uint8_t>& stream,
+                                     CompressionContext& context) const {
+    format::AlgorithmID chosen = format::AlgorithmID::NULL_COMPRESSOR;
+    std::vector<uint8_t> payload;
+    if (!stream.empty()) {
+        // Short streams keep the smallest trial output; long ones are
+        // compressed once more by the backend that did best on their start
+        const ICompressor* best = nullptr;
+        std::vector<uint8_t> sample(stream.begin(), stream.begin() + std::min(stream.size(), CHOICE_SAMPLE_SIZE));
+        for (const auto& candidate : candidates_) {
+            std::vector<uint8_t> trial =
+                candidates_.size() == 1 ? std::vector<uint8_t>() : candidate.second->compress(sample, context);
+            if (!best || trial.size() < payload.size()) {
+                best = candidate.second.get();
+                chosen = candidate.first;
+                payload = std::move(trial);
+            }
+        }
+        if (candidates_.size() == 1 || sample.size() < stream.size()) {
+            payload = best->compress(stream, context);
+        }
+        if (payload.size() >= stream.size()) {
+            chosen = format::AlgorithmID::NULL_COMPRESSOR;
+        }
+    }
+
+    output.push_back(static_cast<uint8_t>(chosen));
+    utils::writeVarint(output, stream.size());
+    const std::vector<uint8_t>& stored = chosen == format::AlgorithmID::NULL_COMPRESSOR ? stream : payload;
+    utils::writeVarint(output, stored.size());
+    output.insert(output.end(), stored.begin(), stored.end());
+}
+
+std::vector<uint8_t> ColumnarCompressor::compress(const std::vector<uint8_t>& data) const {
+    CompressionContext context(scratchSize(data.size()));
+    return compress(data, context);
+}
+
+std::vector<uint8_t> ColumnarCompressor::compress(const std::vector<uint8_t>& data,
+                                                  CompressionContext& context) const {
+    if (data.empty()) {
+        return {};
+    }
+
+    std::vector<uint8_t> result;
+    result.push_back(FORMAT_VERSION);
+    CompressionStats* stats = context.stats();
+
+    size_t pos = 0;
+    while (pos < data.size()) {
+        // Frames end after a newline, unless a whole frame has none
+        size_t frameEnd = std::min(data.size(), pos + FRAME_SIZE);
+        if (frameEnd < data.size()) {
+            size_t linesEnd = wholeLinesSize(data.data() + pos, frameEnd - pos);
+            if (linesEnd > 0) {
+                frameEnd = pos + linesEnd;
+            }
+        }
+        const uint8_t* frame = data.data() + pos;
+        size_t frameSize = frameEnd - pos;
+
+        StageTimer splitTimer(stats, "columnar split", frameSize);
+        Structure structure = detectStructure(frame, frameSize);
+        size_t linesEnd = structure.layout == Layout::RAW ? 0 : wholeLinesSize(frame, frameSize);
+        std::vector<std::vector<uint8_t>> columns;
+        result.push_back(static_cast<uint8_t>(structure.layout));
+        if (structure.layout == Layout::DELIMITED) {
+            size_t lineCount = splitDelimited(frame, linesEnd, structure.delimiter, columns);
+            result.push_back(structure.delimiter);
+            utils::writeVarint(result, lineCount);
+            utils::writeVarint(result, columns.size());
+        } else if (structure.layout == Layout::FIXED_WIDTH) {
+            splitFixedWidth(frame, linesEnd, structure.fieldWidths, structure.lineLength, columns);
+            utils::writeVarint(result, structure.lineLength);
+            utils::writeVarint(result, linesEnd / structure.lineLength);
+            utils::writeVarint(result, structure.fieldWidths.size());
+            for (size_t width : structure.fieldWidths) {
+                utils::writeVarint(result, width);
+            }
+        }
+        columns.emplace_back(frame + linesEnd, frame + frameSize);
+        splitTimer.stop(frameSize);
+
+        StageTimer backendTimer(stats, "columnar backends", frameSize);
+        size_t frameOutput = result.size();
+        for (const auto& column : columns) {
+            writeStream(result, column, context);
+        }
+        backendTimer.stop(result.size() - frameOutput);
+        pos = frameEnd;
+    }
+
+    return result;
+}
+
+std::vector<uint8_t> ColumnarCompressor::decompress(const std::vector<uint8_t>& data) const {
+    CompressionContext context;
+    return decompress(data, context);
+}
+
+std::vector<uint8_t> ColumnarCompressor::decompress(const std::vector<uint8_t>& data,
+                                                    CompressionContext& context) const {
+    if (data.empty()) {
+        return {};
+    }
+    if (data[0] != FORMAT_VERSION) {
+        throw std::runtime_error("Unsupported columnar stream version: " + std::to_string(data[0]));
+    }
+
+    // Streams name their backends, which need not be the ones we were built with
+    std::map<format::AlgorithmID, std::unique_ptr<ICompressor>> decoders;
+    size_t offset = 1;
+    auto readStream = [&]() {
+        if (offset >= data.size()) {
+            throw std::runtime_error("Invalid columnar frame: missing stream");
+        }
+        auto algorithm = static_cast<format::AlgorithmID>(data[offset++]);
+        uint64_t size = utils::readVarint(data, offset, "columnar");
+        uint64_t payloadSize = utils::readVarint(data, offset, "columnar");
+        if (payloadSize > data.size() - offset) {
+            throw std::runtime_error("Invalid columnar frame: truncated stream");
+        }
+        std::vector<uint8_t> stream(data.begin() + offset, data.begin() + offset + payloadSize);
+        offset += payloadSize;
+        if (algorithm != format::AlgorithmID::NULL_COMPRESSOR) {
+            if (algorithm == format::AlgorithmID::COLUMNAR_COMPRESSOR) {
+                throw std::runtime_error("Invalid columnar stream: nested columnar backend");
+            }
+            auto& decoder = decoders[algorithm];
+            if (!decoder) {
+                try {
+                    decoder = createCompressor(algorithm);
+                } catch (const std::invalid_argument&) {
+                    throw std::runtime_error("Invalid columnar stream algorithm: " +
+                                             std::to_string(static_cast<unsigned>(algorithm)));
+                }
+            }
+            stream = decoder->decompress(stream, context);
+        }
+        if (stream.size() != size) {
+            throw std::runtime_error("Invalid columnar stream: size mismatch");
+        }
+        return stream;
+    };
+
+    std::vector<uint8_t> result;
+    while (offset < data.size()) {
+        auto layout = static_cast<Layout>(data[offset++]);
+        if (layout == Layout::DELIMITED) {
+            if (offset >= data.size()) {
+                throw std::runtime_error("Invalid columnar frame: truncated layout");
+            }
+            uint8_t delimiter = data[offset++];
+            uint64_t lineCount = utils::readVarint(data, offset, "columnar");
+            uint64_t columnCount = utils::readVarint(data, offset, "columnar");
+            if (delimiter == '\n' || columnCount == 0 || columnCount > MAX_COLUMNS) {
+                throw std::runtime_error("Invalid columnar frame: bad delimited layout");
+            }
+            std::vector<std::vector<uint8_t>> columns;
+            for (uint64_t i = 0; i < columnCount; ++i) {
+                columns.push_back(readStream());
+            }
+
+            // Each line takes fields from successive columns up to the one ended by a newline
+            std::vector<size_t> cursors(columnCount, 0);
+            for (uint64_t line = 0; line < lineCount; ++line) {
+                for (size_t column = 0;; ++column) {
+                    if (column == columnCount) {
+                        throw std::runtime_error("Invalid columnar frame: line has too many fields");
+                    }
+                    const std::vector<uint8_t>& values = columns[column];
+                    size_t start = cursors[column];
+                    size_t end = start;
+                    while (end < values.size() && values[end] != '\n' &&
+                           (values[end] != delimiter || column + 1 == MAX_COLUMNS)) {
+                        end++;
+                    }
+                    if (end == values.size()) {
+                        throw std::runtime_error("Invalid columnar frame: column ends inside a field");
+                    }
+                    result.insert(result.end(), values.begin() + start, values.begin() + end + 1);
+                    cursors[column] = end + 1;
+                    if (values[end] == '\n') {
+                        break;
+                    }
+                }
+            }
+            for (size_t column = 0; column < columnCount; ++column) {
+                if (cursors[column] != columns[column].size()) {
+                    throw std::runtime_error("Invalid columnar frame: unused column bytes");
+                }
+            }
+        } else if (layout == Layout::FIXED_WIDTH) {
+            uint64_t lineLength = utils::readVarint(data, offset, "columnar");
+            uint64_t lineCount = utils::readVarint(data, offset, "columnar");
+            uint64_t fieldCount = utils::readVarint(data, offset, "columnar");
+            if (fieldCount == 0 || fieldCount > MAX_COLUMNS) {
+                throw std::runtime_error("Invalid columnar frame: bad fixed-width layout");
+            }
+            std::vector<uint64_t> widths(fieldCount);
+            uint64_t totalWidth = 0;
+            for (auto& width : widths) {
+                width = utils::readVarint(data, offset, "columnar");
+                if (width == 0 || width > lineLength) {
+                    throw std::runtime_error("Invalid columnar frame: bad field width");
+                }
+                totalWidth += width;
+            }
+            if (totalWidth != lineLength) {
+                throw std::runtime_error("Invalid columnar frame: field widths do not add up to the line");
+            }
+            std::vector<std::vector<uint8_t>> columns;
+            for (uint64_t field = 0; field < fieldCount; ++field) {
+                columns.push_back(readStream());
+                if (columns.back().size() % widths[field] != 0 ||
+                    columns.back().size() / widths[field] != lineCount) {
+                    throw std::runtime_error("Invalid columnar frame: column size does not match line count");
+                }
+            }
+            result.reserve(result.size() + lineCount * lineLength);
+            for (uint64_t line = 0; line < lineCount; ++line) {
+                for (uint64_t field = 0; field < fieldCount; ++field) {
+                    auto value = columns[field].begin() + line * widths[field];
+                    result.insert(result.end(), value, value + widths[field]);
+                }
+            }
+        } else if (layout != Layout::RAW) {
+            throw std::runtime_error("Invalid columnar frame layout: " + std::to_string(static_cast<unsigned>(layout)));
+        }
+        std::vector<uint8_t> rest = readStream();
+        result.insert(result.end(), rest.begin(), rest.end());
+    }
+
+    return result;
+}
+
+size_t ColumnarCompressor::scratchSize(size_t inputSize) const {
+    size_t frame = std::min(inputSize, FRAME_SIZE);
+    size_t scratch = 0;
+    for (const auto& candidate : candidates_) {
+        scratch = std::max(scratch, candidate.second->scratchSize(frame));
+    }
+    return scratch;
+}
+
+size_t ColumnarCompressor::workingSetSize(size_t inputSize) const {
+    size_t frame = std::min(inputSize, FRAME_SIZE);
+    size_t backend = 0;
+    for (const auto& candidate : candidates_) {
+        backend = std::max(backend, candidate.second->workingSetSize(frame));
+    }
+    // The frame's columns, a column's trial outputs and the growing result
+    return backend + 3 * frame + inputSize;
+}
+
+} // namespace compression
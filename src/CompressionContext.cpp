@@ -0,0 +1,100 @@
+#include "compression/CompressionContext.hpp"
+#include <algorithm>
+
+namespace compression {
+
+namespace {
+// Smallest block we bother allocating; keeps tiny requests from fragmenting the arena.
+constexpr size_t MIN_BLOCK_SIZE = 4096;
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+} // anonymous namespace
+
+CompressionContext::CompressionContext(size_t reserveBytes) {
+    if (reserveBytes > 0) {
+        addBlock(reserveBytes);
+    }
+}
+
+void* CompressionContext::allocateBytes(size_t bytes, size_t alignment) {
+    if (bytes == 0) {
+        bytes = 1; // Hand out a unique, valid pointer even for empty arrays
+    }
+
+    // Try the current block first, then any spare blocks kept from earlier calls
+    while (currentBlock_ < blocks_.size()) {
+        Block& block = blocks_[currentBlock_];
+        size_t start = alignUp(offset_, alignment);
+        if (start + bytes <= block.size) {
+            offset_ = start + bytes;
+            used_ += bytes;
+            peak_ = std::max(peak_, used_);
+            return block.memory.get() + start;
+        }
+        ++currentBlock_;
+        offset_ = 0;
+    }
+
+    addBlock(bytes);
+    Block& block = blocks_.back();
+    offset_ = bytes;
+    used_ += bytes;
+    peak_ = std::max(peak_, used_);
+    return block.memory.get();
+}
+
+void CompressionContext::addBlock(size_t minimumBytes) {
+    // Grow geometrically so a call that keeps allocating needs few blocks
+    size_t size = std::max({minimumBytes, MIN_BLOCK_SIZE, capacity()});
+    Block block;
+    block.memory.reset(new unsigned char[size]);
+    block.size = size;
+    blocks_.push_back(std::move(block));
+    currentBlock_ = blocks_.size() - 1;
+    offset_ = 0;
+}
+
+void CompressionContext::reset() {
+    if (blocks_.size() > 1) {
+        // Coalesce so the next call of the same shape fits in one block
+        size_t total = capacity();
+        blocks_.clear();
+        addBlock(total);
+    }
+    currentBlock_ = 0;
+    offset_ = 0;
+    used_ = 0;
+}
+
+void CompressionContext::reserve(size_t bytes) {
+    size_t available = capacity();
+    if (available >= bytes) {
+        return;
+    }
+    if (used_ == 0) {
+        blocks_.clear();
+        addBlock(bytes);
+    } else {
+        // Memory is still handed out, so append a block instead of replacing
+        addBlock(bytes - available);
+    }
+}
+
+size_t CompressionContext::capacity() const {
+    size_t total = 0;
+    for (const auto& block : blocks_) {
+        total += block.size;
+    }
+    return total;
+}
+
+void CompressionContext::enableStats(bool enabled) {
+    if (enabled && !stats_) {
+        stats_ = std::make_unique<CompressionStats>();
+    }
+    statsEnabled_ = enabled;
+}
+
+} // namespace compression
@@ -0,0 +1,57 @@
+#include "compression/CompressionStats.hpp"
+#include <iomanip>
+
+namespace compression {
+
+void CompressionStats::addCounters(const CompressionStats& other) {
+    literals += other.literals;
+    matches += other.matches;
+    matchedBytes += other.matchedBytes;
+    longMatches += other.longMatches;
+    repeatMatches += other.repeatMatches;
+    matchSearches += other.matchSearches;
+    chainSteps += other.chainSteps;
+    entropyTableBytes += other.entropyTableBytes;
+    storedBytes += other.storedBytes;
+    chunks += other.chunks;
+    duplicateChunks += other.duplicateChunks;
+}
+
+void CompressionStats::print(std::ostream& out) const {
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed;
+
+    out << std::left << std::setw(28) << "Stage" << std::right << std::setw(12) << "Time (ms)"
+        << std::setw(14) << "Bytes in" << std::setw(14) << "Bytes out" << std::setw(10) << "MB/s" << "\n";
+    for (const auto& stage : stages) {
+        std::string name = std::string(2 * stage.depth, ' ') + stage.name;
+        out << std::left << std::setw(28) << name << std::right << std::setprecision(3)
+            << std::setw(12) << stage.seconds * 1000.0 << std::setw(14) << stage.bytesIn
+            << std::setw(14) << stage.bytesOut << std::setprecision(2) << std::setw(10)
+            << (stage.seconds > 0 ? stage.bytesIn / 1e6 / stage.seconds : 0.0) << "\n";
+    }
+
+    if (matchSearches > 0 || matches > 0 || literals > 0) {
+        out << std::setprecision(2)
+            << "Literals: " << literals << ", matches: " << matches << " (" << longMatches
+            << " long, " << repeatMatches << " at a repeat distance), average match length: " << averageMatchLength()
+            << ", literal ratio: " << 100.0 * literalRatio() << "%\n"
+            << "Match searches: " << matchSearches << ", chain steps: " << chainSteps
+            << " (" << averageChainSteps() << " per search)\n";
+    }
+    if (entropyTableBytes > 0) {
+        out << "Entropy table bytes: " << entropyTableBytes << "\n";
+    }
+    if (storedBytes > 0) {
+        out << "Stored bytes: " << storedBytes << "\n";
+    }
+    if (chunks > 0) {
+        out << "Chunks: " << chunks << ", duplicates: " << duplicateChunks << "\n";
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // namespace compression
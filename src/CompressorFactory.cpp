@@ -0,0 +1,103 @@
+#include "compression/CompressorFactory.hpp"
+#include "compression/NullCompressor.hpp"
+#include "compression/RleCompressor.hpp"
+#include "compression/HuffmanCompressor.hpp"
+#include "compression/Lz77Compressor.hpp"
+#include "compression/LzhCompressor.hpp"
+#include "compression/BwtCompressor.hpp"
+#include "compression/DedupCompressor.hpp"
+#include "compression/ColumnarCompressor.hpp"
+#include "compression/AutoCompressor.hpp"
+#include "compression/ContextMixingCompressor.hpp"
+#include "compression/PpmCompressor.hpp"
+#include "compression/Dictionary.hpp"
+#include <stdexcept>
+
+namespace compression {
+
+std::unique_ptr<ICompressor> createCompressor(format::AlgorithmID id,
+                                              std::shared_ptr<const Dictionary> dictionary) {
+    switch (id) {
+        case format::AlgorithmID::RLE_COMPRESSOR:
+            if (dictionary) break;
+            return std::make_unique<RleCompressor>();
+        case format::AlgorithmID::NULL_COMPRESSOR:
+            if (dictionary) break;
+            return std::make_unique<NullCompressor>();
+        case format::AlgorithmID::HUFFMAN_COMPRESSOR: {
+            auto huffman = std::make_unique<HuffmanCompressor>();
+            huffman->setDictionary(std::move(dictionary));
+            return huffman;
+        }
+        case format::AlgorithmID::LZ77_COMPRESSOR: {
+            auto lz77 = std::make_unique<Lz77Compressor>(32768, 3, 258, false, true, true);
+            lz77->setDictionary(std::move(dictionary));
+            return lz77;
+        }
+        case format::AlgorithmID::LZH_COMPRESSOR: {
+            auto lzh = std::make_unique<LzhCompressor>();
+            lzh->setDictionary(std::move(dictionary));
+            return lzh;
+        }
+        case format::AlgorithmID::BWT_COMPRESSOR:
+            if (dictionary) break;
+            return std::make_unique<BwtCompressor>();
+        case format::AlgorithmID::DEDUP_COMPRESSOR:
+            if (dictionary) break;
+            return std::make_unique<DedupCompressor>();
+        case format::AlgorithmID::AUTO_COMPRESSOR:
+            if (dictionary) break;
+            return std::make_unique<AutoCompressor>();
+        case format::AlgorithmID::CONTEXT_MIXING_COMPRESSOR:
+            if (dictionary) break;
+            return std::make_unique<ContextMixingCompressor>();
+        case format::AlgorithmID::PPM_COMPRESSOR:
+            if (dictionary) break;
+            return std::make_unique<PpmCompressor>();
+        case format::AlgorithmID::COLUMNAR_COMPRESSOR:
+            if (dictionary) break;
+            return std::make_unique<ColumnarCompressor>();
+        default:
+            throw std::invalid_argument("Unknown or unsupported compression algorithm ID: "
+                                        + std::to_string(static_cast<uint8_t>(id)));
+    }
+    throw std::invalid_argument("Algorithm " + format::algorithmIdToString(id)
+                                + " does not support dictionaries (use lz77, lzh or huffman)");
+}
+
+std::unique_ptr<ICompressor> createCompressor(const std::string& name,
+                                              std::shared_ptr<const Dictionary> dictionary) {
+    size_t separator = name.find(':');
+    format::AlgorithmID id = format::stringToAlgorithmId(name.substr(0, separator));
+    if (id == format::AlgorithmID::UNKNOWN) {
+        throw std::invalid_argument("Unknown compression strategy name: " + name);
+    }
+    if (separator == std::string::npos) {
+        return createCompressor(id, std::move(dictionary));
+    }
+
+    // "pipeline:backend", or "bwt:<entropy stage>"
+    format::AlgorithmID backend = format::stringToAlgorithmId(name.substr(separator + 1));
+    bool bwtStage = id == format::AlgorithmID::BWT_COMPRESSOR &&
+                    (backend == format::AlgorithmID::HUFFMAN_COMPRESSOR ||
+                     backend == format::AlgorithmID::CONTEXT_MIXING_COMPRESSOR);
+    bool pipelineBackend = (id == format::AlgorithmID::DEDUP_COMPRESSOR ||
+                            id == format::AlgorithmID::COLUMNAR_COMPRESSOR) &&
+                           backend != format::AlgorithmID::UNKNOWN;
+    if (!bwtStage && !pipelineBackend) {
+        throw std::invalid_argument("Unknown compression strategy name: " + name);
+    }
+    if (dictionary) {
+        throw std::invalid_argument("Algorithm " + format::algorithmIdToString(id) +
+                                    " does not support dictionaries (use lz77, lzh or huffman)");
+    }
+    if (bwtStage) {
+        return std::make_unique<BwtCompressor>(backend);
+    }
+    if (id == format::AlgorithmID::COLUMNAR_COMPRESSOR) {
+        return std::make_unique<ColumnarCompressor>(backend);
+    }
+    return std::make_unique<DedupCompressor>(backend);
+}
+
+} // namespace compression
@@ -0,0 +1,322 @@
+#include "compression/ContextMixingCompressor.hpp"
+#include "compression/RangeCoder.hpp"
+#include "compression/StoredFallback.hpp"
+#include "compression/Varint.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+
+namespace compression {
+
+namespace {
+
+// predict() clamps the chance of either bit to at most 4095/4096, and a byte
+// is 8 coded bits: this bounds how many bytes a stream can claim to hold
+constexpr uint64_t MAX_BYTES_PER_CODED_BYTE =
+    utils::maxEventsPerCodedByte(uint64_t(1) << utils::RANGE_CODER_PROBABILITY_BITS) / 8;
+
+// --- Logistic domain ---
+
+// 1 / (1 + e^-x) for x = d / 256, d in [-2047, 2047], as a 12-bit probability;
+// interpolated from 33 points
+constexpr int squash(int d) {
+    constexpr int points[33] = {1,    2,    3,    6,    10,   16,   27,   45,   73,   120,  194,
+                                310,  488,  747,  1101, 1546, 2047, 2549, 2994, 3348, 3607, 3785,
+                                3901, 3975, 4024, 4050, 4068, 4079, 4085, 4089, 4092, 4093, 4094};
+    if (d > 2047) return 4095;
+    if (d < -2047) return 1;
+    int weight = d & 127;
+    int index = (d >> 7) + 16;
+    return (points[index] * (128 - weight) + points[index + 1] * weight + 64) >> 7;
+}
+
+// Inverse of squash(): ln(p / (1 - p)) * 256 for each 12-bit probability
+struct StretchTable {
+    int16_t values[4096];
+    constexpr StretchTable() : values() {
+        int next = 0;
+        for (int d = -2047; d <= 2047; ++d) {
+            int p = squash(d);
+            for (; next <= p; ++next) {
+                values[next] = static_cast<int16_t>(d);
+            }
+        }
+        for (; next < 4096; ++next) {
+            values[next] = 2047;
+        }
+    }
+};
+
+inline constexpr StretchTable STRETCH{};
+
+// --- Bit models ---
+
+// A bit model packs a 22-bit probability of a 1 and a 10-bit count of the
+// bits it has seen. It moves 1/(count + 1.5) of the way towards each bit,
+// so it learns fast from its first bits and then settles, until the count
+// reaches the model's limit and the rate stays fixed.
+constexpr uint32_t NEW_BIT_MODEL = 1u << 31;
+
+struct ReciprocalTable {
+    uint32_t values[1024];
+    constexpr ReciprocalTable() : values() {
+        for (uint32_t count = 0; count < 1024; ++count) {
+            values[count] = 131072 / (2 * count + 3); // 65536 / (count + 1.5)
+        }
+    }
+};
+
+inline constexpr ReciprocalTable RECIPROCALS{};
+
+inline int bitModelP(uint32_t model) {
+    return static_cast<int>(model >> 20);
+}
+
+inline void updateBitModel(uint32_t& model, unsigned bit, uint32_t limit) {
+    uint32_t count = model & 1023;
+    int64_t p = model >> 10;
+    int64_t target = bit ? (1 << 22) - 1 : 0;
+    p += ((target - p) * RECIPROCALS.values[count]) >> 16;
+    model = (static_cast<uint32_t>(p) << 10) | (count < limit ? count + 1 : count);
+}
+
+// Counts after which each order's models stop slowing down; low orders see
+// many mixed contexts and keep adapting faster
+constexpr uint32_t ORDER0_LIMIT = 60;
+constexpr uint32_t ORDER1_LIMIT = 1023;
+constexpr uint32_t ORDER2_LIMIT = 1023;
+
+// --- Mixer and secondary estimation ---
+
+constexpr size_t INPUTS = 4;         // Orders 0-2 and a bias
+constexpr int BIAS_INPUT = 256;
+constexpr int MIXER_RATE = 12;       // Error scale of a weight update
+constexpr int MIXER_SHIFT = 14;      // Weights are 16.16 fixed point; updates drop these bits
+constexpr int INITIAL_WEIGHT = 22000; // About 1/3
+
+// Secondary estimation interpolates 33 bins over the stretched prediction,
+// in each order-1 context
+constexpr size_t APM_BINS = 33;
+constexpr size_t APM_CONTEXTS = 65536;
+constexpr int APM_RATE = 7;
+
+// Model tables are carved out of the context arena
+size_t modelBytes(unsigned order2Bits) {
+    size_t counters = 256 + 65536 + (size_t(1) << order2Bits);
+    return counters * sizeof(uint32_t) + 256 * INPUTS * sizeof(int32_t) +
+           APM_CONTEXTS * APM_BINS * sizeof(uint16_t) + 4 * 64; // Alignment slack
+}
+
+/**
+ * Predicts each bit from the bytes before it and learns from the bit coded.
+ * Encoder and decoder run identical models, so the predictions match.
+ */
+class MixingModel {
+public:
+    MixingModel(CompressionContext& context, unsigned order2Bits)
+        : order2Bits_(order2Bits) {
+        order0_ = context.allocate<uint32_t>(256);
+        order1_ = context.allocate<uint32_t>(65536);
+        order2_ = context.allocate<uint32_t>(size_t(1) << order2Bits);
+        weights_ = context.allocate<int32_t>(256 * INPUTS);
+        apm_ = context.allocate<uint16_t>(APM_CONTEXTS * APM_BINS);
+
+        std::fill_n(order0_, 256, NEW_BIT_MODEL);
+        std::fill_n(order1_, 65536, NEW_BIT_MODEL);
+        std::fill_n(order2_, size_t(1) << order2Bits, NEW_BIT_MODEL);
+        for (size_t set = 0; set < 256; ++set) {
+            std::fill_n(weights_ + set * INPUTS, INPUTS - 1, INITIAL_WEIGHT);
+            weights_[set * INPUTS + INPUTS - 1] = 0;
+        }
+        uint16_t bins[APM_BINS];
+        for (size_t bin = 0; bin < APM_BINS; ++bin) {
+            bins[bin] = static_cast<uint16_t>(squash((static_cast<int>(bin) - 16) * 128) * 16);
+        }
+        for (size_t apmContext = 0; apmContext < APM_CONTEXTS; ++apmContext) {
+            std::copy(bins, bins + APM_BINS, apm_ + apmContext * APM_BINS);
+        }
+        selectContexts();
+    }
+
+    // Probability that the next bit is 1, in 1/4096 units
+    uint32_t predict() {
+        models_[0] = &order0_[partial_];
+        models_[1] = &order1_[(previous_ << 8) | partial_];
+        models_[2] = &order2_[order2Base_ | partial_];
+        for (size_t i = 0; i < 3; ++i) {
+            inputs_[i] = STRETCH.values[bitModelP(*models_[i])];
+        }
+        inputs_[3] = BIAS_INPUT;
+
+        const int32_t* weights = weights_ + partial_ * INPUTS;
+        int64_t dot = 0;
+        for (size_t i = 0; i < INPUTS; ++i) {
+            dot += static_cast<int64_t>(inputs_[i]) * weights[i];
+        }
+        int stretched = static_cast<int>(std::clamp<int64_t>(dot >> 16, -2047, 2047));
+        mixed_ = squash(stretched);
+
+        // Refine in the order-1 context, between the two nearest bins
+        int position = stretched + 2048;
+        apmWeight_ = position & 127;
+        apmSlot_ = apm_ + ((previous_ << 8) | partial_) * APM_BINS + (position >> 7);
+        int refined = (apmSlot_[0] * (128 - apmWeight_) + apmSlot_[1] * apmWeight_) >> 11;
+
+        int p = (mixed_ + 3 * refined) >> 2;
+        return static_cast<uint32_t>(std::clamp(p, 1, 4095));
+    }
+
+    void update(unsigned bit) {
+        updateBitModel(*models_[0], bit, ORDER0_LIMIT);
+        updateBitModel(*models_[1], bit, ORDER1_LIMIT);
+        updateBitModel(*models_[2], bit, ORDER2_LIMIT);
+
+        int32_t* weights = weights_ + partial_ * INPUTS;
+        int error = ((static_cast<int>(bit) << 12) - mixed_) * MIXER_RATE;
+        for (size_t i = 0; i < INPUTS; ++i) {
+            weights[i] += (inputs_[i] * error) >> MIXER_SHIFT;
+        }
+
+        uint16_t& nearest = apmSlot_[apmWeight_ >> 6];
+        int target = bit ? 65535 : 0;
+        nearest = static_cast<uint16_t>(nearest + ((target - nearest) >> APM_RATE));
+
+        partial_ = (partial_ << 1) | bit;
+        if (partial_ >= 256) {
+            previous2_ = previous_;
+            previous_ = partial_ & 0xFF;
+            partial_ = 1;
+            selectContexts();
+        }
+    }
+
+private:
+    // Hashes the last two bytes to a row of 256 order-2 bit models
+    void selectContexts() {
+        uint32_t history = (previous2_ << 8) | previous_;
+        order2Base_ = ((history * 0x9E3779B1u) >> (32 - (order2Bits_ - 8))) << 8;
+    }
+
+    unsigned order2Bits_;
+    uint32_t* order0_;
+    uint32_t* order1_;
+    uint32_t* order2_;
+    int32_t* weights_;  // INPUTS weights per partial byte
+    uint16_t* apm_;     // APM_BINS 16-bit probabilities per order-1 context
+
+    uint32_t partial_ = 1; // Bits of the current byte so far, after a leading 1
+    uint32_t previous_ = 0;
+    uint32_t previous2_ = 0;
+    uint32_t order2Base_ = 0;
+
+    // State of the bit being coded, kept from predict() for update()
+    uint32_t* models_[3] = {};
+    int inputs_[INPUTS] = {};
+    int mixed_ = 2048;
+    uint16_t* apmSlot_ = nullptr;
+    int apmWeight_ = 0;
+};
+
+} // anonymous namespace
+
+unsigned ContextMixingCompressor::order2Bits(size_t inputSize) {
+    // About four bit models per input byte
+    unsigned bits = MIN_ORDER2_BITS;
+    while (bits < MAX_ORDER2_BITS && (size_t(1) << bits) < 4 * inputSize) {
+        ++bits;
+    }
+    return bits;
+}
+
+size_t ContextMixingCompressor::scratchSize(size_t inputSize) const {
+    return modelBytes(order2Bits(inputSize));
+}
+
+size_t ContextMixingCompressor::workingSetSize(size_t inputSize) const {
+    return scratchSize(inputSize) + inputSize;
+}
+
+void ContextMixingCompressor::encodeModeled(const std::vector<uint8_t>& data, std::vector<uint8_t>& output,
+                                            CompressionContext& context) const {
+    CompressionContext::Scope scope(context);
+    MixingModel model(context, order2Bits(data.size()));
+    utils::RangeEncoder encoder(output);
+    for (uint8_t byte : data) {
+        for (int shift = 7; shift >= 0; --shift) {
+            unsigned bit = (byte >> shift) & 1;
+            encoder.encode(bit, model.predict());
+            model.update(bit);
+        }
+    }
+    encoder.flush();
+}
+
+std::vector<uint8_t> ContextMixingCompressor::decodeModeled(const uint8_t* data, size_t size,
+                                                            size_t originalSize,
+                                                            CompressionContext& context) const {
+    CompressionContext::Scope scope(context);
+    MixingModel model(context, order2Bits(originalSize));
+    utils::RangeDecoder decoder(data, size);
+    std::vector<uint8_t> result(originalSize);
+    for (auto& byte : result) {
+        unsigned value = 0;
+        for (int bit = 0; bit < 8; ++bit) {
+            unsigned decoded = decoder.decode(model.predict());
+            model.update(decoded);
+            value = (value << 1) | decoded;
+        }
+        byte = static_cast<uint8_t>(value);
+    }
+    return result;
+}
+
+std::vector<uint8_t> ContextMixingCompressor::compress(const std::vector<uint8_t>& data) const {
+    CompressionContext context(scratchSize(data.size()));
+    return compress(data, context);
+}
+
+std::vector<uint8_t> ContextMixingCompressor::compress(const std::vector<uint8_t>& data,
+                                                       CompressionContext& context) const {
+    if (data.empty()) {
+        return {};
+    }
+
+    CompressionStats* stats = context.stats();
+    return utils::modelOrStore(data, stats, [&](std::vector<uint8_t>& result) {
+        StageTimer timer(stats, "context mixing", data.size());
+        utils::writeVarint(result, data.size());
+        encodeModeled(data, result, context);
+        timer.stop(result.size());
+    });
+}
+
+std::vector<uint8_t> ContextMixingCompressor::decompress(const std::vector<uint8_t>& data) const {
+    CompressionContext context;
+    return decompress(data, context);
+}
+
+std::vector<uint8_t> ContextMixingCompressor::decompress(const std::vector<uint8_t>& data,
+                                                         CompressionContext& context) const {
+    if (data.empty()) {
+        return {};
+    }
+
+    if (utils::isStoredStream(data, "context mixing")) {
+        return std::vector<uint8_t>(data.begin() + 1, data.end());
+    }
+
+    size_t offset = 1;
+    uint64_t originalSize = utils::readVarint(data, offset, "context mixing");
+    if (originalSize / MAX_BYTES_PER_CODED_BYTE > data.size() - offset) {
+        throw std::runtime_error("Context mixing stream claims more data than it can hold");
+    }
+
+    StageTimer timer(context.stats(), "context mixing decoding", data.size());
+    context.reserve(scratchSize(originalSize));
+    auto result = decodeModeled(data.data() + offset, data.size() - offset, originalSize, context);
+    timer.stop(result.size());
+    return result;
+}
+
+} // namespace compression
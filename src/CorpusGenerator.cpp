@@ -0,0 +1,444 @@
+#include "compression/CorpusGenerator.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace compression {
+namespace utils {
+
+namespace {
+
+// xoshiro256** seeded through splitmix64. Only integer arithmetic, so the
+// sequence is identical on every platform and standard library.
+class Random {
+public:
+    explicit Random(uint64_t seed) {
+        for (auto& word : state_) {
+            seed += 0x9E3779B97F4A7C15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        const uint64_t result = rotateLeft(state_[1] * 5, 7) * 9;
+        const uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotateLeft(state_[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, bound); the modulo bias is negligible for our small bounds
+    uint64_t below(uint64_t bound) { return next() % bound; }
+
+    // True with probability numerator / denominator
+    bool chance(uint64_t numerator, uint64_t denominator) { return below(denominator) < numerator; }
+
+    // Index drawn with probability proportional to 1 / (index + 1)
+    size_t zipf(size_t count) {
+        uint64_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            total += ZIPF_SCALE / (i + 1);
+        }
+        uint64_t pick = below(total);
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t weight = ZIPF_SCALE / (i + 1);
+            if (pick < weight) {
+                return i;
+            }
+            pick -= weight;
+        }
+        return count - 1;
+    }
+
+private:
+    static constexpr uint64_t ZIPF_SCALE = 1 << 20;
+
+    static uint64_t rotateLeft(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    uint64_t state_[4];
+};
+
+void append(std::vector<uint8_t>& out, const char* text) {
+    while (*text) {
+        out.push_back(static_cast<uint8_t>(*text++));
+    }
+}
+
+template <typename... Args>
+void appendFormatted(std::vector<uint8_t>& out, const char* format, Args... args) {
+    char line[256];
+    int length = std::snprintf(line, sizeof(line), format, args...);
+    out.insert(out.end(), line, line + std::min<int>(length, sizeof(line) - 1));
+}
+
+// Produces the corpus one small unit (a sentence, a line, a record) at a time
+class Producer {
+public:
+    explicit Producer(uint64_t seed) : random_(seed) {}
+    virtual ~Producer() = default;
+    virtual void next(std::vector<uint8_t>& out) = 0;
+
+protected:
+    Random random_;
+};
+
+const char* const WORDS[] = {
+    "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with", "be", "by",
+    "on", "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "had",
+    "they", "you", "were", "their", "one", "all", "we", "can", "her", "has", "there", "been", "if",
+    "more", "when", "will", "would", "who", "so", "no", "time", "people", "into", "after", "first",
+    "year", "system", "data", "new", "work", "world", "between", "state", "water", "process",
+    "number", "small", "large", "river", "city", "government", "market", "energy", "light", "early",
+    "history", "during", "under", "model", "value", "change", "result", "power", "country", "form",
+    "information", "network", "order", "second", "level", "point", "group", "structure", "method",
+    "research", "development", "language", "memory", "compression", "signal", "surface", "theory",
+    "against", "without", "through", "because", "however", "several", "different", "important",
+    "general", "common", "natural", "public", "known", "called", "used", "found", "made", "given",
+    "became", "began", "built", "produced", "described", "considered", "remained", "returned",
+    "mountain", "island", "village", "summer", "winter", "morning", "evening", "journey", "story"};
+constexpr size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+// Order-1 word Markov chain: each word has a few likely successors
+class TextProducer : public Producer {
+public:
+    explicit TextProducer(uint64_t seed) : Producer(seed) {
+        for (auto& successors : successors_) {
+            for (auto& successor : successors) {
+                successor = static_cast<uint16_t>(random_.below(WORD_COUNT));
+            }
+        }
+        word_ = random_.below(WORD_COUNT);
+    }
+
+    void next(std::vector<uint8_t>& out) override {
+        // One sentence of 6-20 words
+        size_t length = 6 + random_.below(15);
+        for (size_t i = 0; i < length; ++i) {
+            // Mostly follow the chain, sometimes jump to restart it
+            word_ = random_.chance(1, 10) ? random_.below(WORD_COUNT)
+                                          : successors_[word_][random_.zipf(SUCCESSORS)];
+            const char* word = WORDS[word_];
+            if (i == 0) {
+                out.push_back(static_cast<uint8_t>(word[0] - 'a' + 'A'));
+                append(out, word + 1);
+            } else {
+                out.push_back(' ');
+                append(out, word);
+            }
+            if (i + 1 < length && random_.chance(1, 12)) {
+                out.push_back(',');
+            }
+        }
+        out.push_back(random_.chance(1, 15) ? '?' : '.');
+        out.push_back(++sentences_ % 6 == 0 ? '\n' : ' ');
+    }
+
+private:
+    static constexpr size_t SUCCESSORS = 12;
+    std::array<std::array<uint16_t, SUCCESSORS>, WORD_COUNT> successors_;
+    size_t word_;
+    uint64_t sentences_ = 0;
+};
+
+// Converts days since 1970-01-01 to a civil date (proleptic Gregorian)
+void civilFromDays(int64_t days, int& year, unsigned& month, unsigned& day) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+    const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = static_cast<int>(yearOfEra + era * 400 + (month <= 2));
+}
+
+// Service logs: increasing timestamps, skewed levels, a handful of templates
+class LogProducer : public Producer {
+public:
+    explicit LogProducer(uint64_t seed) : Producer(seed) {}
+
+    void next(std::vector<uint8_t>& out) override {
+        static const char* const LEVELS[] = {"INFO", "DEBUG", "WARN", "ERROR"};
+        static const char* const SERVICES[] = {"api-gateway", "auth", "billing", "search",
+                                               "scheduler", "storage", "mailer", "frontend"};
+        static const char* const PATHS[] = {"/api/v1/users", "/api/v1/orders", "/api/v1/items",
+                                            "/health", "/api/v2/search", "/login"};
+
+        timeMs_ += random_.below(2000);
+        const int64_t seconds = static_cast<int64_t>(timeMs_ / 1000);
+        int year;
+        unsigned month, day;
+        civilFromDays(seconds / 86400, year, month, day);
+        const unsigned secondOfDay = static_cast<unsigned>(seconds % 86400);
+        appendFormatted(out, "%04d-%02u-%02uT%02u:%02u:%02u.%03uZ %-5s [%s] ", year, month, day,
+                        secondOfDay / 3600, secondOfDay / 60 % 60, secondOfDay % 60,
+                        static_cast<unsigned>(timeMs_ % 1000), LEVELS[random_.zipf(4)],
+                        SERVICES[random_.zipf(8)]);
+
+        const unsigned id = static_cast<unsigned>(random_.below(100000));
+        switch (random_.zipf(5)) {
+            case 0:
+                appendFormatted(out, "GET %s/%u 200 %ums\n", PATHS[random_.zipf(6)], id,
+                                static_cast<unsigned>(1 + random_.below(250)));
+                break;
+            case 1:
+                appendFormatted(out, "request_id=%08x%08x user=%u action=login status=ok\n",
+                                static_cast<unsigned>(random_.next()), static_cast<unsigned>(random_.next()), id);
+                break;
+            case 2:
+                appendFormatted(out, "connection from 10.%u.%u.%u:%u accepted\n",
+                                static_cast<unsigned>(random_.below(4)), static_cast<unsigned>(random_.below(256)),
+                                static_cast<unsigned>(random_.below(256)),
+                                static_cast<unsigned>(32768 + random_.below(28000)));
+                break;
+            case 3:
+                appendFormatted(out, "cache miss key=session:%u ttl=%u\n", id,
+                                static_cast<unsigned>(60 * (1 + random_.below(60))));
+                break;
+            default:
+                appendFormatted(out, "slow query took %ums: SELECT * FROM orders WHERE customer_id = %u\n",
+                                static_cast<unsigned>(500 + random_.below(5000)), id);
+                break;
+        }
+    }
+
+private:
+    uint64_t timeMs_ = 1704067200000ull; // 2024-01-01T00:00:00Z
+};
+
+class RandomProducer : public Producer {
+public:
+    explicit RandomProducer(uint64_t seed) : Producer(seed) {}
+
+    void next(std::vector<uint8_t>& out) override {
+        uint64_t value = random_.next();
+        for (int i = 0; i < 8; ++i) {
+            out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+};
+
+// Arrays of 64-byte records of little-endian 32-bit fields, most of them zero
+class SparseProducer : public Producer {
+public:
+    explicit SparseProducer(uint64_t seed) : Producer(seed) {}
+
+    void next(std::vector<uint8_t>& out) override {
+        for (int field = 0; field < 16; ++field) {
+            uint32_t value = 0;
+            if (random_.chance(1, 8)) {
+                value = random_.chance(1, 10) ? static_cast<uint32_t>(random_.next())
+                                              : static_cast<uint32_t>(random_.below(256));
+            }
+            for (int i = 0; i < 4; ++i) {
+                out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+            }
+        }
+    }
+};
+
+// Runs of one byte whose lengths span 1 to 4096
+class RunProducer : public Producer {
+public:
+    explicit RunProducer(uint64_t seed) : Producer(seed) {}
+
+    void next(std::vector<uint8_t>& out) override {
+        static const uint8_t PALETTE[] = {0x00, 0xFF, 0x20, 0x30, 0x41, 0x7F, 0x80, 0xAA};
+        uint8_t byte = random_.chance(1, 4) ? static_cast<uint8_t>(random_.below(256))
+                                            : PALETTE[random_.below(sizeof(PALETTE))];
+        size_t length = 1 + random_.below(size_t(1) << (4 + random_.below(9)));
+        out.insert(out.end(), length, byte);
+    }
+};
+
+// JSON lines with a fixed schema, as exported by services or databases
+class RecordProducer : public Producer {
+public:
+    explicit RecordProducer(uint64_t seed) : Producer(seed) {}
+
+    void next(std::vector<uint8_t>& out) override {
+        static const char* const FIRST[] = {"alice", "bob", "carol", "dave", "erin", "frank",
+                                            "grace", "heidi", "ivan", "judy", "mallory", "oscar"};
+        static const char* const LAST[] = {"smith", "jones", "garcia", "chen", "muller", "rossi",
+                                           "tanaka", "silva", "novak", "kowalski"};
+        static const char* const COUNTRIES[] = {"US", "DE", "JP", "BR", "IN", "FR", "GB", "CA"};
+        static const char* const TAGS[] = {"premium", "trial", "beta", "newsletter", "mobile", "vip"};
+
+        const char* first = FIRST[random_.below(12)];
+        const char* last = LAST[random_.below(10)];
+        appendFormatted(out,
+                        "{\"id\":%llu,\"name\":\"%s %s\",\"email\":\"%s.%s@example.com\",\"age\":%u,"
+                        "\"country\":\"%s\",\"balance\":%u.%02u,",
+                        static_cast<unsigned long long>(++id_), first, last, first, last,
+                        static_cast<unsigned>(18 + random_.below(60)), COUNTRIES[random_.zipf(8)],
+                        static_cast<unsigned>(random_.below(100000)), static_cast<unsigned>(random_.below(100)));
+        append(out, "\"tags\":[");
+        size_t tagCount = random_.below(4);
+        for (size_t i = 0; i < tagCount; ++i) {
+            appendFormatted(out, "%s\"%s\"", i ? "," : "", TAGS[random_.zipf(6)]);
+        }
+        append(out, random_.chance(3, 4) ? "],\"active\":true}\n" : "],\"active\":false}\n");
+    }
+
+private:
+    uint64_t id_ = 0;
+};
+
+// Samples of a metrics time series, 32 bytes each: a timestamp in seconds,
+// three counters and four gauges, all little-endian 32-bit values
+class MetricsProducer : public Producer {
+public:
+    explicit MetricsProducer(uint64_t seed) : Producer(seed) {}
+
+    void next(std::vector<uint8_t>& out) override {
+        timestamp_ += 10 + static_cast<uint32_t>(random_.chance(1, 16));
+        appendWord(out, timestamp_);
+        for (size_t i = 0; i < 3; ++i) {
+            counters_[i] += static_cast<uint32_t>(random_.below(100 << (2 * i)));
+            appendWord(out, counters_[i]);
+        }
+        for (size_t i = 0; i < 4; ++i) {
+            // Random walks in hundredths, converted exactly to float
+            gauges_[i] += static_cast<int32_t>(random_.below(11)) - 5;
+            float value = static_cast<float>(gauges_[i]) / 100.0f;
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            appendWord(out, bits);
+        }
+    }
+
+private:
+    static void appendWord(std::vector<uint8_t>& out, uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    uint32_t timestamp_ = 1704067200; // 2024-01-01T00:00:00Z
+    uint32_t counters_[3] = {};
+    int32_t gauges_[4] = {5000, 2000, 75000, 100};
+};
+
+// CSV export of an orders table: a header line, then one order per line
+class TableProducer : public Producer {
+public:
+    explicit TableProducer(uint64_t seed) : Producer(seed) {}
+
+    void next(std::vector<uint8_t>& out) override {
+        static const char* const CUSTOMERS[] = {"alice smith", "bob jones", "carol garcia", "dave chen",
+                                                "erin muller", "frank rossi", "grace tanaka", "heidi silva",
+                                                "ivan novak", "judy kowalski", "mallory chen", "oscar jones"};
+        static const char* const COUNTRIES[] = {"US", "DE", "JP", "BR", "IN", "FR", "GB", "CA"};
+        static const char* const STATUSES[] = {"shipped", "delivered", "pending", "cancelled", "returned"};
+
+        if (id_ == 0) {
+            append(out, "order_id,date,customer,country,sku,quantity,unit_price,status\n");
+        }
+        // Orders arrive in id order, a few hundred per day
+        if (random_.chance(1, 300)) {
+            day_++;
+        }
+        appendFormatted(out, "%llu,2024-%02u-%02u,%s,%s,SKU-%05u,%u,%u.%02u,%s\n",
+                        static_cast<unsigned long long>(100000 + ++id_), 1 + (day_ / 28) % 12,
+                        1 + day_ % 28, CUSTOMERS[random_.below(12)], COUNTRIES[random_.zipf(8)],
+                        static_cast<unsigned>(random_.zipf(64) * 37 + 1000),
+                        static_cast<unsigned>(1 + random_.zipf(10)),
+                        static_cast<unsigned>(1 + random_.below(500)), static_cast<unsigned>(random_.below(100)),
+                        STATUSES[random_.zipf(5)]);
+    }
+
+private:
+    uint64_t id_ = 0;
+    unsigned day_ = 0;
+};
+
+std::unique_ptr<Producer> makeProducer(CorpusKind kind, uint64_t seed) {
+    // Each kind draws from its own stream
+    seed ^= (static_cast<uint64_t>(kind) + 1) * 0xD1B54A32D192ED03ull;
+    switch (kind) {
+        case CorpusKind::TEXT: return std::make_unique<TextProducer>(seed);
+        case CorpusKind::LOGS: return std::make_unique<LogProducer>(seed);
+        case CorpusKind::RANDOM: return std::make_unique<RandomProducer>(seed);
+        case CorpusKind::SPARSE: return std::make_unique<SparseProducer>(seed);
+        case CorpusKind::RUNS: return std::make_unique<RunProducer>(seed);
+        case CorpusKind::RECORDS: return std::make_unique<RecordProducer>(seed);
+        case CorpusKind::METRICS: return std::make_unique<MetricsProducer>(seed);
+        case CorpusKind::TABLE: return std::make_unique<TableProducer>(seed);
+    }
+    throw std::invalid_argument("Unknown corpus kind");
+}
+
+} // anonymous namespace
+
+const std::vector<CorpusKind>& allCorpusKinds() {
+    static const std::vector<CorpusKind> kinds = {CorpusKind::TEXT, CorpusKind::LOGS,
+                                                  CorpusKind::RANDOM, CorpusKind::SPARSE,
+                                                  CorpusKind::RUNS, CorpusKind::RECORDS,
+                                                  CorpusKind::METRICS, CorpusKind::TABLE};
+    return kinds;
+}
+
+std::string corpusKindToString(CorpusKind kind) {
+    switch (kind) {
+        case CorpusKind::TEXT: return "text";
+        case CorpusKind::LOGS: return "logs";
+        case CorpusKind::RANDOM: return "random";
+        case CorpusKind::SPARSE: return "sparse";
+        case CorpusKind::RUNS: return "runs";
+        case CorpusKind::RECORDS: return "records";
+        case CorpusKind::METRICS: return "metrics";
+        case CorpusKind::TABLE: return "table";
+    }
+    return "unknown";
+}
+
+CorpusKind stringToCorpusKind(const std::string& name) {
+    for (CorpusKind kind : allCorpusKinds()) {
+        if (corpusKindToString(kind) == name) {
+            return kind;
+        }
+    }
+    throw std::invalid_argument("Unknown corpus kind: " + name);
+}
+
+std::vector<uint8_t> CorpusGenerator::generate(CorpusKind kind, size_t size) const {
+    std::vector<uint8_t> result;
+    result.reserve(size);
+    generate(kind, size, [&result](const uint8_t* data, size_t length) {
+        result.insert(result.end(), data, data + length);
+    });
+    return result;
+}
+
+void CorpusGenerator::generate(CorpusKind kind, uint64_t size, const Sink& sink) const {
+    auto producer = makeProducer(kind, seed_);
+    std::vector<uint8_t> buffer;
+    buffer.reserve(2 * CHUNK_SIZE);
+
+    // Units are far smaller than a chunk, so refilling to a chunk is cheap
+    while (size > 0) {
+        while (buffer.size() < CHUNK_SIZE && buffer.size() < size) {
+            producer->next(buffer);
+        }
+        size_t length = static_cast<size_t>(std::min<uint64_t>(std::min(buffer.size(), CHUNK_SIZE), size));
+        sink(buffer.data(), length);
+        buffer.erase(buffer.begin(), buffer.begin() + length);
+        size -= length;
+    }
+}
+
+} // namespace utils
+} // namespace compression
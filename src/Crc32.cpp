@@ -0,0 +1,89 @@
+#include "compression/Crc32.hpp"
+#include "compression/ThreadPool.hpp"
+#include <algorithm>
+
+namespace compression {
+namespace utils {
+
+namespace {
+
+// CRC32 arithmetic as 32x32 matrices over GF(2), applied to a vector of bits
+uint32_t gf2MatrixTimes(const uint32_t* matrix, uint32_t vector) {
+    uint32_t sum = 0;
+    while (vector) {
+        if (vector & 1) {
+            sum ^= *matrix;
+        }
+        vector >>= 1;
+        matrix++;
+    }
+    return sum;
+}
+
+void gf2MatrixSquare(uint32_t* square, const uint32_t* matrix) {
+    for (int n = 0; n < 32; ++n) {
+        square[n] = gf2MatrixTimes(matrix, matrix[n]);
+    }
+}
+
+} // anonymous namespace
+
+uint32_t Crc32::combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB) {
+    if (lengthB == 0) {
+        return crcA;
+    }
+
+    // Operator that advances a CRC by one zero bit, then by two and four
+    uint32_t odd[32];
+    uint32_t even[32];
+    odd[0] = POLYNOMIAL;
+    uint32_t row = 1;
+    for (int n = 1; n < 32; ++n) {
+        odd[n] = row;
+        row <<= 1;
+    }
+    gf2MatrixSquare(even, odd);
+    gf2MatrixSquare(odd, even);
+
+    // Advance crcA by lengthB zero bytes, squaring the operator per bit of the length
+    do {
+        gf2MatrixSquare(even, odd);
+        if (lengthB & 1) {
+            crcA = gf2MatrixTimes(even, crcA);
+        }
+        lengthB >>= 1;
+        if (lengthB == 0) {
+            break;
+        }
+        gf2MatrixSquare(odd, even);
+        if (lengthB & 1) {
+            crcA = gf2MatrixTimes(odd, crcA);
+        }
+        lengthB >>= 1;
+    } while (lengthB != 0);
+
+    return crcA ^ crcB;
+}
+
+uint32_t Crc32::calculate(const uint8_t* data, size_t size, ThreadPool& pool) const {
+    size_t segments = (size + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+    if (segments < 2 || pool.size() < 2) {
+        return calculate(data, size);
+    }
+
+    std::vector<uint32_t> checksums(segments);
+    pool.parallelFor(segments, [&](size_t i) {
+        size_t start = i * SEGMENT_SIZE;
+        checksums[i] = calculate(data + start, std::min(SEGMENT_SIZE, size - start));
+    });
+
+    uint32_t crc = checksums[0];
+    for (size_t i = 1; i < segments; ++i) {
+        size_t length = std::min(SEGMENT_SIZE, size - i * SEGMENT_SIZE);
+        crc = combine(crc, checksums[i], length);
+    }
+    return crc;
+}
+
+} // namespace utils
+} // namespace compression
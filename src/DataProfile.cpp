@@ -0,0 +1,102 @@
+#include "compression/DataProfile.hpp"
+#include "compression/Histogram.hpp"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace compression {
+namespace utils {
+
+namespace {
+
+constexpr unsigned MATCH_HASH_BITS = 12;
+constexpr size_t MATCH_MIN_LENGTH = 4;
+constexpr size_t NO_POSITION = SIZE_MAX;
+
+uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t hash4(uint32_t value) {
+    return (value * 2654435761u) >> (32 - MATCH_HASH_BITS);
+}
+
+} // anonymous namespace
+
+DataProfile profileData(const uint8_t* data, size_t size, size_t windowCount, size_t windowSize) {
+    DataProfile profile;
+    if (size == 0 || windowCount == 0 || windowSize == 0) {
+        return profile;
+    }
+
+    // Small buffers form a single window; larger ones are sampled evenly
+    size_t sampleSize = windowCount * windowSize;
+    if (size <= sampleSize) {
+        windowCount = 1;
+        windowSize = size;
+    }
+    size_t stride = windowCount > 1 ? (size - windowSize) / (windowCount - 1) : 0;
+
+    std::array<uint64_t, 256> histogram{};
+    // Windows lie anywhere in the buffer, so positions are kept at full width
+    std::vector<size_t> table(size_t(1) << MATCH_HASH_BITS, NO_POSITION);
+    size_t matched = 0;
+    size_t inRuns = 0;
+
+    for (size_t window = 0; window < windowCount; ++window) {
+        size_t start = window * stride;
+        size_t end = start + windowSize;
+
+        utils::addByteHistogram(data + start, windowSize, histogram);
+
+        size_t runStart = start;
+        for (size_t pos = start; pos < end; ++pos) {
+            if (data[pos] != data[runStart]) {
+                if (pos - runStart >= DataProfile::RUN_MIN_LENGTH) inRuns += pos - runStart;
+                runStart = pos;
+            }
+        }
+        if (end - runStart >= DataProfile::RUN_MIN_LENGTH) inRuns += end - runStart;
+
+        // Greedy matches against earlier sampled bytes, extended within the window
+        size_t pos = start;
+        while (pos + MATCH_MIN_LENGTH <= end) {
+            uint32_t value = read32(data + pos);
+            size_t& slot = table[hash4(value)];
+            size_t candidate = slot;
+            slot = pos;
+            if (candidate != NO_POSITION && read32(data + candidate) == value) {
+                size_t length = MATCH_MIN_LENGTH;
+                while (pos + length < end && data[candidate + length] == data[pos + length]) {
+                    length++;
+                }
+                matched += length;
+                pos += length;
+            } else {
+                pos++;
+            }
+        }
+    }
+
+    size_t sampled = windowCount * windowSize;
+    double entropy = 0.0;
+    for (uint64_t count : histogram) {
+        if (count > 0) {
+            double p = static_cast<double>(count) / sampled;
+            entropy -= p * std::log2(p);
+        }
+    }
+
+    profile.sampledBytes = sampled;
+    profile.entropy = entropy;
+    profile.matchDensity = static_cast<double>(matched) / sampled;
+    profile.runDensity = static_cast<double>(inRuns) / sampled;
+    return profile;
+}
+
+} // namespace utils
+} // namespace compression
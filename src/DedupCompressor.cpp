@@ -0,0 +1,301 @@
+#include "compression/DedupCompressor.hpp"
+#include "compression/CompressorFactory.hpp"
+#include "compression/GearHash.hpp"
+#include "compression/Varint.hpp"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace compression {
+
+namespace {
+
+uint64_t rotateLeft(uint64_t value, unsigned bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// 64-bit chunk fingerprint (xxHash-style mixing); matches are verified byte
+// by byte, so this only needs to be fast and well distributed
+uint64_t fingerprint(const uint8_t* data, size_t length) {
+    constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+    uint64_t hash = PRIME1 ^ (length * PRIME2);
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash ^= rotateLeft(word * PRIME2, 31) * PRIME1;
+        hash = rotateLeft(hash, 27) * PRIME1 + PRIME2;
+    }
+    for (; i < length; ++i) {
+        hash ^= data[i] * PRIME1;
+        hash = rotateLeft(hash, 11) * PRIME2;
+    }
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+unsigned log2Exact(size_t value) {
+    unsigned bits = 0;
+    while ((size_t(1) << bits) < value) {
+        bits++;
+    }
+    return bits;
+}
+
+struct ChunkLocation {
+    size_t offset;
+    size_t length;
+    uint64_t print;
+};
+
+} // anonymous namespace
+
+// --- FastCdcChunker ---
+
+FastCdcChunker::FastCdcChunker(size_t minSize, size_t averageSize, size_t maxSize)
+    : minSize_(minSize), averageSize_(averageSize), maxSize_(maxSize) {
+    if (minSize_ == 0 || minSize_ > averageSize_ || averageSize_ > maxSize_ ||
+        (averageSize_ & (averageSize_ - 1)) != 0) {
+        throw std::invalid_argument("FastCDC needs 0 < min <= average <= max and a power-of-two average");
+    }
+    // Normalization level 2: four times less likely before the average, four times more after
+    unsigned averageBits = log2Exact(averageSize_);
+    strictBits_ = averageBits + 2;
+    looseBits_ = averageBits > 2 ? averageBits - 2 : 0;
+}
+
+size_t FastCdcChunker::nextChunk(const uint8_t* data, size_t available, bool endOfInput) const {
+    if (available <= minSize_) {
+        return endOfInput ? available : 0;
+    }
+
+    size_t limit = std::min(available, maxSize_);
+    size_t normalPoint = std::min(limit, averageSize_);
+
+    // Bytes below the minimum size never end a chunk, but the last 64 of them
+    // must be hashed so the first candidate boundary sees a full window
+    size_t i = minSize_ > 64 ? minSize_ - 64 : 0;
+    uint64_t hash = 0;
+    for (; i < minSize_; ++i) {
+        hash = utils::GearHash::roll(hash, data[i]);
+    }
+    for (; i < normalPoint; ++i) {
+        hash = utils::GearHash::roll(hash, data[i]);
+        if (utils::GearHash::isBoundary(hash, strictBits_)) {
+            return i + 1;
+        }
+    }
+    for (; i < limit; ++i) {
+        hash = utils::GearHash::roll(hash, data[i]);
+        if (utils::GearHash::isBoundary(hash, looseBits_)) {
+            return i + 1;
+        }
+    }
+
+    if (limit == maxSize_ || endOfInput) {
+        return limit;
+    }
+    return 0; // The boundary may lie in bytes we have not seen yet
+}
+
+// --- DedupCompressor ---
+
+DedupCompressor::DedupCompressor(format::AlgorithmID backend, FastCdcChunker chunker, size_t historySize)
+    : backendId_(backend), chunker_(chunker), historySize_(historySize) {
+    if (backendId_ == format::AlgorithmID::DEDUP_COMPRESSOR) {
+        throw std::invalid_argument("Dedup cannot be its own backend");
+    }
+    backend_ = createCompressor(backendId_);
+}
+
+std::vector<uint8_t> DedupCompressor::compress(const std::vector<uint8_t>& data) const {
+    CompressionContext context;
+    return compress(data, context);
+}
+
+std::vector<uint8_t> DedupCompressor::compress(const std::vector<uint8_t>& data,
+                                               CompressionContext& context) const {
+    if (data.empty()) {
+        return {};
+    }
+
+    std::vector<uint8_t> result;
+    result.push_back(static_cast<uint8_t>(backendId_));
+    utils::writeVarint(result, historySize_);
+
+    std::unordered_map<uint64_t, uint64_t> index; // Fingerprint -> new chunk number
+    std::deque<ChunkLocation> history;            // Unique chunks still referable, oldest first
+    uint64_t firstChunk = 0;                      // Number of history.front()
+    size_t historyBytes = 0;
+
+    CompressionStats* stats = context.stats();
+    size_t pos = 0;
+    while (pos < data.size()) {
+        // The decoder drops the same chunks at the same frame boundary
+        while (historyBytes > historySize_) {
+            const ChunkLocation& oldest = history.front();
+            auto it = index.find(oldest.print);
+            if (it != index.end() && it->second == firstChunk) {
+                index.erase(it);
+            }
+            historyBytes -= oldest.length;
+            history.pop_front();
+            firstChunk++;
+        }
+
+        size_t frameStart = pos;
+        std::vector<uint64_t> records;
+        std::vector<uint8_t> uniqueBytes;
+
+        StageTimer chunkTimer(stats, "dedup chunking", 0);
+        while (pos < data.size() && pos - frameStart < FRAME_SIZE) {
+            size_t length = chunker_.nextChunk(data.data() + pos, data.size() - pos);
+            uint64_t print = fingerprint(data.data() + pos, length);
+
+            uint64_t chunkNumber = firstChunk + history.size();
+            auto it = index.find(print);
+            if (it != index.end()) {
+                const ChunkLocation& earlier = history[it->second - firstChunk];
+                if (earlier.length == length &&
+                    std::memcmp(data.data() + earlier.offset, data.data() + pos, length) == 0) {
+                    records.push_back((it->second << 1) | 1);
+                    pos += length;
+                    continue;
+                }
+            } else {
+                index.emplace(print, chunkNumber);
+            }
+
+            history.push_back({pos, length, print});
+            historyBytes += length;
+            records.push_back(static_cast<uint64_t>(length) << 1);
+            uniqueBytes.insert(uniqueBytes.end(), data.begin() + pos, data.begin() + pos + length);
+            pos += length;
+        }
+        chunkTimer.setBytesIn(pos - frameStart);
+        chunkTimer.stop(uniqueBytes.size());
+        if (stats) {
+            stats->chunks += records.size();
+            stats->duplicateChunks += std::count_if(records.begin(), records.end(),
+                                                    [](uint64_t record) { return record & 1; });
+        }
+
+        utils::writeVarint(result, records.size());
+        for (uint64_t record : records) {
+            utils::writeVarint(result, record);
+        }
+        StageTimer backendTimer(stats, "dedup backend", uniqueBytes.size());
+        std::vector<uint8_t> payload = backend_->compress(uniqueBytes, context);
+        backendTimer.stop(payload.size());
+        utils::writeVarint(result, payload.size());
+        result.insert(result.end(), payload.begin(), payload.end());
+    }
+
+    return result;
+}
+
+std::vector<uint8_t> DedupCompressor::decompress(const std::vector<uint8_t>& data) const {
+    CompressionContext context;
+    return decompress(data, context);
+}
+
+std::vector<uint8_t> DedupCompressor::decompress(const std::vector<uint8_t>& data,
+                                                 CompressionContext& context) const {
+    if (data.empty()) {
+        return {};
+    }
+
+    // The stream names its backend, which need not be the one we were built with
+    auto streamBackend = static_cast<format::AlgorithmID>(data[0]);
+    if (streamBackend == format::AlgorithmID::DEDUP_COMPRESSOR) {
+        throw std::runtime_error("Invalid dedup stream: nested dedup backend");
+    }
+    std::unique_ptr<ICompressor> otherBackend;
+    const ICompressor* backend = backend_.get();
+    if (streamBackend != backendId_) {
+        otherBackend = createCompressor(streamBackend);
+        backend = otherBackend.get();
+    }
+
+    size_t offset = 1;
+    uint64_t historySize = utils::readVarint(data, offset, "dedup");
+
+    // Chunks are copied out of the output, so references never reach into decoded frames
+    std::vector<uint8_t> result;
+    std::deque<std::vector<uint8_t>> history;
+    uint64_t firstChunk = 0;
+    uint64_t historyBytes = 0;
+
+    while (offset < data.size()) {
+        while (historyBytes > historySize) {
+            historyBytes -= history.front().size();
+            history.pop_front();
+            firstChunk++;
+        }
+
+        uint64_t recordCount = utils::readVarint(data, offset, "dedup");
+        if (recordCount > data.size() - offset) {
+            throw std::runtime_error("Invalid dedup frame: record count exceeds stream");
+        }
+        std::vector<uint64_t> records(recordCount);
+        for (auto& record : records) {
+            record = utils::readVarint(data, offset, "dedup");
+        }
+        uint64_t payloadSize = utils::readVarint(data, offset, "dedup");
+        if (payloadSize > data.size() - offset) {
+            throw std::runtime_error("Invalid dedup frame: truncated payload");
+        }
+        std::vector<uint8_t> payload(data.begin() + offset, data.begin() + offset + payloadSize);
+        offset += payloadSize;
+        std::vector<uint8_t> uniqueBytes = backend->decompress(payload, context);
+
+        size_t uniquePos = 0;
+        for (uint64_t record : records) {
+            uint64_t value = record >> 1;
+            if (record & 1) {
+                if (value < firstChunk || value - firstChunk >= history.size()) {
+                    throw std::runtime_error("Invalid dedup reference to chunk " + std::to_string(value));
+                }
+                const std::vector<uint8_t>& chunk = history[value - firstChunk];
+                result.insert(result.end(), chunk.begin(), chunk.end());
+            } else {
+                if (value > uniqueBytes.size() - uniquePos) {
+                    throw std::runtime_error("Invalid dedup frame: chunk exceeds payload");
+                }
+                history.emplace_back(uniqueBytes.begin() + uniquePos, uniqueBytes.begin() + uniquePos + value);
+                historyBytes += value;
+                result.insert(result.end(), uniqueBytes.begin() + uniquePos,
+                              uniqueBytes.begin() + uniquePos + value);
+                uniquePos += value;
+            }
+        }
+        if (uniquePos != uniqueBytes.size()) {
+            throw std::runtime_error("Invalid dedup frame: unused payload bytes");
+        }
+    }
+
+    return result;
+}
+
+size_t DedupCompressor::scratchSize(size_t inputSize) const {
+    return backend_->scratchSize(std::min(inputSize, FRAME_SIZE + chunker_.maxSize()));
+}
+
+size_t DedupCompressor::workingSetSize(size_t inputSize) const {
+    size_t frame = std::min(inputSize, FRAME_SIZE + chunker_.maxSize());
+    // A hash map node, a history entry and a record per chunk of the history
+    const size_t bytesPerChunk = 64;
+    size_t history = std::min(inputSize, historySize_ + frame);
+    size_t chunks = history / chunker_.minSize() + 1;
+    // The frame's unique bytes, the decoder's copy of the history and the
+    // growing result sit next to the backend's own buffers
+    return backend_->workingSetSize(frame) + frame + history + 2 * inputSize + chunks * bytesPerChunk;
+}
+
+} // namespace compression
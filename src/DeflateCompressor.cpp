@@ -64,6 +64,23 @@ std::vector<uint8_t> DeflateCompressor::compress(const std::vector<uint8_t>& dat
     return lz77_->compress(data);
 }
 
+std::vector<uint8_t> DeflateCompressor::compress(const std::vector<uint8_t>& data,
+                                                 CompressionContext& context) const {
+    if (!lz77_) {
+        throw std::runtime_error("LZ77 compressor not initialized");
+    }
+    
+    return lz77_->compress(data, context);
+}
+
+size_t DeflateCompressor::scratchSize(size_t inputSize) const {
+    return lz77_ ? lz77_->scratchSize(inputSize) : 0;
+}
+
+size_t DeflateCompressor::workingSetSize(size_t inputSize) const {
+    return lz77_ ? lz77_->workingSetSize(inputSize) : inputSize;
+}
+
 std::vector<uint8_t> DeflateCompressor::decompress(const std::vector<uint8_t>& data) const {
     if (!lz77_) {
         throw std::runtime_error("LZ77 compressor not initialized");
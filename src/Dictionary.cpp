@@ -0,0 +1,212 @@
+#include "compression/Dictionary.hpp"
+#include "compression/Crc32.hpp"
+#include "compression/Histogram.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace compression {
+
+namespace {
+
+constexpr std::array<uint8_t, 4> DICTIONARY_MAGIC = {'C', 'D', 'I', 'C'};
+constexpr uint8_t DICTIONARY_VERSION = 1;
+constexpr size_t DICTIONARY_HEADER_SIZE = DICTIONARY_MAGIC.size() + 1 + sizeof(uint32_t) + sizeof(uint32_t);
+
+void writeUint32(std::vector<uint8_t>& buffer, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        buffer.push_back(static_cast<uint8_t>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+uint32_t readUint32(const std::vector<uint8_t>& buffer, size_t offset) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(buffer[offset + i]) << (i * 8);
+    }
+    return value;
+}
+
+// Key for a d-mer: exact for d <= 8, FNV-1a otherwise
+uint64_t dmerKey(const uint8_t* bytes, size_t length) {
+    if (length <= 8) {
+        uint64_t key = 0;
+        for (size_t i = 0; i < length; ++i) {
+            key |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+        }
+        return key;
+    }
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+struct Segment {
+    size_t start = 0;
+    uint64_t score = 0;
+};
+
+} // anonymous namespace
+
+// --- Dictionary ---
+
+Dictionary::Dictionary(std::vector<uint8_t> content, uint32_t id)
+    : content_(std::move(content)), id_(id) {
+    if (id_ == 0) {
+        id_ = utils::crc32Calculator.calculate(content_);
+        if (id_ == 0) {
+            id_ = 1; // 0 is reserved for "no dictionary"
+        }
+    }
+    utils::addByteHistogram(content_.data(), content_.size(), byteFrequencies_);
+}
+
+std::vector<uint8_t> Dictionary::serialize() const {
+    std::vector<uint8_t> buffer;
+    buffer.reserve(DICTIONARY_HEADER_SIZE + content_.size());
+    buffer.insert(buffer.end(), DICTIONARY_MAGIC.begin(), DICTIONARY_MAGIC.end());
+    buffer.push_back(DICTIONARY_VERSION);
+    writeUint32(buffer, id_);
+    writeUint32(buffer, static_cast<uint32_t>(content_.size()));
+    buffer.insert(buffer.end(), content_.begin(), content_.end());
+    return buffer;
+}
+
+Dictionary Dictionary::deserialize(const std::vector<uint8_t>& buffer) {
+    if (buffer.size() < DICTIONARY_HEADER_SIZE) {
+        throw std::runtime_error("Buffer too small to contain a dictionary.");
+    }
+    if (!std::equal(DICTIONARY_MAGIC.begin(), DICTIONARY_MAGIC.end(), buffer.begin())) {
+        throw std::runtime_error("Invalid dictionary magic number.");
+    }
+    size_t offset = DICTIONARY_MAGIC.size();
+    uint8_t version = buffer[offset++];
+    if (version != DICTIONARY_VERSION) {
+        throw std::runtime_error("Unsupported dictionary version: " + std::to_string(version));
+    }
+    uint32_t id = readUint32(buffer, offset);
+    offset += 4;
+    uint32_t size = readUint32(buffer, offset);
+    offset += 4;
+    if (id == 0 || buffer.size() - offset != size) {
+        throw std::runtime_error("Corrupt dictionary: bad ID or size.");
+    }
+    return Dictionary(std::vector<uint8_t>(buffer.begin() + offset, buffer.end()), id);
+}
+
+// --- DictionaryTrainer ---
+
+DictionaryTrainer::DictionaryTrainer(size_t maxDictionarySize, size_t segmentLength, size_t dmerLength)
+    : maxDictionarySize_(maxDictionarySize),
+      segmentLength_(segmentLength),
+      dmerLength_(dmerLength) {
+    if (dmerLength_ == 0 || segmentLength_ < dmerLength_ || maxDictionarySize_ < segmentLength_) {
+        throw std::invalid_argument("Dictionary trainer needs 0 < d-mer length <= segment length <= dictionary size");
+    }
+}
+
+Dictionary DictionaryTrainer::train(const std::vector<std::vector<uint8_t>>& samples) const {
+    // 1. Concatenate the corpus and remember which sample each byte belongs to
+    std::vector<uint8_t> corpus;
+    std::vector<size_t> sampleEnd; // End offset (exclusive) of the sample containing each byte
+    for (const auto& sample : samples) {
+        corpus.insert(corpus.end(), sample.begin(), sample.end());
+        sampleEnd.insert(sampleEnd.end(), sample.size(), corpus.size());
+    }
+    if (corpus.size() < dmerLength_) {
+        throw std::invalid_argument("Not enough sample data to train a dictionary");
+    }
+
+    // 2. Count, for every d-mer, how many samples contain it
+    std::unordered_map<uint64_t, uint32_t> frequency;
+    std::unordered_map<uint64_t, size_t> lastSample;
+    frequency.reserve(corpus.size());
+    lastSample.reserve(corpus.size());
+    size_t sampleStart = 0;
+    for (size_t s = 0; s < samples.size(); ++s) {
+        size_t size = samples[s].size();
+        for (size_t i = 0; i + dmerLength_ <= size; ++i) {
+            uint64_t key = dmerKey(corpus.data() + sampleStart + i, dmerLength_);
+            auto [it, inserted] = lastSample.try_emplace(key, s);
+            if (inserted || it->second != s) {
+                it->second = s;
+                frequency[key]++;
+            }
+        }
+        sampleStart += size;
+    }
+
+    // 3. Pick the best segment from each epoch of the corpus. Chosen d-mers
+    //    stop counting, so further passes pick the best remaining segments
+    //    until the dictionary is full or no segment has a d-mer left
+    const size_t segmentCount = maxDictionarySize_ / segmentLength_;
+    const size_t epochSize = std::max(corpus.size() / segmentCount, segmentLength_);
+    const size_t dmersPerSegment = segmentLength_ - dmerLength_ + 1;
+    std::vector<Segment> segments;
+
+    // Slide a window of d-mer scores across an epoch; d-mers that cross a
+    // sample boundary never occur in real data and score zero
+    auto dmerScore = [&](size_t pos) -> uint64_t {
+        if (pos + dmerLength_ > sampleEnd[pos]) {
+            return 0;
+        }
+        auto it = frequency.find(dmerKey(corpus.data() + pos, dmerLength_));
+        return it == frequency.end() ? 0 : it->second;
+    };
+
+    for (bool added = true; added && segments.size() < segmentCount;) {
+        added = false;
+        for (size_t epochStart = 0; epochStart + segmentLength_ <= corpus.size(); epochStart += epochSize) {
+            size_t epochEnd = std::min(epochStart + epochSize, corpus.size());
+            Segment best;
+            uint64_t windowScore = 0;
+            for (size_t pos = epochStart; pos + dmerLength_ <= epochEnd; ++pos) {
+                windowScore += dmerScore(pos);
+                if (pos >= epochStart + dmersPerSegment) {
+                    windowScore -= dmerScore(pos - dmersPerSegment);
+                }
+                if (pos + 1 < epochStart + dmersPerSegment) {
+                    continue; // Window not full yet
+                }
+                size_t segmentStart = pos + 1 - dmersPerSegment;
+                if (windowScore > best.score && segmentStart + segmentLength_ <= sampleEnd[segmentStart]) {
+                    best.start = segmentStart;
+                    best.score = windowScore;
+                }
+            }
+            if (best.score == 0) {
+                continue;
+            }
+            segments.push_back(best);
+            added = true;
+
+            // Covered d-mers no longer count, so later picks cover new content
+            for (size_t i = 0; i < dmersPerSegment; ++i) {
+                frequency.erase(dmerKey(corpus.data() + best.start + i, dmerLength_));
+            }
+        }
+    }
+
+    // 4. Keep the highest-scoring segments, shared ones before those seen in
+    //    a single sample, and place the best last, where matches against them
+    //    have the shortest distances
+    std::sort(segments.begin(), segments.end(),
+              [](const Segment& a, const Segment& b) { return a.score > b.score; });
+    if (segments.size() > segmentCount) {
+        segments.resize(segmentCount);
+    }
+    std::vector<uint8_t> content;
+    content.reserve(segments.size() * segmentLength_);
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+        content.insert(content.end(), corpus.begin() + it->start,
+                       corpus.begin() + it->start + segmentLength_);
+    }
+
+    return Dictionary(std::move(content));
+}
+
+} // namespace compression
@@ -0,0 +1,505 @@
+#include "compression/Filters.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define COMPRESSION_FILTERS_SSSE3 1
+#include <immintrin.h>
+#else
+#define COMPRESSION_FILTERS_SSSE3 0
+#endif
+
+namespace compression {
+namespace utils {
+
+namespace {
+
+using format::FilterID;
+using format::FilterSpec;
+
+// Elements per block of the scalar shuffles: the block's input and its
+// `width` output streams stay in L1 while the strided loops run over them
+constexpr size_t SHUFFLE_BLOCK = 2048;
+
+// SIMD kernels work on this many elements per step
+constexpr size_t SIMD_ELEMENTS = 16;
+
+// --- Delta ---
+
+void deltaEncode(const uint8_t* in, uint8_t* out, size_t size, size_t stride) {
+    size_t head = std::min(stride, size);
+    std::memcpy(out, in, head);
+    for (size_t i = head; i < size; ++i) {
+        out[i] = static_cast<uint8_t>(in[i] - in[i - stride]);
+    }
+}
+
+void deltaDecode(const uint8_t* in, uint8_t* out, size_t size, size_t stride) {
+    size_t head = std::min(stride, size);
+    std::memcpy(out, in, head);
+    for (size_t i = head; i < size; ++i) {
+        out[i] = static_cast<uint8_t>(in[i] + out[i - stride]);
+    }
+}
+
+// --- Byte shuffle of `count` elements; stream b starts at out + b * count ---
+
+void shuffleScalar(const uint8_t* in, uint8_t* out, size_t count, size_t width) {
+    for (size_t start = 0; start < count; start += SHUFFLE_BLOCK) {
+        size_t end = std::min(count, start + SHUFFLE_BLOCK);
+        for (size_t byte = 0; byte < width; ++byte) {
+            uint8_t* stream = out + byte * count;
+            for (size_t i = start; i < end; ++i) {
+                stream[i] = in[i * width + byte];
+            }
+        }
+    }
+}
+
+void unshuffleScalar(const uint8_t* in, uint8_t* out, size_t count, size_t width) {
+    for (size_t start = 0; start < count; start += SHUFFLE_BLOCK) {
+        size_t end = std::min(count, start + SHUFFLE_BLOCK);
+        for (size_t byte = 0; byte < width; ++byte) {
+            const uint8_t* stream = in + byte * count;
+            for (size_t i = start; i < end; ++i) {
+                out[i * width + byte] = stream[i];
+            }
+        }
+    }
+}
+
+#if COMPRESSION_FILTERS_SSSE3
+inline __m128i load128(const uint8_t* data) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+inline void store128(uint8_t* data, __m128i value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data), value);
+}
+
+// Each step loads 16 elements as `width` vectors, gathers the bytes of equal
+// significance within each vector with one byte shuffle, and transposes the
+// resulting lanes so that every vector holds 16 bytes of one stream
+__attribute__((target("ssse3")))
+size_t shuffleSsse3(const uint8_t* in, uint8_t* out, size_t count, size_t width) {
+    size_t i = 0;
+    if (width == 2) {
+        const __m128i gather = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+        for (; i + SIMD_ELEMENTS <= count; i += SIMD_ELEMENTS) {
+            __m128i v0 = _mm_shuffle_epi8(load128(in + i * 2), gather);
+            __m128i v1 = _mm_shuffle_epi8(load128(in + i * 2 + 16), gather);
+            store128(out + i, _mm_unpacklo_epi64(v0, v1));
+            store128(out + count + i, _mm_unpackhi_epi64(v0, v1));
+        }
+    } else if (width == 4) {
+        const __m128i gather = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+        for (; i + SIMD_ELEMENTS <= count; i += SIMD_ELEMENTS) {
+            const uint8_t* src = in + i * 4;
+            __m128i v0 = _mm_shuffle_epi8(load128(src), gather);
+            __m128i v1 = _mm_shuffle_epi8(load128(src + 16), gather);
+            __m128i v2 = _mm_shuffle_epi8(load128(src + 32), gather);
+            __m128i v3 = _mm_shuffle_epi8(load128(src + 48), gather);
+            __m128i t0 = _mm_unpacklo_epi32(v0, v1);
+            __m128i t1 = _mm_unpacklo_epi32(v2, v3);
+            __m128i t2 = _mm_unpackhi_epi32(v0, v1);
+            __m128i t3 = _mm_unpackhi_epi32(v2, v3);
+            store128(out + i, _mm_unpacklo_epi64(t0, t1));
+            store128(out + count + i, _mm_unpackhi_epi64(t0, t1));
+            store128(out + 2 * count + i, _mm_unpacklo_epi64(t2, t3));
+            store128(out + 3 * count + i, _mm_unpackhi_epi64(t2, t3));
+        }
+    } else if (width == 8) {
+        const __m128i gather = _mm_setr_epi8(0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15);
+        for (; i + SIMD_ELEMENTS <= count; i += SIMD_ELEMENTS) {
+            // Vector k holds elements 2k and 2k + 1; 16-bit lane j their j-th bytes
+            __m128i v[8];
+            for (size_t k = 0; k < 8; ++k) {
+                v[k] = _mm_shuffle_epi8(load128(in + i * 8 + k * 16), gather);
+            }
+            __m128i a[8], b[8];
+            for (size_t k = 0; k < 4; ++k) {
+                a[k] = _mm_unpacklo_epi16(v[2 * k], v[2 * k + 1]);
+                a[k + 4] = _mm_unpackhi_epi16(v[2 * k], v[2 * k + 1]);
+            }
+            for (size_t k = 0; k < 4; ++k) {
+                b[2 * k] = _mm_unpacklo_epi32(a[2 * k], a[2 * k + 1]);
+                b[2 * k + 1] = _mm_unpackhi_epi32(a[2 * k], a[2 * k + 1]);
+            }
+            // b[0], b[1]: lanes 0-1 and 2-3 of vectors 0-3; b[2], b[3]: of vectors 4-7;
+            // b[4] to b[7] likewise for lanes 4-7
+            for (size_t k = 0; k < 4; ++k) {
+                size_t low = (k / 2) * 4 + k % 2;
+                store128(out + (2 * k) * count + i, _mm_unpacklo_epi64(b[low], b[low + 2]));
+                store128(out + (2 * k + 1) * count + i, _mm_unpackhi_epi64(b[low], b[low + 2]));
+            }
+        }
+    }
+    return i;
+}
+
+// Interleaving is the easy direction: pairwise unpacks of bytes, then of
+// byte pairs and so on rebuild whole elements without any byte shuffle
+__attribute__((target("ssse3")))
+size_t unshuffleSsse3(const uint8_t* in, uint8_t* out, size_t count, size_t width) {
+    size_t i = 0;
+    if (width == 2) {
+        for (; i + SIMD_ELEMENTS <= count; i += SIMD_ELEMENTS) {
+            __m128i s0 = load128(in + i);
+            __m128i s1 = load128(in + count + i);
+            store128(out + i * 2, _mm_unpacklo_epi8(s0, s1));
+            store128(out + i * 2 + 16, _mm_unpackhi_epi8(s0, s1));
+        }
+    } else if (width == 4) {
+        for (; i + SIMD_ELEMENTS <= count; i += SIMD_ELEMENTS) {
+            __m128i s0 = load128(in + i);
+            __m128i s1 = load128(in + count + i);
+            __m128i s2 = load128(in + 2 * count + i);
+            __m128i s3 = load128(in + 3 * count + i);
+            __m128i low01 = _mm_unpacklo_epi8(s0, s1);
+            __m128i high01 = _mm_unpackhi_epi8(s0, s1);
+            __m128i low23 = _mm_unpacklo_epi8(s2, s3);
+            __m128i high23 = _mm_unpackhi_epi8(s2, s3);
+            uint8_t* dst = out + i * 4;
+            store128(dst, _mm_unpacklo_epi16(low01, low23));
+            store128(dst + 16, _mm_unpackhi_epi16(low01, low23));
+            store128(dst + 32, _mm_unpacklo_epi16(high01, high23));
+            store128(dst + 48, _mm_unpackhi_epi16(high01, high23));
+        }
+    } else if (width == 8) {
+        for (; i + SIMD_ELEMENTS <= count; i += SIMD_ELEMENTS) {
+            // pairs[k]: bytes 2k and 2k + 1 of elements 0-7, then of elements 8-15
+            __m128i pairs[4][2];
+            for (size_t k = 0; k < 4; ++k) {
+                __m128i even = load128(in + 2 * k * count + i);
+                __m128i odd = load128(in + (2 * k + 1) * count + i);
+                pairs[k][0] = _mm_unpacklo_epi8(even, odd);
+                pairs[k][1] = _mm_unpackhi_epi8(even, odd);
+            }
+            uint8_t* dst = out + i * 8;
+            for (size_t half = 0; half < 2; ++half) {
+                // Bytes 0-3 and 4-7 of elements 0-3 and 4-7 of this half
+                __m128i quadsLow[2] = {_mm_unpacklo_epi16(pairs[0][half], pairs[1][half]),
+                                       _mm_unpackhi_epi16(pairs[0][half], pairs[1][half])};
+                __m128i quadsHigh[2] = {_mm_unpacklo_epi16(pairs[2][half], pairs[3][half]),
+                                        _mm_unpackhi_epi16(pairs[2][half], pairs[3][half])};
+                for (size_t k = 0; k < 2; ++k) {
+                    store128(dst + half * 64 + k * 32, _mm_unpacklo_epi32(quadsLow[k], quadsHigh[k]));
+                    store128(dst + half * 64 + k * 32 + 16, _mm_unpackhi_epi32(quadsLow[k], quadsHigh[k]));
+                }
+            }
+        }
+    }
+    return i;
+}
+
+bool cpuHasSsse3() {
+    static const bool available = __builtin_cpu_supports("ssse3");
+    return available;
+}
+#endif
+
+// Shuffles `count` elements, with the SIMD kernel for the widths it covers
+// and the scalar loops for the remaining elements
+void shuffle(const uint8_t* in, uint8_t* out, size_t count, size_t width, FilterKernel kernel) {
+    size_t done = 0;
+#if COMPRESSION_FILTERS_SSSE3
+    if (kernel == FilterKernel::SSSE3) {
+        done = shuffleSsse3(in, out, count, width);
+    }
+#endif
+    if (done == 0) {
+        shuffleScalar(in, out, count, width);
+        return;
+    }
+    for (size_t byte = 0; byte < width; ++byte) {
+        for (size_t i = done; i < count; ++i) {
+            out[byte * count + i] = in[i * width + byte];
+        }
+    }
+}
+
+void unshuffle(const uint8_t* in, uint8_t* out, size_t count, size_t width, FilterKernel kernel) {
+    size_t done = 0;
+#if COMPRESSION_FILTERS_SSSE3
+    if (kernel == FilterKernel::SSSE3) {
+        done = unshuffleSsse3(in, out, count, width);
+    }
+#endif
+    if (done == 0) {
+        unshuffleScalar(in, out, count, width);
+        return;
+    }
+    for (size_t byte = 0; byte < width; ++byte) {
+        for (size_t i = done; i < count; ++i) {
+            out[i * width + byte] = in[byte * count + i];
+        }
+    }
+}
+
+// --- Bit planes of a byte stream whose length is a multiple of 8 ---
+// Plane p holds bit p of every byte, byte k of the plane bits p of bytes
+// 8k to 8k + 7 (lowest bit first)
+
+// Transposes the 8x8 bit matrix whose row r is byte r of the word; an
+// involution, so it both splits bytes into planes and joins them back
+inline uint64_t transposeBits(uint64_t x) {
+    uint64_t t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAull;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCull;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ull;
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+inline uint64_t load64(const uint8_t* data) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+void splitBitPlanesScalar(const uint8_t* in, uint8_t* out, size_t size, size_t start) {
+    size_t planeSize = size / 8;
+    for (size_t i = start; i < size; i += 8) {
+        uint64_t planes = transposeBits(load64(in + i));
+        for (size_t plane = 0; plane < 8; ++plane) {
+            out[plane * planeSize + i / 8] = static_cast<uint8_t>(planes >> (8 * plane));
+        }
+    }
+}
+
+void joinBitPlanes(const uint8_t* in, uint8_t* out, size_t size) {
+    size_t planeSize = size / 8;
+    for (size_t i = 0; i < size; i += 8) {
+        uint64_t planes = 0;
+        for (size_t plane = 0; plane < 8; ++plane) {
+            planes |= static_cast<uint64_t>(in[plane * planeSize + i / 8]) << (8 * plane);
+        }
+        uint64_t bytes = transposeBits(planes);
+        for (size_t byte = 0; byte < 8; ++byte) {
+            out[i + byte] = static_cast<uint8_t>(bytes >> (8 * byte));
+        }
+    }
+}
+
+#if COMPRESSION_FILTERS_SSSE3
+// movemask collects the top bit of 16 bytes, i.e. two bytes of one plane;
+// shifting left by one brings the next lower bit up
+__attribute__((target("ssse3")))
+size_t splitBitPlanesSsse3(const uint8_t* in, uint8_t* out, size_t size) {
+    size_t planeSize = size / 8;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i bytes = load128(in + i);
+        for (size_t plane = 8; plane-- > 0;) {
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(bytes));
+            out[plane * planeSize + i / 8] = static_cast<uint8_t>(mask);
+            out[plane * planeSize + i / 8 + 1] = static_cast<uint8_t>(mask >> 8);
+            bytes = _mm_slli_epi16(bytes, 1);
+        }
+    }
+    return i;
+}
+#endif
+
+void splitBitPlanes(const uint8_t* in, uint8_t* out, size_t size, FilterKernel kernel) {
+    size_t done = 0;
+#if COMPRESSION_FILTERS_SSSE3
+    if (kernel == FilterKernel::SSSE3) {
+        done = splitBitPlanesSsse3(in, out, size);
+    }
+#endif
+    splitBitPlanesScalar(in, out, size, done);
+}
+
+// --- One filter; `out` has the size of `in` ---
+
+void applyFilter(const std::vector<uint8_t>& in, std::vector<uint8_t>& out, const FilterSpec& filter,
+                 FilterKernel kernel) {
+    size_t width = filter.width;
+    size_t count = in.size() / width;
+    size_t transformed = 0;
+    switch (filter.id) {
+        case FilterID::DELTA:
+            deltaEncode(in.data(), out.data(), in.size(), width);
+            return;
+        case FilterID::SHUFFLE:
+            shuffle(in.data(), out.data(), count, width, kernel);
+            transformed = count * width;
+            break;
+        case FilterID::BITSHUFFLE: {
+            count -= count % 8;
+            transformed = count * width;
+            std::vector<uint8_t> streams(transformed);
+            shuffle(in.data(), streams.data(), count, width, kernel);
+            for (size_t byte = 0; byte < width; ++byte) {
+                splitBitPlanes(streams.data() + byte * count, out.data() + byte * count, count, kernel);
+            }
+            break;
+        }
+    }
+    std::copy(in.begin() + transformed, in.end(), out.begin() + transformed);
+}
+
+void reverseFilter(const std::vector<uint8_t>& in, std::vector<uint8_t>& out, const FilterSpec& filter,
+                   FilterKernel kernel) {
+    size_t width = filter.width;
+    size_t count = in.size() / width;
+    size_t transformed = 0;
+    switch (filter.id) {
+        case FilterID::DELTA:
+            deltaDecode(in.data(), out.data(), in.size(), width);
+            return;
+        case FilterID::SHUFFLE:
+            unshuffle(in.data(), out.data(), count, width, kernel);
+            transformed = count * width;
+            break;
+        case FilterID::BITSHUFFLE: {
+            count -= count % 8;
+            transformed = count * width;
+            std::vector<uint8_t> streams(transformed);
+            for (size_t byte = 0; byte < width; ++byte) {
+                joinBitPlanes(in.data() + byte * count, streams.data() + byte * count, count);
+            }
+            unshuffle(streams.data(), out.data(), count, width, kernel);
+            break;
+        }
+    }
+    std::copy(in.begin() + transformed, in.end(), out.begin() + transformed);
+}
+
+FilterKernel resolveKernel(FilterKernel kernel, const std::vector<FilterSpec>& filters) {
+    if (!filterKernelSupported(kernel)) {
+        throw std::invalid_argument("Filter kernel not supported on this CPU");
+    }
+    for (const FilterSpec& filter : filters) {
+        if (!format::isValidFilter(filter)) {
+            throw std::invalid_argument("Invalid filter " + filterChainToString({filter}));
+        }
+    }
+    if (filters.size() > format::MAX_FILTERS) {
+        throw std::invalid_argument("At most " + std::to_string(format::MAX_FILTERS) + " filters can be chained");
+    }
+    if (kernel == FilterKernel::AUTO) {
+        kernel = filterKernelSupported(FilterKernel::SSSE3) ? FilterKernel::SSSE3 : FilterKernel::SCALAR;
+    }
+    return kernel;
+}
+
+} // anonymous namespace
+
+bool filterKernelSupported(FilterKernel kernel) {
+    switch (kernel) {
+        case FilterKernel::AUTO:
+        case FilterKernel::SCALAR:
+            return true;
+        case FilterKernel::SSSE3:
+#if COMPRESSION_FILTERS_SSSE3
+            return cpuHasSsse3();
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+std::vector<uint8_t> applyFilters(const std::vector<uint8_t>& data, const std::vector<FilterSpec>& filters,
+                                  FilterKernel kernel) {
+    kernel = resolveKernel(kernel, filters);
+    if (filters.empty()) {
+        return data;
+    }
+    // The first filter reads the input in place; the rest alternate between two buffers
+    std::vector<uint8_t> current(data.size());
+    applyFilter(data, current, filters.front(), kernel);
+    std::vector<uint8_t> next;
+    for (size_t i = 1; i < filters.size(); ++i) {
+        next.resize(data.size());
+        applyFilter(current, next, filters[i], kernel);
+        current.swap(next);
+    }
+    return current;
+}
+
+std::vector<uint8_t> reverseFilters(const std::vector<uint8_t>& data, const std::vector<FilterSpec>& filters,
+                                    FilterKernel kernel) {
+    kernel = resolveKernel(kernel, filters);
+    if (filters.empty()) {
+        return data;
+    }
+    std::vector<uint8_t> current(data.size());
+    reverseFilter(data, current, filters.back(), kernel);
+    std::vector<uint8_t> next;
+    for (size_t i = filters.size() - 1; i-- > 0;) {
+        next.resize(data.size());
+        reverseFilter(current, next, filters[i], kernel);
+        current.swap(next);
+    }
+    return current;
+}
+
+std::vector<FilterSpec> parseFilterChain(const std::string& text) {
+    std::vector<FilterSpec> filters;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = std::min(text.find(',', start), text.size());
+        std::string item = text.substr(start, end - start);
+        size_t colon = item.find(':');
+        std::string name = item.substr(0, colon);
+
+        FilterSpec filter;
+        if (name == "delta") {
+            filter.id = FilterID::DELTA;
+        } else if (name == "shuffle") {
+            filter.id = FilterID::SHUFFLE;
+        } else if (name == "bitshuffle") {
+            filter.id = FilterID::BITSHUFFLE;
+        } else {
+            throw std::invalid_argument("Unknown filter: '" + item + "'");
+        }
+        if (colon == std::string::npos && filter.id != FilterID::DELTA) {
+            throw std::invalid_argument("Filter " + name + " needs an element width, e.g. " + name + ":4");
+        }
+        if (colon != std::string::npos) {
+            std::string width = item.substr(colon + 1);
+            if (width.empty() || width.size() > 3 ||
+                !std::all_of(width.begin(), width.end(), [](char c) { return c >= '0' && c <= '9'; }) ||
+                std::stoul(width) > 255) {
+                throw std::invalid_argument("Invalid filter width: '" + item + "'");
+            }
+            filter.width = static_cast<uint8_t>(std::stoul(width));
+        }
+        if (!format::isValidFilter(filter)) {
+            throw std::invalid_argument("Invalid filter width: '" + item + "'");
+        }
+        filters.push_back(filter);
+        start = end + 1;
+    }
+    if (filters.size() > format::MAX_FILTERS) {
+        throw std::invalid_argument("At most " + std::to_string(format::MAX_FILTERS) + " filters can be chained");
+    }
+    return filters;
+}
+
+std::string filterChainToString(const std::vector<FilterSpec>& filters) {
+    std::string text;
+    for (const FilterSpec& filter : filters) {
+        if (!text.empty()) {
+            text += ',';
+        }
+        switch (filter.id) {
+            case FilterID::DELTA: text += "delta"; break;
+            case FilterID::SHUFFLE: text += "shuffle"; break;
+            case FilterID::BITSHUFFLE: text += "bitshuffle"; break;
+            default: text += "filter" + std::to_string(static_cast<int>(filter.id)); break;
+        }
+        text += ':' + std::to_string(filter.width);
+    }
+    return text;
+}
+
+} // namespace utils
+} // namespace compression
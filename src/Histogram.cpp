@@ -0,0 +1,155 @@
+#include "compression/Histogram.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define COMPRESSION_HISTOGRAM_AVX2 1
+#include <immintrin.h>
+#else
+#define COMPRESSION_HISTOGRAM_AVX2 0
+#endif
+
+namespace compression {
+namespace utils {
+
+namespace {
+
+// Below this, clearing several tables costs more than the conflicts they avoid
+constexpr size_t SMALL_INPUT = 64;
+
+// addByteHistogram() counts in chunks that cannot overflow 32-bit counts
+constexpr size_t MAX_CHUNK = size_t(1) << 30;
+
+ByteHistogram histogramSmall(const uint8_t* data, size_t size) {
+    ByteHistogram counts{};
+    for (size_t i = 0; i < size; ++i) {
+        counts[data[i]]++;
+    }
+    return counts;
+}
+
+uint64_t load64(const uint8_t* data) {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// Counts the 8 bytes of a word, byte i into table i % TABLES, so that equal
+// neighbouring bytes land on different counters
+template <size_t TABLES>
+inline void countWord(uint32_t (*tables)[256], uint64_t word) {
+    tables[0][word & 0xFF]++;
+    tables[1 % TABLES][(word >> 8) & 0xFF]++;
+    tables[2 % TABLES][(word >> 16) & 0xFF]++;
+    tables[3 % TABLES][(word >> 24) & 0xFF]++;
+    tables[4 % TABLES][(word >> 32) & 0xFF]++;
+    tables[5 % TABLES][(word >> 40) & 0xFF]++;
+    tables[6 % TABLES][(word >> 48) & 0xFF]++;
+    tables[7 % TABLES][word >> 56]++;
+}
+
+ByteHistogram histogramScalar(const uint8_t* data, size_t size) {
+    uint32_t tables[4][256] = {};
+    size_t pos = 0;
+    for (; pos + 16 <= size; pos += 16) {
+        countWord<4>(tables, load64(data + pos));
+        countWord<4>(tables, load64(data + pos + 8));
+    }
+    for (; pos < size; ++pos) {
+        tables[0][data[pos]]++;
+    }
+
+    ByteHistogram counts;
+    for (size_t symbol = 0; symbol < 256; ++symbol) {
+        counts[symbol] = tables[0][symbol] + tables[1][symbol] + tables[2][symbol] + tables[3][symbol];
+    }
+    return counts;
+}
+
+#if COMPRESSION_HISTOGRAM_AVX2
+// Scattered increments have no vector form; AVX2 widens the loads and sums
+// the eight tables eight counts at a time
+__attribute__((target("avx2")))
+ByteHistogram histogramAvx2(const uint8_t* data, size_t size) {
+    alignas(32) uint32_t tables[8][256] = {};
+    size_t pos = 0;
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        countWord<8>(tables, static_cast<uint64_t>(_mm256_extract_epi64(bytes, 0)));
+        countWord<8>(tables, static_cast<uint64_t>(_mm256_extract_epi64(bytes, 1)));
+        countWord<8>(tables, static_cast<uint64_t>(_mm256_extract_epi64(bytes, 2)));
+        countWord<8>(tables, static_cast<uint64_t>(_mm256_extract_epi64(bytes, 3)));
+    }
+    for (; pos < size; ++pos) {
+        tables[0][data[pos]]++;
+    }
+
+    alignas(32) ByteHistogram counts;
+    for (size_t symbol = 0; symbol < 256; symbol += 8) {
+        __m256i sum = _mm256_load_si256(reinterpret_cast<const __m256i*>(&tables[0][symbol]));
+        for (size_t table = 1; table < 8; ++table) {
+            sum = _mm256_add_epi32(sum, _mm256_load_si256(reinterpret_cast<const __m256i*>(&tables[table][symbol])));
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i*>(&counts[symbol]), sum);
+    }
+    return counts;
+}
+
+bool cpuHasAvx2() {
+    static const bool available = __builtin_cpu_supports("avx2");
+    return available;
+}
+#endif
+
+} // anonymous namespace
+
+bool histogramKernelSupported(HistogramKernel kernel) {
+    switch (kernel) {
+        case HistogramKernel::AUTO:
+        case HistogramKernel::SCALAR:
+            return true;
+        case HistogramKernel::AVX2:
+#if COMPRESSION_HISTOGRAM_AVX2
+            return cpuHasAvx2();
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+ByteHistogram byteHistogram(const uint8_t* data, size_t size, HistogramKernel kernel) {
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("Byte histogram input must be smaller than 4 GiB");
+    }
+    if (!histogramKernelSupported(kernel)) {
+        throw std::invalid_argument("Histogram kernel not supported on this CPU");
+    }
+    if (kernel == HistogramKernel::AUTO) {
+        if (size < SMALL_INPUT) {
+            return histogramSmall(data, size);
+        }
+        kernel = histogramKernelSupported(HistogramKernel::AVX2) ? HistogramKernel::AVX2
+                                                                 : HistogramKernel::SCALAR;
+    }
+#if COMPRESSION_HISTOGRAM_AVX2
+    if (kernel == HistogramKernel::AVX2) {
+        return histogramAvx2(data, size);
+    }
+#endif
+    return histogramScalar(data, size);
+}
+
+void addByteHistogram(const uint8_t* data, size_t size, std::array<uint64_t, 256>& totals) {
+    for (size_t start = 0; start < size; start += MAX_CHUNK) {
+        ByteHistogram counts = byteHistogram(data + start, std::min(MAX_CHUNK, size - start));
+        for (size_t symbol = 0; symbol < 256; ++symbol) {
+            totals[symbol] += counts[symbol];
+        }
+    }
+}
+
+} // namespace utils
+} // namespace compression
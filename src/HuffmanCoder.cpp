@@ -1,107 +1,135 @@
 #include "compression/HuffmanCoder.hpp"
-#include <queue>
 #include <cstdint>
 #include <utility>
 #include <algorithm>
 #include <functional>
+#include <stdexcept>
+#include <string>
 
 namespace compression {
 
-// Custom comparator for priority queue
-struct NodeComparator {
-    bool operator()(
-        const std::unique_ptr<HuffmanCoder::HuffmanNode>& a, 
-        const std::unique_ptr<HuffmanCoder::HuffmanNode>& b) const {
-        return a->frequency > b->frequency; // Min heap, sort by frequency
-    }
-};
+namespace {
 
-std::unique_ptr<HuffmanCoder::HuffmanNode> HuffmanCoder::buildHuffmanTree(
-    const FrequencyMap& freqMap) const {
-    
-    // Edge case: empty frequency map
-    if (freqMap.empty()) {
-        return nullptr;
+// Longest code a canonical code assignment can hold in its counter
+constexpr uint8_t MAX_CODE_LENGTH_LIMIT = 32;
+
+void checkLengthLimit(size_t symbolCount, uint8_t maxLength) {
+    if (maxLength < 1 || maxLength > MAX_CODE_LENGTH_LIMIT) {
+        throw std::invalid_argument("Huffman code length limit must be between 1 and " +
+                                    std::to_string(MAX_CODE_LENGTH_LIMIT));
     }
-    
-    // Edge case: only one symbol
-    if (freqMap.size() == 1) {
-        auto it = freqMap.begin();
-        auto node = std::make_unique<HuffmanNode>(it->first, it->second);
-        return node;
+    if (symbolCount > (uint64_t(1) << maxLength)) {
+        throw std::invalid_argument(std::to_string(symbolCount) + " symbols do not fit in " +
+                                    std::to_string(maxLength) + "-bit codes");
     }
-    
-    // Create min-heap (priority queue)
-    std::priority_queue<
-        std::unique_ptr<HuffmanNode>,
-        std::vector<std::unique_ptr<HuffmanNode>>,
-        NodeComparator
-    > minHeap;
-    
-    // Add all symbols to the heap
-    for (const auto& [symbol, freq] : freqMap) {
-        minHeap.push(std::make_unique<HuffmanNode>(symbol, freq));
+}
+
+} // anonymous namespace
+
+HuffmanCoder::CodeLengths HuffmanCoder::computeCodeLengths(const uint64_t* frequencies, size_t symbolCount) {
+    if (symbolCount > MAX_SYMBOLS) {
+        throw std::invalid_argument("Huffman alphabet larger than " + std::to_string(MAX_SYMBOLS) + " symbols");
     }
+    CodeLengths lengths{};
     
-    // Combine nodes until only the root remains
-    while (minHeap.size() > 1) {
-        // Extract two nodes with lowest frequencies
-        auto left = std::move(const_cast<std::unique_ptr<HuffmanNode>&>(minHeap.top()));
-        minHeap.pop();
-        
-        auto right = std::move(const_cast<std::unique_ptr<HuffmanNode>&>(minHeap.top()));
-        minHeap.pop();
-        
-        // Create new internal node with these two as children
-        auto parent = std::make_unique<HuffmanNode>(std::move(left), std::move(right));
-        minHeap.push(std::move(parent));
+    // Coded symbols in ascending frequency order; ties by symbol
+    std::array<uint16_t, MAX_SYMBOLS> order;
+    size_t n = 0;
+    for (size_t symbol = 0; symbol < symbolCount; ++symbol) {
+        if (frequencies[symbol] > 0) {
+            order[n++] = static_cast<uint16_t>(symbol);
+        }
+    }
+    if (n == 1) {
+        lengths[order[0]] = 1;
     }
+    if (n <= 1) {
+        return lengths;
+    }
+    std::stable_sort(order.begin(), order.begin() + n,
+                     [&](uint16_t a, uint16_t b) { return frequencies[a] < frequencies[b]; });
     
-    // Return the root of the Huffman tree
-    return std::move(const_cast<std::unique_ptr<HuffmanNode>&>(minHeap.top()));
-}
-
-void HuffmanCoder::generateCodes(
-    const HuffmanNode* node,
-    HuffmanCode prefix,
-    HuffmanCodeMap& codeMap) const {
+    std::array<uint64_t, MAX_SYMBOLS> A;
+    for (size_t i = 0; i < n; ++i) {
+        A[i] = frequencies[order[i]];
+    }
     
-    if (!node) {
-        return;
+    // Phase 1: A[next] becomes the weight of internal node next; an internal
+    // node that has been given a parent stores the parent's index instead.
+    // Leaves are consumed from leaf on, unparented internal nodes from root on.
+    size_t leaf = 2;
+    size_t root = 0;
+    A[0] += A[1];
+    for (size_t next = 1; next < n - 1; ++next) {
+        if (leaf >= n || A[root] < A[leaf]) {
+            A[next] = A[root];
+            A[root++] = next;
+        } else {
+            A[next] = A[leaf++];
+        }
+        if (leaf >= n || (root < next && A[root] < A[leaf])) {
+            A[next] += A[root];
+            A[root++] = next;
+        } else {
+            A[next] += A[leaf++];
+        }
     }
     
-    // If this is a leaf node, we've found a complete code
-    if (node->isLeaf()) {
-        codeMap[node->symbol] = prefix;
-        return;
+    // Phase 2: parent indices to internal node depths, root first
+    A[n - 2] = 0;
+    for (size_t next = n - 2; next-- > 0;) {
+        A[next] = A[A[next]] + 1;
     }
     
-    // Traverse left (add 0)
-    if (node->left) {
-        HuffmanCode leftPrefix = prefix;
-        leftPrefix.push_back(false);
-        generateCodes(node->left.get(), leftPrefix, codeMap);
+    // Phase 3: each level's free slots not taken by internal nodes are
+    // leaves; the most frequent symbols sit at the top of the array
+    size_t available = 1;
+    size_t used = 0;
+    uint64_t depth = 0;
+    ptrdiff_t internal = static_cast<ptrdiff_t>(n) - 2;
+    ptrdiff_t next = static_cast<ptrdiff_t>(n) - 1;
+    while (available > 0) {
+        while (internal >= 0 && A[internal] == depth) {
+            used++;
+            internal--;
+        }
+        while (available > used) {
+            A[next--] = depth;
+            available--;
+        }
+        available = 2 * used;
+        depth++;
+        used = 0;
     }
     
-    // Traverse right (add 1)
-    if (node->right) {
-        HuffmanCode rightPrefix = prefix;
-        rightPrefix.push_back(true);
-        generateCodes(node->right.get(), rightPrefix, codeMap);
+    for (size_t i = 0; i < n; ++i) {
+        lengths[order[i]] = static_cast<uint8_t>(A[i]);
     }
+    return lengths;
 }
 
 HuffmanCodeMap HuffmanCoder::buildHuffmanCodes(const FrequencyMap& freqMap) const {
-    // Build the Huffman tree
-    auto rootNode = buildHuffmanTree(freqMap);
-    
-    // Generate codes by traversing the tree
-    HuffmanCodeMap codeMap;
-    if (rootNode) {
-        generateCodes(rootNode.get(), {}, codeMap);
+    // Compact the coded symbols into consecutive indices
+    std::array<uint64_t, MAX_SYMBOLS> frequencies{};
+    std::array<uint32_t, MAX_SYMBOLS> symbols;
+    size_t count = 0;
+    for (const auto& [symbol, frequency] : freqMap) {
+        if (frequency > 0) {
+            if (count == MAX_SYMBOLS) {
+                throw std::invalid_argument("Huffman alphabet larger than " +
+                                            std::to_string(MAX_SYMBOLS) + " symbols");
+            }
+            symbols[count] = symbol;
+            frequencies[count++] = frequency;
+        }
     }
     
-    return codeMap;
+    CodeLengths lengths = computeCodeLengths(frequencies.data(), count);
+    std::map<uint32_t, uint8_t> lengthMap;
+    for (size_t i = 0; i < count; ++i) {
+        lengthMap[symbols[i]] = lengths[i];
+    }
+    return buildCanonicalCodes(lengthMap);
 }
 
 std::map<uint32_t, uint8_t> HuffmanCoder::getCodeLengths(const HuffmanCodeMap& codeMap) const {
@@ -115,10 +143,121 @@ std::map<uint32_t, uint8_t> HuffmanCoder::getCodeLengths(const HuffmanCodeMap& c
     return lengthMap;
 }
 
+HuffmanCodeMap HuffmanCoder::buildHuffmanCodes(const FrequencyMap& freqMap, uint8_t maxLength) const {
+    return buildCanonicalCodes(buildLimitedCodeLengths(freqMap, maxLength));
+}
+
+// Package-merge: every symbol is a coin of its frequency in each of the
+// maxLength denominations. From the smallest denomination up, coins are
+// paired into packages that join the next denomination's coins, and the
+// cheapest 2n - 2 items of the largest denomination are picked. A symbol's
+// code length is the number of its coins inside the picked items.
+std::map<uint32_t, uint8_t> HuffmanCoder::buildLimitedCodeLengths(
+    const FrequencyMap& freqMap,
+    uint8_t maxLength) const {
+    
+    std::vector<std::pair<uint64_t, uint32_t>> leaves; // (frequency, symbol)
+    for (const auto& [symbol, frequency] : freqMap) {
+        if (frequency > 0) {
+            leaves.emplace_back(frequency, symbol);
+        }
+    }
+    checkLengthLimit(leaves.size(), maxLength);
+    
+    std::map<uint32_t, uint8_t> lengths;
+    if (leaves.size() == 1) {
+        lengths[leaves[0].second] = 1;
+    }
+    if (leaves.size() <= 1) {
+        return lengths;
+    }
+    std::sort(leaves.begin(), leaves.end());
+    
+    // Each list is in weight order, leaves before packages of equal weight.
+    // A package is the next unpaired pair of the previous list, so the lists
+    // are kept to expand the picked items afterwards.
+    struct Item {
+        uint64_t weight;
+        int32_t leaf; // Index into leaves, or -1 for a package
+    };
+    std::vector<std::vector<Item>> lists(1);
+    for (size_t i = 0; i < leaves.size(); ++i) {
+        lists[0].push_back({leaves[i].first, static_cast<int32_t>(i)});
+    }
+    for (uint8_t level = 1; level < maxLength; ++level) {
+        const std::vector<Item>& previous = lists.back();
+        std::vector<Item> merged;
+        merged.reserve(leaves.size() + previous.size() / 2);
+        size_t leaf = 0;
+        for (size_t pair = 0; pair + 1 < previous.size(); pair += 2) {
+            uint64_t weight = previous[pair].weight + previous[pair + 1].weight;
+            while (leaf < lists[0].size() && lists[0][leaf].weight <= weight) {
+                merged.push_back(lists[0][leaf++]);
+            }
+            merged.push_back({weight, -1});
+        }
+        merged.insert(merged.end(), lists[0].begin() + leaf, lists[0].end());
+        lists.push_back(std::move(merged));
+    }
+    
+    // Walk down from the picked prefix: a prefix of a list includes whole
+    // pairs of the previous list, which form a prefix there in turn
+    std::vector<uint8_t> leafLengths(leaves.size(), 0);
+    size_t picked = 2 * leaves.size() - 2;
+    for (size_t level = lists.size(); level-- > 0;) {
+        size_t packages = 0;
+        for (size_t i = 0; i < picked; ++i) {
+            const Item& item = lists[level][i];
+            if (item.leaf >= 0) {
+                leafLengths[item.leaf]++;
+            } else {
+                packages++;
+            }
+        }
+        picked = 2 * packages;
+    }
+    
+    for (size_t i = 0; i < leaves.size(); ++i) {
+        lengths[leaves[i].second] = leafLengths[i];
+    }
+    return lengths;
+}
+
+HuffmanCodeMap HuffmanCoder::buildCanonicalCodes(const std::map<uint32_t, uint8_t>& lengths) const {
+    std::vector<std::pair<uint8_t, uint32_t>> order; // (length, symbol)
+    for (const auto& [symbol, length] : lengths) {
+        if (length < 1 || length > MAX_CODE_LENGTH_LIMIT) {
+            throw std::invalid_argument("Invalid Huffman code length: " + std::to_string(length));
+        }
+        order.emplace_back(length, symbol);
+    }
+    std::sort(order.begin(), order.end());
+    
+    HuffmanCodeMap codeMap;
+    uint64_t code = 0;
+    uint8_t previousLength = order.empty() ? 0 : order.front().first;
+    for (const auto& [length, symbol] : order) {
+        code <<= (length - previousLength);
+        previousLength = length;
+        if (code >> length) {
+            throw std::invalid_argument("Huffman code lengths oversubscribe the code space");
+        }
+        HuffmanCode bits(length);
+        for (uint8_t bit = 0; bit < length; ++bit) {
+            bits[bit] = (code >> (length - 1 - bit)) & 1;
+        }
+        codeMap[symbol] = std::move(bits);
+        code++;
+    }
+    return codeMap;
+}
+
 std::map<uint32_t, uint8_t> HuffmanCoder::limitCodeLengths(
     const std::map<uint32_t, uint8_t>& inputLengths,
     uint8_t maxLength) const {
     
+    checkLengthLimit(inputLengths.size(), maxLength);
+    
     // If nothing exceeds max length, just return as is
     bool needsReduction = false;
     for (const auto& [symbol, length] : inputLengths) {
@@ -132,34 +271,34 @@ std::map<uint32_t, uint8_t> HuffmanCoder::limitCodeLengths(
         return inputLengths;
     }
     
-    // Count symbols at each length
-    std::vector<int> blCount(maxLength + 1, 0);
+    // Kraft sum in units of 2^-maxLength; a prefix code needs at most 2^maxLength
+    std::map<uint32_t, uint8_t> resultLengths;
+    std::vector<std::vector<uint32_t>> symbolsByLength(maxLength + 1);
+    uint64_t kraft = 0;
     for (const auto& [symbol, length] : inputLengths) {
-        if (length <= maxLength) {
-            blCount[length]++;
+        if (length == 0) { // Not coded
+            resultLengths[symbol] = 0;
+            continue;
         }
+        uint8_t clamped = std::min(length, maxLength);
+        resultLengths[symbol] = clamped;
+        symbolsByLength[clamped].push_back(symbol);
+        kraft += uint64_t(1) << (maxLength - clamped);
     }
     
-    // Find the first code for each code length
-    std::vector<int> nextCode(maxLength + 1, 0);
-    int code = 0;
-    blCount[0] = 0;
-    for (int bits = 1; bits <= maxLength; bits++) {
-        code = (code + blCount[bits-1]) << 1;
-        nextCode[bits] = code;
-    }
-    
-    // Assign new lengths, ensuring none exceed maxLength
-    std::map<uint32_t, uint8_t> resultLengths;
-    for (const auto& [symbol, length] : inputLengths) {
-        if (length <= maxLength) {
-            resultLengths[symbol] = length;
-        } else {
-            // Need to reduce this code's length
-            // In a real implementation, we'd use the Package-Merge algorithm
-            // For simplicity, we'll just cap at maxLength
-            resultLengths[symbol] = maxLength;
+    // Lengthening a code of length l frees 2^(maxLength - l - 1) units; the
+    // longest codes below the limit cost the least ratio to lengthen
+    const uint64_t capacity = uint64_t(1) << maxLength;
+    while (kraft > capacity) {
+        uint8_t length = maxLength - 1;
+        while (symbolsByLength[length].empty()) {
+            length--;
         }
+        uint32_t symbol = symbolsByLength[length].back();
+        symbolsByLength[length].pop_back();
+        symbolsByLength[length + 1].push_back(symbol);
+        resultLengths[symbol] = length + 1;
+        kraft -= uint64_t(1) << (maxLength - length - 1);
     }
     
     return resultLengths;
@@ -1,11 +1,17 @@
 #include "compression/HuffmanCompressor.hpp"
+#include "compression/Dictionary.hpp"
+#include "compression/DataProfile.hpp"
+#include "compression/Histogram.hpp"
+#include "compression/HuffmanCoder.hpp"
+#include "compression/ThreadPool.hpp"
+#include "compression/Varint.hpp"
+#include <array>
 #include <bitset>
 #include <algorithm>
 #include <stdexcept>
 #include <sstream>
 #include <vector>
 #include <map>
-#include <queue>
 #include <iterator> // for std::back_inserter
 #include <iostream> // Added for std::cerr, std::endl
 
@@ -35,12 +41,6 @@ public:
         }
     }
 
-    void writeCode(const HuffmanCompressor::HuffmanCode& code) {
-        for (bool bit : code) {
-            writeBit(bit);
-        }
-    }
-
     // Call at the end to write any remaining bits in the current byte
     void flush() {
         if (bit_position > 0) {
@@ -115,6 +115,43 @@ uint64_t deserializeUint64(const std::vector<std::byte>& buffer, size_t& offset)
     return value;
 }
 
+// Leading byte of dictionary-mode streams
+constexpr uint8_t MODE_DICTIONARY_CODES = 0;
+constexpr uint8_t MODE_EMBEDDED_TABLE = 1;
+constexpr uint8_t MODE_STORED = 2;
+constexpr uint8_t MODE_DICTIONARY_SEGMENTS = 3;
+// Added to modes 0 and 3 when the codes are length-limited; a byte with the
+// limit follows the mode
+constexpr uint8_t MODE_LIMITED_CODES = 4;
+
+// Table-format markers: a one-entry table with a zero frequency, which a real
+// table never contains. The entry's symbol holds flags for what follows; no
+// flags means the input is stored.
+constexpr uint8_t STORED_TABLE_MARKER[] = {1, 0, 0};
+constexpr size_t TABLE_MARKER_SIZE = sizeof(STORED_TABLE_MARKER);
+// A real table and one payload per segment follow
+constexpr uint8_t TABLE_FLAG_SEGMENTED = 0x01;
+// A byte with the code length limit follows, then the table
+constexpr uint8_t TABLE_FLAG_LIMITED_CODES = 0x02;
+constexpr uint8_t KNOWN_TABLE_FLAGS = TABLE_FLAG_SEGMENTED | TABLE_FLAG_LIMITED_CODES;
+
+bool hasTableMarker(const std::vector<uint8_t>& data, size_t offset) {
+    return data.size() >= offset + TABLE_MARKER_SIZE && data[offset] == 1 && data[offset + 2] == 0;
+}
+
+// Reads the limit after a limited-codes flag
+uint8_t readCodeLengthLimit(const std::vector<uint8_t>& data, size_t& offset) {
+    if (offset >= data.size()) {
+        throw std::runtime_error("Unexpected end of compressed data");
+    }
+    uint8_t maxLength = data[offset++];
+    if (maxLength < HuffmanCompressor::SHORTEST_CODE_LENGTH_LIMIT ||
+        maxLength > HuffmanCompressor::LONGEST_CODE_LENGTH_LIMIT) {
+        throw std::runtime_error("Invalid Huffman code length limit: " + std::to_string(maxLength));
+    }
+    return maxLength;
+}
+
 } // anonymous namespace
 
 // --- HuffmanCompressor Implementation --- 
@@ -137,124 +174,132 @@ static uint8_t bitsRequired(uint64_t value) {
     return bits;
 }
 
-// Helper for debugging: get node description (address + data)
-static std::string getNodeDesc(const HuffmanCompressor::HuffmanNode* node) {
-    if (!node) return "NULL";
-    std::stringstream ss;
-    ss << "Node@" << node << "(data=" << static_cast<int>(node->data) 
-       << ", freq=" << node->frequency << ")";
-    return ss.str();
-}
-
 // --- Frequency Map Construction ---
 HuffmanCompressor::FrequencyMap HuffmanCompressor::buildFrequencyMap(
     const std::vector<uint8_t>& data) const {
-    FrequencyMap freqMap;
+    std::array<uint64_t, 256> counts{};
+    utils::addByteHistogram(data.data(), data.size(), counts);
     
-    // Count occurrences of each byte
-    for (const auto& byte : data) {
-        freqMap[byte]++;
+    FrequencyMap freqMap;
+    for (size_t symbol = 0; symbol < 256; ++symbol) {
+        if (counts[symbol] > 0) {
+            freqMap.emplace_hint(freqMap.end(), static_cast<uint8_t>(symbol), counts[symbol]);
+        }
     }
-    
     return freqMap;
 }
 
-// --- Huffman Tree Construction ---
-// Custom comparator for the priority queue
-struct NodePtrGreater {
-    bool operator()(
-        const std::unique_ptr<HuffmanCompressor::HuffmanNode>& lhs, 
-        const std::unique_ptr<HuffmanCompressor::HuffmanNode>& rhs) const {
-        return lhs->frequency > rhs->frequency; // Min heap based on frequency
+HuffmanCompressor::FrequencyMap HuffmanCompressor::buildFrequencyMapParallel(
+    const std::vector<uint8_t>& data) const {
+    size_t segmentCount = (data.size() + parallelBlockSize_ - 1) / parallelBlockSize_;
+    std::vector<std::array<uint64_t, 256>> counts(segmentCount);
+    pool().parallelFor(segmentCount, [&](size_t i) {
+        counts[i].fill(0);
+        size_t start = i * parallelBlockSize_;
+        utils::addByteHistogram(data.data() + start, std::min(parallelBlockSize_, data.size() - start),
+                                counts[i]);
+    });
+    
+    FrequencyMap freqMap;
+    for (size_t symbol = 0; symbol < 256; ++symbol) {
+        uint64_t total = 0;
+        for (const auto& segment : counts) {
+            total += segment[symbol];
+        }
+        if (total > 0) {
+            freqMap.emplace_hint(freqMap.end(), static_cast<uint8_t>(symbol), total);
+        }
     }
-};
+    return freqMap;
+}
 
-std::unique_ptr<HuffmanCompressor::HuffmanNode> HuffmanCompressor::buildHuffmanTree(
-    const FrequencyMap& freqMap) const {
+// --- Huffman Tree Construction ---
+void HuffmanCompressor::buildHuffmanTree(const FrequencyMap& freqMap, HuffmanTree& tree) const {
+    tree.nodeCount = 0;
+    tree.root = HuffmanTree::NO_NODE;
     
     // Special case: empty input
     if (freqMap.empty()) {
-        return nullptr;
+        return;
     }
     
     // Special case: only one byte value in the input
     if (freqMap.size() == 1) {
-        auto it = freqMap.begin();
-        auto leaf = std::make_unique<HuffmanNode>(it->first, it->second);
-        // For single-symbol files, create a root with the leaf as left child
-        auto root = std::make_unique<HuffmanNode>(std::move(leaf), nullptr);
-        return root;
+        uint16_t leaf = tree.addNode(HuffmanTree::NO_NODE, HuffmanTree::NO_NODE, freqMap.begin()->first);
+        // For single-symbol files, create a root with the leaf as its 0 child
+        tree.root = tree.addNode(leaf, HuffmanTree::NO_NODE);
+        return;
     }
     
-    // Priority queue containing the nodes of the Huffman tree
-    // Using min heap based on frequency
-    using MinHeap = std::priority_queue<
-        std::unique_ptr<HuffmanNode>, 
-        std::vector<std::unique_ptr<HuffmanNode>>, 
-        NodePtrGreater
-    >;
-    
-    MinHeap pq;
+    // Min heap of node indices by weight. The heap operations are the ones
+    // std::priority_queue performs, so ties resolve as they always have and
+    // the decoder rebuilds exactly the encoder's tree from the stored table.
+    std::array<uint64_t, HuffmanTree::MAX_NODES> weights;
+    std::array<uint16_t, 256> heap;
+    size_t heapSize = 0;
+    auto heavier = [&](uint16_t lhs, uint16_t rhs) { return weights[lhs] > weights[rhs]; };
     
-    // Create a leaf node for each symbol and add it to the priority queue
     for (const auto& [byte, freq] : freqMap) {
-        pq.push(std::make_unique<HuffmanNode>(byte, freq));
+        uint16_t leaf = tree.addNode(HuffmanTree::NO_NODE, HuffmanTree::NO_NODE, byte);
+        weights[leaf] = freq;
+        heap[heapSize++] = leaf;
+        std::push_heap(heap.begin(), heap.begin() + heapSize, heavier);
     }
     
-    // While there is more than one node in the queue
-    while (pq.size() > 1) {
-        // Extract the two nodes with lowest frequency
-        auto left = std::move(const_cast<std::unique_ptr<HuffmanNode>&>(pq.top()));
-        pq.pop();
-        
-        auto right = std::move(const_cast<std::unique_ptr<HuffmanNode>&>(pq.top()));
-        pq.pop();
+    // Merge the two lightest nodes until one is left
+    while (heapSize > 1) {
+        std::pop_heap(heap.begin(), heap.begin() + heapSize, heavier);
+        uint16_t zero = heap[--heapSize];
+        std::pop_heap(heap.begin(), heap.begin() + heapSize, heavier);
+        uint16_t one = heap[--heapSize];
         
-        // Create a new internal node with these two nodes as children
-        // and with frequency equal to the sum of their frequencies
-        auto parent = std::make_unique<HuffmanNode>(std::move(left), std::move(right));
-        
-        // Add the new node to the priority queue
-        pq.push(std::move(parent));
+        uint16_t parent = tree.addNode(zero, one);
+        weights[parent] = weights[zero] + weights[one];
+        heap[heapSize++] = parent;
+        std::push_heap(heap.begin(), heap.begin() + heapSize, heavier);
     }
-    
-    // The remaining node is the root node of the Huffman tree
-    return std::move(const_cast<std::unique_ptr<HuffmanNode>&>(pq.top()));
+    tree.root = heap[0];
 }
 
 // --- Code Generation ---
-void HuffmanCompressor::generateCodes(
-    const HuffmanNode* node, 
-    HuffmanCode prefix, 
-    HuffmanCodeMap& codeMap) const {
-    
-    if (!node) return;
-    
-    // Check if this is a leaf node
-    if (!node->left && !node->right) {
-        // Assign code to symbol
-        if (prefix.empty()) {
-            // Special case: single node tree, assign a single 0 bit
-            prefix.push_back(false);
-        }
-        codeMap[node->data] = prefix;
-        return;
+size_t HuffmanCompressor::generateCodes(const HuffmanTree& tree, size_t maxLength, CodeTable& codes) const {
+    codes.lengths.fill(0);
+    if (tree.root == HuffmanTree::NO_NODE) {
+        return 0;
     }
     
-    // Recursive traversal to build codes
-    if (node->left) {
-        // Add 0 for left branch
-        HuffmanCode leftCode = prefix;
-        leftCode.push_back(false);
-        generateCodes(node->left.get(), leftCode, codeMap);
-    }
-    
-    if (node->right) {
-        // Add 1 for right branch
-        HuffmanCode rightCode = prefix;
-        rightCode.push_back(true);
-        generateCodes(node->right.get(), rightCode, codeMap);
+    // Depth-first walk with an explicit stack; a tree of 256 leaves holds at
+    // most one pending sibling per level
+    struct Pending {
+        uint16_t node;
+        uint8_t length;
+        uint64_t bits;
+    };
+    std::array<Pending, HuffmanTree::MAX_NODES> stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = {tree.root, 0, 0};
+    size_t longest = 0;
+    
+    while (stackSize > 0) {
+        Pending entry = stack[--stackSize];
+        const auto& node = tree.nodes[entry.node];
+        if (node.isLeaf()) {
+            codes.bits[node.symbol] = static_cast<uint32_t>(entry.bits);
+            codes.lengths[node.symbol] = entry.length;
+            longest = std::max<size_t>(longest, entry.length);
+            continue;
+        }
+        if (entry.length >= maxLength) {
+            return entry.length + 1;
+        }
+        for (uint16_t bit : {1, 0}) {
+            if (node.child[bit] != HuffmanTree::NO_NODE) {
+                stack[stackSize++] = {node.child[bit], static_cast<uint8_t>(entry.length + 1),
+                                      (entry.bits << 1) | bit};
+            }
+        }
     }
+    return longest;
 }
 
 // --- Serialization of Frequency Map ---
@@ -264,12 +309,12 @@ std::vector<uint8_t> HuffmanCompressor::serializeFrequencyMap(
     std::vector<uint8_t> serialized;
     
     // Format: 
-    // - Byte: Number of entries (max 256)
+    // - Byte: Number of entries (0 stands for 256; empty input has no table)
     // - For each entry:
     //   - Byte: Symbol
     //   - VarInt: Frequency
     
-    // Number of entries (max 256 for byte values)
+    // Number of entries; 256 wraps to 0
     serialized.push_back(static_cast<uint8_t>(freqMap.size()));
     
     // For each symbol and its frequency
@@ -303,11 +348,14 @@ HuffmanCompressor::FrequencyMap HuffmanCompressor::deserializeFrequencyMap(
         throw std::runtime_error("Buffer ended unexpectedly during map deserialization");
     }
     
-    // Get count of entries
-    uint8_t count = buffer[offset++];
+    // Get count of entries (0 means all 256 byte values)
+    size_t count = buffer[offset++];
+    if (count == 0) {
+        count = 256;
+    }
     
     // Process each entry
-    for (uint8_t i = 0; i < count; i++) {
+    for (size_t i = 0; i < count; i++) {
         // Check buffer size
         if (offset + 1 >= buffer.size()) {
             throw std::runtime_error("Buffer ended unexpectedly during map entry deserialization");
@@ -349,188 +397,438 @@ HuffmanCompressor::FrequencyMap HuffmanCompressor::deserializeFrequencyMap(
     return freqMap;
 }
 
+// --- Dictionary Support ---
+void HuffmanCompressor::setDictionary(std::shared_ptr<const Dictionary> dictionary) {
+    dictionary_ = std::move(dictionary);
+    dictionaryTree_.reset();
+    dictionaryCodes_ = CodeTable{};
+    dictionaryCodeLength_ = 0;
+    if (dictionary_) {
+        auto tree = std::make_shared<HuffmanTree>();
+        buildHuffmanTree(dictionaryFrequencyMap(), *tree);
+        // Deeper trees are never used as they are; compress() falls back to
+        // limited codes whatever the configured limit
+        dictionaryCodeLength_ = generateCodes(*tree, LONGEST_CODE_LENGTH_LIMIT, dictionaryCodes_);
+        dictionaryTree_ = std::move(tree);
+    }
+}
+
+// --- Length-Limited Codes ---
+void HuffmanCompressor::setMaxCodeLength(uint8_t maxLength) {
+    if (maxLength < SHORTEST_CODE_LENGTH_LIMIT || maxLength > LONGEST_CODE_LENGTH_LIMIT) {
+        throw std::invalid_argument("Huffman code length limit must be between " +
+                                    std::to_string(SHORTEST_CODE_LENGTH_LIMIT) + " and " +
+                                    std::to_string(LONGEST_CODE_LENGTH_LIMIT));
+    }
+    maxCodeLength_ = maxLength;
+}
+
+void HuffmanCompressor::buildLimitedCodes(
+    const FrequencyMap& freqMap, uint8_t maxLength, CodeTable& codes) const {
+    compression::FrequencyMap symbols(freqMap.begin(), freqMap.end());
+    codes.lengths.fill(0);
+    for (const auto& [symbol, code] : HuffmanCoder().buildHuffmanCodes(symbols, maxLength)) {
+        uint32_t bits = 0;
+        for (bool bit : code) {
+            bits = (bits << 1) | bit;
+        }
+        codes.bits[symbol] = bits;
+        codes.lengths[symbol] = static_cast<uint8_t>(code.size());
+    }
+}
+
+void HuffmanCompressor::buildTreeFromCodes(const CodeTable& codes, HuffmanTree& tree) const {
+    tree.nodeCount = 0;
+    tree.root = tree.addNode(HuffmanTree::NO_NODE, HuffmanTree::NO_NODE);
+    for (size_t symbol = 0; symbol < 256; ++symbol) {
+        uint16_t node = tree.root;
+        for (size_t bit = codes.lengths[symbol]; bit-- > 0;) {
+            uint16_t& child = tree.nodes[node].child[(codes.bits[symbol] >> bit) & 1];
+            if (child == HuffmanTree::NO_NODE) {
+                child = tree.addNode(HuffmanTree::NO_NODE, HuffmanTree::NO_NODE);
+            }
+            node = child;
+        }
+        tree.nodes[node].symbol = static_cast<uint8_t>(symbol);
+    }
+}
+
+HuffmanCompressor::FrequencyMap HuffmanCompressor::dictionaryFrequencyMap() const {
+    FrequencyMap freqMap;
+    const auto& counts = dictionary_->byteFrequencies();
+    for (size_t symbol = 0; symbol < counts.size(); ++symbol) {
+        freqMap[static_cast<uint8_t>(symbol)] = counts[symbol] + 1;
+    }
+    return freqMap;
+}
+
+// --- Parallel Segments ---
+void HuffmanCompressor::setParallelBlockSize(size_t blockSize, ThreadPool* pool) {
+    if (blockSize != 0 && blockSize < MIN_PARALLEL_BLOCK_SIZE) {
+        throw std::invalid_argument("Parallel Huffman segments must be at least " +
+                                    std::to_string(MIN_PARALLEL_BLOCK_SIZE) + " bytes");
+    }
+    parallelBlockSize_ = blockSize;
+    pool_ = pool;
+}
+
+bool HuffmanCompressor::usesParallelSegments(size_t inputSize) const {
+    return parallelBlockSize_ > 0 && inputSize > parallelBlockSize_;
+}
+
+ThreadPool& HuffmanCompressor::pool() const {
+    return pool_ ? *pool_ : ThreadPool::shared();
+}
+
+void HuffmanCompressor::encodeSegments(
+    const std::vector<uint8_t>& data,
+    const CodeTable& codes,
+    std::vector<uint8_t>& output) const {
+    
+    size_t segmentCount = (data.size() + parallelBlockSize_ - 1) / parallelBlockSize_;
+    std::vector<std::vector<uint8_t>> payloads(segmentCount);
+    pool().parallelFor(segmentCount, [&](size_t i) {
+        size_t start = i * parallelBlockSize_;
+        encodePayload(data.data() + start, std::min(parallelBlockSize_, data.size() - start),
+                      codes, payloads[i]);
+    });
+    
+    utils::writeVarint(output, data.size());
+    utils::writeVarint(output, parallelBlockSize_);
+    for (const auto& payload : payloads) {
+        utils::writeVarint(output, payload.size());
+    }
+    for (const auto& payload : payloads) {
+        output.insert(output.end(), payload.begin(), payload.end());
+    }
+}
+
+std::vector<uint8_t> HuffmanCompressor::decodeSegments(
+    const std::vector<uint8_t>& data,
+    size_t offset,
+    const HuffmanTree& tree) const {
+    
+    uint64_t totalSize = utils::readVarint(data, offset, "Huffman");
+    uint64_t segmentSize = utils::readVarint(data, offset, "Huffman");
+    if (segmentSize == 0) {
+        throw std::runtime_error("Invalid Huffman segment size");
+    }
+    // Every segment takes at least its length byte and its bit count byte
+    uint64_t segmentCount = totalSize / segmentSize + (totalSize % segmentSize != 0);
+    if (segmentCount > (data.size() - offset) / 2) {
+        throw std::runtime_error("Huffman segment count exceeds stream");
+    }
+    
+    std::vector<size_t> payloadOffsets(segmentCount + 1);
+    std::vector<uint64_t> payloadSizes(segmentCount);
+    for (auto& size : payloadSizes) {
+        size = utils::readVarint(data, offset, "Huffman");
+    }
+    payloadOffsets[0] = offset;
+    for (size_t i = 0; i < segmentCount; ++i) {
+        if (payloadSizes[i] > data.size() - payloadOffsets[i]) {
+            throw std::runtime_error("Huffman segment exceeds stream");
+        }
+        payloadOffsets[i + 1] = payloadOffsets[i] + payloadSizes[i];
+    }
+    
+    std::vector<std::vector<uint8_t>> segments(segmentCount);
+    pool().parallelFor(segmentCount, [&](size_t i) {
+        segments[i] = decodePayload(data.data() + payloadOffsets[i], payloadSizes[i], tree);
+        uint64_t expected = std::min(segmentSize, totalSize - i * segmentSize);
+        if (segments[i].size() != expected) {
+            throw std::runtime_error("Huffman segment decoded to the wrong size");
+        }
+    });
+    
+    std::vector<uint8_t> result;
+    result.reserve(totalSize);
+    for (const auto& segment : segments) {
+        result.insert(result.end(), segment.begin(), segment.end());
+    }
+    return result;
+}
+
+// --- Payload Encoding ---
+void HuffmanCompressor::encodePayload(
+    const uint8_t* data,
+    size_t size,
+    const CodeTable& codes,
+    std::vector<uint8_t>& output) const {
+    
+    // Number of bits in the last byte, known once all codes are written
+    size_t header = output.size();
+    output.push_back(0);
+    output.reserve(output.size() + size); // Rough estimate: one byte per symbol
+    
+    // Codes enter an accumulator most significant bit first; at most 7 bits
+    // stay behind between codes, so a 32-bit code always fits
+    uint64_t pending = 0;
+    unsigned pendingBits = 0;
+    for (size_t i = 0; i < size; ++i) {
+        uint8_t length = codes.lengths[data[i]];
+        pending = (pending << length) | codes.bits[data[i]];
+        pendingBits += length;
+        while (pendingBits >= 8) {
+            pendingBits -= 8;
+            output.push_back(static_cast<uint8_t>(pending >> pendingBits));
+        }
+    }
+    
+    if (pendingBits > 0) {
+        output.push_back(static_cast<uint8_t>(pending << (8 - pendingBits)));
+        output[header] = static_cast<uint8_t>(pendingBits);
+    }
+}
+
+// --- Payload Decoding ---
+std::vector<uint8_t> HuffmanCompressor::decodePayload(
+    const uint8_t* payload,
+    size_t size,
+    const HuffmanTree& tree) const {
+    
+    // 1. Validate the data
+    if (size == 0) {
+        throw std::runtime_error("Unexpected end of compressed data");
+    }
+    
+    // 2. Get bit count in last byte
+    uint8_t lastByteBits = payload[0];
+    if (lastByteBits > 7) {
+        throw std::runtime_error("Invalid bit count in last byte (must be 0-7)");
+    }
+    const uint8_t* data = payload + 1;
+    
+    // 3. Calculate total number of bits in encoded data
+    size_t dataByteCount = size - 1;
+    if (dataByteCount == 0) {
+        return {}; // No encoded bits
+    }
+    
+    size_t totalBits = (dataByteCount - 1) * 8;
+    if (lastByteBits == 0) {
+        totalBits += 8; // Last byte uses all 8 bits
+    } else {
+        totalBits += lastByteBits;
+    }
+    
+    // 4. Decode the data
+    std::vector<uint8_t> result;
+    result.reserve(size * 2); // Reasonable estimate
+    
+    // Start at root node
+    const auto& nodes = tree.nodes;
+    uint16_t current = tree.root;
+    
+    // Process each bit
+    for (size_t bitsProcessed = 0; bitsProcessed < totalBits; bitsProcessed++) {
+        // Most significant bit first
+        unsigned bit = (data[bitsProcessed / 8] >> (7 - bitsProcessed % 8)) & 1;
+        
+        // Follow the tree
+        current = nodes[current].child[bit];
+        if (current == HuffmanTree::NO_NODE) {
+            throw std::runtime_error("Invalid Huffman code - missing child node");
+        }
+        
+        // If leaf node, output symbol and reset to root
+        if (nodes[current].isLeaf()) {
+            result.push_back(nodes[current].symbol);
+            current = tree.root;
+        }
+    }
+    
+    // If we're not at the root, the data is incomplete
+    if (current != tree.root) {
+        throw std::runtime_error("Incomplete Huffman code at end of data");
+    }
+    
+    return result;
+}
+
 // --- Main Compression Function ---
 std::vector<uint8_t> HuffmanCompressor::compress(
     const std::vector<uint8_t>& data) const {
+    CompressionContext context;
+    return compress(data, context);
+}
+
+std::vector<uint8_t> HuffmanCompressor::compress(
+    const std::vector<uint8_t>& data, CompressionContext& context) const {
     
     // Handle empty input
     if (data.empty()) {
         return {};
     }
     
-    // 1. Build frequency map
-    FrequencyMap freqMap = buildFrequencyMap(data);
+    CompressionStats* stats = context.stats();
+    std::vector<uint8_t> result;
     
-    // 2. Build Huffman tree
-    auto treeRoot = buildHuffmanTree(freqMap);
-    
-    // 3. Generate codes for each symbol
-    HuffmanCodeMap codeMap;
-    generateCodes(treeRoot.get(), {}, codeMap);
-    
-    // Verify all symbols have codes
-    for (const auto& byte : data) {
-        if (codeMap.find(byte) == codeMap.end()) {
-            // Add a fallback code if somehow a symbol doesn't have one
-            codeMap[byte] = {false}; // Default to a single 0 bit
-        }
+    // Random-looking input is stored without building codes at all
+    if (!utils::profileData(data.data(), data.size()).likelyIncompressible()) {
+        result = dictionary_ ? compressWithDictionary(data, stats) : compressWithTable(data, stats);
     }
     
-    // 4. Serialize the frequency map
-    std::vector<uint8_t> result = serializeFrequencyMap(freqMap);
-    
-    // 5. Write the compressed data
-    std::vector<bool> encodedBits;
-    
-    // Pre-allocate enough space for encoded bits (rough estimate)
-    encodedBits.reserve(data.size() * 8); // Worst case: no compression
+    // So is input whose coded form turns out no smaller, which bounds the
+    // expansion to the stored marker
+    std::vector<uint8_t> stored;
+    if (dictionary_) {
+        stored.push_back(MODE_STORED);
+    } else {
+        stored.assign(std::begin(STORED_TABLE_MARKER), std::end(STORED_TABLE_MARKER));
+    }
+    if (!result.empty() && result.size() < data.size() + stored.size()) {
+        return result;
+    }
+    stored.insert(stored.end(), data.begin(), data.end());
+    if (stats) {
+        stats->storedBytes += data.size();
+    }
+    return stored;
+}
+
+std::vector<uint8_t> HuffmanCompressor::compressWithDictionary(
+    const std::vector<uint8_t>& data, CompressionStats* stats) const {
+    // Codes derived from the dictionary cost no table at all
+    StageTimer timer(stats, "huffman encoding", data.size());
+    uint8_t mode = usesParallelSegments(data.size()) ? MODE_DICTIONARY_SEGMENTS : MODE_DICTIONARY_CODES;
+    const CodeTable* codes = &dictionaryCodes_;
+    CodeTable limitedCodes;
+    if (dictionaryCodeLength_ > maxCodeLength_) {
+        buildLimitedCodes(dictionaryFrequencyMap(), maxCodeLength_, limitedCodes);
+        codes = &limitedCodes;
+        mode |= MODE_LIMITED_CODES;
+    }
+    std::vector<uint8_t> result = {mode};
+    if (mode & MODE_LIMITED_CODES) {
+        result.push_back(maxCodeLength_);
+    }
+    if (usesParallelSegments(data.size())) {
+        encodeSegments(data, *codes, result);
+    } else {
+        encodePayload(data.data(), data.size(), *codes, result);
+    }
+    timer.stop(result.size());
     
-    // Encode each symbol
-    for (const auto& byte : data) {
-        const auto& code = codeMap[byte];
-        encodedBits.insert(encodedBits.end(), code.begin(), code.end());
+    // Inputs that do not resemble the dictionary are better off with their own table
+    std::vector<uint8_t> withTable = compressWithTable(data, stats);
+    if (withTable.size() + 1 < result.size()) {
+        result.assign(1, MODE_EMBEDDED_TABLE);
+        result.insert(result.end(), withTable.begin(), withTable.end());
     }
+    return result;
+}
+
+std::vector<uint8_t> HuffmanCompressor::compressWithTable(
+    const std::vector<uint8_t>& data, CompressionStats* stats) const {
+    StageTimer tableTimer(stats, "huffman table", data.size());
     
-    // Convert bits to bytes (8 bits per byte)
-    size_t fullByteCount = encodedBits.size() / 8;
-    uint8_t remainingBits = encodedBits.size() % 8;
+    // 1. Build frequency map
+    bool segmented = usesParallelSegments(data.size());
+    FrequencyMap freqMap = segmented ? buildFrequencyMapParallel(data) : buildFrequencyMap(data);
+    // A single symbol is restored from its count alone
+    segmented = segmented && freqMap.size() > 1;
     
-    // Add number of bits in the last byte (or 0 if perfectly aligned)
-    result.push_back(remainingBits == 0 ? 0 : remainingBits);
+    // 2. Build Huffman tree
+    HuffmanTree tree;
+    buildHuffmanTree(freqMap, tree);
+    
+    // 3. Generate codes for each symbol; every byte of the input gets one.
+    // Trees deeper than the limit give way to length-limited codes
+    CodeTable codes;
+    bool limited = generateCodes(tree, maxCodeLength_, codes) > maxCodeLength_;
+    if (limited) {
+        buildLimitedCodes(freqMap, maxCodeLength_, codes);
+    }
     
-    // Process full bytes
-    for (size_t i = 0; i < fullByteCount; i++) {
-        uint8_t byte = 0;
-        for (size_t bit = 0; bit < 8; bit++) {
-            if (encodedBits[i * 8 + bit]) {
-                byte |= (1 << (7 - bit));
-            }
-        }
-        result.push_back(byte);
+    // 4. Serialize the frequency map
+    std::vector<uint8_t> result;
+    uint8_t flags = (segmented ? TABLE_FLAG_SEGMENTED : 0) | (limited ? TABLE_FLAG_LIMITED_CODES : 0);
+    if (flags) {
+        result = {STORED_TABLE_MARKER[0], flags, STORED_TABLE_MARKER[2]};
+    }
+    if (limited) {
+        result.push_back(maxCodeLength_);
+    }
+    std::vector<uint8_t> table = serializeFrequencyMap(freqMap);
+    result.insert(result.end(), table.begin(), table.end());
+    tableTimer.stop(result.size());
+    if (stats) {
+        stats->entropyTableBytes += result.size();
     }
     
-    // Process remaining bits (if any)
-    if (remainingBits > 0) {
-        uint8_t byte = 0;
-        for (size_t bit = 0; bit < remainingBits; bit++) {
-            if (encodedBits[fullByteCount * 8 + bit]) {
-                byte |= (1 << (7 - bit));
-            }
-        }
-        result.push_back(byte);
+    // 5. Write the compressed data
+    StageTimer encodeTimer(stats, "huffman encoding", data.size());
+    if (segmented) {
+        encodeSegments(data, codes, result);
+    } else {
+        encodePayload(data.data(), data.size(), codes, result);
     }
+    encodeTimer.stop(result.size());
     
     return result;
 }
 
+size_t HuffmanCompressor::workingSetSize(size_t inputSize) const {
+    // Frequency map, tree and code strings for up to 256 symbols
+    const size_t tableBytes = 64 * 1024;
+    // Segment payloads are held until they are joined
+    size_t segmentBytes = usesParallelSegments(inputSize) ? inputSize : 0;
+    return (dictionary_ ? 6 : 4) * inputSize + segmentBytes + tableBytes;
+}
+
 // --- Main Decompression Function ---
 std::vector<uint8_t> HuffmanCompressor::decompress(
     const std::vector<uint8_t>& data) const {
+    CompressionContext context;
+    return decompress(data, context);
+}
+
+std::vector<uint8_t> HuffmanCompressor::decompress(
+    const std::vector<uint8_t>& data, CompressionContext& context) const {
     
     // Handle empty input
     if (data.empty()) {
         return {};
     }
     
+    StageTimer timer(context.stats(), "huffman decoding", data.size());
     try {
-        // 1. Read the frequency map
-        size_t offset = 0;
-        FrequencyMap freqMap;
-        
-        try {
-            freqMap = deserializeFrequencyMap(data, offset);
-        } catch (const std::exception& e) {
-            throw std::runtime_error(std::string("Failed to deserialize frequency map: ") + e.what());
-        }
-        
-        if (freqMap.empty()) {
-            return {}; // No symbols defined, return empty result
-        }
-        
-        // 2. Rebuild the Huffman tree
-        auto treeRoot = buildHuffmanTree(freqMap);
-        if (!treeRoot) {
-            return {}; // No data to decompress
-        }
-        
-        // 3. Validate the data
-        if (offset >= data.size()) {
-            throw std::runtime_error("Unexpected end of compressed data");
-        }
-        
-        // 4. Get bit count in last byte
-        uint8_t lastByteBits = data[offset++];
-        if (lastByteBits > 7) {
-            throw std::runtime_error("Invalid bit count in last byte (must be 0-7)");
-        }
-        
-        // 5. Calculate total number of bits in encoded data
-        size_t dataByteCount = data.size() - offset;
-        if (dataByteCount == 0) {
-            return {}; // No encoded bits
-        }
-        
-        size_t totalBits = (dataByteCount - 1) * 8;
-        if (lastByteBits == 0 && dataByteCount > 0) {
-            totalBits += 8; // Last byte uses all 8 bits
-        } else {
-            totalBits += lastByteBits;
-        }
-        
-        // 6. Special case for single-symbol input
-        if (freqMap.size() == 1) {
-            auto it = freqMap.begin();
-            uint64_t count = it->second;
-            uint8_t symbol = it->first;
-            std::vector<uint8_t> result(count, symbol);
-            return result;
-        }
-        
-        // 7. Decode the data
         std::vector<uint8_t> result;
-        result.reserve(data.size() * 2); // Reasonable estimate
-        
-        // Start at root node
-        const HuffmanNode* currentNode = treeRoot.get();
-        
-        // Process each bit
-        for (size_t bitsProcessed = 0; bitsProcessed < totalBits; bitsProcessed++) {
-            // Calculate byte index and bit position
-            size_t byteIndex = offset + bitsProcessed / 8;
-            if (byteIndex >= data.size()) {
-                throw std::runtime_error("Truncated data - not enough bytes for encoded bits");
+        if (!dictionary_) {
+            if (hasTableMarker(data, 0) && data[1] == 0) {
+                result.assign(data.begin() + TABLE_MARKER_SIZE, data.end());
+            } else {
+                result = decompressWithTable(data, 0);
             }
-            
-            uint8_t bitPos = 7 - (bitsProcessed % 8); // Most significant bit first
-            
-            // Get the bit
-            bool bit = (data[byteIndex] & (1 << bitPos)) != 0;
-            
-            // Follow the tree
-            if (bit) {
-                if (!currentNode->right) {
-                    throw std::runtime_error("Invalid Huffman code - missing right node");
+        } else {
+            uint8_t mode = data[0];
+            if (mode == MODE_STORED) {
+                result.assign(data.begin() + 1, data.end());
+            } else if (mode == MODE_EMBEDDED_TABLE) {
+                result = decompressWithTable(data, 1);
+            } else if ((mode & ~MODE_LIMITED_CODES) == MODE_DICTIONARY_CODES ||
+                       (mode & ~MODE_LIMITED_CODES) == MODE_DICTIONARY_SEGMENTS) {
+                size_t offset = 1;
+                const HuffmanTree* tree = dictionaryTree_.get();
+                HuffmanTree limitedTree;
+                if (mode & MODE_LIMITED_CODES) {
+                    uint8_t maxLength = readCodeLengthLimit(data, offset);
+                    CodeTable limitedCodes;
+                    buildLimitedCodes(dictionaryFrequencyMap(), maxLength, limitedCodes);
+                    buildTreeFromCodes(limitedCodes, limitedTree);
+                    tree = &limitedTree;
                 }
-                currentNode = currentNode->right.get();
-            } else {
-                if (!currentNode->left) {
-                    throw std::runtime_error("Invalid Huffman code - missing left node");
+                if ((mode & ~MODE_LIMITED_CODES) == MODE_DICTIONARY_SEGMENTS) {
+                    result = decodeSegments(data, offset, *tree);
+                } else {
+                    result = decodePayload(data.data() + offset, data.size() - offset, *tree);
                 }
-                currentNode = currentNode->left.get();
-            }
-            
-            // If leaf node, output symbol and reset to root
-            if (!currentNode->left && !currentNode->right) {
-                result.push_back(currentNode->data);
-                currentNode = treeRoot.get();
+            } else {
+                throw std::runtime_error("Unknown Huffman dictionary mode: " + std::to_string(mode));
             }
         }
-        
-        // If we're not at the root or a leaf, the data is incomplete
-        if (currentNode != treeRoot.get() && (currentNode->left || currentNode->right)) {
-            throw std::runtime_error("Incomplete Huffman code at end of data");
-        }
-        
+        timer.stop(result.size());
         return result;
     } catch (const std::exception& e) {
         std::cerr << "Error during Huffman decompression: " << e.what() << std::endl;
@@ -538,4 +836,60 @@ std::vector<uint8_t> HuffmanCompressor::decompress(
     }
 }
 
-} // namespace compression
\ No newline at end of file
+std::vector<uint8_t> HuffmanCompressor::decompressWithTable(
+    const std::vector<uint8_t>& data, size_t offset) const {
+    
+    uint8_t flags = 0;
+    if (hasTableMarker(data, offset)) {
+        flags = data[offset + 1];
+        if (flags == 0 || (flags & ~KNOWN_TABLE_FLAGS)) {
+            throw std::runtime_error("Unknown Huffman table flags: " + std::to_string(flags));
+        }
+        offset += TABLE_MARKER_SIZE;
+    }
+    bool segmented = flags & TABLE_FLAG_SEGMENTED;
+    uint8_t maxLength = 0;
+    if (flags & TABLE_FLAG_LIMITED_CODES) {
+        maxLength = readCodeLengthLimit(data, offset);
+    }
+    
+    // 1. Read the frequency map
+    FrequencyMap freqMap;
+    
+    try {
+        freqMap = deserializeFrequencyMap(data, offset);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("Failed to deserialize frequency map: ") + e.what());
+    }
+    
+    if (freqMap.empty()) {
+        return {}; // No symbols defined, return empty result
+    }
+    
+    // 2. Rebuild the Huffman tree
+    HuffmanTree tree;
+    if (maxLength) {
+        CodeTable codes;
+        buildLimitedCodes(freqMap, maxLength, codes);
+        buildTreeFromCodes(codes, tree);
+    } else {
+        buildHuffmanTree(freqMap, tree);
+    }
+    
+    // 3. Special case for single-symbol input: the count says it all
+    if (freqMap.size() == 1) {
+        if (offset >= data.size()) {
+            throw std::runtime_error("Unexpected end of compressed data");
+        }
+        auto it = freqMap.begin();
+        return std::vector<uint8_t>(it->second, it->first);
+    }
+    
+    // 4. Decode the data
+    if (segmented) {
+        return decodeSegments(data, offset, tree);
+    }
+    return decodePayload(data.data() + offset, data.size() - offset, tree);
+}
+
+} // namespace compression
@@ -1,12 +1,45 @@
 #include <compression/Lz77Compressor.hpp>
+#include <compression/Dictionary.hpp>
+#include <compression/GearHash.hpp>
+#include <compression/DataProfile.hpp>
+#include <compression/ThreadPool.hpp>
+#include <compression/Varint.hpp>
 #include <stdexcept>
 #include <algorithm>
 #include <cstring>
 #include <queue>
 #include <limits>
+#include <string>
 
 namespace compression {
 
+namespace {
+
+size_t ceilLog2(size_t value) {
+    size_t bits = 0;
+    while ((size_t(1) << bits) < value) {
+        bits++;
+    }
+    return bits;
+}
+
+// Append length bytes copied from distance bytes back; the ranges may overlap
+void copyMatch(std::vector<uint8_t>& output, size_t distance, size_t length) {
+    size_t from = output.size() - distance;
+    output.resize(output.size() + length);
+    uint8_t* out = output.data() + output.size() - length;
+    const uint8_t* src = output.data() + from;
+    if (distance >= length) {
+        std::memcpy(out, src, length);
+    } else {
+        for (size_t j = 0; j < length; j++) {
+            out[j] = src[j];
+        }
+    }
+}
+
+} // anonymous namespace
+
 // Constructor
 Lz77Compressor::Lz77Compressor(
     size_t windowSize, 
@@ -16,13 +49,94 @@ Lz77Compressor::Lz77Compressor(
     bool useOptimalParsing,
     bool aggressiveMatching
 ) : windowSize_(windowSize),
-    minMatchLength_(minMatchLength),
+    minMatchLength_(std::max<size_t>(minMatchLength, 3)), // Shorter lengths are escape codes
     maxMatchLength_(maxMatchLength),
     useGreedyParsing_(useGreedyParsing),
     useOptimalParsing_(useOptimalParsing),
     aggressiveMatching_(aggressiveMatching) {
 }
 
+std::shared_ptr<const Lz77Compressor::DigestedDictionary> Lz77Compressor::digestDictionary(
+    std::shared_ptr<const Dictionary> dictionary) const {
+    if (!dictionary) {
+        throw std::invalid_argument("Cannot digest a null dictionary");
+    }
+    
+    // Only the last window's worth of the dictionary is reachable
+    const auto& content = dictionary->content();
+    size_t windowSize = std::min({content.size(), windowSize_, MAX_ENCODED_DISTANCE});
+    
+    std::shared_ptr<DigestedDictionary> digested(new DigestedDictionary());
+    digested->dictionary_ = std::move(dictionary);
+    digested->window_.assign(content.end() - windowSize, content.end());
+    digested->hashBits_ = hashBits_;
+    digested->head_.assign(size_t(1) << hashBits_, 0u);
+    digested->prev_.assign(windowSize, 0u);
+    
+    // Full-width chains over every position whose hash lies inside the window
+    const auto& window = digested->window_;
+    for (size_t pos = 0; pos + HASH_BYTES <= window.size(); ++pos) {
+        uint32_t hash = hashTriplet(window, pos);
+        digested->prev_[pos] = digested->head_[hash];
+        digested->head_[hash] = static_cast<uint32_t>(pos + 1);
+    }
+    return digested;
+}
+
+void Lz77Compressor::setDictionary(std::shared_ptr<const Dictionary> dictionary) {
+    setDigestedDictionary(dictionary ? digestDictionary(std::move(dictionary)) : nullptr);
+}
+
+void Lz77Compressor::setDigestedDictionary(std::shared_ptr<const DigestedDictionary> digested) {
+    if (digested) {
+        size_t expectedWindow = std::min({digested->dictionary().content().size(), windowSize_, MAX_ENCODED_DISTANCE});
+        if (digested->window_.size() != expectedWindow || digested->hashBits_ != hashBits_) {
+            throw std::invalid_argument("Digested dictionary was built for a different LZ77 configuration");
+        }
+    }
+    dictionary_ = std::move(digested);
+}
+
+void Lz77Compressor::setLongDistanceWindow(size_t windowSize) {
+    if (windowSize > MAX_LONG_DISTANCE_WINDOW) {
+        throw std::invalid_argument("Long-distance window exceeds 2 GiB");
+    }
+    longDistanceWindow_ = windowSize;
+}
+
+void Lz77Compressor::setParallelBlockSize(size_t blockSize, ThreadPool* pool) {
+    if (blockSize != 0 && blockSize < MIN_PARALLEL_BLOCK_SIZE) {
+        throw std::invalid_argument("Parallel LZ77 blocks must be at least " +
+                                    std::to_string(MIN_PARALLEL_BLOCK_SIZE) + " bytes");
+    }
+    parallelBlockSize_ = blockSize;
+    pool_ = pool;
+}
+
+bool Lz77Compressor::usesParallelBlocks(size_t inputSize) const {
+    return parallelBlockSize_ > 0 && inputSize > parallelBlockSize_;
+}
+
+void Lz77Compressor::setLevel(int level) {
+    // Hash chain candidates searched per position, indexed by level
+    static constexpr size_t CHAIN_LENGTHS[MAX_LEVEL + 1] = {0, 4, 8, 16, 16, 32, 64, 128, 512, 4096};
+    if (level < MIN_LEVEL || level > MAX_LEVEL) {
+        throw std::invalid_argument("LZ77 level must be between " + std::to_string(MIN_LEVEL) +
+                                    " and " + std::to_string(MAX_LEVEL));
+    }
+    level_ = level;
+    maxHashChainLength_ = CHAIN_LENGTHS[level];
+    useGreedyParsing_ = level <= 3;
+}
+
+size_t Lz77Compressor::dictionaryPrefixSize() const {
+    return dictionary_ ? dictionary_->window_.size() : 0;
+}
+
+size_t Lz77Compressor::localSpan(size_t inputSize) const {
+    return inputSize + std::min(dictionaryPrefixSize(), HASH_BYTES - 1);
+}
+
 // Static method to convert length code to actual length
 uint32_t Lz77Compressor::getLengthFromCode(uint32_t code) {
     // Basic implementation - in a real deflate compressor this would 
@@ -51,7 +165,7 @@ uint32_t Lz77Compressor::getLengthFromCode(uint32_t code) {
 }
 
 // Improved hash function using the Murmur3 mixing steps
-uint32_t Lz77Compressor::hashTriplet(const std::vector<uint8_t>& data, size_t pos) const {
+uint32_t Lz77Compressor::hashTriplet(ByteSpan data, size_t pos) const {
     if (pos + 2 >= data.size()) {
         return 0;
     }
@@ -80,62 +194,258 @@ uint32_t Lz77Compressor::hashTriplet(const std::vector<uint8_t>& data, size_t po
     return h & ((1 << hashBits_) - 1);
 }
 
+// Hash table bits for an input: no point clearing 32K buckets for a 200-byte message
+size_t Lz77Compressor::effectiveHashBits(size_t inputSize) const {
+    size_t bits = 8;
+    while (bits < hashBits_ && (size_t(1) << bits) < inputSize) {
+        bits++;
+    }
+    return bits;
+}
+
+// Carve the head table and chain ring out of the context arena
+Lz77Compressor::HashChains Lz77Compressor::createHashChains(size_t inputSize, CompressionContext& context) const {
+    HashChains chains;
+    
+    size_t headSize = size_t(1) << effectiveHashBits(inputSize);
+    chains.hashMask = static_cast<uint32_t>(headSize - 1);
+    chains.head = context.allocate<uint32_t>(headSize);
+    std::fill(chains.head, chains.head + headSize, 0u);
+    
+    // The ring must cover every distance we can emit; entries are always
+    // written before they are read, so it needs no clearing
+    size_t ringSize = chainRingSize(inputSize);
+    chains.windowMask = ringSize - 1;
+    chains.prev = context.allocate<uint32_t>(ringSize);
+    
+    return chains;
+}
+
+// Power-of-two ring large enough for every distance reachable in this input
+size_t Lz77Compressor::chainRingSize(size_t inputSize) const {
+    size_t reach = std::min({windowSize_, MAX_ENCODED_DISTANCE, std::max<size_t>(inputSize, 1)});
+    size_t ringSize = 1;
+    while (ringSize < reach) {
+        ringSize <<= 1;
+    }
+    return ringSize;
+}
+
+size_t Lz77Compressor::scratchSize(size_t inputSize) const {
+    // Parallel blocks take their scratch from per-block contexts
+    return usesParallelBlocks(inputSize) ? 0 : serialScratchSize(inputSize);
+}
+
+size_t Lz77Compressor::serialScratchSize(size_t inputSize) const {
+    size_t longMatchBytes = 0;
+    if (longDistanceWindow_ > 0) {
+        size_t hashBits = 0;
+        size_t anchorBits = 0;
+        longMatchTableBits(inputSize + dictionaryPrefixSize(), hashBits, anchorBits);
+        longMatchBytes = (size_t(1) << hashBits) * sizeof(LongMatchEntry);
+    }
+    // With a dictionary, its window and the input are joined in the arena
+    size_t prefixSize = dictionaryPrefixSize();
+    size_t joinedWindow = prefixSize > 0 ? prefixSize + inputSize : 0;
+    inputSize = localSpan(inputSize);
+    size_t headSize = size_t(1) << effectiveHashBits(inputSize);
+    return (headSize + chainRingSize(inputSize)) * sizeof(uint32_t) + longMatchBytes + joinedWindow;
+}
+
+size_t Lz77Compressor::workingSetSize(size_t inputSize) const {
+    // Incompressible data yields one symbol per byte, and a growing vector
+    // briefly holds its old and its doubled buffer (3x); the encoded output
+    // grows the same way. A dictionary's joined window is part of the scratch.
+    size_t prefixSize = dictionaryPrefixSize();
+    if (usesParallelBlocks(inputSize)) {
+        // Every thread (the caller included) works on one block with its
+        // history, read in place, at a time; the encoded blocks and the
+        // result hold up to 3x the input
+        size_t threads = (pool_ ? pool_->size() : ThreadPool::shared().size()) + 1;
+        size_t blocks = (inputSize + parallelBlockSize_ - 1) / parallelBlockSize_;
+        size_t window = std::max(prefixSize, std::min(windowSize_, MAX_ENCODED_DISTANCE)) + parallelBlockSize_;
+        size_t perBlock = serialScratchSize(window) + 3 * parallelBlockSize_ * sizeof(Lz77Symbol) +
+                          3 * parallelBlockSize_;
+        return std::min(threads, blocks) * perBlock + 3 * inputSize;
+    }
+    return scratchSize(inputSize) + 3 * inputSize * sizeof(Lz77Symbol) + 3 * inputSize;
+}
+
+// The index covers the reachable span with one entry per anchor on average,
+// spacing anchors further apart once the table reaches its size limit
+void Lz77Compressor::longMatchTableBits(size_t inputSize, size_t& hashBits, size_t& anchorBits) const {
+    constexpr size_t MIN_ANCHOR_BITS = 6;
+    constexpr size_t MAX_HASH_BITS = 22;
+    size_t spanBits = ceilLog2(std::min(inputSize, longDistanceWindow_));
+    hashBits = std::clamp<size_t>(spanBits > MIN_ANCHOR_BITS ? spanBits - MIN_ANCHOR_BITS : 0, 8, MAX_HASH_BITS);
+    anchorBits = std::max(MIN_ANCHOR_BITS, spanBits > hashBits ? spanBits - hashBits : 0);
+}
+
+// Index content-defined anchors with a gear rolling hash and verify repeats.
+// The hash at an anchor covers exactly the preceding LONG_MATCH_BLOCK bytes,
+// so equal hashes at two anchors mean (almost certainly) equal blocks.
+std::vector<Lz77Compressor::LongMatch> Lz77Compressor::findLongMatches(
+    ByteSpan data, size_t start, CompressionContext& context) const {
+    std::vector<LongMatch> matches;
+    if (data.size() - start < LONG_MATCH_BLOCK) {
+        return matches;
+    }
+    
+    size_t hashBits = 0;
+    size_t anchorBits = 0;
+    longMatchTableBits(data.size(), hashBits, anchorBits);
+    size_t tableSize = size_t(1) << hashBits;
+    LongMatchEntry* table = context.allocate<LongMatchEntry>(tableSize);
+    std::fill(table, table + tableSize, LongMatchEntry{0, 0});
+    
+    uint64_t hash = 0;
+    size_t coveredUntil = start; // Bytes before this are already part of a long match
+    for (size_t i = 0; i < data.size(); ++i) {
+        hash = utils::GearHash::roll(hash, data[i]);
+        if (i + 1 < LONG_MATCH_BLOCK || !utils::GearHash::isBoundary(hash, static_cast<unsigned>(anchorBits))) {
+            continue;
+        }
+        
+        size_t blockStart = i + 1 - LONG_MATCH_BLOCK;
+        LongMatchEntry& entry = table[(hash * 0x9E3779B97F4A7C15ull) >> (64 - hashBits)];
+        LongMatchEntry previous = entry;
+        entry = {static_cast<uint32_t>(blockStart + 1), static_cast<uint32_t>(hash)};
+        if (previous.position == 0 || previous.check != static_cast<uint32_t>(hash) ||
+            blockStart < coveredUntil) {
+            continue;
+        }
+        
+        size_t candidate = previous.position - 1;
+        size_t distance = blockStart - candidate;
+        if (distance > longDistanceWindow_ ||
+            std::memcmp(&data[candidate], &data[blockStart], LONG_MATCH_BLOCK) != 0) {
+            continue;
+        }
+        
+        // Grow the verified block in both directions
+        size_t matchStart = blockStart;
+        while (matchStart > coveredUntil && matchStart - distance > 0 &&
+               data[matchStart - 1] == data[matchStart - 1 - distance]) {
+            matchStart--;
+        }
+        size_t matchEnd = blockStart + LONG_MATCH_BLOCK;
+        while (matchEnd < data.size() && data[matchEnd] == data[matchEnd - distance]) {
+            matchEnd++;
+        }
+        
+        matches.push_back({matchStart, matchEnd - matchStart, distance});
+        coveredUntil = matchEnd;
+    }
+    return matches;
+}
+
 // Update the hash table for efficient match finding
-void Lz77Compressor::updateHashTable(std::unordered_map<uint32_t, std::vector<size_t>>& hashTable, 
-                      const std::vector<uint8_t>& data, size_t pos) const {
+void Lz77Compressor::updateHashTable(HashChains& chains, ByteSpan data, size_t pos) const {
     if (pos + minMatchLength_ > data.size()) {
         return;
     }
 
-    uint32_t hash = hashTriplet(data, pos);
-    auto& positions = hashTable[hash];
-    
-    // Manage hash chain length - if chain is too long, keep more recent entries
-    if (positions.size() >= maxHashChainLength_) {
-        // Keep more recent entries for better match locality
-        positions.erase(positions.begin(), positions.begin() + positions.size() / 2);
-    }
+    uint32_t hash = hashTriplet(data, pos) & chains.hashMask;
     
-    positions.push_back(pos);
+    // Link the new position in front of the previous chain head
+    chains.prev[pos & chains.windowMask] = chains.head[hash];
+    chains.head[hash] = static_cast<uint32_t>(pos + 1);
 }
 
 // Find the best match at the current position with improved match scoring
 Lz77Compressor::Match Lz77Compressor::findBestMatchAt(
-    const std::vector<uint8_t>& data, 
+    ByteSpan data,
     size_t pos,
-    const std::unordered_map<uint32_t, std::vector<size_t>>& hashTable) const {
+    const HashChains& chains,
+    const RepeatOffsets* repeats) const {
     
     if (pos + minMatchLength_ > data.size()) {
         return Match();
     }
 
-    uint32_t hash = hashTriplet(data, pos);
-    auto it = hashTable.find(hash);
-    if (it == hashTable.end() || it->second.empty()) {
-        return Match();
-    }
-
     Match bestMatch;
-    size_t lookaheadLimit = std::min(maxMatchLength_, data.size() - pos);
+    size_t lookaheadLimit = std::min({maxMatchLength_, MAX_ENCODED_MATCH, data.size() - pos});
     
     // Start with a minimum viable score
     float bestScore = 0.5f; // Require matches to provide at least this benefit
     
-    // Prioritize longer matches and recently used positions
-    for (auto rIt = it->second.rbegin(); rIt != it->second.rend(); ++rIt) {
-        size_t candidatePos = *rIt;
+    // Repeat distances cost a few compares per position and hit often on
+    // structured data; one that already gives an excellent match makes the
+    // chain walk unnecessary
+    if (repeats) {
+        float repeatBonus = codesRepeatOffsets() ? REPEAT_MATCH_BONUS : 0.0f;
+        for (uint32_t distance : repeats->distances) {
+            if (distance > pos || distance > windowSize_ || distance > MAX_ENCODED_DISTANCE) {
+                continue;
+            }
+            size_t matchLength = 0;
+            while (matchLength < lookaheadLimit &&
+                   data[pos - distance + matchLength] == data[pos + matchLength]) {
+                matchLength++;
+            }
+            if (matchLength < minMatchLength_) {
+                continue;
+            }
+            float matchBenefit = matchScore(matchLength, distance) + repeatBonus;
+            if (matchBenefit > bestScore) {
+                bestMatch = Match(distance, matchLength, pos);
+                bestScore = matchBenefit;
+            }
+        }
+        if (bestMatch.length >= GOOD_REPEAT_MATCH_LENGTH) {
+            return bestMatch;
+        }
+    }
+
+#if COMPRESSION_ENABLE_STATS
+    if (chains.stats) {
+        chains.stats->matchSearches++;
+    }
+#endif
+    uint32_t fullHash = hashTriplet(data, pos);
+    uint32_t candidate = chains.head[fullHash & chains.hashMask];
+    
+    // Once the per-call chain runs out, continue in the dictionary's chain
+    const DigestedDictionary* dictionary = chains.dictionary;
+    bool inDictionary = false;
+    if (candidate == 0 && dictionary) {
+        candidate = dictionary->head_[fullHash];
+        inDictionary = true;
+    }
+    if (candidate == 0) {
+        return bestMatch;
+    }
+
+    // Walk the chain from the most recent position backwards
+    size_t steps = 0;
+    while (candidate != 0 && steps++ < maxHashChainLength_) {
+        size_t candidatePos = candidate - 1;
         
-        // Skip positions that would exceed the window size
-        if (candidatePos >= pos || pos - candidatePos > windowSize_ || pos - candidatePos <= 0) {
-            continue;
+        // Chains are ordered by recency, so once a candidate is out of the
+        // window (or not behind us) nothing further down can be used
+        if (candidatePos >= pos) {
+            break;
         }
         
         // Calculate the distance
         size_t distance = pos - candidatePos;
         
-        // Skip if the distance is invalid or too large to encode effectively
-        if (distance < 1 || distance > 32768) {
-            continue;
+        // Stop if the distance is too large to encode or outside the window
+        if (distance > windowSize_ || distance > MAX_ENCODED_DISTANCE) {
+            break;
+        }
+        
+        // Follow the chain before evaluating this candidate; a link that does
+        // not point strictly backwards was overwritten in the ring
+        if (inDictionary) {
+            candidate = dictionary->prev_[candidatePos];
+        } else {
+            uint32_t next = chains.prev[candidatePos & chains.windowMask];
+            candidate = (next != 0 && next - 1 < candidatePos) ? next : 0;
+            if (candidate == 0 && dictionary) {
+                candidate = dictionary->head_[fullHash];
+                inDictionary = true;
+            }
         }
         
         // Maximum match length is limited by available data and window size
@@ -153,32 +463,39 @@ Lz77Compressor::Match Lz77Compressor::findBestMatchAt(
             continue;
         }
         
-        // Calculate match benefit 
-        // Cost: 4 bytes for encoding match (marker + length + distance)
-        // Benefit: matchLength bytes saved
-        // Net benefit = matchLength - 4
-        float matchBenefit = static_cast<float>(matchLength) - 4.0f;
-        
-        // Extra benefit for very long matches
-        if (matchLength > 20) matchBenefit += 1.0f;
-        
-        // Penalty for large distances (more expensive to encode)
-        if (distance > 1024) matchBenefit -= 0.5f;
-        
+        float matchBenefit = matchScore(matchLength, distance);
         if (matchBenefit > bestScore) {
             bestMatch = Match(distance, matchLength, pos);
             bestScore = matchBenefit;
             
             // Early exit for excellent matches
-            if (matchLength > 64) {
+            if (matchLength > EXCELLENT_MATCH_LENGTH) {
                 break;
             }
         }
     }
     
+#if COMPRESSION_ENABLE_STATS
+    if (chains.stats) {
+        chains.stats->chainSteps += std::min(steps, maxHashChainLength_);
+    }
+#endif
     return bestMatch;
 }
 
+float Lz77Compressor::matchScore(size_t length, size_t distance) {
+    // Cost: 4 bytes for encoding match (marker + length + distance)
+    // Benefit: length bytes saved
+    float benefit = static_cast<float>(length) - 4.0f;
+    
+    // Extra benefit for very long matches
+    if (length > 20) benefit += 1.0f;
+    
+    // Penalty for large distances (more expensive to encode)
+    if (distance > 1024) benefit -= 0.5f;
+    return benefit;
+}
+
 // Calculate score for a match, prioritizing length and considering encoding overhead
 float Lz77Compressor::scoreMatch(const Match& match) const {
     if (match.length < minMatchLength_) {
@@ -203,51 +520,234 @@ float Lz77Compressor::scoreMatch(const Match& match) const {
 
 // Get the length code for encoding
 uint32_t Lz77Compressor::getLengthCode(size_t length) const {
-    // Simple linear mapping for now
-    return LENGTH_CODE_BASE + static_cast<uint32_t>(length - 3);
+    // Pick the largest code whose base length does not exceed the length,
+    // so every match maps into the [257, 285] range checked by isLength()
+    uint32_t code = LENGTH_CODE_BASE;
+    while (code < 285 && getLengthFromCode(code + 1) <= length) {
+        code++;
+    }
+    return code;
 }
 
 // Main compression logic
 std::vector<uint8_t> Lz77Compressor::compress(const std::vector<uint8_t>& data) const {
     if (data.empty()) return {};
     
+    CompressionContext context(scratchSize(data.size()));
+    return compress(data, context);
+}
+
+std::vector<uint8_t> Lz77Compressor::compress(const std::vector<uint8_t>& data,
+                                              CompressionContext& context) const {
+    if (data.empty()) return {};
+    if (data.size() >= std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("LZ77 input exceeds 4 GiB; split it into blocks");
+    }
+    if (usesParallelBlocks(data.size())) {
+        return compressParallel(data, context);
+    }
+    
+    size_t prefixSize = dictionaryPrefixSize();
+    if (prefixSize == 0) {
+        return compressBlock(data, 0, nullptr, context);
+    }
+    
+    // Parse the input as the continuation of the dictionary window, joined
+    // in the arena so small messages cost no heap allocation
+    CompressionContext::Scope scope(context);
+    uint8_t* window = context.allocate<uint8_t>(prefixSize + data.size());
+    std::memcpy(window, dictionary_->window_.data(), prefixSize);
+    std::memcpy(window + prefixSize, data.data(), data.size());
+    return compressBlock(ByteSpan(window, prefixSize + data.size()), prefixSize, dictionary_.get(), context);
+}
+
+std::vector<uint8_t> Lz77Compressor::compressBlock(ByteSpan data, size_t start,
+                                                   const DigestedDictionary* prefixChains,
+                                                   CompressionContext& context) const {
     // Compress to LZ77 symbols
-    std::vector<Lz77Symbol> symbols = compressToSymbols(data);
+    CompressionStats* stats = context.stats();
+    std::vector<Lz77Symbol> symbols;
+    {
+        StageTimer timer(stats, "lz77 match finding", data.size() - start);
+        symbols = compressToSymbols(data, start, context, prefixChains);
+        // The stage's output is the in-memory symbol stream
+        timer.setBytesOut(symbols.size() * sizeof(Lz77Symbol));
+    }
+    if (stats) {
+        for (const auto& symbol : symbols) {
+            if (symbol.isLiteral()) {
+                stats->literals++;
+            } else if (symbol.isLength()) {
+                stats->matches++;
+                stats->matchedBytes += symbol.length;
+            }
+        }
+    }
     
     // Encode symbols to bytes
-    return encodeSymbols(symbols);
+    StageTimer timer(stats, "lz77 encoding", data.size() - start);
+    std::vector<uint8_t> result = encodeSymbols(symbols);
+    timer.setBytesOut(result.size());
+    return result;
+}
+
+std::vector<uint8_t> Lz77Compressor::compressParallel(const std::vector<uint8_t>& data,
+                                                      CompressionContext& context) const {
+    ThreadPool& pool = pool_ ? *pool_ : ThreadPool::shared();
+    size_t blockCount = (data.size() + parallelBlockSize_ - 1) / parallelBlockSize_;
+    size_t history = std::min(windowSize_, MAX_ENCODED_DISTANCE);
+    
+    // Contexts are per thread, so each block collects its own counters
+    CompressionStats* stats = context.stats();
+    StageTimer timer(stats, "lz77 parallel blocks", data.size());
+    std::vector<std::vector<uint8_t>> encoded(blockCount);
+    std::vector<CompressionStats> blockStats(stats ? blockCount : 0);
+    
+    pool.parallelFor(blockCount, [&](size_t i) {
+        size_t blockStart = i * parallelBlockSize_;
+        size_t blockEnd = std::min(blockStart + parallelBlockSize_, data.size());
+        
+        // The first block follows the dictionary, if any, joined in the
+        // block's arena; the others read the window of input before them in
+        // place, indexed per block
+        const DigestedDictionary* prefixChains = nullptr;
+        size_t prefixSize = blockStart == 0 ? 0 : std::min(history, blockStart);
+        ByteSpan window(data.data() + blockStart - prefixSize, blockEnd - blockStart + prefixSize);
+        CompressionContext blockContext(serialScratchSize(window.size()));
+        if (stats) {
+            blockContext.enableStats();
+        }
+        if (blockStart == 0 && dictionary_) {
+            prefixChains = dictionary_.get();
+            prefixSize = dictionary_->window_.size();
+            uint8_t* joined = blockContext.allocate<uint8_t>(prefixSize + blockEnd);
+            std::memcpy(joined, dictionary_->window_.data(), prefixSize);
+            std::memcpy(joined + prefixSize, data.data(), blockEnd);
+            window = ByteSpan(joined, prefixSize + blockEnd);
+        }
+        encoded[i] = compressBlock(window, prefixSize, prefixChains, blockContext);
+        if (stats) {
+            blockStats[i] = *blockContext.stats();
+        }
+    });
+    
+    // Each block's stream continues the previous one, so plain concatenation decodes
+    size_t totalSize = 0;
+    for (const auto& block : encoded) {
+        totalSize += block.size();
+    }
+    std::vector<uint8_t> result;
+    result.reserve(totalSize);
+    for (auto& block : encoded) {
+        result.insert(result.end(), block.begin(), block.end());
+        std::vector<uint8_t>().swap(block);
+    }
+    for (const auto& counters : blockStats) {
+        stats->addCounters(counters);
+    }
+    timer.setBytesOut(result.size());
+    return result;
 }
 
 // Generate LZ77 symbols with lazy matching for better compression
-std::vector<Lz77Compressor::Lz77Symbol> Lz77Compressor::compressToSymbols(const std::vector<uint8_t>& data) const {
-    if (data.empty()) return {};
+std::vector<Lz77Compressor::Lz77Symbol> Lz77Compressor::compressToSymbols(
+    ByteSpan data, size_t start, CompressionContext& context,
+    const DigestedDictionary* prefixChains) const {
+    if (start >= data.size()) return {};
 
-    // Initialize hash table
-    std::unordered_map<uint32_t, std::vector<size_t>> hashTable;
-    hashTable.reserve(1 << (hashBits_ - 2));
-    
-    // Build initial hash table (preload)
-    for (size_t i = 0; i < std::min(data.size(), size_t(32768)); i++) {
-        if (i + minMatchLength_ <= data.size()) {
-            updateHashTable(hashTable, data, i);
-        }
+    // Hash chains are scratch memory; positions are inserted as the parser
+    // passes them, so only already-seen data can be referenced. Dictionary
+    // positions come prebuilt from the digest, except for the last few whose
+    // hash reaches into the input; other history is indexed here
+    CompressionContext::Scope scope(context);
+    size_t localStart = prefixChains ? start - std::min(start, HASH_BYTES - 1) : 0;
+    HashChains hashTable = createHashChains(data.size() - localStart, context);
+    hashTable.dictionary = prefixChains;
+    hashTable.stats = context.stats();
+    for (size_t pos = localStart; pos < start; ++pos) {
+        updateHashTable(hashTable, data, pos);
     }
     
     std::vector<Lz77Symbol> symbols;
-    symbols.reserve(data.size() / 2);
+    symbols.reserve((data.size() - start) / 2);
     
-    size_t currentPos = 0;
+    size_t currentPos = start;
+    
+    // Long matches found up front take priority once the parser reaches them
+    std::vector<LongMatch> longMatches;
+    if (longDistanceWindow_ > 0) {
+        longMatches = findLongMatches(data, start, context);
+    }
+    size_t nextLongMatch = 0;
+    
+    // Distances of the last matches, tried first at every position
+    RepeatOffsets repeats;
+    auto recordMatch = [&](const Lz77Symbol& match) {
+        if (hashTable.stats && repeats.find(match.distance) < RepeatOffsets::COUNT) {
+            hashTable.stats->repeatMatches++;
+        }
+        repeats.update(match.distance);
+        symbols.push_back(match);
+    };
+    
+    // Input up to probeEnd has been probed; up to skipEnd it looked random
+    size_t probeEnd = currentPos;
+    size_t skipEnd = currentPos;
     
     // Main compression loop using lazy matching
     while (currentPos < data.size()) {
+        if (nextLongMatch < longMatches.size() && currentPos >= longMatches[nextLongMatch].position) {
+            const LongMatch& longMatch = longMatches[nextLongMatch++];
+            size_t end = longMatch.position + longMatch.length;
+            // A regular match may already have consumed the head of this one
+            if (currentPos + LONG_MATCH_BLOCK / 4 <= end) {
+                Lz77Symbol lengthDist;
+                lengthDist.length = static_cast<uint32_t>(end - currentPos);
+                lengthDist.distance = static_cast<uint32_t>(longMatch.distance);
+                lengthDist.symbol = getLengthCode(lengthDist.length);
+                recordMatch(lengthDist);
+                if (hashTable.stats) {
+                    hashTable.stats->longMatches++;
+                }
+                
+                // Only the last window of a long match is reachable afterwards
+                size_t reach = std::min(windowSize_, MAX_ENCODED_DISTANCE);
+                for (size_t pos = std::max(currentPos, end > reach ? end - reach : 0); pos < end; pos++) {
+                    updateHashTable(hashTable, data, pos);
+                }
+                currentPos = end;
+            }
+            continue;
+        }
+        
+        // Spans that sample as random pass through as literals without being
+        // searched or indexed; long matches into them still apply above
+        if (currentPos >= probeEnd) {
+            probeEnd = std::min(currentPos + PROBE_SPAN, data.size());
+            auto profile = utils::profileData(data.data() + currentPos, probeEnd - currentPos,
+                                              PROBE_WINDOWS, PROBE_WINDOW_SIZE);
+            skipEnd = profile.likelyIncompressible() ? probeEnd : currentPos;
+        }
+        if (currentPos < skipEnd) {
+            Lz77Symbol literal;
+            literal.symbol = data[currentPos];
+            literal.literal = data[currentPos];
+            symbols.push_back(literal);
+            if (hashTable.stats) {
+                hashTable.stats->storedBytes++;
+            }
+            currentPos++;
+            continue;
+        }
+        
         // Find the best match at the current position
-        Match currentMatch = findBestMatchAt(data, currentPos, hashTable);
+        Match currentMatch = findBestMatchAt(data, currentPos, hashTable, &repeats);
         
         // Check if we have a good match
         if (currentMatch.length >= minMatchLength_ && currentMatch.length > 3) {
             // For lazy matching, look ahead to see if next position has a better match
             if (!useGreedyParsing_ && currentPos + 1 < data.size()) {
-                Match nextMatch = findBestMatchAt(data, currentPos + 1, hashTable);
+                Match nextMatch = findBestMatchAt(data, currentPos + 1, hashTable, &repeats);
                 
                 // If next position has a better match, output current byte as literal
                 if (nextMatch.length > currentMatch.length && 
@@ -260,6 +760,7 @@ std::vector<Lz77Compressor::Lz77Symbol> Lz77Compressor::compressToSymbols(const
                     symbols.push_back(literal);
                     
                     // Move to next position and continue
+                    updateHashTable(hashTable, data, currentPos);
                     currentPos++;
                     continue;
                 }
@@ -267,10 +768,10 @@ std::vector<Lz77Compressor::Lz77Symbol> Lz77Compressor::compressToSymbols(const
             
             // Use the current match
             Lz77Symbol lengthDist;
-            lengthDist.symbol = LENGTH_CODE_BASE + (currentMatch.length - 3);
-            lengthDist.distance = currentMatch.distance;
-            lengthDist.length = currentMatch.length;
-            symbols.push_back(lengthDist);
+            lengthDist.symbol = getLengthCode(currentMatch.length);
+            lengthDist.distance = static_cast<uint32_t>(currentMatch.distance);
+            lengthDist.length = static_cast<uint32_t>(currentMatch.length);
+            recordMatch(lengthDist);
             
             // Skip the matched bytes
             for (size_t i = 0; i < currentMatch.length; i++) {
@@ -308,10 +809,43 @@ std::vector<uint8_t> Lz77Compressor::encodeSymbols(const std::vector<Lz77Symbol>
     // Reserve conservatively to avoid reallocations
     result.reserve(symbols.size());
     
-    for (const auto& symbol : symbols) {
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        const auto& symbol = symbols[i];
         if (symbol.isLiteral()) {
-            // For literals, directly output the byte (0-255)
-            result.push_back(static_cast<uint8_t>(symbol.symbol));
+            size_t runEnd = i;
+            size_t markers = 0;
+            while (runEnd < symbols.size() && symbols[runEnd].isLiteral()) {
+                markers += symbols[runEnd].symbol == MATCH_MARKER;
+                runEnd++;
+            }
+            size_t runLength = runEnd - i;
+            
+            if (markers > 2 + utils::varintSize(runLength)) {
+                // Stored raw, the run costs a fixed header instead of one
+                // escape per marker byte, which bounds random data's growth
+                result.push_back(MATCH_MARKER);
+                result.push_back(ESCAPE_STORED);
+                utils::writeVarint(result, runLength);
+                for (size_t j = i; j < runEnd; ++j) {
+                    result.push_back(static_cast<uint8_t>(symbols[j].symbol));
+                }
+            } else {
+                // For literals, directly output the byte (0-255); the marker byte is escaped
+                for (size_t j = i; j < runEnd; ++j) {
+                    result.push_back(static_cast<uint8_t>(symbols[j].symbol));
+                    if (symbols[j].symbol == MATCH_MARKER) {
+                        result.push_back(ESCAPE_LITERAL);
+                    }
+                }
+            }
+            i = runEnd - 1;
+        } else if (symbol.isLength() &&
+                   (symbol.length > MAX_ENCODED_MATCH || symbol.distance > MAX_ENCODED_DISTANCE)) {
+            // Long-distance or very long match: escape followed by two varints
+            result.push_back(MATCH_MARKER);
+            result.push_back(ESCAPE_LONG_MATCH);
+            utils::writeVarint(result, symbol.length);
+            utils::writeVarint(result, symbol.distance);
         } else if (symbol.isLength()) {
             // For matches, use a special format:
             // First byte: 0xFF (marker)
@@ -335,15 +869,43 @@ std::vector<uint8_t> Lz77Compressor::encodeSymbols(const std::vector<Lz77Symbol>
 std::vector<uint8_t> Lz77Compressor::decompress(const std::vector<uint8_t>& data) const {
     if (data.empty()) return {};
     
+    // Matches may reach back into the dictionary, so decode after its tail
+    size_t prefixSize = dictionaryPrefixSize();
     std::vector<uint8_t> result;
     // Pre-allocate some space to reduce reallocations
-    result.reserve(data.size() * 2);
+    result.reserve(prefixSize + data.size() * 2);
+    if (prefixSize > 0) {
+        result.insert(result.end(), dictionary_->window_.begin(), dictionary_->window_.end());
+    }
     
     size_t i = 0;
     while (i < data.size()) {
         uint8_t currentByte = data[i++];
         
-        if (currentByte == 0xFF) {
+        if (currentByte == MATCH_MARKER && i < data.size() && data[i] == ESCAPE_LITERAL) {
+            // Escaped literal 0xFF
+            result.push_back(MATCH_MARKER);
+            i++;
+        } else if (currentByte == MATCH_MARKER && i < data.size() && data[i] == ESCAPE_LONG_MATCH) {
+            // Long match: unlike short matches, a damaged one cannot be padded
+            // with placeholders since its length is unbounded
+            i++;
+            uint64_t length = utils::readVarint(data, i, "LZ77");
+            uint64_t distance = utils::readVarint(data, i, "LZ77");
+            if (distance == 0 || distance > result.size() || length > std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error("Invalid long-distance match");
+            }
+            copyMatch(result, distance, length);
+        } else if (currentByte == MATCH_MARKER && i < data.size() && data[i] == ESCAPE_STORED) {
+            // Stored literal run
+            i++;
+            uint64_t length = utils::readVarint(data, i, "LZ77");
+            if (length > data.size() - i) {
+                throw std::runtime_error("Truncated stored literal run");
+            }
+            result.insert(result.end(), data.begin() + i, data.begin() + i + length);
+            i += length;
+        } else if (currentByte == MATCH_MARKER) {
             // This is a match pattern (marker 0xFF)
             // Check for truncated data
             if (i + 2 >= data.size()) {
@@ -379,19 +941,15 @@ std::vector<uint8_t> Lz77Compressor::decompress(const std::vector<uint8_t>& data
                 continue;
             }
             
-            // Copy bytes from the output buffer
-            size_t startPos = result.size() - distance;
-            for (size_t j = 0; j < length; j++) {
-                // Handle overlapping copy correctly using modulo
-                uint8_t byte = result[startPos + (j % distance)];
-                result.push_back(byte);
-            }
+            // Copy bytes from the output buffer, handling overlapping copies
+            copyMatch(result, distance, length);
         } else {
             // This is a literal byte
             result.push_back(currentByte);
         }
     }
     
+    result.erase(result.begin(), result.begin() + prefixSize);
     return result;
 }
 
@@ -0,0 +1,521 @@
+#include <compression/LzhCompressor.hpp>
+#include <compression/HuffmanCoder.hpp>
+#include <compression/Varint.hpp>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace compression {
+
+namespace {
+
+// Values below DIRECT_VALUES are their own bucket. Larger ones are bucketed
+// by bit length and the bit after the leading one, and the bits below that
+// follow the bucket's code raw
+constexpr uint32_t DIRECT_VALUES = 16;
+constexpr unsigned DIRECT_BITS = 4;
+constexpr size_t VALUE_CODES = DIRECT_VALUES + 2 * (32 - DIRECT_BITS);
+constexpr size_t LITERAL_CODES = 256;
+
+// Offset codes below REPEAT_CODES pick a recent distance; the value codes
+// of distance - 1 follow
+using RepeatOffsets = Lz77Compressor::RepeatOffsets;
+constexpr size_t REPEAT_CODES = RepeatOffsets::COUNT;
+constexpr size_t OFFSET_CODES = REPEAT_CODES + VALUE_CODES;
+
+// Shortest match the parser emits; lengths are coded above it
+constexpr uint32_t MIN_MATCH = 3;
+
+enum Stream : size_t { LITERALS, RUNS, LENGTHS, OFFSETS, STREAM_COUNT };
+constexpr size_t ALPHABET_SIZES[STREAM_COUNT] = {LITERAL_CODES, VALUE_CODES, VALUE_CODES, OFFSET_CODES};
+
+// Code table kinds
+constexpr uint8_t TABLE_UNUSED = 0;
+constexpr uint8_t TABLE_HUFFMAN = 1;
+constexpr uint8_t TABLE_RAW = 2; // Literals only: every byte is its own 8-bit code
+
+// Append length bytes copied from distance bytes back; the ranges may overlap
+void copyMatch(std::vector<uint8_t>& output, size_t distance, size_t length) {
+    size_t from = output.size() - distance;
+    output.resize(output.size() + length);
+    uint8_t* out = output.data() + output.size() - length;
+    const uint8_t* src = output.data() + from;
+    if (distance >= length) {
+        std::memcpy(out, src, length);
+    } else {
+        for (size_t j = 0; j < length; j++) {
+            out[j] = src[j];
+        }
+    }
+}
+
+unsigned floorLog2(uint32_t value) {
+    unsigned bits = 0;
+    while (value >>= 1) {
+        bits++;
+    }
+    return bits;
+}
+
+// A value's bucket and the raw bits that follow its code
+struct ValueCode {
+    uint32_t code;
+    uint32_t extra;
+    unsigned extraBits;
+};
+
+ValueCode valueCode(uint32_t value) {
+    if (value < DIRECT_VALUES) {
+        return {value, 0, 0};
+    }
+    unsigned extraBits = floorLog2(value) - 1;
+    uint32_t code = DIRECT_VALUES + 2 * (extraBits + 1 - DIRECT_BITS) + ((value >> extraBits) & 1);
+    return {code, value & ((uint32_t(1) << extraBits) - 1), extraBits};
+}
+
+// Packs codes most significant bit first; at most 7 bits stay behind
+// between writes, so a 32-bit write always fits the accumulator
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& output) : output_(output) {}
+
+    void write(uint32_t bits, unsigned count) {
+        pending_ = (pending_ << count) | bits;
+        pendingBits_ += count;
+        while (pendingBits_ >= 8) {
+            pendingBits_ -= 8;
+            output_.push_back(static_cast<uint8_t>(pending_ >> pendingBits_));
+        }
+    }
+
+    // Pads the last byte with zero bits
+    void flush() {
+        if (pendingBits_ > 0) {
+            output_.push_back(static_cast<uint8_t>(pending_ << (8 - pendingBits_)));
+            pendingBits_ = 0;
+        }
+    }
+
+private:
+    std::vector<uint8_t>& output_;
+    uint64_t pending_ = 0;
+    unsigned pendingBits_ = 0;
+};
+
+// Reads what BitWriter wrote. Reading past the end yields zero bits, so
+// decoding corrupt input stays in bounds; overrun() tells afterwards
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    // The next count bits (1 to 32) without consuming them
+    uint32_t peek(unsigned count) {
+        if (count > available_) {
+            refill();
+        }
+        return static_cast<uint32_t>(buffer_ >> (64 - count));
+    }
+
+    void skip(unsigned count) {
+        buffer_ <<= count;
+        available_ -= count;
+    }
+
+    uint32_t read(unsigned count) {
+        if (count == 0) return 0;
+        uint32_t bits = peek(count);
+        skip(count);
+        return bits;
+    }
+
+    // Whether more bits were consumed than the stream holds
+    bool overrun() const { return position_ * 8 - available_ > size_ * 8; }
+
+private:
+    void refill() {
+        while (available_ <= 56) {
+            uint64_t byte = position_ < size_ ? data_[position_] : 0;
+            buffer_ |= byte << (56 - available_);
+            available_ += 8;
+            position_++;
+        }
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t position_ = 0;
+    uint64_t buffer_ = 0; // Unread bits, left-aligned
+    unsigned available_ = 0;
+};
+
+// Canonical code of one stream
+struct CodeTable {
+    uint8_t kind = TABLE_UNUSED;
+    size_t symbolCount = 0; // Highest coded symbol plus one
+    std::array<uint32_t, LITERAL_CODES> bits{};
+    std::array<uint8_t, LITERAL_CODES> lengths{};
+};
+
+// Codes of one length are consecutive in symbol order and shorter codes come
+// first, as in HuffmanCoder::buildCanonicalCodes()
+void assignCanonicalCodes(CodeTable& table) {
+    std::array<uint32_t, LzhCompressor::MAX_CODE_LENGTH + 1> counts{};
+    for (size_t symbol = 0; symbol < table.symbolCount; ++symbol) {
+        counts[table.lengths[symbol]]++;
+    }
+    counts[0] = 0;
+    std::array<uint32_t, LzhCompressor::MAX_CODE_LENGTH + 1> next{};
+    uint32_t code = 0;
+    for (unsigned length = 1; length <= LzhCompressor::MAX_CODE_LENGTH; ++length) {
+        code = (code + counts[length - 1]) << 1;
+        next[length] = code;
+    }
+    for (size_t symbol = 0; symbol < table.symbolCount; ++symbol) {
+        if (table.lengths[symbol] > 0) {
+            table.bits[symbol] = next[table.lengths[symbol]]++;
+        }
+    }
+}
+
+CodeTable rawLiteralTable() {
+    CodeTable table;
+    table.kind = TABLE_RAW;
+    table.symbolCount = LITERAL_CODES;
+    for (size_t symbol = 0; symbol < LITERAL_CODES; ++symbol) {
+        table.bits[symbol] = static_cast<uint32_t>(symbol);
+        table.lengths[symbol] = 8;
+    }
+    return table;
+}
+
+// Length-limited Huffman code for a stream; literals stay raw when coding
+// would not make them smaller
+CodeTable buildCodeTable(const std::array<uint64_t, LITERAL_CODES>& frequencies, Stream stream) {
+    FrequencyMap freqMap;
+    uint64_t count = 0;
+    for (size_t symbol = 0; symbol < ALPHABET_SIZES[stream]; ++symbol) {
+        if (frequencies[symbol] > 0) {
+            freqMap[static_cast<uint32_t>(symbol)] = frequencies[symbol];
+            count += frequencies[symbol];
+        }
+    }
+
+    CodeTable table;
+    if (freqMap.empty()) {
+        return table;
+    }
+    auto lengths = HuffmanCoder().buildLimitedCodeLengths(freqMap, LzhCompressor::MAX_CODE_LENGTH);
+    table.kind = TABLE_HUFFMAN;
+    table.symbolCount = lengths.rbegin()->first + 1;
+    uint64_t codedBits = 0;
+    for (const auto& [symbol, length] : lengths) {
+        table.lengths[symbol] = length;
+        codedBits += frequencies[symbol] * length;
+    }
+    if (stream == LITERALS &&
+        (codedBits + 7) / 8 + utils::varintSize(table.symbolCount) + (table.symbolCount + 1) / 2 >= count) {
+        return rawLiteralTable();
+    }
+    assignCanonicalCodes(table);
+    return table;
+}
+
+// Kind byte, then for Huffman tables the symbol count and 4-bit code lengths
+void writeCodeTable(std::vector<uint8_t>& output, const CodeTable& table) {
+    output.push_back(table.kind);
+    if (table.kind != TABLE_HUFFMAN) {
+        return;
+    }
+    utils::writeVarint(output, table.symbolCount);
+    for (size_t symbol = 0; symbol < table.symbolCount; symbol += 2) {
+        uint8_t high = symbol + 1 < table.symbolCount ? table.lengths[symbol + 1] : 0;
+        output.push_back(static_cast<uint8_t>(table.lengths[symbol] | (high << 4)));
+    }
+}
+
+// One lookup of the next tableBits bits gives the symbol and code length
+// (symbol << 4 | length); length 0 marks bits no code starts with
+struct DecodeTable {
+    bool raw = false; // Raw literals are copied, not looked up
+    unsigned tableBits = 1;
+    std::vector<uint16_t> entries = std::vector<uint16_t>(2, 0);
+};
+
+DecodeTable readCodeTable(const std::vector<uint8_t>& data, size_t& offset, Stream stream) {
+    if (offset >= data.size()) {
+        throw std::runtime_error("Truncated LZH code table");
+    }
+    DecodeTable decoder;
+    CodeTable table;
+    uint8_t kind = data[offset++];
+    if (kind == TABLE_UNUSED) {
+        return decoder;
+    } else if (kind == TABLE_RAW && stream == LITERALS) {
+        decoder.raw = true;
+        table = rawLiteralTable();
+    } else if (kind == TABLE_HUFFMAN) {
+        uint64_t symbolCount = utils::readVarint(data, offset, "LZH");
+        if (symbolCount == 0 || symbolCount > ALPHABET_SIZES[stream] ||
+            (symbolCount + 1) / 2 > data.size() - offset) {
+            throw std::runtime_error("Invalid LZH code table");
+        }
+        table.kind = TABLE_HUFFMAN;
+        table.symbolCount = static_cast<size_t>(symbolCount);
+        for (size_t symbol = 0; symbol < table.symbolCount; ++symbol) {
+            uint8_t packed = data[offset + symbol / 2];
+            table.lengths[symbol] = symbol % 2 ? packed >> 4 : packed & 0x0F;
+            if (table.lengths[symbol] > LzhCompressor::MAX_CODE_LENGTH) {
+                throw std::runtime_error("Invalid LZH code length");
+            }
+        }
+        offset += (table.symbolCount + 1) / 2;
+        assignCanonicalCodes(table);
+    } else {
+        throw std::runtime_error("Unknown LZH code table kind: " + std::to_string(kind));
+    }
+
+    unsigned longest = *std::max_element(table.lengths.begin(), table.lengths.end());
+    if (longest == 0) {
+        throw std::runtime_error("LZH code table has no codes");
+    }
+    decoder.tableBits = longest;
+    decoder.entries.assign(size_t(1) << longest, 0);
+    // An overfull set of lengths would run its codes past the table
+    uint64_t used = 0;
+    for (size_t symbol = 0; symbol < table.symbolCount; ++symbol) {
+        if (table.lengths[symbol] > 0) {
+            used += size_t(1) << (longest - table.lengths[symbol]);
+        }
+    }
+    if (used > decoder.entries.size()) {
+        throw std::runtime_error("Invalid LZH code lengths");
+    }
+    for (size_t symbol = 0; symbol < table.symbolCount; ++symbol) {
+        unsigned length = table.lengths[symbol];
+        if (length == 0) continue;
+        size_t span = size_t(1) << (longest - length);
+        size_t first = static_cast<size_t>(table.bits[symbol]) << (longest - length);
+        std::fill_n(decoder.entries.begin() + first, span, static_cast<uint16_t>(symbol << 4 | length));
+    }
+    return decoder;
+}
+
+uint32_t decodeSymbol(BitReader& reader, const DecodeTable& table) {
+    uint16_t entry = table.entries[reader.peek(table.tableBits)];
+    if ((entry & 0x0F) == 0) {
+        throw std::runtime_error("Invalid LZH code");
+    }
+    reader.skip(entry & 0x0F);
+    return entry >> 4;
+}
+
+// The offset code of a match, which then becomes the most recent distance
+ValueCode offsetCode(RepeatOffsets& repeats, uint32_t distance) {
+    size_t index = repeats.find(distance);
+    repeats.update(distance);
+    if (index < REPEAT_CODES) {
+        return {static_cast<uint32_t>(index), 0, 0};
+    }
+    ValueCode code = valueCode(distance - 1);
+    code.code += REPEAT_CODES;
+    return code;
+}
+
+void writeCode(BitWriter& writer, const CodeTable& table, const ValueCode& code) {
+    writer.write(table.bits[code.code], table.lengths[code.code]);
+    writer.write(code.extra, code.extraBits);
+}
+
+// The value of a bucket code, reading its extra bits
+uint64_t readExtra(BitReader& reader, uint32_t code) {
+    if (code < DIRECT_VALUES) {
+        return code;
+    }
+    unsigned extraBits = (code - DIRECT_VALUES) / 2 + DIRECT_BITS - 1;
+    uint64_t top = 2 | ((code - DIRECT_VALUES) & 1);
+    return (top << extraBits) | reader.read(extraBits);
+}
+
+uint64_t readValue(BitReader& reader, const DecodeTable& table) {
+    return readExtra(reader, decodeSymbol(reader, table));
+}
+
+uint64_t readOffset(BitReader& reader, const DecodeTable& table, RepeatOffsets& repeats) {
+    uint32_t code = decodeSymbol(reader, table);
+    uint64_t distance = code < REPEAT_CODES ? repeats.distances[code]
+                                            : readExtra(reader, code - REPEAT_CODES) + 1;
+    if (distance > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Invalid LZH offset");
+    }
+    repeats.update(static_cast<uint32_t>(distance));
+    return distance;
+}
+
+} // anonymous namespace
+
+LzhCompressor::LzhCompressor() : Lz77Compressor(32768, 3, 258, false, true, true) {
+}
+
+bool LzhCompressor::codesRepeatOffsets() const {
+    return true;
+}
+
+std::vector<uint8_t> LzhCompressor::encodeSymbols(const std::vector<Lz77Symbol>& symbols) const {
+    // Count every stream's symbols for its code
+    std::array<std::array<uint64_t, LITERAL_CODES>, STREAM_COUNT> frequencies{};
+    uint64_t decodedSize = 0;
+    uint64_t literalCount = 0;
+    uint64_t sequenceCount = 0;
+    uint32_t run = 0;
+    RepeatOffsets repeats;
+    for (const auto& symbol : symbols) {
+        if (symbol.isLiteral()) {
+            frequencies[LITERALS][symbol.symbol]++;
+            run++;
+            literalCount++;
+            decodedSize++;
+        } else if (symbol.isLength()) {
+            frequencies[RUNS][valueCode(run).code]++;
+            frequencies[LENGTHS][valueCode(symbol.length - MIN_MATCH).code]++;
+            frequencies[OFFSETS][offsetCode(repeats, symbol.distance).code]++;
+            run = 0;
+            decodedSize += symbol.length;
+            sequenceCount++;
+        }
+    }
+    if (decodedSize == 0) return {};
+
+    std::array<CodeTable, STREAM_COUNT> tables;
+    for (size_t stream = 0; stream < STREAM_COUNT; ++stream) {
+        tables[stream] = buildCodeTable(frequencies[stream], static_cast<Stream>(stream));
+    }
+
+    // Each sequence is a literal run and the match after it; literals after
+    // the last match are implied by the decoded size
+    std::array<std::vector<uint8_t>, STREAM_COUNT> streams;
+    streams[LITERALS].reserve(literalCount);
+    std::array<BitWriter, STREAM_COUNT> writers = {
+        BitWriter(streams[LITERALS]), BitWriter(streams[RUNS]),
+        BitWriter(streams[LENGTHS]), BitWriter(streams[OFFSETS])};
+    const CodeTable& literals = tables[LITERALS];
+    run = 0;
+    repeats = RepeatOffsets();
+    for (const auto& symbol : symbols) {
+        if (symbol.isLiteral()) {
+            writers[LITERALS].write(literals.bits[symbol.symbol], literals.lengths[symbol.symbol]);
+            run++;
+        } else if (symbol.isLength()) {
+            writeCode(writers[RUNS], tables[RUNS], valueCode(run));
+            writeCode(writers[LENGTHS], tables[LENGTHS], valueCode(symbol.length - MIN_MATCH));
+            writeCode(writers[OFFSETS], tables[OFFSETS], offsetCode(repeats, symbol.distance));
+            run = 0;
+        }
+    }
+
+    std::vector<uint8_t> result;
+    utils::writeVarint(result, decodedSize);
+    utils::writeVarint(result, sequenceCount);
+    for (size_t stream = 0; stream < STREAM_COUNT; ++stream) {
+        writers[stream].flush();
+        writeCodeTable(result, tables[stream]);
+        utils::writeVarint(result, streams[stream].size());
+    }
+    for (const auto& stream : streams) {
+        result.insert(result.end(), stream.begin(), stream.end());
+    }
+    return result;
+}
+
+void LzhCompressor::decodeBlock(const std::vector<uint8_t>& data, size_t& offset,
+                                std::vector<uint8_t>& output) {
+    uint64_t decodedSize = utils::readVarint(data, offset, "LZH");
+    uint64_t sequenceCount = utils::readVarint(data, offset, "LZH");
+    if (decodedSize == 0 || decodedSize >= std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Invalid LZH block size");
+    }
+
+    std::array<DecodeTable, STREAM_COUNT> tables;
+    std::array<uint64_t, STREAM_COUNT> sizes{};
+    for (size_t stream = 0; stream < STREAM_COUNT; ++stream) {
+        tables[stream] = readCodeTable(data, offset, static_cast<Stream>(stream));
+        sizes[stream] = utils::readVarint(data, offset, "LZH");
+    }
+    std::array<BitReader, STREAM_COUNT> readers = {
+        BitReader(nullptr, 0), BitReader(nullptr, 0), BitReader(nullptr, 0), BitReader(nullptr, 0)};
+    const uint8_t* literals = nullptr;
+    for (size_t stream = 0; stream < STREAM_COUNT; ++stream) {
+        if (sizes[stream] > data.size() - offset) {
+            throw std::runtime_error("LZH stream exceeds block");
+        }
+        readers[stream] = BitReader(data.data() + offset, static_cast<size_t>(sizes[stream]));
+        if (stream == LITERALS) {
+            literals = data.data() + offset;
+        }
+        offset += static_cast<size_t>(sizes[stream]);
+    }
+    // Every sequence codes at least one bit of offset
+    if (sequenceCount > sizes[OFFSETS] * 8) {
+        throw std::runtime_error("Invalid LZH sequence count");
+    }
+
+    // A corrupt size must not reserve gigabytes; long matches still grow the output
+    size_t end = output.size() + static_cast<size_t>(decodedSize);
+    output.reserve(std::min<size_t>(end, output.size() + data.size() * 8));
+    // Every literal takes at least one bit, raw ones a byte
+    uint64_t literalsLeft = tables[LITERALS].raw ? sizes[LITERALS] : sizes[LITERALS] * 8;
+    auto decodeLiterals = [&](uint64_t count) {
+        if (count > end - output.size() || count > literalsLeft) {
+            throw std::runtime_error("LZH literal run exceeds block");
+        }
+        size_t position = output.size();
+        output.resize(position + static_cast<size_t>(count));
+        if (tables[LITERALS].raw) {
+            std::memcpy(output.data() + position, literals + (sizes[LITERALS] - literalsLeft), count);
+        } else {
+            for (uint8_t* out = output.data() + position; out != output.data() + output.size(); ++out) {
+                *out = static_cast<uint8_t>(decodeSymbol(readers[LITERALS], tables[LITERALS]));
+            }
+        }
+        literalsLeft -= count;
+    };
+    RepeatOffsets repeats;
+    for (uint64_t i = 0; i < sequenceCount; ++i) {
+        decodeLiterals(readValue(readers[RUNS], tables[RUNS]));
+        uint64_t length = readValue(readers[LENGTHS], tables[LENGTHS]) + MIN_MATCH;
+        uint64_t distance = readOffset(readers[OFFSETS], tables[OFFSETS], repeats);
+        if (length > end - output.size() || distance > output.size()) {
+            throw std::runtime_error("Invalid LZH match");
+        }
+        copyMatch(output, static_cast<size_t>(distance), static_cast<size_t>(length));
+    }
+    decodeLiterals(end - output.size());
+
+    for (const auto& reader : readers) {
+        if (reader.overrun()) {
+            throw std::runtime_error("Truncated LZH stream");
+        }
+    }
+}
+
+std::vector<uint8_t> LzhCompressor::decompress(const std::vector<uint8_t>& data) const {
+    if (data.empty()) return {};
+
+    // Matches may reach back into the dictionary, so decode after its tail
+    std::vector<uint8_t> result;
+    size_t prefixSize = 0;
+    if (const DigestedDictionary* dictionary = digestedDictionary()) {
+        result = dictionary->window();
+        prefixSize = result.size();
+    }
+    size_t offset = 0;
+    while (offset < data.size()) {
+        decodeBlock(data, offset, result);
+    }
+    result.erase(result.begin(), result.begin() + prefixSize);
+    return result;
+}
+
+} // namespace compression
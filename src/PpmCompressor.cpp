@@ -0,0 +1,577 @@
+#include "compression/PpmCompressor.hpp"
+#include "compression/RangeCoder.hpp"
+#include "compression/StoredFallback.hpp"
+#include "compression/Varint.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace compression {
+
+namespace {
+
+// Frequencies follow PPM method D: a symbol enters a context at 1 and gains
+// 2 each time it is seen there. Contexts halve their counts once a symbol
+// passes MAX_FREQUENCY, which keeps every total below the coder's limit and
+// lets old statistics fade. Symbols that fade to 0 are no longer predicted
+// until they are seen again, so a few strays cannot tax a dominant symbol.
+constexpr uint16_t NEW_FREQUENCY = 1;
+constexpr uint16_t FREQUENCY_STEP = 2;
+constexpr uint16_t MAX_FREQUENCY = 124;
+static_assert(256 * (MAX_FREQUENCY + FREQUENCY_STEP) + 256 < utils::SYMBOL_RANGE_CODER_MAX_TOTAL,
+              "Context totals must fit the range coder");
+
+// --- Context tree ---
+
+// Nodes refer to each other by 32-bit offsets into the model memory; offset
+// 0 is never handed out and means "none"
+struct State {
+    uint8_t symbol;
+    uint8_t unused;
+    uint16_t frequency; // 0 once faded; the state keeps its place and successor
+    uint32_t successor; // Context one byte longer: this context followed by symbol
+};
+
+struct Context {
+    uint32_t suffix;  // Context one byte shorter, 0 for the order-0 root
+    uint32_t states;  // Array of 2^sizeClass states, count of them in use
+    uint16_t count;
+    uint16_t total;   // Sum of the state frequencies
+    uint8_t order;
+    uint8_t sizeClass;
+    uint16_t unused;
+};
+
+static_assert(sizeof(State) == 8 && sizeof(Context) == 16, "Tree nodes are packed into 8-byte units");
+
+// Escape estimates adapt like bit models: 1/(count + 1.5) of the way
+// towards each outcome, until count reaches SEE_LIMIT
+struct SeeCell {
+    uint16_t probability; // Of an escape, in 1/65536 units
+    uint16_t count;
+};
+
+constexpr unsigned SEE_HISTORIES = 8; // Previous byte's class, and whether it escaped
+constexpr unsigned SEE_CANDIDATE_BUCKETS = 8;
+constexpr unsigned SEE_MEAN_BUCKETS = 6;
+constexpr uint16_t SEE_LIMIT = 60;
+constexpr int32_t SEE_MIN_PROBABILITY = 16;
+constexpr int32_t SEE_MAX_PROBABILITY = 65520;
+constexpr uint32_t SCALED_TOTAL = 4096;
+
+// Rounding in estimateEscape() keeps at least half of SEE_MIN_PROBABILITY for
+// the escape, so every byte is coded with a probability of at most
+// 1 - SEE_MIN_PROBABILITY / 131072; this bounds how many bytes a stream can
+// claim to hold
+constexpr uint64_t MAX_BYTES_PER_CODED_BYTE = utils::maxEventsPerCodedByte(2 * 65536 / SEE_MIN_PROBABILITY);
+
+// Digits, letters, space and the rest escape differently after them
+unsigned symbolClass(uint8_t symbol) {
+    if (symbol >= '0' && symbol <= '9') return 0;
+    if ((symbol | 0x20) >= 'a' && (symbol | 0x20) <= 'z') return 1;
+    return symbol == ' ' ? 2 : 3;
+}
+
+constexpr size_t UNIT = 8;
+constexpr unsigned SIZE_CLASSES = 9; // State arrays of 1, 2, 4, ... 256 states
+
+// Most memory one symbol's update can take: a new context and a state
+// array grown to the largest class, for every order
+size_t updateReserve(unsigned order) {
+    return (order + 2) * (sizeof(Context) + (UNIT << (SIZE_CLASSES - 1)));
+}
+
+/**
+ * Hands out 8-byte-aligned blocks from one fixed block of memory. State
+ * arrays come in power-of-two size classes; arrays that grow return their
+ * old block to a free list for their class, and contexts are only released
+ * all at once by reset().
+ */
+class SubAllocator {
+public:
+    SubAllocator(uint8_t* memory, size_t size) : memory_(memory), size_(size) { reset(); }
+
+    void reset() {
+        next_ = UNIT;
+        std::fill(std::begin(freeLists_), std::end(freeLists_), 0);
+    }
+
+    size_t remaining() const { return size_ - next_; }
+
+    // Callers keep updateReserve() bytes free, so this cannot run out
+    uint32_t allocate(size_t bytes) {
+        uint32_t offset = static_cast<uint32_t>(next_);
+        next_ += bytes;
+        return offset;
+    }
+
+    uint32_t allocateStates(unsigned sizeClass) {
+        uint32_t head = freeLists_[sizeClass];
+        if (head == 0) {
+            return allocate(UNIT << sizeClass);
+        }
+        std::memcpy(&freeLists_[sizeClass], memory_ + head, sizeof(uint32_t));
+        return head;
+    }
+
+    void freeStates(uint32_t offset, unsigned sizeClass) {
+        std::memcpy(memory_ + offset, &freeLists_[sizeClass], sizeof(uint32_t));
+        freeLists_[sizeClass] = offset;
+    }
+
+    template <typename T>
+    T* at(uint32_t offset) {
+        return reinterpret_cast<T*>(memory_ + offset);
+    }
+
+private:
+    uint8_t* memory_;
+    size_t size_;
+    size_t next_ = UNIT;
+    uint32_t freeLists_[SIZE_CLASSES] = {};
+};
+
+/**
+ * Codes each byte in the longest context that has seen it and learns from
+ * it. Encoder and decoder run identical models, so the frequencies match.
+ */
+class PpmModel {
+public:
+    PpmModel(uint8_t* memory, size_t size, unsigned order)
+        : allocator_(memory, size), order_(order), reserve_(updateReserve(order)) {
+        restart();
+    }
+
+    void encode(utils::SymbolRangeEncoder& encoder, uint8_t symbol) {
+        beginSymbol();
+        for (uint32_t offset = maxContext_; offset != 0; offset = context(offset).suffix) {
+            Context& current = context(offset);
+            State* states = allocator_.at<State>(current.states);
+            uint32_t total = 0;
+            uint32_t cumulative = 0;
+            uint32_t candidates = 0;
+            int index = -1;
+            for (uint32_t i = 0; i < current.count; ++i) {
+                if (states[i].frequency == 0 || excluded(states[i].symbol)) continue;
+                if (states[i].symbol == symbol) {
+                    index = static_cast<int>(i);
+                    cumulative = total;
+                }
+                total += states[i].frequency;
+                ++candidates;
+            }
+            if (candidates > 0) {
+                EscapeEstimate estimate = estimateEscape(current.order, candidates, total);
+                if (index >= 0) {
+                    encoder.encode(cumulative * estimate.scale, states[index].frequency * estimate.scale,
+                                   estimate.total);
+                    learnEscape(estimate, false);
+                    update(symbol, offset, static_cast<uint32_t>(index));
+                    return;
+                }
+                encoder.encode(total * estimate.scale, estimate.escape, estimate.total);
+                learnEscape(estimate, true);
+                exclude(current);
+            }
+            escaped_[escapedCount_++] = offset;
+        }
+
+        // Order -1: every byte not yet ruled out is equally likely
+        uint32_t below = 0;
+        for (unsigned other = 0; other < symbol; ++other) {
+            below += !excluded(static_cast<uint8_t>(other));
+        }
+        encoder.encode(below, 1, 256 - excludedCount_);
+        update(symbol, 0, 0);
+    }
+
+    uint8_t decode(utils::SymbolRangeDecoder& decoder) {
+        beginSymbol();
+        for (uint32_t offset = maxContext_; offset != 0; offset = context(offset).suffix) {
+            Context& current = context(offset);
+            State* states = allocator_.at<State>(current.states);
+            uint32_t total = 0;
+            uint32_t candidates = 0;
+            for (uint32_t i = 0; i < current.count; ++i) {
+                if (states[i].frequency == 0 || excluded(states[i].symbol)) continue;
+                total += states[i].frequency;
+                ++candidates;
+            }
+            if (candidates > 0) {
+                EscapeEstimate estimate = estimateEscape(current.order, candidates, total);
+                uint32_t target = decoder.frequency(estimate.total) / estimate.scale;
+                if (target < total) {
+                    uint32_t cumulative = 0;
+                    for (uint32_t i = 0;; ++i) {
+                        if (states[i].frequency == 0 || excluded(states[i].symbol)) continue;
+                        if (target < cumulative + states[i].frequency) {
+                            decoder.decode(cumulative * estimate.scale, states[i].frequency * estimate.scale);
+                            learnEscape(estimate, false);
+                            uint8_t symbol = states[i].symbol;
+                            update(symbol, offset, i);
+                            return symbol;
+                        }
+                        cumulative += states[i].frequency;
+                    }
+                }
+                decoder.decode(total * estimate.scale, estimate.escape);
+                learnEscape(estimate, true);
+                exclude(current);
+            }
+            escaped_[escapedCount_++] = offset;
+        }
+
+        if (excludedCount_ == 256) {
+            throw std::runtime_error("Corrupt PPM stream: escaped past every symbol");
+        }
+        uint32_t target = decoder.frequency(256 - excludedCount_);
+        unsigned symbol = 0;
+        for (uint32_t rank = 0;; ++symbol) {
+            if (excluded(static_cast<uint8_t>(symbol))) continue;
+            if (rank++ == target) break;
+        }
+        decoder.decode(target, 1);
+        update(static_cast<uint8_t>(symbol), 0, 0);
+        return static_cast<uint8_t>(symbol);
+    }
+
+private:
+    Context& context(uint32_t offset) { return *allocator_.at<Context>(offset); }
+
+    void restart() {
+        allocator_.reset();
+        root_ = newContext(0, 0);
+        maxContext_ = root_;
+    }
+
+    uint32_t newContext(uint32_t suffix, unsigned order) {
+        uint32_t offset = allocator_.allocate(sizeof(Context));
+        context(offset) = Context{suffix, 0, 0, 0, static_cast<uint8_t>(order), 0, 0};
+        return offset;
+    }
+
+    void beginSymbol() {
+        if (++stamp_ == 0) {
+            std::fill(std::begin(exclusions_), std::end(exclusions_), 0);
+            stamp_ = 1;
+        }
+        excludedCount_ = 0;
+        escapedCount_ = 0;
+    }
+
+    // --- Escape estimation ---
+
+    struct EscapeEstimate {
+        SeeCell* cell;
+        uint32_t scale;  // Symbol frequencies are coded times this
+        uint32_t escape; // Escape frequency, on the scaled symbol total
+        uint32_t total;  // Scaled symbol total plus the escape
+    };
+
+    // Predicts the escape from what escapes did in similar contexts: same
+    // order, about as many candidate symbols, seen about as often, after a
+    // similar byte
+    EscapeEstimate estimateEscape(unsigned order, uint32_t candidates, uint32_t total) {
+        unsigned candidateBucket = candidates <= 4 ? candidates - 1
+                                 : candidates <= 6 ? 4 : candidates <= 10 ? 5 : candidates <= 20 ? 6 : 7;
+        uint32_t mean = total / candidates;
+        unsigned meanBucket = 0;
+        while (meanBucket < SEE_MEAN_BUCKETS - 1 && mean >= (2u << meanBucket)) {
+            ++meanBucket;
+        }
+        SeeCell* cell = &see_[history_][(order * SEE_CANDIDATE_BUCKETS + candidateBucket) * SEE_MEAN_BUCKETS +
+                                        meanBucket];
+        if (cell->count == 0) {
+            // Start from method D: one escape per distinct symbol
+            cell->probability = static_cast<uint16_t>(std::clamp<uint32_t>(
+                (candidates << 16) / (total + candidates), SEE_MIN_PROBABILITY, SEE_MAX_PROBABILITY));
+        }
+
+        // Small totals are scaled up so that unlikely escapes can get
+        // less than one count's worth of the range
+        uint32_t scale = std::max<uint32_t>(1, SCALED_TOTAL / total);
+        uint32_t symbols = total * scale;
+        uint64_t escape = static_cast<uint64_t>(cell->probability) * symbols / (65536 - cell->probability);
+        escape = std::clamp<uint64_t>(escape, 1, utils::SYMBOL_RANGE_CODER_MAX_TOTAL - 1 - symbols);
+        return {cell, scale, static_cast<uint32_t>(escape), symbols + static_cast<uint32_t>(escape)};
+    }
+
+    void learnEscape(const EscapeEstimate& estimate, bool escaped) {
+        SeeCell& cell = *estimate.cell;
+        int32_t target = escaped ? 65535 : 0;
+        int32_t probability = cell.probability;
+        probability += (target - probability) * 2 / (2 * static_cast<int32_t>(cell.count) + 3);
+        cell.probability = static_cast<uint16_t>(
+            std::clamp<int32_t>(probability, SEE_MIN_PROBABILITY, SEE_MAX_PROBABILITY));
+        if (cell.count < SEE_LIMIT) {
+            ++cell.count;
+        }
+    }
+
+    bool excluded(uint8_t symbol) const { return exclusions_[symbol] == stamp_; }
+
+    // Rules out the symbols of a context that escaped for the shorter ones
+    void exclude(const Context& current) {
+        State* states = allocator_.at<State>(current.states);
+        for (uint32_t i = 0; i < current.count; ++i) {
+            if (states[i].frequency != 0 && !excluded(states[i].symbol)) {
+                exclusions_[states[i].symbol] = stamp_;
+                ++excludedCount_;
+            }
+        }
+    }
+
+    // Revives symbol's faded state, or appends one, growing the array if it
+    // is full; returns its index
+    uint32_t addSymbol(Context& current, uint8_t symbol) {
+        State* states = allocator_.at<State>(current.states);
+        for (uint32_t i = 0; i < current.count; ++i) {
+            if (states[i].symbol == symbol) {
+                states[i].frequency = NEW_FREQUENCY;
+                current.total += NEW_FREQUENCY;
+                return i;
+            }
+        }
+        if (current.states == 0) {
+            current.states = allocator_.allocateStates(0);
+        } else if (current.count == (1u << current.sizeClass)) {
+            uint32_t grown = allocator_.allocateStates(current.sizeClass + 1);
+            std::memcpy(allocator_.at<State>(grown), allocator_.at<State>(current.states),
+                        current.count * sizeof(State));
+            allocator_.freeStates(current.states, current.sizeClass);
+            current.states = grown;
+            ++current.sizeClass;
+        }
+        allocator_.at<State>(current.states)[current.count] = State{symbol, 0, NEW_FREQUENCY, 0};
+        current.total += NEW_FREQUENCY;
+        return current.count++;
+    }
+
+    void rescale(Context& current) {
+        State* states = allocator_.at<State>(current.states);
+        current.total = 0;
+        for (uint32_t i = 0; i < current.count; ++i) {
+            states[i].frequency = static_cast<uint16_t>(states[i].frequency / 2);
+            current.total += states[i].frequency;
+        }
+    }
+
+    State& stateFor(uint32_t offset, uint8_t symbol) {
+        Context& current = context(offset);
+        State* states = allocator_.at<State>(current.states);
+        for (uint32_t i = 0;; ++i) {
+            if (states[i].symbol == symbol) return states[i];
+        }
+    }
+
+    // Learns symbol, coded in context found (0 for order -1) after escaping
+    // from escaped_, and moves to the context that now ends with it
+    void update(uint8_t symbol, uint32_t found, uint32_t index) {
+        history_ = symbolClass(symbol) * 2 + (escapedCount_ > 0);
+        if (allocator_.remaining() < reserve_) {
+            restart();
+            return;
+        }
+
+        // Contexts whose states may need a successor, longest first; each
+        // state index is that of symbol
+        uint32_t chain[PpmCompressor::MAX_ORDER + 2];
+        uint32_t chainIndex[PpmCompressor::MAX_ORDER + 2];
+        size_t length = 0;
+        for (size_t i = 0; i < escapedCount_; ++i) {
+            chain[length] = escaped_[i];
+            chainIndex[length++] = addSymbol(context(escaped_[i]), symbol);
+        }
+        if (found != 0) {
+            Context& current = context(found);
+            State* states = allocator_.at<State>(current.states);
+            states[index].frequency += FREQUENCY_STEP;
+            current.total += FREQUENCY_STEP;
+            // Frequent symbols drift to the front, where searches end sooner
+            if (index > 0 && states[index].frequency > states[index - 1].frequency) {
+                std::swap(states[index], states[index - 1]);
+                --index;
+            }
+            if (states[index].frequency > MAX_FREQUENCY) {
+                rescale(current);
+            }
+            chain[length] = found;
+            chainIndex[length++] = index;
+        }
+
+        // Give each new state the context one byte longer, shortest first
+        // so that each new context can link to the suffix just made. Below
+        // the found context every state already has its successor.
+        uint32_t successors[PpmCompressor::MAX_ORDER + 2] = {};
+        uint32_t shorter = 0;
+        for (size_t i = length; i-- > 0;) {
+            Context& current = context(chain[i]);
+            if (current.order >= order_) {
+                successors[i] = 0;
+                continue;
+            }
+            State& state = allocator_.at<State>(current.states)[chainIndex[i]];
+            if (state.successor == 0) {
+                uint32_t suffix = current.order == 0 ? root_ : shorter;
+                state.successor = newContext(suffix, current.order + 1);
+            }
+            successors[i] = shorter = state.successor;
+        }
+
+        // The longest context is at most order_ bytes; past that, drop its first byte
+        if (successors[0] != 0) {
+            maxContext_ = successors[0];
+        } else if (length > 1) {
+            maxContext_ = successors[1];
+        } else {
+            maxContext_ = stateFor(context(chain[0]).suffix, symbol).successor;
+        }
+    }
+
+    SubAllocator allocator_;
+    unsigned order_;
+    size_t reserve_;
+    uint32_t root_ = 0;
+    uint32_t maxContext_ = 0;
+
+    // Per-symbol state: contexts escaped from, and symbols they ruled out
+    uint32_t escaped_[PpmCompressor::MAX_ORDER + 1] = {};
+    size_t escapedCount_ = 0;
+    uint32_t exclusions_[256] = {};
+    uint32_t stamp_ = 0;
+    uint32_t excludedCount_ = 0;
+
+    unsigned history_ = 0; // Escape estimation context from the previous byte
+    SeeCell see_[SEE_HISTORIES][(PpmCompressor::MAX_ORDER + 1) * SEE_CANDIDATE_BUCKETS * SEE_MEAN_BUCKETS] = {};
+};
+
+} // anonymous namespace
+
+PpmCompressor::PpmCompressor(unsigned order, size_t memoryLimit) {
+    setOrder(order);
+    setMemoryLimit(memoryLimit);
+}
+
+void PpmCompressor::setOrder(unsigned order) {
+    if (order < MIN_ORDER || order > MAX_ORDER) {
+        throw std::invalid_argument("PPM order must be between " + std::to_string(MIN_ORDER) + " and " +
+                                    std::to_string(MAX_ORDER));
+    }
+    order_ = order;
+}
+
+void PpmCompressor::setMemoryLimit(size_t bytes) {
+    if (bytes < MIN_MEMORY_LIMIT || bytes > MAX_MEMORY_LIMIT) {
+        throw std::invalid_argument("PPM memory limit must be between 1 MiB and 1 GiB");
+    }
+    memoryLimit_ = bytes & ~((size_t(1) << 20) - 1);
+}
+
+size_t PpmCompressor::modelMemory(size_t inputSize, unsigned order, size_t memoryLimit) {
+    // A byte adds at most one context and one state per order; state arrays
+    // at most double. Inputs that cannot fill the limit get less.
+    size_t perByte = (order + 1) * (sizeof(Context) + 2 * sizeof(State));
+    size_t base = updateReserve(order) + (size_t(64) << 10);
+    if (inputSize >= (memoryLimit - base) / perByte) {
+        return memoryLimit;
+    }
+    return base + inputSize * perByte;
+}
+
+size_t PpmCompressor::scratchSize(size_t inputSize) const {
+    return modelMemory(inputSize, order_, memoryLimit_) + UNIT;
+}
+
+size_t PpmCompressor::workingSetSize(size_t inputSize) const {
+    return scratchSize(inputSize) + inputSize;
+}
+
+void PpmCompressor::encodeModeled(const std::vector<uint8_t>& data, std::vector<uint8_t>& output,
+                                  unsigned order, size_t memoryLimit, CompressionContext& context) {
+    CompressionContext::Scope scope(context);
+    size_t memory = modelMemory(data.size(), order, memoryLimit);
+    PpmModel model(reinterpret_cast<uint8_t*>(context.allocate<uint64_t>(memory / UNIT)), memory, order);
+    utils::SymbolRangeEncoder encoder(output);
+    for (uint8_t byte : data) {
+        model.encode(encoder, byte);
+    }
+    encoder.flush();
+}
+
+std::vector<uint8_t> PpmCompressor::decodeModeled(const uint8_t* data, size_t size, size_t originalSize,
+                                                  unsigned order, size_t memoryLimit,
+                                                  CompressionContext& context) {
+    CompressionContext::Scope scope(context);
+    size_t memory = modelMemory(originalSize, order, memoryLimit);
+    PpmModel model(reinterpret_cast<uint8_t*>(context.allocate<uint64_t>(memory / UNIT)), memory, order);
+    utils::SymbolRangeDecoder decoder(data, size);
+    std::vector<uint8_t> result(originalSize);
+    for (auto& byte : result) {
+        byte = model.decode(decoder);
+    }
+    return result;
+}
+
+std::vector<uint8_t> PpmCompressor::compress(const std::vector<uint8_t>& data) const {
+    CompressionContext context(scratchSize(data.size()));
+    return compress(data, context);
+}
+
+std::vector<uint8_t> PpmCompressor::compress(const std::vector<uint8_t>& data,
+                                             CompressionContext& context) const {
+    if (data.empty()) {
+        return {};
+    }
+
+    CompressionStats* stats = context.stats();
+    return utils::modelOrStore(data, stats, [&](std::vector<uint8_t>& result) {
+        StageTimer timer(stats, "ppm", data.size());
+        utils::writeVarint(result, data.size());
+        result.push_back(static_cast<uint8_t>(order_));
+        utils::writeVarint(result, memoryLimit_ >> 20);
+        encodeModeled(data, result, order_, memoryLimit_, context);
+        timer.stop(result.size());
+    });
+}
+
+std::vector<uint8_t> PpmCompressor::decompress(const std::vector<uint8_t>& data) const {
+    CompressionContext context;
+    return decompress(data, context);
+}
+
+std::vector<uint8_t> PpmCompressor::decompress(const std::vector<uint8_t>& data,
+                                               CompressionContext& context) const {
+    if (data.empty()) {
+        return {};
+    }
+
+    if (utils::isStoredStream(data, "PPM")) {
+        return std::vector<uint8_t>(data.begin() + 1, data.end());
+    }
+
+    size_t offset = 1;
+    uint64_t originalSize = utils::readVarint(data, offset, "PPM");
+    if (offset >= data.size()) {
+        throw std::runtime_error("Truncated PPM stream header");
+    }
+    unsigned order = data[offset++];
+    uint64_t memoryMiB = utils::readVarint(data, offset, "PPM");
+    if (order < MIN_ORDER || order > MAX_ORDER || memoryMiB < (MIN_MEMORY_LIMIT >> 20) ||
+        memoryMiB > (MAX_MEMORY_LIMIT >> 20)) {
+        throw std::runtime_error("Invalid PPM model parameters in stream");
+    }
+    if (originalSize / MAX_BYTES_PER_CODED_BYTE > data.size() - offset) {
+        throw std::runtime_error("PPM stream claims more data than it can hold");
+    }
+
+    StageTimer timer(context.stats(), "ppm decoding", data.size());
+    size_t memoryLimit = static_cast<size_t>(memoryMiB) << 20;
+    context.reserve(modelMemory(originalSize, order, memoryLimit) + UNIT);
+    auto result = decodeModeled(data.data() + offset, data.size() - offset, originalSize, order,
+                                memoryLimit, context);
+    timer.stop(result.size());
+    return result;
+}
+
+} // namespace compression
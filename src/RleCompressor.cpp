@@ -6,6 +6,13 @@ namespace compression {
 // Simple RLE format: [Count][Value][Count][Value]...
 // Count is stored as a single byte (unsigned char).
 // Max run length is 255.
+// A leading zero count (never a valid run) marks input stored as is.
+
+namespace {
+
+constexpr uint8_t STORED_MARKER = 0;
+
+} // anonymous namespace
 
 std::vector<uint8_t> RleCompressor::compress(const std::vector<uint8_t>& data) const {
     if (data.empty()) {
@@ -37,6 +44,13 @@ std::vector<uint8_t> RleCompressor::compress(const std::vector<uint8_t>& data) c
     compressed.push_back(count);
     compressed.push_back(current);
     
+    // Data without runs doubles in size; storing it costs one byte instead
+    if (compressed.size() > data.size() + 1) {
+        compressed.clear();
+        compressed.push_back(STORED_MARKER);
+        compressed.insert(compressed.end(), data.begin(), data.end());
+    }
+    
     return compressed;
 }
 
@@ -45,6 +59,10 @@ std::vector<uint8_t> RleCompressor::decompress(const std::vector<uint8_t>& data)
         return {};
     }
     
+    if (data[0] == STORED_MARKER) {
+        return std::vector<uint8_t>(data.begin() + 1, data.end());
+    }
+    
     if (data.size() % 2 != 0) {
         throw std::runtime_error("Invalid RLE data: length must be even");
     }
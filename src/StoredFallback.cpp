@@ -0,0 +1,38 @@
+#include "compression/StoredFallback.hpp"
+#include "compression/DataProfile.hpp"
+#include <stdexcept>
+#include <string>
+
+namespace compression {
+namespace utils {
+
+std::vector<uint8_t> modelOrStore(const std::vector<uint8_t>& data, CompressionStats* stats,
+                                  const std::function<void(std::vector<uint8_t>&)>& encode) {
+    if (!profileData(data.data(), data.size()).likelyIncompressible()) {
+        std::vector<uint8_t> modeled = {STREAM_MODE_MODELED};
+        encode(modeled);
+        if (modeled.size() < data.size() + 1) {
+            return modeled;
+        }
+    }
+
+    std::vector<uint8_t> stored;
+    stored.reserve(data.size() + 1);
+    stored.push_back(STREAM_MODE_STORED);
+    stored.insert(stored.end(), data.begin(), data.end());
+    if (stats) {
+        stats->storedBytes += data.size();
+    }
+    return stored;
+}
+
+bool isStoredStream(const std::vector<uint8_t>& data, const char* name) {
+    uint8_t mode = data[0];
+    if (mode != STREAM_MODE_MODELED && mode != STREAM_MODE_STORED) {
+        throw std::runtime_error(std::string("Unknown ") + name + " mode: " + std::to_string(mode));
+    }
+    return mode == STREAM_MODE_STORED;
+}
+
+} // namespace utils
+} // namespace compression
@@ -0,0 +1,220 @@
+#include "compression/ThreadPool.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace compression {
+
+namespace {
+
+// The pool and deque index of the worker running on this thread, if any
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+
+constexpr size_t NOT_A_WORKER = std::numeric_limits<size_t>::max();
+
+std::mutex sharedMutex;
+std::unique_ptr<ThreadPool> sharedPool;
+size_t sharedThreadCount = 0;
+bool sharedPinThreads = false;
+
+void pinToCpu(std::thread& thread, size_t index) {
+#ifdef __linux__
+    size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % cpus, &set);
+    // Best effort: a restricted affinity mask simply leaves the thread unpinned
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)index;
+#endif
+}
+
+} // anonymous namespace
+
+ThreadPool::ThreadPool(size_t threadCount, bool pinThreads) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    queues_.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        queues_.push_back(std::make_unique<WorkerQueue>());
+    }
+    workers_.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers_.emplace_back([this, i] { workerLoop(i); });
+        if (pinThreads) {
+            pinToCpu(workers_.back(), i);
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::post(Task task) {
+    size_t index = currentPool == this ? currentWorker : nextQueue_++ % queues_.size();
+    bool waiters;
+    {
+        // Counted before it is visible, so a taker never sees the count wrap
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        pending_++;
+        waiters = waiters_ > 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    wake_.notify_one();
+    if (waiters) {
+        progress_.notify_all();
+    }
+}
+
+bool ThreadPool::takeTask(size_t self, Task& task) {
+    if (pending_ == 0) {
+        return false;
+    }
+    // Own work newest first
+    if (self != NOT_A_WORKER) {
+        WorkerQueue& own = *queues_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            pending_--;
+            return true;
+        }
+    }
+    // Other workers' work oldest first
+    size_t start = self == NOT_A_WORKER ? 0 : self + 1;
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        WorkerQueue& victim = *queues_[(start + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending_--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::runTask(Task& task) {
+    task();
+    bool waiters;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        finished_++;
+        waiters = waiters_ > 0;
+    }
+    if (waiters) {
+        progress_.notify_all();
+    }
+}
+
+bool ThreadPool::runPendingTask() {
+    Task task;
+    if (!takeTask(currentPool == this ? currentWorker : NOT_A_WORKER, task)) {
+        return false;
+    }
+    runTask(task);
+    return true;
+}
+
+size_t ThreadPool::finishedTasks() {
+    std::lock_guard<std::mutex> lock(wakeMutex_);
+    return finished_;
+}
+
+void ThreadPool::waitForProgress(size_t finished) {
+    std::unique_lock<std::mutex> lock(wakeMutex_);
+    waiters_++;
+    progress_.wait(lock, [&] { return finished_ != finished || pending_ > 0; });
+    waiters_--;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentWorker = index;
+    for (;;) {
+        Task task;
+        if (takeTask(index, task)) {
+            runTask(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wake_.wait(lock, [this] { return stopping_ || pending_ > 0; });
+        if (stopping_ && pending_ == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    std::atomic<size_t> next{0};
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    auto run = [&] {
+        for (size_t i = next++; i < count; i = next++) {
+            try {
+                body(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    // Helpers that start after the indices ran out return at once
+    size_t helperCount = count > 1 ? std::min(size(), count - 1) : 0;
+    std::vector<std::future<void>> helpers;
+    helpers.reserve(helperCount);
+    for (size_t i = 0; i < helperCount; ++i) {
+        helpers.push_back(submit(run));
+    }
+    run();
+    for (auto& helper : helpers) {
+        wait(helper);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    if (!sharedPool) {
+        sharedPool = std::make_unique<ThreadPool>(sharedThreadCount, sharedPinThreads);
+    }
+    return *sharedPool;
+}
+
+void ThreadPool::configureShared(size_t threadCount, bool pinThreads) {
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    if (sharedPool) {
+        throw std::logic_error("The shared thread pool is already running");
+    }
+    sharedThreadCount = threadCount;
+    sharedPinThreads = pinThreads;
+}
+
+} // namespace compression
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <compression/AutoCompressor.hpp>
+#include <compression/CompressorFactory.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <compression/DataProfile.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+using compression::AutoCompressor;
+using compression::format::AlgorithmID;
+using compression::utils::CorpusGenerator;
+using compression::utils::CorpusKind;
+
+TEST(DataProfileTest, EstimatesMatchTheDataShape) {
+    CorpusGenerator generator;
+
+    auto random = generator.generate(CorpusKind::RANDOM, 200000);
+    auto profile = compression::utils::profileData(random.data(), random.size());
+    EXPECT_EQ(profile.sampledBytes, 16u * 4096u); // Sampled, not read in full
+    EXPECT_GT(profile.entropy, 7.9);
+    EXPECT_LT(profile.matchDensity, 0.01);
+    EXPECT_LT(profile.runDensity, 0.01);
+
+    std::vector<uint8_t> zeros(10000, 0);
+    profile = compression::utils::profileData(zeros.data(), zeros.size());
+    EXPECT_EQ(profile.sampledBytes, zeros.size());
+    EXPECT_DOUBLE_EQ(profile.entropy, 0.0);
+    EXPECT_DOUBLE_EQ(profile.runDensity, 1.0);
+    EXPECT_GT(profile.matchDensity, 0.99);
+
+    auto logs = generator.generate(CorpusKind::LOGS, 200000);
+    profile = compression::utils::profileData(logs.data(), logs.size());
+    EXPECT_GT(profile.matchDensity, 0.3);
+    EXPECT_LT(profile.entropy, 6.0);
+
+    EXPECT_EQ(compression::utils::profileData(nullptr, 0).sampledBytes, 0u);
+}
+
+TEST(AutoCompressorTest, ChoosesPerDataKind) {
+    CorpusGenerator generator;
+    AutoCompressor automatic;
+    auto choiceFor = [&](CorpusKind kind) {
+        auto data = generator.generate(kind, 100000);
+        return automatic.choose(compression::utils::profileData(data.data(), data.size())).algorithm;
+    };
+
+    EXPECT_EQ(choiceFor(CorpusKind::RANDOM), AlgorithmID::NULL_COMPRESSOR);
+    EXPECT_EQ(choiceFor(CorpusKind::LOGS), AlgorithmID::LZ77_COMPRESSOR);
+    EXPECT_EQ(choiceFor(CorpusKind::RECORDS), AlgorithmID::LZ77_COMPRESSOR);
+
+    std::vector<uint8_t> runs;
+    for (int i = 0; i < 1000; ++i) {
+        runs.insert(runs.end(), 50 + i % 7, static_cast<uint8_t>(i));
+    }
+    EXPECT_EQ(automatic.choose(compression::utils::profileData(runs.data(), runs.size())).algorithm,
+              AlgorithmID::RLE_COMPRESSOR);
+
+    // Skewed bytes without repeats only gain from entropy coding
+    std::vector<uint8_t> skewed(50000);
+    uint32_t state = 12345;
+    for (auto& byte : skewed) {
+        state = state * 1103515245u + 12345u;
+        uint32_t r = state >> 16;
+        byte = static_cast<uint8_t>((r & 3) ? r % 16 : (r >> 2) % 256);
+    }
+    EXPECT_EQ(automatic.choose(compression::utils::profileData(skewed.data(), skewed.size())).algorithm,
+              AlgorithmID::HUFFMAN_COMPRESSOR);
+
+    // High levels trade speed for bwt's ratio
+    AutoCompressor thorough(9);
+    auto logs = generator.generate(CorpusKind::LOGS, 100000);
+    EXPECT_EQ(thorough.choose(compression::utils::profileData(logs.data(), logs.size())).algorithm,
+              AlgorithmID::BWT_COMPRESSOR);
+}
+
+TEST(AutoCompressorTest, RoundTripsAndNeverExpandsMuch) {
+    CorpusGenerator generator;
+    for (int level : {1, 6, 9}) {
+        AutoCompressor automatic(level);
+        for (CorpusKind kind : compression::utils::allCorpusKinds()) {
+            for (size_t size : {1u, 100u, 70000u}) {
+                auto data = generator.generate(kind, size);
+                auto compressed = automatic.compress(data);
+                EXPECT_EQ(automatic.decompress(compressed), data)
+                    << compression::utils::corpusKindToString(kind) << " x" << size << " level " << level;
+                EXPECT_LE(compressed.size(), data.size() + 8);
+            }
+        }
+    }
+    EXPECT_TRUE(AutoCompressor().compress({}).empty());
+    EXPECT_TRUE(AutoCompressor().decompress({}).empty());
+}
+
+TEST(AutoCompressorTest, ChoosesPerBlock) {
+    CorpusGenerator generator;
+    auto data = generator.generate(CorpusKind::RANDOM, AutoCompressor::BLOCK_SIZE);
+    auto logs = generator.generate(CorpusKind::LOGS, AutoCompressor::BLOCK_SIZE / 2);
+    data.insert(data.end(), logs.begin(), logs.end());
+
+    auto compressor = compression::createCompressor("auto");
+    auto compressed = compressor->compress(data);
+    EXPECT_EQ(AutoCompressor::blockAlgorithms(compressed),
+              (std::vector<AlgorithmID>{AlgorithmID::NULL_COMPRESSOR, AlgorithmID::LZ77_COMPRESSOR}));
+    EXPECT_LT(compressed.size(), AutoCompressor::BLOCK_SIZE + logs.size() / 2);
+    EXPECT_EQ(compressor->decompress(compressed), data);
+}
+
+TEST(AutoCompressorTest, RejectsBadInput) {
+    AutoCompressor automatic;
+    EXPECT_THROW(automatic.setLevel(0), std::invalid_argument);
+    EXPECT_THROW(automatic.setLevel(10), std::invalid_argument);
+
+    auto compressed = automatic.compress(std::vector<uint8_t>(1000, 'a'));
+    auto wrongVersion = compressed;
+    wrongVersion[0] = 99;
+    EXPECT_THROW(automatic.decompress(wrongVersion), std::runtime_error);
+    compressed.pop_back();
+    EXPECT_THROW(automatic.decompress(compressed), std::runtime_error);
+    EXPECT_THROW(automatic.decompress({1, 42, 1, 1, 'x'}), std::runtime_error); // Unknown algorithm
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <compression/ColumnarCompressor.hpp>
+#include <compression/CompressorFactory.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using compression::ColumnarCompressor;
+using compression::format::AlgorithmID;
+using compression::utils::CorpusKind;
+
+namespace {
+
+std::vector<uint8_t> bytesOf(const std::string& text) {
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+ColumnarCompressor::Structure detect(const std::vector<uint8_t>& data) {
+    return ColumnarCompressor::detectStructure(data.data(), data.size());
+}
+
+// Space-padded report lines: account, branch, amount and a status word
+std::vector<uint8_t> fixedWidthRecords(size_t lines) {
+    static const char* const STATUSES[] = {"OPEN", "CLOSED", "HOLD", "REVIEW"};
+    std::mt19937 rng(7);
+    std::string text;
+    char line[64];
+    for (size_t i = 0; i < lines; ++i) {
+        std::snprintf(line, sizeof(line), "ACC%07zu  BR%03u  %10u.%02u  %-6s\n", 4000000 + i * 3,
+                      static_cast<unsigned>(rng() % 40), static_cast<unsigned>(rng() % 100000),
+                      static_cast<unsigned>(rng() % 100), STATUSES[rng() % 4]);
+        text += line;
+    }
+    return bytesOf(text);
+}
+
+} // anonymous namespace
+
+TEST(ColumnarCompressorTest, DetectsDelimitedAndFixedWidthLines) {
+    auto csv = compression::utils::CorpusGenerator().generate(CorpusKind::TABLE, 20000);
+    auto structure = detect(csv);
+    EXPECT_EQ(structure.layout, ColumnarCompressor::Layout::DELIMITED);
+    EXPECT_EQ(structure.delimiter, ',');
+
+    // A few lines with an extra field do not hide the delimiter
+    structure = detect(bytesOf("a\tb\tc\n1\t2\t3\n4\t5\t6\n7\t8\t9\n"
+                               "1\t2\t3\n4\t5\t6\n7\t8\t9\n1\t2\t3\n4\t5\t6\n7\t8\t9\t0\n"));
+    EXPECT_EQ(structure.layout, ColumnarCompressor::Layout::DELIMITED);
+    EXPECT_EQ(structure.delimiter, '\t');
+
+    structure = detect(fixedWidthRecords(100));
+    EXPECT_EQ(structure.layout, ColumnarCompressor::Layout::FIXED_WIDTH);
+    EXPECT_EQ(structure.lineLength, 41u);
+    // Amounts below 100000 leave their first five columns blank, so they end the branch field
+    EXPECT_EQ(structure.fieldWidths, (std::vector<size_t>{12, 12, 10, 7}));
+
+    auto text = compression::utils::CorpusGenerator().generate(CorpusKind::TEXT, 20000);
+    EXPECT_EQ(detect(text).layout, ColumnarCompressor::Layout::RAW);
+    EXPECT_EQ(detect(bytesOf("a,b\nc,d\ne,f\n")).layout, ColumnarCompressor::Layout::RAW);
+}
+
+TEST(ColumnarCompressorTest, AnyInputRoundTrips) {
+    std::string manyColumns;
+    for (int line = 0; line < 10; ++line) {
+        for (int field = 0; field < 300; ++field) {
+            manyColumns += std::to_string(line * field) + ",";
+        }
+        manyColumns += "end\n";
+    }
+    std::vector<uint8_t> random(100000);
+    std::mt19937 rng(3);
+    for (auto& byte : random) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    const std::vector<std::vector<uint8_t>> inputs = {
+        {},
+        bytesOf("x"),
+        // Quoted delimiters, ragged and empty lines, and no final newline
+        bytesOf("id,name,note\n1,\"smith, j\",ok\n2,,\n\n3,lee,\"a,b,c\",extra\n4,kim\n5,ng,fine\n6,o,tail"),
+        bytesOf(manyColumns),
+        fixedWidthRecords(1000),
+        random,
+        compression::utils::CorpusGenerator().generate(CorpusKind::LOGS, 50000),
+    };
+    for (AlgorithmID backend : {AlgorithmID::UNKNOWN, AlgorithmID::LZ77_COMPRESSOR, AlgorithmID::NULL_COMPRESSOR}) {
+        ColumnarCompressor compressor(backend);
+        for (const auto& input : inputs) {
+            EXPECT_EQ(compressor.decompress(compressor.compress(input)), input)
+                << input.size() << " bytes, backend " << static_cast<int>(backend);
+        }
+    }
+}
+
+TEST(ColumnarCompressorTest, FramesEndOnLineBoundaries) {
+    auto csv = compression::utils::CorpusGenerator().generate(CorpusKind::TABLE,
+                                                              ColumnarCompressor::FRAME_SIZE * 2 + 12345);
+    ColumnarCompressor compressor(AlgorithmID::HUFFMAN_COMPRESSOR);
+    EXPECT_EQ(compressor.decompress(compressor.compress(csv)), csv);
+}
+
+TEST(ColumnarCompressorTest, BeatsRowMajorCompressionOnRecords) {
+    auto csv = compression::utils::CorpusGenerator().generate(CorpusKind::TABLE, 1 << 20);
+    auto fixed = fixedWidthRecords(30000);
+    auto columnar = compression::createCompressor("columnar");
+    for (const auto& data : {csv, fixed}) {
+        auto compressed = columnar->compress(data);
+        EXPECT_EQ(columnar->decompress(compressed), data);
+        for (const char* rowMajor : {"lzh", "bwt"}) {
+            EXPECT_LT(compressed.size(), compression::createCompressor(rowMajor)->compress(data).size()) << rowMajor;
+        }
+    }
+
+    // A fixed backend applies to every column
+    auto lz77 = compression::createCompressor("columnar:lz77");
+    auto compressed = lz77->compress(csv);
+    EXPECT_LT(compressed.size(), compression::createCompressor("lz77")->compress(csv).size());
+    EXPECT_EQ(columnar->decompress(compressed), csv);
+}
+
+TEST(ColumnarCompressorTest, RejectsBadBackendsAndStreams) {
+    EXPECT_THROW(ColumnarCompressor(AlgorithmID::COLUMNAR_COMPRESSOR), std::invalid_argument);
+    EXPECT_THROW(compression::createCompressor("columnar:columnar"), std::invalid_argument);
+    EXPECT_THROW(compression::createCompressor("columnar:nope"), std::invalid_argument);
+
+    ColumnarCompressor compressor;
+    auto compressed = compressor.compress(fixedWidthRecords(200));
+
+    auto badVersion = compressed;
+    badVersion[0] = 9;
+    EXPECT_THROW(compressor.decompress(badVersion), std::runtime_error);
+    auto badLayout = compressed;
+    badLayout[1] = 7;
+    EXPECT_THROW(compressor.decompress(badLayout), std::runtime_error);
+    auto truncated = compressed;
+    truncated.resize(truncated.size() / 2);
+    EXPECT_THROW(compressor.decompress(truncated), std::runtime_error);
+    // The first field width no longer adds up to the line length
+    auto badWidth = compressed;
+    badWidth[6]++;
+    EXPECT_THROW(compressor.decompress(badWidth), std::runtime_error);
+}
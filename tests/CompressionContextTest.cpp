@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <compression/CompressionContext.hpp>
+#include <compression/Lz77Compressor.hpp>
+#include <compression/BwtCompressor.hpp>
+#include <compression/RleCompressor.hpp>
+#include <compression/CompressorFactory.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+// Helper function to convert string to vector<uint8_t>
+static std::vector<uint8_t> stringToBytes(const std::string& str) {
+    return std::vector<uint8_t>(str.begin(), str.end());
+}
+
+// Builds a small JSON-like payload that differs per index
+static std::vector<uint8_t> makeMessage(int index) {
+    std::string message = "{\"id\":" + std::to_string(index) +
+                          ",\"user\":\"user" + std::to_string(index % 7) +
+                          "\",\"status\":\"active\",\"tags\":[\"alpha\",\"beta\",\"alpha\"]}";
+    return stringToBytes(message);
+}
+
+TEST(CompressionContextTest, AllocationsAreAlignedAndDistinct) {
+    compression::CompressionContext context;
+    uint8_t* bytes = context.allocate<uint8_t>(3);
+    uint64_t* words = context.allocate<uint64_t>(4);
+    uint32_t* ints = context.allocate<uint32_t>(5);
+
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(words) % alignof(uint64_t), 0u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ints) % alignof(uint32_t), 0u);
+    EXPECT_NE(static_cast<void*>(bytes), static_cast<void*>(words));
+    EXPECT_GE(context.used(), 3u + 4 * sizeof(uint64_t) + 5 * sizeof(uint32_t));
+}
+
+TEST(CompressionContextTest, ResetReusesMemoryWithoutGrowing) {
+    compression::CompressionContext context(1024);
+    size_t initialCapacity = context.capacity();
+
+    for (int round = 0; round < 10; ++round) {
+        context.allocate<uint32_t>(200);
+        context.reset();
+    }
+
+    EXPECT_EQ(context.capacity(), initialCapacity);
+    EXPECT_EQ(context.used(), 0u);
+}
+
+TEST(CompressionContextTest, ResetCoalescesOverflowBlocks) {
+    compression::CompressionContext context(64);
+    context.allocate<uint8_t>(10000);
+    context.allocate<uint8_t>(50000);
+    size_t grownCapacity = context.capacity();
+    context.reset();
+
+    // After coalescing, the same request pattern fits without new blocks
+    context.allocate<uint8_t>(10000);
+    context.allocate<uint8_t>(50000);
+    EXPECT_EQ(context.capacity(), grownCapacity);
+}
+
+TEST(CompressionContextTest, NestedScopesReleaseOnlyTheirOwnMemory) {
+    compression::CompressionContext context;
+    uint32_t* outer = nullptr;
+    {
+        compression::CompressionContext::Scope outerScope(context);
+        outer = context.allocate<uint32_t>(16);
+        outer[0] = 42;
+        size_t usedBefore = context.used();
+        {
+            compression::CompressionContext::Scope innerScope(context);
+            context.allocate<uint32_t>(1000);
+        }
+        EXPECT_EQ(context.used(), usedBefore);
+        EXPECT_EQ(outer[0], 42u);
+    }
+    EXPECT_EQ(context.used(), 0u);
+}
+
+TEST(CompressionContextTest, Lz77ReusedContextMatchesFreshCalls) {
+    compression::Lz77Compressor compressor;
+    compression::CompressionContext context(compressor.scratchSize(256));
+
+    for (int i = 0; i < 50; ++i) {
+        auto message = makeMessage(i);
+        auto withContext = compressor.compress(message, context);
+        EXPECT_EQ(withContext, compressor.compress(message));
+        EXPECT_EQ(compressor.decompress(withContext, context), message);
+    }
+
+    // Scratch is returned after every call, so the arena never grows past one message
+    EXPECT_EQ(context.used(), 0u);
+    EXPECT_LE(context.peakUsage(), compressor.scratchSize(256));
+}
+
+TEST(CompressionContextTest, BwtReusedContextMatchesFreshCalls) {
+    compression::BwtCompressor compressor;
+    compression::CompressionContext context;
+
+    std::string text;
+    for (int i = 0; i < 40; ++i) {
+        text += "the quick brown fox jumps over the lazy dog ";
+    }
+    std::vector<std::vector<uint8_t>> inputs = {
+        stringToBytes("banana"), stringToBytes(text), stringToBytes(text.substr(0, 700))};
+
+    for (const auto& input : inputs) {
+        auto withContext = compressor.compress(input, context);
+        EXPECT_EQ(withContext, compressor.compress(input));
+        EXPECT_EQ(compressor.decompress(withContext, context), compressor.decompress(withContext));
+    }
+    EXPECT_EQ(compressor.decompress(compressor.compress(inputs[0], context), context), inputs[0]);
+    EXPECT_EQ(context.used(), 0u);
+}
+
+TEST(CompressionContextTest, CompressorsWithoutScratchAcceptContext) {
+    compression::RleCompressor compressor;
+    compression::CompressionContext context;
+    auto data = stringToBytes("AAAABBBCCD");
+
+    EXPECT_EQ(compressor.scratchSize(data.size()), 0u);
+    auto compressed = compressor.compress(data, context);
+    EXPECT_EQ(compressed, compressor.compress(data));
+    EXPECT_EQ(compressor.decompress(compressed, context), data);
+}
+
+// Working sets cover scratch memory and at least one input-sized buffer, and grow with the input
+TEST(CompressionContextTest, WorkingSetCoversScratchAndOutput) {
+    for (const char* algorithm : {"null", "rle", "huffman", "lz77", "bwt", "dedup"}) {
+        auto compressor = compression::createCompressor(algorithm);
+        size_t previous = 0;
+        for (size_t size : {1000u, 100000u, 4000000u}) {
+            size_t workingSet = compressor->workingSetSize(size);
+            EXPECT_GE(workingSet, compressor->scratchSize(size) + size) << algorithm << " x" << size;
+            EXPECT_GT(workingSet, previous) << algorithm << " x" << size;
+            previous = workingSet;
+        }
+    }
+
+    // BWT memory follows its block size, LZ77's its symbol stream
+    compression::BwtCompressor bwt;
+    EXPECT_GT(bwt.workingSetSize(1 << 20), 20u << 20);
+    compression::Lz77Compressor lz77;
+    EXPECT_GT(lz77.workingSetSize(1 << 20), lz77.scratchSize(1 << 20) + (16u << 20));
+}
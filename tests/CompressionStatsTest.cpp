@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <compression/CompressionContext.hpp>
+#include <compression/CompressionStats.hpp>
+#include <compression/CompressorFactory.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using compression::CompressionContext;
+using compression::CompressionStats;
+using compression::utils::CorpusGenerator;
+using compression::utils::CorpusKind;
+
+#if COMPRESSION_ENABLE_STATS
+
+namespace {
+
+bool hasStage(const CompressionStats& stats, const std::string& name) {
+    return std::any_of(stats.stages.begin(), stats.stages.end(),
+                       [&](const CompressionStats::Stage& stage) { return stage.name == name; });
+}
+
+} // namespace
+
+TEST(CompressionStatsTest, DisabledByDefault) {
+    CompressionContext context;
+    EXPECT_EQ(context.stats(), nullptr);
+
+    context.enableStats();
+    ASSERT_NE(context.stats(), nullptr);
+    context.enableStats(false);
+    EXPECT_EQ(context.stats(), nullptr);
+}
+
+TEST(CompressionStatsTest, Lz77CountsCoverTheInput) {
+    auto data = CorpusGenerator().generate(CorpusKind::LOGS, 50000);
+    auto lz77 = compression::createCompressor("lz77");
+    CompressionContext context;
+    context.enableStats();
+
+    auto compressed = lz77->compress(data, context);
+    const CompressionStats& stats = *context.stats();
+    EXPECT_EQ(stats.literals + stats.matchedBytes, data.size());
+    EXPECT_GT(stats.matches, 0u);
+    EXPECT_GE(stats.averageMatchLength(), 3.0);
+    EXPECT_GT(stats.matchSearches, 0u);
+    EXPECT_GT(stats.chainSteps, 0u);
+    EXPECT_GT(stats.literalRatio(), 0.0);
+    EXPECT_LT(stats.literalRatio(), 1.0);
+
+    ASSERT_TRUE(hasStage(stats, "lz77 match finding"));
+    ASSERT_TRUE(hasStage(stats, "lz77 encoding"));
+    EXPECT_EQ(stats.stages.back().bytesOut, compressed.size());
+}
+
+TEST(CompressionStatsTest, BwtRecordsNestedStages) {
+    auto data = CorpusGenerator().generate(CorpusKind::TEXT, 20000);
+    auto bwt = compression::createCompressor("bwt");
+    CompressionContext context;
+    context.enableStats();
+
+    auto compressed = bwt->compress(data, context);
+    const CompressionStats& stats = *context.stats();
+    for (const char* name : {"bwt suffix sort", "mtf", "rle", "entropy coding", "huffman table"}) {
+        EXPECT_TRUE(hasStage(stats, name)) << name;
+    }
+    EXPECT_GT(stats.entropyTableBytes, 0u);
+
+    // Stages run one after another; Huffman's stages nest inside entropy coding
+    for (const auto& stage : stats.stages) {
+        bool huffmanStage = stage.name.rfind("huffman", 0) == 0;
+        EXPECT_EQ(stage.depth, huffmanStage ? 1 : 0) << stage.name;
+        EXPECT_GE(stage.seconds, 0.0);
+    }
+
+    context.stats()->reset();
+    EXPECT_EQ(bwt->decompress(compressed, context), data);
+    EXPECT_TRUE(hasStage(*context.stats(), "inverse bwt"));
+    EXPECT_TRUE(hasStage(*context.stats(), "huffman decoding"));
+}
+
+TEST(CompressionStatsTest, DedupCountsChunks) {
+    auto block = CorpusGenerator().generate(CorpusKind::RANDOM, 40000);
+    std::vector<uint8_t> data = block;
+    data.insert(data.end(), block.begin(), block.end());
+    auto dedup = compression::createCompressor("dedup");
+    CompressionContext context;
+    context.enableStats();
+
+    dedup->compress(data, context);
+    const CompressionStats& stats = *context.stats();
+    EXPECT_GT(stats.chunks, 0u);
+    EXPECT_GT(stats.duplicateChunks, 0u);
+    EXPECT_LT(stats.duplicateChunks, stats.chunks);
+    EXPECT_TRUE(hasStage(stats, "dedup chunking"));
+
+    std::ostringstream report;
+    stats.print(report);
+    EXPECT_NE(report.str().find("dedup chunking"), std::string::npos);
+    EXPECT_NE(report.str().find("duplicates"), std::string::npos);
+}
+
+#else
+
+TEST(CompressionStatsTest, CompiledOut) {
+    CompressionContext context;
+    context.enableStats();
+    EXPECT_EQ(context.stats(), nullptr);
+}
+
+#endif
+
+// Collecting statistics never changes the output
+TEST(CompressionStatsTest, OutputIndependentOfStats) {
+    auto data = CorpusGenerator().generate(CorpusKind::RECORDS, 30000);
+    for (const char* algorithm : {"huffman", "lz77", "bwt", "dedup"}) {
+        auto compressor = compression::createCompressor(algorithm);
+        CompressionContext context;
+        context.enableStats();
+        EXPECT_EQ(compressor->compress(data, context), compressor->compress(data)) << algorithm;
+    }
+}
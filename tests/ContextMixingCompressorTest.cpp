@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <compression/BwtCompressor.hpp>
+#include <compression/CompressionContext.hpp>
+#include <compression/CompressorFactory.hpp>
+#include <compression/ContextMixingCompressor.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <compression/HuffmanCompressor.hpp>
+#include <compression/RangeCoder.hpp>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using compression::ContextMixingCompressor;
+using compression::utils::CorpusGenerator;
+using compression::utils::CorpusKind;
+
+TEST(RangeCoderTest, RoundTripsBitsAtAnyProbability) {
+    std::mt19937 random(11);
+    std::vector<unsigned> bits(200000);
+    std::vector<uint32_t> probabilities(bits.size());
+    for (size_t i = 0; i < bits.size(); ++i) {
+        // Includes the extremes and predictions that are badly wrong
+        probabilities[i] = i % 7 == 0 ? 1 : (i % 7 == 1 ? 4095 : 1 + random() % 4095);
+        bits[i] = random() % 4096 < probabilities[i] ? 1 : 0;
+        if (i % 101 == 0) bits[i] ^= 1;
+    }
+
+    std::vector<uint8_t> coded;
+    compression::utils::RangeEncoder encoder(coded);
+    for (size_t i = 0; i < bits.size(); ++i) {
+        encoder.encode(bits[i], probabilities[i]);
+    }
+    encoder.flush();
+
+    compression::utils::RangeDecoder decoder(coded.data(), coded.size());
+    for (size_t i = 0; i < bits.size(); ++i) {
+        ASSERT_EQ(decoder.decode(probabilities[i]), bits[i]) << i;
+    }
+}
+
+TEST(ContextMixingCompressorTest, RoundTripsEveryCorpusKind) {
+    ContextMixingCompressor cm;
+    CorpusGenerator generator;
+    compression::CompressionContext context;
+    for (CorpusKind kind : compression::utils::allCorpusKinds()) {
+        auto data = generator.generate(kind, 100000);
+        auto compressed = cm.compress(data, context);
+        EXPECT_LE(compressed.size(), data.size() + 1) << compression::utils::corpusKindToString(kind);
+        EXPECT_EQ(cm.decompress(compressed, context), data) << compression::utils::corpusKindToString(kind);
+    }
+
+    for (size_t size : {0u, 1u, 2u, 9u}) {
+        std::vector<uint8_t> small(size, 'x');
+        EXPECT_EQ(cm.decompress(cm.compress(small)), small) << size;
+    }
+}
+
+TEST(ContextMixingCompressorTest, BeatsOrderZeroHuffman) {
+    ContextMixingCompressor cm;
+    compression::HuffmanCompressor huffman;
+    CorpusGenerator generator;
+    for (CorpusKind kind : {CorpusKind::TEXT, CorpusKind::LOGS, CorpusKind::RECORDS}) {
+        auto data = generator.generate(kind, 300000);
+        auto compressed = cm.compress(data);
+        // Order-1 and order-2 contexts take text far below the order-0 bound
+        EXPECT_LT(compressed.size(), huffman.compress(data).size() / 2)
+            << compression::utils::corpusKindToString(kind);
+        EXPECT_EQ(cm.decompress(compressed), data);
+    }
+}
+
+TEST(ContextMixingCompressorTest, StoresRandomDataAndRejectsBadStreams) {
+    ContextMixingCompressor cm;
+    auto random = CorpusGenerator().generate(CorpusKind::RANDOM, 50000);
+    auto compressed = cm.compress(random);
+    EXPECT_EQ(compressed.size(), random.size() + 1);
+    EXPECT_EQ(compressed[0], 1);
+    EXPECT_EQ(cm.decompress(compressed), random);
+
+    EXPECT_THROW(cm.decompress({7, 1, 2}), std::runtime_error);
+    // A size no payload of two bytes could hold
+    EXPECT_THROW(cm.decompress({0, 0xFF, 0xFF, 0xFF, 0x7F, 0, 0}), std::runtime_error);
+    EXPECT_THROW(cm.decompress({0, 0x80}), std::runtime_error);
+}
+
+TEST(ContextMixingCompressorTest, BwtEntropyStage) {
+    auto data = CorpusGenerator().generate(CorpusKind::LOGS, 200000);
+    compression::BwtCompressor huffmanStage;
+    auto bwtCm = compression::createCompressor("bwt:cm");
+    auto compressed = bwtCm->compress(data);
+
+    const uint8_t contextMixingFlag = 0x08; // Header flags byte, bit 3
+    EXPECT_NE(compressed[4] & contextMixingFlag, 0);
+    auto plain = huffmanStage.compress(data);
+    EXPECT_EQ(plain[4] & contextMixingFlag, 0);
+    EXPECT_LT(compressed.size(), plain.size());
+
+    // The flag, not the configuration, selects the stage when decoding
+    EXPECT_EQ(huffmanStage.decompress(compressed), data);
+    EXPECT_EQ(bwtCm->decompress(plain), data);
+
+    EXPECT_NO_THROW(compression::createCompressor("bwt:huffman"));
+    EXPECT_THROW(compression::createCompressor("bwt:lz77"), std::invalid_argument);
+    EXPECT_THROW(compression::createCompressor("lz77:cm"), std::invalid_argument);
+    EXPECT_THROW(compression::BwtCompressor(compression::format::AlgorithmID::RLE_COMPRESSOR),
+                 std::invalid_argument);
+}
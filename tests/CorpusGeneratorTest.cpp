@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <compression/CorpusGenerator.hpp>
+#include <compression/CompressorFactory.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+using compression::utils::CorpusGenerator;
+using compression::utils::CorpusKind;
+
+TEST(CorpusGeneratorTest, SameSeedSameBytes) {
+    CorpusGenerator first(42);
+    CorpusGenerator second(42);
+    CorpusGenerator other(43);
+    for (CorpusKind kind : compression::utils::allCorpusKinds()) {
+        auto data = first.generate(kind, 20000);
+        EXPECT_EQ(data, second.generate(kind, 20000)) << compression::utils::corpusKindToString(kind);
+        EXPECT_NE(data, other.generate(kind, 20000)) << compression::utils::corpusKindToString(kind);
+    }
+    // Kinds draw from separate streams
+    EXPECT_NE(first.generate(CorpusKind::RANDOM, 64), first.generate(CorpusKind::SPARSE, 64));
+}
+
+TEST(CorpusGeneratorTest, ExactSizesAndPrefixes) {
+    CorpusGenerator generator;
+    for (CorpusKind kind : compression::utils::allCorpusKinds()) {
+        EXPECT_TRUE(generator.generate(kind, 0).empty());
+        auto large = generator.generate(kind, 150000);
+        ASSERT_EQ(large.size(), 150000u);
+        auto small = generator.generate(kind, 1000);
+        ASSERT_EQ(small.size(), 1000u);
+        EXPECT_TRUE(std::equal(small.begin(), small.end(), large.begin()));
+    }
+}
+
+TEST(CorpusGeneratorTest, StreamingMatchesWholeBuffer) {
+    CorpusGenerator generator(7);
+    const size_t size = 3 * CorpusGenerator::CHUNK_SIZE + 123;
+    std::vector<uint8_t> streamed;
+    std::vector<size_t> chunkSizes;
+    generator.generate(CorpusKind::LOGS, size, [&](const uint8_t* data, size_t length) {
+        streamed.insert(streamed.end(), data, data + length);
+        chunkSizes.push_back(length);
+    });
+    EXPECT_EQ(streamed, generator.generate(CorpusKind::LOGS, size));
+    EXPECT_EQ(chunkSizes, (std::vector<size_t>{CorpusGenerator::CHUNK_SIZE, CorpusGenerator::CHUNK_SIZE,
+                                               CorpusGenerator::CHUNK_SIZE, 123}));
+}
+
+TEST(CorpusGeneratorTest, KindsHaveTheirShape) {
+    CorpusGenerator generator;
+    const size_t size = 100000;
+
+    auto text = generator.generate(CorpusKind::TEXT, size);
+    for (uint8_t byte : text) {
+        ASSERT_TRUE(byte == '\n' || (byte >= 0x20 && byte < 0x7F));
+    }
+
+    auto logs = generator.generate(CorpusKind::LOGS, size);
+    EXPECT_EQ(std::string(logs.begin(), logs.begin() + 11), "2024-01-01T");
+
+    auto sparse = generator.generate(CorpusKind::SPARSE, size);
+    size_t zeros = std::count(sparse.begin(), sparse.end(), 0);
+    EXPECT_GT(zeros, size * 3 / 4);
+
+    auto records = generator.generate(CorpusKind::RECORDS, size);
+    EXPECT_EQ(std::string(records.begin(), records.begin() + 8), "{\"id\":1,");
+
+    // 32-byte samples whose first field is a timestamp advancing by 10 or 11 seconds
+    auto metrics = generator.generate(CorpusKind::METRICS, size);
+    for (size_t offset = 32; offset + 4 <= size; offset += 32) {
+        uint32_t previous = 0, current = 0;
+        for (int i = 3; i >= 0; --i) {
+            previous = previous << 8 | metrics[offset - 32 + i];
+            current = current << 8 | metrics[offset + i];
+        }
+        ASSERT_TRUE(current - previous == 10 || current - previous == 11) << offset;
+    }
+
+    // Random data does not compress, runs and logs compress well
+    auto lz77 = compression::createCompressor("lz77");
+    EXPECT_GE(lz77->compress(generator.generate(CorpusKind::RANDOM, size)).size(), size);
+    EXPECT_LT(lz77->compress(generator.generate(CorpusKind::RUNS, size)).size(), size / 10);
+    EXPECT_LT(lz77->compress(logs).size(), size / 2);
+
+    EXPECT_EQ(compression::utils::stringToCorpusKind("records"), CorpusKind::RECORDS);
+    EXPECT_THROW(compression::utils::stringToCorpusKind("video"), std::invalid_argument);
+}
+
+// Every compressor round-trips every kind of data, from tiny to multi-block inputs
+TEST(CorpusGeneratorTest, AllCompressorsRoundTripAllKinds) {
+    CorpusGenerator generator;
+    const char* const algorithms[] = {"null", "rle", "huffman", "lz77", "bwt", "dedup", "dedup:huffman"};
+    for (CorpusKind kind : compression::utils::allCorpusKinds()) {
+        for (size_t size : {1u, 1024u, 65536u}) {
+            auto data = generator.generate(kind, size);
+            for (const char* algorithm : algorithms) {
+                auto compressor = compression::createCompressor(algorithm);
+                EXPECT_EQ(compressor->decompress(compressor->compress(data)), data)
+                    << algorithm << " on " << compression::utils::corpusKindToString(kind) << " x" << size;
+            }
+        }
+    }
+}
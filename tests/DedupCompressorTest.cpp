@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <compression/DedupCompressor.hpp>
+#include <compression/CompressorFactory.hpp>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+// Random bytes with no internal redundancy
+static std::vector<uint8_t> randomBytes(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> bytes(size);
+    for (auto& byte : bytes) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    return bytes;
+}
+
+static void append(std::vector<uint8_t>& target, const std::vector<uint8_t>& source) {
+    target.insert(target.end(), source.begin(), source.end());
+}
+
+TEST(FastCdcChunkerTest, ChunksRespectSizeLimits) {
+    compression::FastCdcChunker chunker(1024, 4096, 16384);
+    auto data = randomBytes(500000, 1);
+    size_t pos = 0;
+    size_t chunks = 0;
+    while (pos < data.size()) {
+        size_t length = chunker.nextChunk(data.data() + pos, data.size() - pos);
+        ASSERT_GT(length, 0u);
+        ASSERT_LE(length, 16384u);
+        if (pos + length < data.size()) {
+            ASSERT_GE(length, 1024u);
+        }
+        pos += length;
+        chunks++;
+    }
+    // Normalized chunking keeps the average near the target
+    double average = static_cast<double>(data.size()) / chunks;
+    EXPECT_GT(average, 2048.0);
+    EXPECT_LT(average, 8192.0);
+}
+
+TEST(FastCdcChunkerTest, BoundariesResynchronizeAfterInsertion) {
+    compression::FastCdcChunker chunker;
+    auto data = randomBytes(300000, 2);
+    auto shifted = data;
+    shifted.insert(shifted.begin() + 100, {'x', 'y', 'z'});
+
+    auto boundaries = [&](const std::vector<uint8_t>& input, size_t shift) {
+        std::vector<size_t> result;
+        for (size_t pos = 0; pos < input.size();) {
+            pos += chunker.nextChunk(input.data() + pos, input.size() - pos);
+            if (pos > 1000) result.push_back(pos - shift);
+        }
+        return result;
+    };
+    auto original = boundaries(data, 0);
+    auto moved = boundaries(shifted, 3);
+    size_t common = 0;
+    for (size_t boundary : moved) {
+        common += std::count(original.begin(), original.end(), boundary);
+    }
+    EXPECT_GE(common + 2, original.size());
+}
+
+TEST(FastCdcChunkerTest, ReportsWhenMoreInputIsNeeded) {
+    compression::FastCdcChunker chunker(1024, 4096, 16384);
+    std::vector<uint8_t> zeros(2000, 0); // Zero runs never hit a boundary
+    EXPECT_EQ(chunker.nextChunk(zeros.data(), zeros.size(), false), 0u);
+    EXPECT_EQ(chunker.nextChunk(zeros.data(), zeros.size(), true), zeros.size());
+    EXPECT_THROW(compression::FastCdcChunker(1024, 3000, 16384), std::invalid_argument);
+}
+
+TEST(DedupCompressorTest, RepeatedRegionsAreStoredOnce) {
+    auto fileA = randomBytes(200000, 3);
+    auto fileB = randomBytes(100000, 4);
+    std::vector<uint8_t> data;
+    append(data, fileA);
+    append(data, fileB);
+    append(data, fileA);
+    append(data, fileB);
+    append(data, fileA);
+
+    compression::DedupCompressor dedup(compression::format::AlgorithmID::NULL_COMPRESSOR);
+    auto compressed = dedup.compress(data);
+    EXPECT_EQ(dedup.decompress(compressed), data);
+    // Unique content plus a small reference table
+    EXPECT_LT(compressed.size(), fileA.size() + fileB.size() + 4096);
+}
+
+TEST(DedupCompressorTest, RoundTripsWithEveryBackend) {
+    std::vector<uint8_t> data;
+    auto block = randomBytes(30000, 5);
+    std::string text = "log line: request served in 12ms status=200\n";
+    for (int i = 0; i < 3; ++i) {
+        append(data, block);
+        for (int j = 0; j < 200; ++j) {
+            data.insert(data.end(), text.begin(), text.end());
+        }
+    }
+
+    for (auto backend : {compression::format::AlgorithmID::NULL_COMPRESSOR,
+                         compression::format::AlgorithmID::RLE_COMPRESSOR,
+                         compression::format::AlgorithmID::HUFFMAN_COMPRESSOR,
+                         compression::format::AlgorithmID::LZ77_COMPRESSOR}) {
+        compression::DedupCompressor dedup(backend);
+        EXPECT_EQ(dedup.decompress(dedup.compress(data)), data)
+            << compression::format::algorithmIdToString(backend);
+    }
+    EXPECT_TRUE(compression::DedupCompressor().compress({}).empty());
+}
+
+TEST(DedupCompressorTest, StreamNamesItsBackend) {
+    auto data = randomBytes(50000, 6);
+    append(data, data);
+
+    auto writer = compression::createCompressor("dedup:huffman");
+    auto reader = compression::createCompressor(compression::format::AlgorithmID::DEDUP_COMPRESSOR);
+    EXPECT_EQ(reader->decompress(writer->compress(data)), data);
+    EXPECT_THROW(compression::createCompressor("dedup:nope"), std::invalid_argument);
+    EXPECT_THROW(compression::createCompressor("lz77:huffman"), std::invalid_argument);
+}
+
+TEST(DedupCompressorTest, RejectsCorruptReferences) {
+    compression::DedupCompressor dedup(compression::format::AlgorithmID::NULL_COMPRESSOR);
+    // One frame with a single reference to a chunk that was never sent
+    std::vector<uint8_t> corrupt = {static_cast<uint8_t>(compression::format::AlgorithmID::NULL_COMPRESSOR),
+                                    0, 1, (5 << 1) | 1, 0};
+    EXPECT_THROW(dedup.decompress(corrupt), std::runtime_error);
+}
+
+TEST(DedupCompressorTest, ReferencesStayWithinTheHistory) {
+    // A block repeated in the next frame, after more than a frame of other data
+    auto block = randomBytes(1 << 20, 7);
+    std::vector<uint8_t> data = block;
+    append(data, randomBytes(compression::DedupCompressor::FRAME_SIZE, 8));
+    append(data, block);
+
+    compression::DedupCompressor unbounded(compression::format::AlgorithmID::NULL_COMPRESSOR);
+    compression::DedupCompressor frameOnly(compression::format::AlgorithmID::NULL_COMPRESSOR,
+                                           compression::FastCdcChunker(), 0);
+    auto far = unbounded.compress(data);
+    auto near = frameOnly.compress(data);
+    EXPECT_LT(far.size() + block.size() / 2, data.size());
+    EXPECT_GT(near.size(), data.size());
+
+    // The stream records its history size, and references past it are rejected
+    EXPECT_EQ(unbounded.decompress(near), data);
+    EXPECT_EQ(frameOnly.decompress(far), data);
+    std::vector<uint8_t> evicted = {static_cast<uint8_t>(compression::format::AlgorithmID::NULL_COMPRESSOR), 0,
+                                    1, 2 << 1, 2, 'a', 'b', 1, (0 << 1) | 1, 0};
+    EXPECT_THROW(frameOnly.decompress(evicted), std::runtime_error);
+    evicted[1] = 2;
+    EXPECT_EQ(frameOnly.decompress(evicted), (std::vector<uint8_t>{'a', 'b', 'a', 'b'}));
+}
@@ -0,0 +1,214 @@
+#include <gtest/gtest.h>
+#include <compression/Dictionary.hpp>
+#include <compression/Lz77Compressor.hpp>
+#include <compression/HuffmanCompressor.hpp>
+#include <compression/FileFormat.hpp>
+#include <compression/CompressionContext.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <thread>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <stdexcept>
+
+// Helper function to convert string to vector<uint8_t>
+static std::vector<uint8_t> stringToBytes(const std::string& str) {
+    return std::vector<uint8_t>(str.begin(), str.end());
+}
+
+// Builds a JSON message shaped like our RPC payloads
+static std::vector<uint8_t> makeMessage(int index) {
+    static const char* const cities[] = {"Berlin", "Lisbon", "Osaka", "Denver", "Nairobi"};
+    std::string message = "{\"requestId\":\"req-" + std::to_string(100000 + index * 7919) +
+                          "\",\"user\":{\"id\":" + std::to_string(index * 31) +
+                          ",\"name\":\"customer_" + std::to_string(index % 13) +
+                          "\",\"city\":\"" + cities[index % 5] +
+                          "\"},\"status\":\"active\",\"permissions\":[\"read\",\"write\"],"
+                          "\"metadata\":{\"client\":\"mobile-app\",\"version\":\"4.2." +
+                          std::to_string(index % 4) + "\",\"locale\":\"en_US\"}}";
+    return stringToBytes(message);
+}
+
+static std::vector<std::vector<uint8_t>> makeSamples(int first, int count) {
+    std::vector<std::vector<uint8_t>> samples;
+    for (int i = first; i < first + count; ++i) {
+        samples.push_back(makeMessage(i));
+    }
+    return samples;
+}
+
+class DictionaryTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        compression::DictionaryTrainer trainer(4096);
+        dictionary = std::make_shared<const compression::Dictionary>(trainer.train(makeSamples(0, 200)));
+    }
+
+    std::shared_ptr<const compression::Dictionary> dictionary;
+};
+
+TEST_F(DictionaryTest, TrainerRespectsSizeAndKeepsSharedContent) {
+    const auto& content = dictionary->content();
+    ASSERT_FALSE(content.empty());
+    EXPECT_LE(content.size(), 4096u);
+    EXPECT_NE(dictionary->id(), 0u);
+
+    // Field names shared by every sample should be in the dictionary
+    std::string text(content.begin(), content.end());
+    EXPECT_NE(text.find("permissions"), std::string::npos);
+    EXPECT_NE(text.find("metadata"), std::string::npos);
+}
+
+TEST_F(DictionaryTest, TrainerFillsTheDictionaryFromFewSamples) {
+    // Two large samples share few segments; the rest comes from the best of
+    // what each holds alone
+    std::vector<std::vector<uint8_t>> samples;
+    for (uint64_t seed : {1, 2}) {
+        samples.push_back(compression::utils::CorpusGenerator(seed).generate(compression::utils::CorpusKind::LOGS,
+                                                                             200000));
+    }
+    compression::DictionaryTrainer trainer(65536);
+    EXPECT_GE(trainer.train(samples).content().size(), 65536u * 9 / 10);
+
+    // Samples smaller than the dictionary are used up
+    auto small = compression::DictionaryTrainer(65536).train(makeSamples(0, 20));
+    EXPECT_GT(small.content().size(), 0u);
+    EXPECT_LE(small.content().size(), 20u * makeMessage(0).size());
+}
+
+TEST_F(DictionaryTest, TrainerRejectsInsufficientData) {
+    compression::DictionaryTrainer trainer;
+    EXPECT_THROW(trainer.train({stringToBytes("abc")}), std::invalid_argument);
+    EXPECT_THROW(compression::DictionaryTrainer(16, 64, 8), std::invalid_argument);
+}
+
+TEST_F(DictionaryTest, SerializationRoundTrip) {
+    auto restored = compression::Dictionary::deserialize(dictionary->serialize());
+    EXPECT_EQ(restored.id(), dictionary->id());
+    EXPECT_EQ(restored.content(), dictionary->content());
+
+    auto corrupt = dictionary->serialize();
+    corrupt[0] = 'X';
+    EXPECT_THROW(compression::Dictionary::deserialize(corrupt), std::runtime_error);
+}
+
+TEST_F(DictionaryTest, Lz77DictionaryImprovesSmallMessages) {
+    compression::Lz77Compressor plain;
+    compression::Lz77Compressor primed;
+    primed.setDictionary(dictionary);
+
+    size_t originalTotal = 0;
+    size_t plainTotal = 0;
+    size_t primedTotal = 0;
+    // Messages not seen during training
+    for (const auto& message : makeSamples(1000, 50)) {
+        auto compressed = primed.compress(message);
+        ASSERT_EQ(primed.decompress(compressed), message);
+        originalTotal += message.size();
+        plainTotal += plain.compress(message).size();
+        primedTotal += compressed.size();
+    }
+
+    EXPECT_LT(primedTotal * 3, originalTotal);
+    EXPECT_LT(primedTotal * 2, plainTotal);
+}
+
+TEST_F(DictionaryTest, DigestedDictionaryIsSharedAcrossThreads) {
+    compression::Lz77Compressor digester;
+    auto digested = digester.digestDictionary(dictionary);
+    compression::Lz77Compressor compressor;
+    compression::Lz77Compressor decompressor;
+    compressor.setDigestedDictionary(digested);
+    decompressor.setDictionary(dictionary);
+
+    // Per-call hash chains cover the message only, not the dictionary window;
+    // the arena also holds the window joined with the message
+    auto message = makeMessage(3000);
+    compression::CompressionContext context;
+    auto compressed = compressor.compress(message, context);
+    EXPECT_EQ(decompressor.decompress(compressed), message);
+    EXPECT_LE(context.peakUsage(), compressor.scratchSize(message.size()));
+    compression::Lz77Compressor largeDictionary;
+    largeDictionary.setDictionary(
+        std::make_shared<const compression::Dictionary>(std::vector<uint8_t>(32768, 'x')));
+    EXPECT_EQ(largeDictionary.scratchSize(message.size()) - 32768,
+              compressor.scratchSize(message.size()) - digested->window().size());
+
+    std::vector<std::thread> threads;
+    std::vector<int> failures(4, 0);
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            compression::CompressionContext threadContext;
+            for (const auto& sample : makeSamples(4000 + t * 100, 25)) {
+                if (decompressor.decompress(compressor.compress(sample, threadContext)) != sample) {
+                    failures[t]++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(failures, std::vector<int>(4, 0));
+}
+
+TEST_F(DictionaryTest, DigestedDictionaryRejectsOtherWindowSize) {
+    compression::Lz77Compressor digester;
+    auto digested = digester.digestDictionary(dictionary);
+    compression::Lz77Compressor smallWindow(1024);
+    EXPECT_THROW(smallWindow.setDigestedDictionary(digested), std::invalid_argument);
+}
+
+TEST_F(DictionaryTest, HuffmanDictionaryRoundTrip) {
+    compression::HuffmanCompressor plain;
+    compression::HuffmanCompressor primed;
+    primed.setDictionary(dictionary);
+
+    for (const auto& message : makeSamples(2000, 20)) {
+        auto compressed = primed.compress(message);
+        EXPECT_EQ(primed.decompress(compressed), message);
+        // Dictionary statistics save the embedded table
+        EXPECT_LT(compressed.size(), plain.compress(message).size());
+    }
+
+    // Data unlike the dictionary falls back to an embedded table
+    std::vector<uint8_t> unrelated(300, 0x07);
+    EXPECT_EQ(primed.decompress(primed.compress(unrelated)), unrelated);
+}
+
+TEST(FileFormatTest, HeaderCarriesDictionaryId) {
+    compression::format::FileHeader header;
+    header.algorithmId = compression::format::AlgorithmID::LZ77_COMPRESSOR;
+    header.originalSize = 1234;
+    header.originalChecksum = 0xDEADBEEF;
+    header.dictionaryId = 0x12345678;
+
+    auto bytes = compression::format::serializeHeader(header);
+    EXPECT_EQ(bytes.size(), compression::format::headerSize(header));
+
+    auto parsed = compression::format::deserializeHeader(bytes);
+    EXPECT_EQ(parsed.formatVersion, compression::format::FORMAT_VERSION);
+    EXPECT_EQ(parsed.dictionaryId, 0x12345678u);
+    EXPECT_EQ(parsed.originalSize, 1234u);
+    EXPECT_EQ(parsed.originalChecksum, 0xDEADBEEFu);
+    EXPECT_EQ(compression::format::headerSize(parsed), bytes.size());
+
+    bytes[compression::format::HEADER_SIZE] |= 0x80; // Unknown flag
+    EXPECT_THROW(compression::format::deserializeHeader(bytes), std::runtime_error);
+}
+
+TEST(FileFormatTest, VersionOneHeadersStillParse) {
+    compression::format::FileHeader header;
+    header.formatVersion = 1;
+    header.algorithmId = compression::format::AlgorithmID::RLE_COMPRESSOR;
+    header.originalSize = 42;
+
+    auto bytes = compression::format::serializeHeader(header);
+    ASSERT_EQ(bytes.size(), compression::format::HEADER_SIZE);
+
+    auto parsed = compression::format::deserializeHeader(bytes);
+    EXPECT_EQ(parsed.formatVersion, 1);
+    EXPECT_EQ(parsed.dictionaryId, 0u);
+    EXPECT_EQ(compression::format::headerSize(parsed), compression::format::HEADER_SIZE);
+}
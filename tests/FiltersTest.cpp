@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <compression/CompressorFactory.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <compression/FileFormat.hpp>
+#include <compression/Filters.hpp>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using compression::format::FilterID;
+using compression::format::FilterSpec;
+using compression::utils::FilterKernel;
+
+namespace {
+
+std::vector<FilterSpec> chain(const std::string& text) {
+    return compression::utils::parseFilterChain(text);
+}
+
+} // anonymous namespace
+
+TEST(FiltersTest, EachFilterHasItsLayout) {
+    std::vector<uint8_t> data = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    EXPECT_EQ(compression::utils::applyFilters(data, chain("delta")),
+              (std::vector<uint8_t>{1, 1, 1, 1, 1, 1, 1, 1, 1}));
+    EXPECT_EQ(compression::utils::applyFilters(data, chain("delta:4")),
+              (std::vector<uint8_t>{1, 2, 3, 4, 4, 4, 4, 4, 4}));
+    // Trailing bytes after the last whole element pass through
+    EXPECT_EQ(compression::utils::applyFilters(data, chain("shuffle:4")),
+              (std::vector<uint8_t>{1, 5, 2, 6, 3, 7, 4, 8, 9}));
+    EXPECT_EQ(compression::utils::applyFilters({0x00, 0x00, 0x80, 0x80}, chain("delta:2")),
+              (std::vector<uint8_t>{0x00, 0x00, 0x80, 0x80}));
+
+    // Bit plane p of 8 bytes is one byte holding bit p of each
+    std::vector<uint8_t> bytes = {0x01, 0x00, 0x01, 0x80, 0x00, 0x00, 0x00, 0x81, 0xFF};
+    EXPECT_EQ(compression::utils::applyFilters(bytes, chain("bitshuffle:1")),
+              (std::vector<uint8_t>{0x85, 0, 0, 0, 0, 0, 0, 0x88, 0xFF}));
+}
+
+TEST(FiltersTest, KernelsAgreeAndEveryChainReverses) {
+    auto metrics = compression::utils::CorpusGenerator().generate(compression::utils::CorpusKind::METRICS, 100003);
+    const char* const chains[] = {"delta", "delta:4", "delta:32", "shuffle:2", "shuffle:4", "shuffle:8",
+                                  "shuffle:3", "shuffle:16", "bitshuffle:1", "bitshuffle:4",
+                                  "bitshuffle:8", "delta:4,shuffle:4", "delta:32,bitshuffle:4"};
+    for (const char* text : chains) {
+        // Sizes around the SIMD steps and the 8-element groups of bit shuffles
+        for (size_t size : {size_t(0), size_t(3), size_t(63), size_t(64), size_t(1000), size_t(4099), metrics.size()}) {
+            std::vector<uint8_t> data(metrics.begin(), metrics.begin() + size);
+            auto expected = compression::utils::applyFilters(data, chain(text), FilterKernel::SCALAR);
+            for (FilterKernel kernel : {FilterKernel::AUTO, FilterKernel::SCALAR, FilterKernel::SSSE3}) {
+                if (!compression::utils::filterKernelSupported(kernel)) {
+                    continue;
+                }
+                auto filtered = compression::utils::applyFilters(data, chain(text), kernel);
+                EXPECT_EQ(filtered, expected) << text << " kernel " << static_cast<int>(kernel) << " x" << size;
+                EXPECT_EQ(compression::utils::reverseFilters(filtered, chain(text), kernel), data)
+                    << text << " kernel " << static_cast<int>(kernel) << " x" << size;
+            }
+        }
+    }
+}
+
+TEST(FiltersTest, DeltaAndShuffleNearlyDoubleTheRatioOnMetrics) {
+    auto metrics = compression::utils::CorpusGenerator().generate(compression::utils::CorpusKind::METRICS, 1 << 20);
+    // Differences to the previous 32-byte sample, then one stream per byte of the sample
+    auto filters = chain("delta:32,shuffle:32");
+    auto filtered = compression::utils::applyFilters(metrics, filters);
+    for (const char* algorithm : {"lz77", "bwt"}) {
+        auto compressor = compression::createCompressor(algorithm);
+        auto compressed = compressor->compress(filtered);
+        EXPECT_LT(compressed.size() * 7, compressor->compress(metrics).size() * 4) << algorithm;
+        EXPECT_EQ(compression::utils::reverseFilters(compressor->decompress(compressed), filters), metrics);
+    }
+}
+
+TEST(FiltersTest, ParsesAndRejectsChains) {
+    EXPECT_EQ(chain("delta"), (std::vector<FilterSpec>{{FilterID::DELTA, 1}}));
+    EXPECT_EQ(chain("delta:8,bitshuffle:4"),
+              (std::vector<FilterSpec>{{FilterID::DELTA, 8}, {FilterID::BITSHUFFLE, 4}}));
+    EXPECT_EQ(compression::utils::filterChainToString(chain("delta,shuffle:2")), "delta:1,shuffle:2");
+
+    for (const char* bad : {"", "delta,", "lzma", "shuffle", "shuffle:1", "delta:0", "delta:256", "delta:x",
+                            "delta:-1", "delta,delta,delta,delta,delta,delta,delta,delta,delta"}) {
+        EXPECT_THROW(chain(bad), std::invalid_argument) << bad;
+    }
+    EXPECT_THROW(compression::utils::applyFilters({1, 2}, {{FilterID::SHUFFLE, 1}}), std::invalid_argument);
+    EXPECT_THROW(compression::utils::reverseFilters({1, 2}, {{static_cast<FilterID>(9), 1}}), std::invalid_argument);
+}
+
+TEST(FileFormatTest, HeaderCarriesFilterChain) {
+    compression::format::FileHeader header;
+    header.algorithmId = compression::format::AlgorithmID::LZ77_COMPRESSOR;
+    header.originalSize = 1000;
+    header.dictionaryId = 7;
+    header.filters = chain("delta:4,shuffle:4");
+
+    auto bytes = compression::format::serializeHeader(header);
+    EXPECT_EQ(bytes.size(), compression::format::HEADER_SIZE + 1 + 4 + 5);
+    auto parsed = compression::format::deserializeHeader(bytes);
+    EXPECT_EQ(parsed.filters, header.filters);
+    EXPECT_EQ(parsed.dictionaryId, 7u);
+    EXPECT_EQ(compression::format::headerSize(parsed), bytes.size());
+
+    // Truncated chains, unknown filters and bad widths are rejected
+    auto truncated = bytes;
+    truncated.pop_back();
+    EXPECT_THROW(compression::format::deserializeHeader(truncated), std::runtime_error);
+    auto unknown = bytes;
+    unknown[bytes.size() - 2] = 0x7F;
+    EXPECT_THROW(compression::format::deserializeHeader(unknown), std::runtime_error);
+    auto zeroWidth = bytes;
+    zeroWidth.back() = 0;
+    EXPECT_THROW(compression::format::deserializeHeader(zeroWidth), std::runtime_error);
+
+    header.filters.assign(compression::format::MAX_FILTERS + 1, {FilterID::DELTA, 1});
+    EXPECT_THROW(compression::format::serializeHeader(header), std::invalid_argument);
+}
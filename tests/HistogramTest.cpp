@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <compression/CorpusGenerator.hpp>
+#include <compression/Histogram.hpp>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+using compression::utils::HistogramKernel;
+
+namespace {
+
+compression::utils::ByteHistogram referenceHistogram(const uint8_t* data, size_t size) {
+    compression::utils::ByteHistogram counts{};
+    for (size_t i = 0; i < size; ++i) {
+        counts[data[i]]++;
+    }
+    return counts;
+}
+
+} // anonymous namespace
+
+TEST(HistogramTest, KernelsMatchReferenceCounts) {
+    compression::utils::CorpusGenerator generator;
+    std::vector<std::vector<uint8_t>> inputs = {
+        generator.generate(compression::utils::CorpusKind::RANDOM, 100003),
+        generator.generate(compression::utils::CorpusKind::LOGS, 65536),
+        std::vector<uint8_t>(5000, 0xAB), // One value: every increment hits one counter
+    };
+
+    for (HistogramKernel kernel : {HistogramKernel::AUTO, HistogramKernel::SCALAR, HistogramKernel::AVX2}) {
+        if (!compression::utils::histogramKernelSupported(kernel)) {
+            continue;
+        }
+        for (const auto& data : inputs) {
+            // Every tail length after the unrolled loops
+            for (size_t size : {size_t(0), size_t(1), size_t(31), size_t(63), size_t(64), size_t(1000), data.size()}) {
+                size = std::min(size, data.size());
+                EXPECT_EQ(compression::utils::byteHistogram(data.data(), size, kernel),
+                          referenceHistogram(data.data(), size))
+                    << "kernel " << static_cast<int>(kernel) << " x" << size;
+            }
+        }
+    }
+}
+
+TEST(HistogramTest, AddsToWideTotals) {
+    std::vector<uint8_t> data = {1, 2, 2, 3, 3, 3};
+    std::array<uint64_t, 256> totals{};
+    totals[3] = 10;
+    compression::utils::addByteHistogram(data.data(), data.size(), totals);
+    EXPECT_EQ(totals[1], 1u);
+    EXPECT_EQ(totals[2], 2u);
+    EXPECT_EQ(totals[3], 13u);
+    EXPECT_EQ(totals[0], 0u);
+
+    EXPECT_TRUE(compression::utils::histogramKernelSupported(HistogramKernel::SCALAR));
+    if (!compression::utils::histogramKernelSupported(HistogramKernel::AVX2)) {
+        EXPECT_THROW(compression::utils::byteHistogram(data.data(), data.size(), HistogramKernel::AVX2),
+                     std::invalid_argument);
+    }
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <compression/HuffmanCoder.hpp>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using compression::FrequencyMap;
+using compression::HuffmanCoder;
+
+namespace {
+
+// Frequencies 1, 1, 2, 3, 5, ... give the deepest possible Huffman tree
+FrequencyMap fibonacciFrequencies(uint32_t symbols) {
+    FrequencyMap freqMap;
+    uint64_t a = 1;
+    uint64_t b = 1;
+    for (uint32_t symbol = 0; symbol < symbols; ++symbol) {
+        freqMap[symbol] = a;
+        uint64_t next = a + b;
+        a = b;
+        b = next;
+    }
+    return freqMap;
+}
+
+// Kraft sum scaled by 2^32; a complete prefix code sums to exactly 2^32
+uint64_t kraftSum(const std::map<uint32_t, uint8_t>& lengths) {
+    uint64_t sum = 0;
+    for (const auto& [symbol, length] : lengths) {
+        sum += uint64_t(1) << (32 - length);
+    }
+    return sum;
+}
+
+uint64_t codedBits(const FrequencyMap& freqMap, const std::map<uint32_t, uint8_t>& lengths) {
+    uint64_t bits = 0;
+    for (const auto& [symbol, frequency] : freqMap) {
+        bits += frequency * lengths.at(symbol);
+    }
+    return bits;
+}
+
+} // anonymous namespace
+
+TEST(HuffmanCoderTest, PackageMergeRespectsTheLimit) {
+    HuffmanCoder coder;
+    FrequencyMap freqMap = fibonacciFrequencies(30);
+    auto unlimited = coder.getCodeLengths(coder.buildHuffmanCodes(freqMap));
+    EXPECT_EQ(unlimited.at(0), 29); // Far beyond any decoding table
+
+    uint64_t previousBits = UINT64_MAX;
+    for (uint8_t limit : {5, 11, 12, 15, 29}) {
+        auto lengths = coder.buildLimitedCodeLengths(freqMap, limit);
+        ASSERT_EQ(lengths.size(), freqMap.size());
+        for (const auto& [symbol, length] : lengths) {
+            EXPECT_GE(length, 1);
+            EXPECT_LE(length, limit);
+        }
+        EXPECT_EQ(kraftSum(lengths), uint64_t(1) << 32) << int(limit);
+        // A looser limit never costs more, and no limit costs what Huffman does
+        uint64_t bits = codedBits(freqMap, lengths);
+        EXPECT_LE(bits, previousBits);
+        previousBits = bits;
+    }
+    EXPECT_EQ(previousBits, codedBits(freqMap, unlimited));
+
+    // Four symbols in 2 bits must all get length 2
+    auto flat = coder.buildLimitedCodeLengths({{'a', 1}, {'b', 1}, {'c', 2}, {'d', 100}}, 2);
+    for (const auto& [symbol, length] : flat) {
+        EXPECT_EQ(length, 2);
+    }
+    EXPECT_EQ(coder.buildLimitedCodeLengths({{7, 42}}, 8), (std::map<uint32_t, uint8_t>{{7, 1}}));
+    EXPECT_TRUE(coder.buildLimitedCodeLengths({}, 8).empty());
+    EXPECT_THROW(coder.buildLimitedCodeLengths(fibonacciFrequencies(9), 3), std::invalid_argument);
+}
+
+TEST(HuffmanCoderTest, InPlaceCodeLengthsAreOptimal) {
+    HuffmanCoder coder;
+    std::mt19937 random(7);
+    for (size_t symbols : {size_t(2), size_t(3), size_t(19), size_t(256), HuffmanCoder::MAX_SYMBOLS}) {
+        // Skewed weights with ties and unused symbols
+        std::vector<uint64_t> frequencies(symbols);
+        FrequencyMap freqMap;
+        for (size_t symbol = 0; symbol < symbols; ++symbol) {
+            if (symbol < 2 || random() % 4 != 0) {
+                frequencies[symbol] = 1 + random() % (1 + symbol * symbol);
+            }
+            if (frequencies[symbol] > 0) {
+                freqMap[static_cast<uint32_t>(symbol)] = frequencies[symbol];
+            }
+        }
+
+        auto lengths = HuffmanCoder::computeCodeLengths(frequencies.data(), symbols);
+        std::map<uint32_t, uint8_t> lengthMap;
+        for (size_t symbol = 0; symbol < symbols; ++symbol) {
+            EXPECT_EQ(lengths[symbol] == 0, frequencies[symbol] == 0) << symbol;
+            if (lengths[symbol] > 0) {
+                lengthMap[static_cast<uint32_t>(symbol)] = lengths[symbol];
+            }
+        }
+        for (size_t symbol = symbols; symbol < HuffmanCoder::MAX_SYMBOLS; ++symbol) {
+            EXPECT_EQ(lengths[symbol], 0);
+        }
+        EXPECT_EQ(kraftSum(lengthMap), uint64_t(1) << 32) << symbols;
+        // No limit that binds means package-merge finds the Huffman cost too
+        EXPECT_EQ(codedBits(freqMap, lengthMap), codedBits(freqMap, coder.buildLimitedCodeLengths(freqMap, 32)))
+            << symbols;
+    }
+
+    // Fibonacci weights build the deepest tree
+    std::vector<uint64_t> fibonacci;
+    for (const auto& [symbol, frequency] : fibonacciFrequencies(30)) {
+        fibonacci.push_back(frequency);
+    }
+    auto deep = HuffmanCoder::computeCodeLengths(fibonacci.data(), fibonacci.size());
+    EXPECT_EQ(deep[0], 29);
+    EXPECT_EQ(deep[29], 1);
+
+    uint64_t lone[] = {0, 0, 5};
+    auto single = HuffmanCoder::computeCodeLengths(lone, 3);
+    EXPECT_EQ(single[2], 1);
+    EXPECT_EQ(single[0], 0);
+    EXPECT_EQ(HuffmanCoder::computeCodeLengths(lone, 0)[0], 0);
+
+    std::vector<uint64_t> tooMany(HuffmanCoder::MAX_SYMBOLS + 1, 1);
+    EXPECT_THROW(HuffmanCoder::computeCodeLengths(tooMany.data(), tooMany.size()), std::invalid_argument);
+}
+
+TEST(HuffmanCoderTest, LimitCodeLengthsKeepsAPrefixCode) {
+    HuffmanCoder coder;
+    auto unlimited = coder.getCodeLengths(coder.buildHuffmanCodes(fibonacciFrequencies(20)));
+    auto limited = coder.limitCodeLengths(unlimited, 8);
+    for (const auto& [symbol, length] : limited) {
+        EXPECT_LE(length, 8);
+    }
+    EXPECT_LE(kraftSum(limited), uint64_t(1) << 32);
+    EXPECT_NO_THROW(coder.buildCanonicalCodes(limited));
+
+    EXPECT_EQ(coder.limitCodeLengths(unlimited, 30), unlimited);
+}
+
+TEST(HuffmanCoderTest, CanonicalCodesFollowDeflate) {
+    // The example of RFC 1951, section 3.2.2
+    HuffmanCoder coder;
+    auto codes = coder.buildCanonicalCodes(
+        {{'A', 3}, {'B', 3}, {'C', 3}, {'D', 3}, {'E', 3}, {'F', 2}, {'G', 4}, {'H', 4}});
+    using Code = compression::HuffmanCode;
+    EXPECT_EQ(codes.at('F'), (Code{0, 0}));
+    EXPECT_EQ(codes.at('A'), (Code{0, 1, 0}));
+    EXPECT_EQ(codes.at('E'), (Code{1, 1, 0}));
+    EXPECT_EQ(codes.at('G'), (Code{1, 1, 1, 0}));
+    EXPECT_EQ(codes.at('H'), (Code{1, 1, 1, 1}));
+
+    EXPECT_THROW(coder.buildCanonicalCodes({{'a', 1}, {'b', 1}, {'c', 1}}), std::invalid_argument);
+}
@@ -1,10 +1,15 @@
 // tests/Lz77CompressorTest.cpp
 #include <gtest/gtest.h>
 #include <compression/Lz77Compressor.hpp>
+#include <compression/CompressionContext.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <compression/Dictionary.hpp>
+#include <compression/ThreadPool.hpp>
 #include <vector>
 #include <string>
 #include <cstdint> // For uint8_t
 #include <stdexcept>
+#include <random>
 
 // Helper function to convert string to vector<uint8_t>
 static std::vector<uint8_t> stringToBytes(const std::string& str) {
@@ -184,6 +189,47 @@ TEST_F(Lz77CompressorTest, DataRequiresMaxLength) {
 }
 
 
+TEST_F(Lz77CompressorTest, MarkerByteRoundTrip) {
+    // 0xFF doubles as the match marker and must survive as a literal
+    std::vector<uint8_t> data;
+    for (int round = 0; round < 4; ++round) {
+        for (int value = 0; value < 256; ++value) {
+            data.push_back(static_cast<uint8_t>(value));
+        }
+        data.insert(data.end(), 5, 0xFF);
+    }
+    EXPECT_EQ(compressor.decompress(compressor.compress(data)), data);
+}
+
+TEST_F(Lz77CompressorTest, LongDistanceMatchBeyondWindow) {
+    // Random blocks have no short-range redundancy, only the far repeat
+    std::mt19937 rng(1234);
+    std::vector<uint8_t> block(256 * 1024);
+    std::vector<uint8_t> filler(128 * 1024);
+    for (auto& byte : block) byte = static_cast<uint8_t>(rng());
+    for (auto& byte : filler) byte = static_cast<uint8_t>(rng());
+
+    std::vector<uint8_t> data = block;
+    data.insert(data.end(), filler.begin(), filler.end());
+    data.insert(data.end(), block.begin(), block.end());
+
+    compression::Lz77Compressor longRange;
+    longRange.setLongDistanceWindow(64 * 1024 * 1024);
+    std::vector<uint8_t> compressed = longRange.compress(data);
+
+    // Any compressor can decode long matches
+    EXPECT_EQ(compressor.decompress(compressed), data);
+    EXPECT_LT(compressed.size(), block.size() + filler.size() + 16 * 1024);
+    EXPECT_GT(compressor.compress(data).size(), data.size() - 1024);
+}
+
+TEST_F(Lz77CompressorTest, LongDistanceWindowIsBounded) {
+    compression::Lz77Compressor longRange;
+    EXPECT_THROW(longRange.setLongDistanceWindow(compression::Lz77Compressor::MAX_LONG_DISTANCE_WINDOW + 1),
+                 std::invalid_argument);
+    EXPECT_NO_THROW(longRange.setLongDistanceWindow(0));
+}
+
 // --- Decompression Error Tests ---
 
 TEST_F(Lz77CompressorTest, DecompressEmpty) {
@@ -285,6 +331,97 @@ TEST_F(Lz77CompressorTest, DecompressInvalidDistanceTooLarge) {
     EXPECT_EQ(decompressed[5], '?');
 }
 
+TEST_F(Lz77CompressorTest, DecompressInvalidLongMatch) {
+    // Long match reaching before the start of the output
+    std::vector<uint8_t> compressed = {'A', 'B', 0xFF, 0x01, 100, 50};
+    EXPECT_THROW(compressor.decompress(compressed), std::runtime_error);
+    // Truncated varint
+    compressed = {'A', 0xFF, 0x01, 0x80};
+    EXPECT_THROW(compressor.decompress(compressed), std::runtime_error);
+}
+
+TEST_F(Lz77CompressorTest, LevelsTradeSpeedForRatio) {
+    std::mt19937 rng(7);
+    std::string text;
+    const char* words[] = {"alpha ", "beta ", "gamma ", "delta ", "epsilon ", "zeta ", "eta\n"};
+    for (int i = 0; i < 20000; ++i) {
+        text += words[rng() % 7];
+    }
+    std::vector<uint8_t> data = stringToBytes(text);
+
+    compression::Lz77Compressor fast;
+    fast.setLevel(compression::Lz77Compressor::MIN_LEVEL);
+    compression::Lz77Compressor best;
+    best.setLevel(compression::Lz77Compressor::MAX_LEVEL);
+    EXPECT_EQ(best.level(), compression::Lz77Compressor::MAX_LEVEL);
+
+    auto fastCompressed = fast.compress(data);
+    auto bestCompressed = best.compress(data);
+    // Every level decodes with a default-configured compressor
+    EXPECT_EQ(compressor.decompress(fastCompressed), data);
+    EXPECT_EQ(compressor.decompress(bestCompressed), data);
+    EXPECT_LE(bestCompressed.size(), fastCompressed.size());
+
+    EXPECT_THROW(fast.setLevel(0), std::invalid_argument);
+    EXPECT_THROW(fast.setLevel(10), std::invalid_argument);
+}
+
+TEST_F(Lz77CompressorTest, ParallelBlocksMatchAcrossBoundaries) {
+    using compression::utils::CorpusKind;
+    auto data = compression::utils::CorpusGenerator().generate(CorpusKind::LOGS, 600000);
+    auto serialCompressed = compressor.compress(data);
+
+    compression::ThreadPool pool(4);
+    compression::Lz77Compressor parallel;
+    parallel.setParallelBlockSize(compression::Lz77Compressor::MIN_PARALLEL_BLOCK_SIZE, &pool);
+    auto parallelCompressed = parallel.compress(data);
+
+    // An ordinary stream: any compressor decodes it
+    EXPECT_EQ(compressor.decompress(parallelCompressed), data);
+    // History from the previous block keeps the ratio close to serial
+    EXPECT_LT(parallelCompressed.size(), serialCompressed.size() * 102 / 100);
+
+    // The output depends on the block size only, not on the threads
+    compression::ThreadPool single(1);
+    compression::Lz77Compressor oneThread;
+    oneThread.setParallelBlockSize(compression::Lz77Compressor::MIN_PARALLEL_BLOCK_SIZE, &single);
+    EXPECT_EQ(oneThread.compress(data), parallelCompressed);
+
+    // Inputs of one block compress serially
+    std::vector<uint8_t> small(data.begin(), data.begin() + 1000);
+    EXPECT_EQ(parallel.compress(small), compressor.compress(small));
+
+    EXPECT_THROW(parallel.setParallelBlockSize(1000), std::invalid_argument);
+    parallel.setParallelBlockSize(0);
+    EXPECT_EQ(parallel.compress(data), serialCompressed);
+}
+
+TEST_F(Lz77CompressorTest, ParallelBlocksKeepDictionaryAndStats) {
+    using compression::utils::CorpusKind;
+    compression::utils::CorpusGenerator generator;
+    auto dictionary = std::make_shared<const compression::Dictionary>(
+        compression::DictionaryTrainer(8192).train({generator.generate(CorpusKind::RECORDS, 50000)}));
+    auto data = generator.generate(CorpusKind::RECORDS, 300000);
+
+    compression::ThreadPool pool(3);
+    compression::Lz77Compressor parallel;
+    parallel.setDictionary(dictionary);
+    parallel.setParallelBlockSize(100000, &pool);
+    compression::Lz77Compressor reader;
+    reader.setDictionary(dictionary);
+    compression::CompressionContext context;
+    context.enableStats();
+    EXPECT_EQ(reader.decompress(parallel.compress(data, context)), data);
+
+    if (const compression::CompressionStats* stats = context.stats()) {
+        EXPECT_EQ(stats->literals + stats->matchedBytes, data.size());
+    }
+    // Only the blocks in flight hold symbols, so large inputs need less memory
+    compression::Lz77Compressor serial;
+    serial.setDictionary(dictionary);
+    EXPECT_LT(parallel.workingSetSize(64 * data.size()), serial.workingSetSize(64 * data.size()));
+}
+
 // TEST_F(Lz77CompressorTest, DecompressInvalidLengthTooSmall) {
 //     // Note: The compressor shouldn't produce lengths < MIN_MATCH_LENGTH for pairs,
 //     // and the decompressor adds MIN_MATCH_LENGTH back, making this check unreachable
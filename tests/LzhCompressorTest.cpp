@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <compression/CompressionContext.hpp>
+#include <compression/CompressorFactory.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <compression/Dictionary.hpp>
+#include <compression/LzhCompressor.hpp>
+#include <compression/ThreadPool.hpp>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using compression::LzhCompressor;
+using compression::utils::CorpusGenerator;
+using compression::utils::CorpusKind;
+
+TEST(LzhCompressorTest, RoundTripsEveryCorpusKindAtEveryLevel) {
+    CorpusGenerator generator;
+    compression::CompressionContext context;
+    for (int level : {LzhCompressor::MIN_LEVEL, LzhCompressor::DEFAULT_LEVEL, LzhCompressor::MAX_LEVEL}) {
+        LzhCompressor lzh;
+        lzh.setLevel(level);
+        for (CorpusKind kind : compression::utils::allCorpusKinds()) {
+            auto data = generator.generate(kind, 200000);
+            EXPECT_EQ(lzh.decompress(lzh.compress(data, context)), data)
+                << level << " " << compression::utils::corpusKindToString(kind);
+        }
+    }
+
+    LzhCompressor lzh;
+    for (size_t size : {0u, 1u, 3u, 4u, 100u}) {
+        std::vector<uint8_t> small(size, 'x');
+        EXPECT_EQ(lzh.decompress(lzh.compress(small)), small) << size;
+    }
+}
+
+TEST(LzhCompressorTest, CodesTheSameParseSmallerThanLz77) {
+    CorpusGenerator generator;
+    auto lz77 = compression::createCompressor("lz77");
+    auto lzh = compression::createCompressor("lzh");
+    for (CorpusKind kind : {CorpusKind::TEXT, CorpusKind::LOGS, CorpusKind::RECORDS, CorpusKind::RUNS}) {
+        auto data = generator.generate(kind, 500000);
+        auto compressed = lzh->compress(data);
+        // The byte format spends at least 4 bytes per match; coded, most are far shorter
+        EXPECT_LT(compressed.size() * 5, lz77->compress(data).size() * 4)
+            << compression::utils::corpusKindToString(kind);
+        EXPECT_EQ(compression::createCompressor(compression::format::AlgorithmID::LZH_COMPRESSOR)
+                      ->decompress(compressed),
+                  data);
+    }
+}
+
+TEST(LzhCompressorTest, KeepsDictionariesLongMatchesAndParallelBlocks) {
+    CorpusGenerator generator;
+    // Train on 1000-byte samples, then compress records past them
+    auto records = generator.generate(CorpusKind::RECORDS, 52000);
+    std::vector<std::vector<uint8_t>> samples;
+    for (size_t start = 0; start < 50000; start += 1000) {
+        samples.emplace_back(records.begin() + start, records.begin() + start + 1000);
+    }
+    auto dictionary = std::make_shared<const compression::Dictionary>(
+        compression::DictionaryTrainer(8192).train(samples));
+    records.erase(records.begin(), records.begin() + 50000);
+    LzhCompressor primed;
+    primed.setDictionary(dictionary);
+    auto compressed = primed.compress(records);
+    EXPECT_LT(compressed.size(), LzhCompressor().compress(records).size());
+    EXPECT_EQ(primed.decompress(compressed), records);
+
+    // Repeats beyond the 32 KB window come back as single long matches
+    auto half = generator.generate(CorpusKind::RANDOM, 300000);
+    std::vector<uint8_t> doubled(half);
+    doubled.insert(doubled.end(), half.begin(), half.end());
+    LzhCompressor longRange;
+    longRange.setLongDistanceWindow(1 << 20);
+    compressed = longRange.compress(doubled);
+    EXPECT_LT(compressed.size(), half.size() + 1000);
+    EXPECT_EQ(LzhCompressor().decompress(compressed), doubled);
+
+    // Parallel blocks are self-delimiting, so their concatenation decodes serially
+    auto text = generator.generate(CorpusKind::TEXT, 500000);
+    compression::ThreadPool pool(3);
+    LzhCompressor parallel;
+    parallel.setParallelBlockSize(LzhCompressor::MIN_PARALLEL_BLOCK_SIZE, &pool);
+    compressed = parallel.compress(text);
+    EXPECT_EQ(LzhCompressor().decompress(compressed), text);
+}
+
+TEST(LzhCompressorTest, RandomDataBarelyGrowsAndBadStreamsThrow) {
+    LzhCompressor lzh;
+    auto random = CorpusGenerator().generate(CorpusKind::RANDOM, 100000);
+    auto compressed = lzh.compress(random);
+    EXPECT_LE(compressed.size(), random.size() + 16);
+    EXPECT_EQ(lzh.decompress(compressed), random);
+
+    auto text = CorpusGenerator().generate(CorpusKind::TEXT, 20000);
+    compressed = lzh.compress(text);
+    auto truncated = compressed;
+    truncated.resize(compressed.size() / 2);
+    EXPECT_THROW(lzh.decompress(truncated), std::runtime_error);
+
+    // A match reaching before the start of the output
+    EXPECT_THROW(lzh.decompress({4, 1, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0x00, 0x00, 0x00}),
+                 std::runtime_error);
+    EXPECT_THROW(lzh.decompress({0, 0}), std::runtime_error);
+    EXPECT_THROW(lzh.decompress({5, 0, 7}), std::runtime_error);
+    // Code lengths that overfill the code space
+    EXPECT_THROW(lzh.decompress({5, 0, 1, 3, 0x11, 0x01, 1, 0, 0, 0, 0, 0, 0, 0}), std::runtime_error);
+}
+
+TEST(LzhCompressorTest, RepeatOffsetsKeepTheLastDistancesInUseOrder) {
+    LzhCompressor::RepeatOffsets repeats;
+    EXPECT_EQ(repeats.find(4), 1u);
+    EXPECT_EQ(repeats.find(100), LzhCompressor::RepeatOffsets::COUNT);
+    repeats.update(100);
+    EXPECT_EQ(repeats.distances, (std::array<uint32_t, 3>{100, 1, 4}));
+    repeats.update(4);
+    EXPECT_EQ(repeats.distances, (std::array<uint32_t, 3>{4, 100, 1}));
+    repeats.update(4);
+    EXPECT_EQ(repeats.distances, (std::array<uint32_t, 3>{4, 100, 1}));
+}
+
+TEST(LzhCompressorTest, FixedWidthRecordsMatchAtRepeatDistances) {
+    // 35-byte rows that differ from the row above in a few bytes
+    std::vector<uint8_t> rows;
+    for (unsigned row = 0; row < 20000; ++row) {
+        std::string line = "id=" + std::to_string(100000 + row) + ";state=ok;zone=" +
+                           std::to_string(row % 7) + ";pad=xxxx\n";
+        rows.insert(rows.end(), line.begin(), line.end());
+    }
+    compression::CompressionContext context;
+    context.enableStats();
+    auto compressed = LzhCompressor().compress(rows, context);
+    EXPECT_EQ(LzhCompressor().decompress(compressed), rows);
+    // A repeat offset costs a few bits, where the byte format spends two bytes
+    EXPECT_LT(compressed.size() * 3, compression::createCompressor("lz77")->compress(rows).size());
+#if COMPRESSION_ENABLE_STATS
+    EXPECT_GT(context.stats()->repeatMatches * 2, context.stats()->matches);
+#endif
+}
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <compression/BwtCompressor.hpp>
+#include <compression/CompressionContext.hpp>
+#include <compression/CompressorFactory.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <compression/PpmCompressor.hpp>
+#include <compression/RangeCoder.hpp>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using compression::PpmCompressor;
+using compression::utils::CorpusGenerator;
+using compression::utils::CorpusKind;
+
+TEST(RangeCoderTest, RoundTripsSymbolsOfAnyFrequency) {
+    struct Coded {
+        uint32_t cumulative, frequency, total;
+    };
+    std::mt19937 random(5);
+    std::vector<Coded> symbols(100000);
+    for (auto& symbol : symbols) {
+        // Totals up to the limit, and slices from a single count to almost all of it
+        symbol.total = 2 + random() % (compression::utils::SYMBOL_RANGE_CODER_MAX_TOTAL - 2);
+        symbol.frequency = random() % 2 ? 1 : 1 + random() % (symbol.total - 1);
+        symbol.cumulative = random() % (symbol.total - symbol.frequency + 1);
+    }
+
+    std::vector<uint8_t> coded;
+    compression::utils::SymbolRangeEncoder encoder(coded);
+    for (const auto& symbol : symbols) {
+        encoder.encode(symbol.cumulative, symbol.frequency, symbol.total);
+    }
+    encoder.flush();
+
+    compression::utils::SymbolRangeDecoder decoder(coded.data(), coded.size());
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        uint32_t value = decoder.frequency(symbols[i].total);
+        ASSERT_GE(value, symbols[i].cumulative) << i;
+        ASSERT_LT(value, symbols[i].cumulative + symbols[i].frequency) << i;
+        decoder.decode(symbols[i].cumulative, symbols[i].frequency);
+    }
+}
+
+TEST(PpmCompressorTest, HigherOrdersUseLongerContexts) {
+    auto text = CorpusGenerator().generate(CorpusKind::TEXT, 300000);
+    size_t order2 = 0;
+    size_t order4 = 0;
+    compression::CompressionContext context;
+    for (unsigned order = PpmCompressor::MIN_ORDER; order <= PpmCompressor::MAX_ORDER; ++order) {
+        PpmCompressor ppm(order);
+        auto compressed = ppm.compress(text, context);
+        // The decoder takes the order from the stream
+        EXPECT_EQ(PpmCompressor().decompress(compressed, context), text) << order;
+        if (order == 2) order2 = compressed.size();
+        if (order == 4) order4 = compressed.size();
+
+        for (size_t size : {1u, 2u, 9u}) {
+            std::vector<uint8_t> small(size, 'x');
+            EXPECT_EQ(ppm.decompress(ppm.compress(small)), small) << order << " x" << size;
+        }
+    }
+    // Words are longer than two bytes
+    EXPECT_LT(order4, order2 * 3 / 5);
+}
+
+TEST(PpmCompressorTest, BeatsBwtOnText) {
+    PpmCompressor ppm;
+    compression::BwtCompressor bwt;
+    CorpusGenerator generator;
+    for (CorpusKind kind : {CorpusKind::TEXT, CorpusKind::LOGS}) {
+        auto data = generator.generate(kind, 500000);
+        auto compressed = ppm.compress(data);
+        EXPECT_LT(compressed.size(), bwt.compress(data).size()) << compression::utils::corpusKindToString(kind);
+        EXPECT_EQ(ppm.decompress(compressed), data);
+    }
+}
+
+TEST(PpmCompressorTest, MemoryLimitCapsTheModel) {
+    auto data = CorpusGenerator().generate(CorpusKind::TEXT, 1500000);
+    PpmCompressor small(PpmCompressor::DEFAULT_ORDER, PpmCompressor::MIN_MEMORY_LIMIT);
+    EXPECT_LE(small.scratchSize(data.size()), PpmCompressor::MIN_MEMORY_LIMIT + 64);
+    // Tiny inputs do not get the whole limit
+    EXPECT_LT(PpmCompressor().scratchSize(1000), size_t(1) << 20);
+
+    // The model restarts whenever the limit is reached; the decoder follows
+    compression::CompressionContext context;
+    auto compressed = small.compress(data, context);
+    EXPECT_LE(context.peakUsage(), small.scratchSize(data.size()));
+    EXPECT_EQ(PpmCompressor().decompress(compressed, context), data);
+    EXPECT_LE(context.peakUsage(), small.scratchSize(data.size()));
+    EXPECT_LT(PpmCompressor().compress(data).size(), compressed.size());
+
+    EXPECT_THROW(PpmCompressor(PpmCompressor::MAX_ORDER + 1), std::invalid_argument);
+    EXPECT_THROW(PpmCompressor(PpmCompressor::DEFAULT_ORDER, PpmCompressor::MIN_MEMORY_LIMIT - 1),
+                 std::invalid_argument);
+    EXPECT_THROW(small.setOrder(1), std::invalid_argument);
+}
+
+TEST(PpmCompressorTest, LearnedEscapesGetCheap) {
+    // Contexts that never escape learn an escape far below method D's one in
+    // twice their count, so each repeat of a block costs a fraction of a byte
+    std::vector<uint8_t> block(1024);
+    std::mt19937 random(1);
+    for (auto& byte : block) {
+        byte = static_cast<uint8_t>(random());
+    }
+    std::vector<uint8_t> repeated;
+    for (int i = 0; i < 1024; ++i) {
+        repeated.insert(repeated.end(), block.begin(), block.end());
+    }
+    PpmCompressor ppm;
+    auto compressed = ppm.compress(repeated);
+    EXPECT_LT(compressed.size(), block.size() + 256);
+    EXPECT_EQ(ppm.decompress(compressed), repeated);
+
+    // Bytes those contexts never saw still escape, down to order -1
+    std::vector<uint8_t> tail(10000);
+    for (auto& byte : tail) {
+        byte = static_cast<uint8_t>(random());
+    }
+    auto data = repeated;
+    data.insert(data.end(), tail.begin(), tail.end());
+    auto withTail = ppm.compress(data);
+    EXPECT_LT(withTail.size(), compressed.size() + tail.size() * 21 / 20);
+    EXPECT_EQ(ppm.decompress(withTail), data);
+}
+
+TEST(PpmCompressorTest, RestartsAtTheMemoryLimit) {
+    auto text = CorpusGenerator().generate(CorpusKind::TEXT, 300000);
+    auto twice = text;
+    twice.insert(twice.end(), text.begin(), text.end());
+
+    // With room to spare the second copy is predicted from the first; at the
+    // smallest limit the model has restarted since, and learns it anew
+    PpmCompressor large;
+    PpmCompressor small(PpmCompressor::DEFAULT_ORDER, PpmCompressor::MIN_MEMORY_LIMIT);
+    EXPECT_LT(large.compress(twice).size(), large.compress(text).size() * 7 / 4);
+    auto compressed = small.compress(twice);
+    EXPECT_GT(compressed.size(), small.compress(text).size() * 19 / 10);
+    EXPECT_EQ(large.decompress(compressed), twice);
+}
+
+TEST(PpmCompressorTest, RejectsBadStreams) {
+    PpmCompressor ppm;
+    // Orders and memory limits outside what a compressor can be configured with
+    EXPECT_THROW(ppm.decompress({0, 1, 1, 16, 0}), std::runtime_error);
+    EXPECT_THROW(ppm.decompress({0, 1, 17, 16, 0}), std::runtime_error);
+    EXPECT_THROW(ppm.decompress({0, 1, 8, 0, 0}), std::runtime_error);
+    EXPECT_THROW(ppm.decompress({0, 1, 8, 0x80, 0x10, 0}), std::runtime_error);
+    // A size no payload of two bytes could hold
+    EXPECT_THROW(ppm.decompress({0, 0xFF, 0xFF, 0xFF, 0x7F, 8, 16, 0, 0}), std::runtime_error);
+    EXPECT_THROW(ppm.decompress({0, 1}), std::runtime_error);
+    EXPECT_THROW(ppm.decompress({0, 0x80}), std::runtime_error);
+
+    auto text = CorpusGenerator().generate(CorpusKind::TEXT, 20000);
+    EXPECT_EQ(compression::createCompressor(compression::format::AlgorithmID::PPM_COMPRESSOR)
+                  ->decompress(compression::createCompressor("ppm")->compress(text)),
+              text);
+}
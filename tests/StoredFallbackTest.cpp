@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <compression/BwtCompressor.hpp>
+#include <compression/CompressionContext.hpp>
+#include <compression/CompressorFactory.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <compression/DataProfile.hpp>
+#include <compression/FileFormat.hpp>
+#include <compression/Lz77Compressor.hpp>
+#include <compression/RleCompressor.hpp>
+#include <compression/StoredFallback.hpp>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using compression::CompressionContext;
+using compression::utils::CorpusGenerator;
+using compression::utils::CorpusKind;
+
+TEST(StoredFallbackTest, ProfileFlagsOnlyRandomData) {
+    CorpusGenerator generator;
+    auto random = generator.generate(CorpusKind::RANDOM, 100000);
+    EXPECT_TRUE(compression::utils::profileData(random.data(), random.size()).likelyIncompressible());
+
+    for (CorpusKind kind : {CorpusKind::LOGS, CorpusKind::RECORDS}) {
+        auto data = generator.generate(kind, 100000);
+        EXPECT_FALSE(compression::utils::profileData(data.data(), data.size()).likelyIncompressible())
+            << compression::utils::corpusKindToString(kind);
+    }
+    EXPECT_FALSE(compression::utils::profileData(nullptr, 0).likelyIncompressible());
+}
+
+TEST(StoredFallbackTest, RandomDataBarelyGrows) {
+    CorpusGenerator generator;
+    for (const std::string name : {"rle", "huffman", "lz77", "bwt"}) {
+        auto compressor = compression::createCompressor(name);
+        for (size_t size : {1u, 300u, 5000u, 250000u}) {
+            auto data = generator.generate(CorpusKind::RANDOM, size);
+            auto compressed = compressor->compress(data);
+            EXPECT_LE(compressed.size(), data.size() + 16) << name << " x" << size;
+            EXPECT_EQ(compressor->decompress(compressed), data) << name << " x" << size;
+        }
+    }
+}
+
+TEST(StoredFallbackTest, Lz77StillCompressesAroundRandomSpans) {
+    CorpusGenerator generator;
+    auto logs = generator.generate(CorpusKind::LOGS, 100000);
+    auto random = generator.generate(CorpusKind::RANDOM, 200000);
+    std::vector<uint8_t> data = logs;
+    data.insert(data.end(), random.begin(), random.end());
+    data.insert(data.end(), logs.begin(), logs.end());
+
+    compression::Lz77Compressor lz77;
+    auto compressed = lz77.compress(data);
+    EXPECT_EQ(lz77.decompress(compressed), data);
+    EXPECT_LT(compressed.size(), random.size() + logs.size());
+
+    // A stored run that claims more bytes than follow is rejected
+    std::vector<uint8_t> truncated = {'a', 0xFF, 0x02, 10, 'b', 'c'};
+    EXPECT_THROW(lz77.decompress(truncated), std::runtime_error);
+}
+
+TEST(StoredFallbackTest, BwtStoresOnlyIncompressibleBlocks) {
+    CorpusGenerator generator;
+    // One random 1 MiB block, then one of logs
+    auto data = generator.generate(CorpusKind::RANDOM, 1024 * 1024);
+    auto logs = generator.generate(CorpusKind::LOGS, 150000);
+    data.insert(data.end(), logs.begin(), logs.end());
+
+    const uint8_t rawBlocksFlag = 0x04; // Header flags byte, bit 2
+    compression::BwtCompressor bwt;
+    auto compressed = bwt.compress(data);
+    EXPECT_NE(compressed[4] & rawBlocksFlag, 0);
+    EXPECT_LT(compressed.size(), 1024 * 1024 + logs.size() / 2);
+    EXPECT_EQ(bwt.decompress(compressed), data);
+
+    // Compressible data keeps the flag clear
+    EXPECT_EQ(bwt.compress(logs)[4] & rawBlocksFlag, 0);
+}
+
+TEST(StoredFallbackTest, RleStoresDataWithoutRuns) {
+    compression::RleCompressor rle;
+    std::vector<uint8_t> data = {1, 2, 3, 4, 5};
+    auto compressed = rle.compress(data);
+    EXPECT_EQ(compressed, (std::vector<uint8_t>{0, 1, 2, 3, 4, 5}));
+    EXPECT_EQ(rle.decompress(compressed), data);
+}
+
+TEST(StoredFallbackTest, ModelingCompressorsStoreWhatTheyCannotShrink) {
+    using compression::utils::STREAM_MODE_MODELED;
+    using compression::utils::STREAM_MODE_STORED;
+    std::vector<uint8_t> data(1000, 'a');
+    auto shrink = [](std::vector<uint8_t>& out) { out.push_back(42); };
+    auto grow = [&](std::vector<uint8_t>& out) { out.insert(out.end(), data.begin(), data.end()); };
+    EXPECT_EQ(compression::utils::modelOrStore(data, nullptr, shrink),
+              (std::vector<uint8_t>{STREAM_MODE_MODELED, 42}));
+    auto stored = compression::utils::modelOrStore(data, nullptr, grow);
+    EXPECT_EQ(stored.size(), data.size() + 1);
+    EXPECT_EQ(stored[0], STREAM_MODE_STORED);
+    EXPECT_TRUE(compression::utils::isStoredStream(stored, "test"));
+    EXPECT_THROW(compression::utils::isStoredStream({7, 1, 2}, "test"), std::runtime_error);
+
+    // Random input is stored without running the model
+    auto random = CorpusGenerator().generate(CorpusKind::RANDOM, 50000);
+    bool modeled = false;
+    compression::utils::modelOrStore(random, nullptr, [&](std::vector<uint8_t>&) { modeled = true; });
+    EXPECT_FALSE(modeled);
+
+    for (const std::string name : {"cm", "ppm"}) {
+        auto compressor = compression::createCompressor(name);
+        auto compressed = compressor->compress(random);
+        EXPECT_EQ(compressed.size(), random.size() + 1) << name;
+        EXPECT_EQ(compressed[0], STREAM_MODE_STORED) << name;
+        EXPECT_EQ(compressor->decompress(compressed), random) << name;
+    }
+}
+
+#if COMPRESSION_ENABLE_STATS
+TEST(StoredFallbackTest, StatsCountStoredBytes) {
+    auto random = CorpusGenerator().generate(CorpusKind::RANDOM, 200000);
+    for (const std::string name : {"huffman", "lz77", "bwt", "cm", "ppm"}) {
+        CompressionContext context;
+        context.enableStats();
+        compression::createCompressor(name)->compress(random, context);
+        EXPECT_EQ(context.stats()->storedBytes, random.size()) << name;
+    }
+}
+#endif
+
+TEST(StoredFallbackTest, HeaderCarriesStoredFlag) {
+    compression::format::FileHeader header;
+    header.algorithmId = compression::format::AlgorithmID::HUFFMAN_COMPRESSOR;
+    header.originalSize = 10;
+    header.flags = compression::format::HEADER_FLAG_STORED;
+
+    auto bytes = compression::format::serializeHeader(header);
+    EXPECT_EQ(bytes.size(), compression::format::headerSize(header));
+    auto parsed = compression::format::deserializeHeader(bytes);
+    EXPECT_EQ(parsed.flags, compression::format::HEADER_FLAG_STORED);
+    EXPECT_EQ(parsed.dictionaryId, 0u);
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+#include <compression/Crc32.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <compression/ThreadPool.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <stdexcept>
+#include <vector>
+
+using compression::ThreadPool;
+
+TEST(ThreadPoolTest, SubmitReturnsResultsAndExceptions) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4u);
+
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 100; ++i) {
+        futures.push_back(pool.submit([i] { return i * i; }));
+    }
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(futures[i].get(), i * i);
+    }
+
+    auto failing = pool.submit([]() -> int { throw std::runtime_error("task failed"); });
+    EXPECT_THROW(failing.get(), std::runtime_error);
+}
+
+TEST(ThreadPoolTest, ParallelForVisitsEachIndexOnce) {
+    ThreadPool pool(3);
+    std::vector<std::atomic<int>> visits(1000);
+    pool.parallelFor(visits.size(), [&](size_t i) { visits[i]++; });
+    for (const auto& count : visits) {
+        EXPECT_EQ(count.load(), 1);
+    }
+
+    pool.parallelFor(0, [](size_t) { FAIL(); });
+
+    EXPECT_THROW(pool.parallelFor(10, [](size_t i) {
+        if (i == 7) throw std::invalid_argument("bad index");
+    }), std::invalid_argument);
+}
+
+TEST(ThreadPoolTest, NestedWaitsDoNotDeadlock) {
+    // Every worker blocks on inner work; waiting runs the inner tasks itself
+    ThreadPool pool(2);
+    std::atomic<int> leaves{0};
+    std::vector<std::future<void>> outer;
+    for (int i = 0; i < 8; ++i) {
+        outer.push_back(pool.submit([&] {
+            pool.parallelFor(16, [&](size_t) { leaves++; });
+            auto inner = pool.submit([&] { leaves++; });
+            pool.wait(inner);
+        }));
+    }
+    for (auto& future : outer) {
+        pool.wait(future);
+    }
+    EXPECT_EQ(leaves.load(), 8 * 17);
+}
+
+#ifdef __linux__
+TEST(ThreadPoolTest, WaitingSleepsWhileNothingIsQueued) {
+    ThreadPool pool(1);
+    auto threadCpuSeconds = [] {
+        timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return time.tv_sec + time.tv_nsec / 1e9;
+    };
+    auto slow = pool.submit([] { std::this_thread::sleep_for(std::chrono::milliseconds(200)); });
+    double start = threadCpuSeconds();
+    pool.wait(slow);
+    pool.parallelFor(2, [](size_t) { std::this_thread::sleep_for(std::chrono::milliseconds(100)); });
+    // A spinning waiter would burn most of the 0.2 s spent waiting
+    EXPECT_LT(threadCpuSeconds() - start, 0.05);
+}
+#endif
+
+TEST(ThreadPoolTest, SharedPoolIsConfiguredOnce) {
+    ThreadPool& shared = ThreadPool::shared();
+    EXPECT_GE(shared.size(), 1u);
+    EXPECT_EQ(&shared, &ThreadPool::shared());
+    EXPECT_THROW(ThreadPool::configureShared(2), std::logic_error);
+
+    ThreadPool pinned(2, true);
+    EXPECT_EQ(pinned.submit([] { return 42; }).get(), 42);
+}
+
+TEST(Crc32Test, CombineMatchesWholeBufferChecksum) {
+    const auto& crc = compression::utils::crc32Calculator;
+    auto data = compression::utils::CorpusGenerator().generate(compression::utils::CorpusKind::LOGS, 100000);
+    uint32_t whole = crc.calculate(data);
+
+    for (size_t split : {0u, 1u, 4096u, 99999u, 100000u}) {
+        uint32_t head = crc.calculate(data.data(), split);
+        uint32_t tail = crc.calculate(data.data() + split, data.size() - split);
+        EXPECT_EQ(compression::utils::Crc32::combine(head, tail, data.size() - split), whole) << split;
+    }
+
+    // Known value: CRC32 of "123456789"
+    const uint8_t digits[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    EXPECT_EQ(crc.calculate(digits, sizeof(digits)), 0xCBF43926u);
+}
+
+TEST(Crc32Test, ParallelChecksumMatchesSerial) {
+    ThreadPool pool(4);
+    const auto& crc = compression::utils::crc32Calculator;
+    auto data = compression::utils::CorpusGenerator().generate(
+        compression::utils::CorpusKind::RANDOM, 3 * compression::utils::Crc32::SEGMENT_SIZE + 12345);
+    EXPECT_EQ(crc.calculate(data.data(), data.size(), pool), crc.calculate(data));
+    EXPECT_EQ(crc.calculate(data.data(), 100, pool), crc.calculate(data.data(), 100));
+}
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include <compression/Varint.hpp>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+using compression::utils::readVarint;
+using compression::utils::writeVarint;
+
+TEST(VarintTest, RoundTripsEveryLength) {
+    std::vector<uint64_t> values = {0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, std::numeric_limits<uint64_t>::max()};
+    for (unsigned bits = 7; bits < 64; bits += 7) {
+        values.push_back((uint64_t(1) << bits) - 1);
+        values.push_back(uint64_t(1) << bits);
+    }
+    std::vector<uint8_t> buffer;
+    for (uint64_t value : values) {
+        size_t before = buffer.size();
+        writeVarint(buffer, value);
+        EXPECT_EQ(buffer.size() - before, compression::utils::varintSize(value)) << value;
+    }
+    EXPECT_EQ(compression::utils::varintSize(std::numeric_limits<uint64_t>::max()),
+              compression::utils::MAX_VARINT_SIZE);
+
+    size_t offset = 0;
+    for (uint64_t value : values) {
+        EXPECT_EQ(readVarint(buffer, offset, "test"), value);
+    }
+    EXPECT_EQ(offset, buffer.size());
+}
+
+TEST(VarintTest, RejectsTruncatedAndOverlongValues) {
+    size_t offset = 0;
+    EXPECT_THROW(readVarint({}, offset, "test"), std::runtime_error);
+    offset = 0;
+    EXPECT_THROW(readVarint({0x80, 0x80}, offset, "test"), std::runtime_error);
+
+    // Bits past the 64th, and an eleventh byte
+    std::vector<uint8_t> tooLarge(9, 0xFF);
+    tooLarge.push_back(0x02);
+    offset = 0;
+    EXPECT_THROW(readVarint(tooLarge, offset, "test"), std::runtime_error);
+    std::vector<uint8_t> tooLong(10, 0x80);
+    tooLong.push_back(0x00);
+    offset = 0;
+    EXPECT_THROW(readVarint(tooLong, offset, "test"), std::runtime_error);
+}
@@ -4,6 +4,9 @@
 #include <compression/RleCompressor.hpp>
 #include <compression/HuffmanCompressor.hpp>
 #include <compression/BwtCompressor.hpp>
+#include <compression/CorpusGenerator.hpp>
+#include <compression/Dictionary.hpp>
+#include <compression/ThreadPool.hpp>
 #include <vector>
 #include <cstdint>
 #include <string>
@@ -118,9 +121,8 @@ TEST_F(RleCompressorTest, SimpleRun) {
 TEST_F(RleCompressorTest, NoRuns) {
     auto data = stringToBytes("ABCDEFG");
     auto compressed = compressor.compress(data);
-    // Expected: 1A 1B 1C 1D 1E 1F 1G
-    EXPECT_EQ(compressed, bytesFromInts({1,'A', 1,'B', 1,'C', 1,'D', 1,'E', 1,'F', 1,'G'}));
-    EXPECT_GT(compressed.size(), data.size()); // RLE made it larger
+    // Pairs would double the size (1A 1B ... 1G), so the data is stored after a zero count
+    EXPECT_EQ(compressed, bytesFromInts({0, 'A', 'B', 'C', 'D', 'E', 'F', 'G'}));
     auto decompressed = compressor.decompress(compressed);
     EXPECT_EQ(decompressed, data);
 }
@@ -160,7 +162,8 @@ TEST_F(RleCompressorTest, DecompressInvalidSize) {
 }
 
 TEST_F(RleCompressorTest, DecompressZeroCount) {
-    auto invalidData = bytesFromInts({0, 'A', 2, 'B'}); // Zero count
+    // Only a leading zero count marks stored data
+    auto invalidData = bytesFromInts({3, 'A', 0, 'B'});
     EXPECT_THROW(compressor.decompress(invalidData), std::runtime_error);
 }
 
@@ -261,8 +264,10 @@ TEST_F(HuffmanCompressorTest, DecompressInvalidData_TooShortForHeader) {
 }
 
 TEST_F(HuffmanCompressorTest, DecompressInvalidData_TruncatedPayload) {
-    // Compress valid data first
-    auto originalData = stringToBytes("some data");
+    // Compress valid data first; long enough that codes beat storing it
+    std::string text;
+    for (int i = 0; i < 10; ++i) text += "some data";
+    auto originalData = stringToBytes(text);
     std::vector<uint8_t> compressed;
     ASSERT_NO_THROW(compressed = compressor.compress(originalData));
     ASSERT_GT(compressed.size(), 10); // Ensure it has some payload
@@ -274,6 +279,115 @@ TEST_F(HuffmanCompressorTest, DecompressInvalidData_TruncatedPayload) {
     EXPECT_THROW(compressor.decompress(truncatedData), std::runtime_error); 
 }
 
+TEST_F(HuffmanCompressorTest, ParallelSegmentsShareOneTable) {
+    using compression::utils::CorpusKind;
+    auto data = compression::utils::CorpusGenerator().generate(CorpusKind::RECORDS, 300000);
+    auto serialCompressed = compressor.compress(data);
+
+    compression::ThreadPool pool(4);
+    compression::HuffmanCompressor parallel;
+    parallel.setParallelBlockSize(compression::HuffmanCompressor::MIN_PARALLEL_BLOCK_SIZE, &pool);
+    auto parallelCompressed = parallel.compress(data);
+
+    // A serial decompressor reads segmented streams too
+    EXPECT_EQ(compressor.decompress(parallelCompressed), data);
+    EXPECT_EQ(parallel.decompress(parallelCompressed), data);
+    // Only the segment lengths and padding are added
+    EXPECT_LT(parallelCompressed.size(), serialCompressed.size() + 32);
+
+    compression::ThreadPool single(1);
+    compression::HuffmanCompressor oneThread;
+    oneThread.setParallelBlockSize(compression::HuffmanCompressor::MIN_PARALLEL_BLOCK_SIZE, &single);
+    EXPECT_EQ(oneThread.compress(data), parallelCompressed);
+
+    // Single-symbol input needs no segments
+    std::vector<uint8_t> zeros(200000, 0);
+    EXPECT_EQ(parallel.decompress(parallel.compress(zeros)), zeros);
+
+    // A segment cut short is rejected
+    auto truncated = parallelCompressed;
+    truncated.pop_back();
+    EXPECT_THROW(parallel.decompress(truncated), std::runtime_error);
+
+    EXPECT_THROW(parallel.setParallelBlockSize(1000), std::invalid_argument);
+}
+
+TEST_F(HuffmanCompressorTest, ParallelSegmentsWithDictionary) {
+    using compression::utils::CorpusKind;
+    compression::utils::CorpusGenerator generator;
+    auto dictionary = std::make_shared<const compression::Dictionary>(
+        compression::DictionaryTrainer(8192).train({generator.generate(CorpusKind::LOGS, 50000)}));
+    auto data = generator.generate(CorpusKind::LOGS, 250000);
+
+    compression::ThreadPool pool(3);
+    compression::HuffmanCompressor parallel;
+    parallel.setDictionary(dictionary);
+    parallel.setParallelBlockSize(100000, &pool);
+    compression::HuffmanCompressor reader;
+    reader.setDictionary(dictionary);
+    EXPECT_EQ(reader.decompress(parallel.compress(data)), data);
+}
+
+TEST_F(HuffmanCompressorTest, LengthLimitedCodes) {
+    // Byte i occurs fib(i) times: a 26-level tree without a limit
+    std::vector<uint8_t> data;
+    uint64_t a = 1;
+    uint64_t b = 1;
+    for (int symbol = 0; symbol < 26; ++symbol) {
+        data.insert(data.end(), a, static_cast<uint8_t>('A' + symbol));
+        uint64_t next = a + b;
+        a = b;
+        b = next;
+    }
+    std::shuffle(data.begin(), data.end(), std::mt19937(42));
+
+    compression::HuffmanCompressor limited;
+    limited.setMaxCodeLength(11);
+    auto compressed = limited.compress(data);
+    EXPECT_EQ(compressed[1], 0x02); // Limited-codes table flag
+    EXPECT_EQ(compressed[3], 11);
+    // The limit travels with the stream
+    EXPECT_EQ(compressor.decompress(compressed), data);
+    // Rarely used symbols pay for the limit; the total barely moves
+    compression::HuffmanCompressor unlimited;
+    unlimited.setMaxCodeLength(compression::HuffmanCompressor::LONGEST_CODE_LENGTH_LIMIT);
+    EXPECT_LT(compressed.size(), unlimited.compress(data).size() * 101 / 100);
+
+    EXPECT_EQ(compressor.maxCodeLength(), compression::HuffmanCompressor::DEFAULT_MAX_CODE_LENGTH);
+    EXPECT_THROW(limited.setMaxCodeLength(7), std::invalid_argument);
+    EXPECT_THROW(limited.setMaxCodeLength(33), std::invalid_argument);
+
+    // Shallow trees keep their codes and format
+    auto text = stringToBytes("this is a test string with several repeated characters");
+    EXPECT_EQ(limited.compress(text), compressor.compress(text));
+}
+
+TEST_F(HuffmanCompressorTest, LengthLimitedDictionaryCodes) {
+    // Fibonacci byte counts make the dictionary's code tree deep
+    std::vector<uint8_t> content;
+    uint64_t a = 1;
+    uint64_t b = 1;
+    for (int symbol = 0; symbol < 24; ++symbol) {
+        content.insert(content.end(), a, static_cast<uint8_t>('a' + symbol));
+        uint64_t next = a + b;
+        a = b;
+        b = next;
+    }
+    auto dictionary = std::make_shared<const compression::Dictionary>(content);
+
+    compression::HuffmanCompressor writer;
+    writer.setDictionary(dictionary);
+    writer.setMaxCodeLength(12);
+    compression::HuffmanCompressor reader;
+    reader.setDictionary(dictionary);
+
+    auto data = stringToBytes("xxwwxxvxxxxwxxxxxxxxxxxxxxwxxxxxxxxxxxxxxxxxuxxxxwxxxxxxvxxxxxxxxxxxxxxxxxxxa");
+    auto compressed = writer.compress(data);
+    EXPECT_EQ(compressed[0], 4); // Dictionary codes, length-limited
+    EXPECT_EQ(compressed[1], 12);
+    EXPECT_EQ(reader.decompress(compressed), data);
+}
+
 // BWT Compressor Tests
 TEST(BwtCompressorTest, EmptyData) {
     compression::BwtCompressor compressor;